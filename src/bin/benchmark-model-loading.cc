@@ -0,0 +1,130 @@
+// bin/benchmark-model-loading.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "util/common-utils.h"
+#include "fstext/kaldi-fst-io.h"
+#include "lm/const-arpa-lm.h"
+
+namespace kaldi {
+
+// Visits every arc of 'fst', which forces all of a memory-mapped FST to be
+// paged in; returns the sum of the arc weights so that the compiler cannot
+// optimize it away.
+double TouchAllArcs(const fst::Fst<fst::StdArc> &fst) {
+  double ans = 0.0;
+  for (fst::StateIterator<fst::Fst<fst::StdArc> > siter(fst);
+       !siter.Done(); siter.Next()) {
+    for (fst::ArcIterator<fst::Fst<fst::StdArc> > aiter(fst, siter.Value());
+         !aiter.Done(); aiter.Next())
+      ans += aiter.Value().weight.Value();
+  }
+  return ans;
+}
+
+void BenchmarkFstLoading(const std::string &fst_rxfilename,
+                         int32 num_repeats) {
+  for (int32 use_mmap = 0; use_mmap <= 1; use_mmap++) {
+    double load_time = 0.0, touch_time = 0.0, weight_sum = 0.0;
+    for (int32 i = 0; i < num_repeats; i++) {
+      Timer timer;
+      fst::Fst<fst::StdArc> *fst = fst::ReadFstKaldiGeneric(
+          fst_rxfilename, true, use_mmap != 0);
+      load_time += timer.Elapsed();
+      timer.Reset();
+      weight_sum = TouchAllArcs(*fst);
+      touch_time += timer.Elapsed();
+      delete fst;
+    }
+    KALDI_LOG << "Loading FST " << fst_rxfilename
+              << (use_mmap ? " with" : " without") << " memory-mapping took "
+              << (load_time / num_repeats) << " seconds on average; visiting "
+              << "all its arcs afterwards took " << (touch_time / num_repeats)
+              << " seconds (sum of weights is " << weight_sum << ").";
+  }
+}
+
+void BenchmarkConstArpaLoading(const std::string &lm_rxfilename,
+                               int32 num_repeats) {
+  for (int32 use_mmap = 0; use_mmap <= 1; use_mmap++) {
+    double load_time = 0.0;
+    for (int32 i = 0; i < num_repeats; i++) {
+      Timer timer;
+      ConstArpaLm const_arpa;
+      if (use_mmap)
+        const_arpa.ReadMapped(lm_rxfilename);
+      else
+        ReadKaldiObject(lm_rxfilename, &const_arpa);
+      load_time += timer.Elapsed();
+    }
+    KALDI_LOG << "Loading ConstArpaLm " << lm_rxfilename
+              << (use_mmap ? " with" : " without") << " memory-mapping took "
+              << (load_time / num_repeats) << " seconds on average.";
+  }
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Measures the time taken to load a decoding graph and/or a const-arpa\n"
+        "language model, with and without memory-mapping (see the --use-mmap\n"
+        "options of the decoding and rescoring programs).  Note: the first\n"
+        "load may be slower because the file is not yet in the OS page cache.\n"
+        "For the FST to be memory-mapped it must be a ConstFst written with\n"
+        "alignment, e.g. by fstconvert --fst_type=const --fst_align=true.\n"
+        "\n"
+        "Usage: benchmark-model-loading [options]\n"
+        "e.g.: benchmark-model-loading --fst=HCLG.fst --const-arpa=G.carpa\n";
+
+    ParseOptions po(usage);
+    std::string fst_rxfilename, lm_rxfilename;
+    int32 num_repeats = 3;
+
+    po.Register("fst", &fst_rxfilename, "Decoding graph to load.");
+    po.Register("const-arpa", &lm_rxfilename,
+                "Language model in const-arpa format to load.");
+    po.Register("num-repeats", &num_repeats,
+                "Number of times to load each model.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 0 ||
+        (fst_rxfilename.empty() && lm_rxfilename.empty())) {
+      po.PrintUsage();
+      exit(1);
+    }
+    KALDI_ASSERT(num_repeats > 0);
+
+    if (!fst_rxfilename.empty())
+      BenchmarkFstLoading(fst_rxfilename, num_repeats);
+    if (!lm_rxfilename.empty())
+      BenchmarkConstArpaLoading(lm_rxfilename, num_repeats);
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,131 @@
+// bin/build-table-index.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/table-index.h"
+#include "hmm/posterior.h"
+#include "lat/kaldi-lattice.h"
+
+namespace kaldi {
+
+// Adds the entries of the archive 'archive_filename' to 'writer', reading its
+// objects as type 'type'.  Returns the number of entries, or -1 on error.
+int64 AddArchiveOfType(const std::string &type,
+                       const std::string &archive_filename,
+                       TableIndexWriter *writer) {
+  if (type == "matrix")
+    return AddArchiveToTableIndex<KaldiObjectHolder<Matrix<BaseFloat> > >(
+        archive_filename, writer);
+  else if (type == "vector")
+    return AddArchiveToTableIndex<KaldiObjectHolder<Vector<BaseFloat> > >(
+        archive_filename, writer);
+  else if (type == "int-vector")
+    return AddArchiveToTableIndex<BasicVectorHolder<int32> >(
+        archive_filename, writer);
+  else if (type == "posterior")
+    return AddArchiveToTableIndex<PosteriorHolder>(archive_filename, writer);
+  else if (type == "lattice")
+    return AddArchiveToTableIndex<LatticeHolder>(archive_filename, writer);
+  else if (type == "compact-lattice")
+    return AddArchiveToTableIndex<CompactLatticeHolder>(archive_filename,
+                                                        writer);
+  KALDI_ERR << "Invalid --type option '" << type << "'";
+  return -1;  // Suppress compiler warning.
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+
+    const char *usage =
+        "Build an index of the keys of one or more archives, which allows\n"
+        "them to be randomly accessed with the rspecifier idx:<index-out>\n"
+        "without reading an scp file into memory (the index is memory-mapped\n"
+        "and searched by binary search).  The inputs may be scp files whose\n"
+        "entries are offsets into archives (as written by the ark,scp:\n"
+        "wspecifier), or archives, which are scanned; in that case --type\n"
+        "must say what type of object the archives contain.  The archives\n"
+        "must be plain files, and must not be modified afterwards.\n"
+        "\n"
+        "Usage: build-table-index [options] <scp-or-ark-rspecifier1> "
+        "[<scp-or-ark-rspecifier2> ...] <index-out>\n"
+        "e.g.: build-table-index scp:data/train/feats.scp "
+        "data/train/feats.idx\n"
+        " or: build-table-index --type=compact-lattice ark:lat.1.ark "
+        "ark:lat.2.ark lat.idx\n"
+        "  lattice-copy 'idx:lat.idx' ark:- ...\n";
+
+    std::string type;
+    ParseOptions po(usage);
+    po.Register("type", &type, "Type of the objects in the archives, needed "
+                "only for ark: inputs: one of matrix, vector, int-vector, "
+                "posterior, lattice, compact-lattice.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string index_wxfilename = po.GetArg(po.NumArgs());
+    TableIndexWriter writer;
+
+    for (int32 i = 1; i < po.NumArgs(); i++) {
+      std::string rspecifier = po.GetArg(i), rxfilename;
+      RspecifierType rs = ClassifyRspecifier(rspecifier, &rxfilename, NULL);
+      if (rs == kScriptRspecifier) {
+        std::vector<std::pair<std::string, std::string> > script;
+        if (!ReadScriptFile(rxfilename, true, &script))
+          KALDI_ERR << "Error reading script file "
+                    << PrintableRxfilename(rxfilename);
+        for (size_t j = 0; j < script.size(); j++)
+          if (!writer.AddScriptEntry(script[j].first, script[j].second))
+            KALDI_ERR << "Error indexing script file "
+                      << PrintableRxfilename(rxfilename);
+        KALDI_LOG << "Indexed " << script.size() << " entries of script file "
+                  << PrintableRxfilename(rxfilename);
+      } else if (rs == kArchiveRspecifier) {
+        if (type.empty())
+          KALDI_ERR << "The --type option is required to index archives.";
+        int64 num_entries = AddArchiveOfType(type, rxfilename, &writer);
+        if (num_entries < 0)
+          KALDI_ERR << "Error indexing archive "
+                    << PrintableRxfilename(rxfilename);
+        KALDI_LOG << "Indexed " << num_entries << " entries of archive "
+                  << PrintableRxfilename(rxfilename);
+      } else {
+        KALDI_ERR << "Expected an scp: or ark: rspecifier, got " << rspecifier;
+      }
+    }
+
+    if (!writer.Write(index_wxfilename))
+      KALDI_ERR << "Error writing table index to "
+                << PrintableWxfilename(index_wxfilename);
+    KALDI_LOG << "Wrote index of " << writer.NumEntries() << " keys to "
+              << PrintableWxfilename(index_wxfilename);
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -37,6 +37,8 @@ int main(int argc, char *argv[]) {
     po.Register("binary", &binary, "Write matrix in binary mode.");
     po.Register("write-full-matrix", &full_matrix_wxfilename,
                 "Write full LDA matrix to this location.");
+    po.Register("matrix-num-threads", &g_matrix_num_threads,
+                "Number of threads to use for large matrix operations.");
     opts.Register(&po);
     po.Read(argc, argv);
 
@@ -50,6 +50,7 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
     TaskSequencerConfig sequencer_config; // has --num-threads option
+    int32 num_determinize_threads = 0;
 
     std::string word_syms_filename;
     config.Register(&po);
@@ -59,6 +60,10 @@ int main(int argc, char *argv[]) {
 
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial, "If true, produce output even if end state was not reached.");
+    po.Register("num-determinize-threads", &num_determinize_threads,
+                "If > 0, the lattices are determinized by this many separate "
+                "threads rather than by the decoding threads, so that the "
+                "decoding does not wait for the determinization.");
 
     po.Read(argc, argv);
 
@@ -101,6 +106,13 @@ int main(int argc, char *argv[]) {
     Fst<StdArc> *decode_fst = NULL; // only used if there is a single
                                     // decoding graph.
 
+    // The determinizer is declared first, so that it is destroyed after the
+    // decoding tasks, which give their lattices to it.
+    TaskSequencerConfig determinizer_config;
+    determinizer_config.num_threads = num_determinize_threads;
+    TaskSequencer<DeterminizeLatticeClass> determinizer(determinizer_config);
+    TaskSequencer<DeterminizeLatticeClass> *determinizer_ptr =
+        (num_determinize_threads > 0 ? &determinizer : NULL);
     TaskSequencer<DecodeUtteranceLatticeFasterClass> sequencer(sequencer_config);
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader loglike_reader(feature_rspecifier);
@@ -129,7 +141,8 @@ int main(int argc, char *argv[]) {
                   decoder, decodable, trans_model, word_syms, utt,
                   acoustic_scale, determinize, allow_partial, &alignment_writer,
                   &words_writer, &compact_lattice_writer, &lattice_writer,
-                  &tot_like, &frame_count, &num_success, &num_fail, NULL);
+                  &tot_like, &frame_count, &num_success, &num_fail, NULL,
+                  determinizer_ptr);
 
           sequencer.Run(task); // takes ownership of "task",
           // and will delete it when done.
@@ -165,12 +178,14 @@ int main(int argc, char *argv[]) {
                 decoder, decodable, trans_model, word_syms, utt, acoustic_scale,
                 determinize, allow_partial, &alignment_writer, &words_writer,
                 &compact_lattice_writer, &lattice_writer, &tot_like,
-                &frame_count, &num_success, &num_fail, NULL);
+                &frame_count, &num_success, &num_fail, NULL,
+                determinizer_ptr);
         sequencer.Run(task); // takes ownership of "task",
         // and will delete it when done.
       }
     }
     sequencer.Wait();
+    determinizer.Wait();
 
     delete decode_fst;
 
@@ -29,6 +29,54 @@
 #include "decoder/decodable-matrix.h"
 #include "base/timer.h"
 
+namespace kaldi {
+
+// Decodes all the utterances in 'loglike_reader' with 'decoder'.  This is
+// templated so that the decoding graph can be either an OpenFst FST or a
+// FlatFst.
+template <typename FST>
+void DecodeAllUtterances(LatticeFasterDecoderTpl<FST> &decoder,
+                         const TransitionModel &trans_model,
+                         const fst::SymbolTable *word_syms,
+                         BaseFloat acoustic_scale,
+                         bool determinize,
+                         bool allow_partial,
+                         SequentialBaseFloatMatrixReader *loglike_reader,
+                         Int32VectorWriter *alignment_writer,
+                         Int32VectorWriter *words_writer,
+                         CompactLatticeWriter *compact_lattice_writer,
+                         LatticeWriter *lattice_writer,
+                         double *tot_like,
+                         int64 *frame_count,
+                         int *num_success,
+                         int *num_fail) {
+  for (; !loglike_reader->Done(); loglike_reader->Next()) {
+    std::string utt = loglike_reader->Key();
+    Matrix<BaseFloat> loglikes (loglike_reader->Value());
+    loglike_reader->FreeCurrent();
+    if (loglikes.NumRows() == 0) {
+      KALDI_WARN << "Zero-length utterance: " << utt;
+      (*num_fail)++;
+      continue;
+    }
+
+    DecodableMatrixScaledMapped decodable(trans_model, loglikes, acoustic_scale);
+
+    double like;
+    if (DecodeUtteranceLatticeFaster(
+            decoder, decodable, trans_model, word_syms, utt,
+            acoustic_scale, determinize, allow_partial, alignment_writer,
+            words_writer, compact_lattice_writer, lattice_writer,
+            &like)) {
+      *tot_like += like;
+      *frame_count += loglikes.NumRows();
+      (*num_success)++;
+    } else (*num_fail)++;
+  }
+}
+
+}  // namespace kaldi
+
 
 int main(int argc, char *argv[]) {
   try {
@@ -42,7 +90,8 @@ int main(int argc, char *argv[]) {
         "Generate lattices, reading log-likelihoods as matrices\n"
         " (model is needed only for the integer mappings in its transition-model)\n"
         "Usage: latgen-faster-mapped [options] trans-model-in (fst-in|fsts-rspecifier) loglikes-rspecifier"
-        " lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n";
+        " lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n"
+        "fst-in may also be a FlatFst, as created by make-flat-fst.\n";
     ParseOptions po(usage);
     Timer timer;
     bool allow_partial = false;
@@ -97,38 +146,30 @@ int main(int argc, char *argv[]) {
 
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader loglike_reader(feature_rspecifier);
-      // Input FST is just one FST, not a table of FSTs.
-      Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      // Input FST is just one FST, not a table of FSTs.  It may be either a
+      // normal FST or a FlatFst (see make-flat-fst).
+      Fst<StdArc> *decode_fst = NULL;
+      fst::FlatFst *flat_fst = fst::ReadDecodingGraph(fst_in_str, &decode_fst);
       timer.Reset();
 
-      {
+      if (flat_fst != NULL) {
+        LatticeFasterDecoderTpl<fst::FlatFst> decoder(*flat_fst, config);
+        DecodeAllUtterances(decoder, trans_model, word_syms, acoustic_scale,
+                            determinize, allow_partial, &loglike_reader,
+                            &alignment_writer, &words_writer,
+                            &compact_lattice_writer, &lattice_writer,
+                            &tot_like, &frame_count, &num_success, &num_fail);
+      } else {
         LatticeFasterDecoder decoder(*decode_fst, config);
-
-        for (; !loglike_reader.Done(); loglike_reader.Next()) {
-          std::string utt = loglike_reader.Key();
-          Matrix<BaseFloat> loglikes (loglike_reader.Value());
-          loglike_reader.FreeCurrent();
-          if (loglikes.NumRows() == 0) {
-            KALDI_WARN << "Zero-length utterance: " << utt;
-            num_fail++;
-            continue;
-          }
-
-          DecodableMatrixScaledMapped decodable(trans_model, loglikes, acoustic_scale);
-
-          double like;
-          if (DecodeUtteranceLatticeFaster(
-                  decoder, decodable, trans_model, word_syms, utt,
-                  acoustic_scale, determinize, allow_partial, &alignment_writer,
-                  &words_writer, &compact_lattice_writer, &lattice_writer,
-                  &like)) {
-            tot_like += like;
-            frame_count += loglikes.NumRows();
-            num_success++;
-          } else num_fail++;
-        }
+        DecodeAllUtterances(decoder, trans_model, word_syms, acoustic_scale,
+                            determinize, allow_partial, &loglike_reader,
+                            &alignment_writer, &words_writer,
+                            &compact_lattice_writer, &lattice_writer,
+                            &tot_like, &frame_count, &num_success, &num_fail);
       }
-      delete decode_fst; // delete this only after decoder goes out of scope.
+      // delete these only after the decoder goes out of scope.
+      delete decode_fst;
+      delete flat_fst;
     } else { // We have different FSTs for different utterances.
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
       RandomAccessBaseFloatMatrixReader loglike_reader(feature_rspecifier);
@@ -0,0 +1,405 @@
+// cudamatrix/cu-cpu-kernels.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KALDI_CPU_KERNELS_SSE2
+#endif
+#include "base/kaldi-math.h"
+#include "cudamatrix/cu-cpu-kernels.h"
+
+namespace kaldi {
+
+// Each of the structs ScalarOps, Sse2Ops, Avx2Ops and Avx512Ops provides the
+// operations we need on a vector of kWidth floats (type V), and on the
+// comparison masks (type M), so that each kernel can be written once as a
+// template.  The semantics of Min() and Max() are those of the SSE
+// instructions: if either argument is NaN, the second one is returned.
+
+struct ScalarOps {
+  typedef float V;
+  typedef bool M;
+  static const int32 kWidth = 1;
+  static inline V Load(const float *p) { return *p; }
+  static inline void Store(float *p, V a) { *p = a; }
+  static inline V Set(float f) { return f; }
+  static inline V Add(V a, V b) { return a + b; }
+  static inline V Sub(V a, V b) { return a - b; }
+  static inline V Mul(V a, V b) { return a * b; }
+  static inline V Div(V a, V b) { return a / b; }
+  static inline V Min(V a, V b) { return a < b ? a : b; }
+  static inline V Max(V a, V b) { return a > b ? a : b; }
+  static inline M Lt(V a, V b) { return a < b; }
+  static inline M Gt(V a, V b) { return a > b; }
+  static inline M Eq(V a, V b) { return a == b; }
+  static inline M IsNan(V a) { return a != a; }
+  static inline V Select(M m, V a, V b) { return m ? a : b; }
+  static inline V Abs(V a) { return std::abs(a); }
+  static inline V Floor(V a) { return std::floor(a); }
+  // Returns 2^n, for integer n in [-126, 127].
+  static inline V Pow2(V n) {
+    int32 i = (static_cast<int32>(n) + 127) << 23;
+    V ans;
+    memcpy(&ans, &i, sizeof(ans));
+    return ans;
+  }
+  // For normalized positive x, returns e and sets *m so that x = m * 2^e,
+  // with 0.5 <= m < 1.
+  static inline V Frexp(V x, V *m) {
+    int32 i;
+    memcpy(&i, &x, sizeof(i));
+    int32 e = ((i >> 23) & 0xff) - 126;
+    i = (i & 0x007fffff) | 0x3f000000;
+    memcpy(m, &i, sizeof(i));
+    return static_cast<V>(e);
+  }
+};
+
+#ifdef KALDI_CPU_KERNELS_SSE2
+struct Sse2Ops {
+  typedef __m128 V;
+  typedef __m128 M;
+  static const int32 kWidth = 4;
+  static inline V Load(const float *p) { return _mm_loadu_ps(p); }
+  static inline void Store(float *p, V a) { _mm_storeu_ps(p, a); }
+  static inline V Set(float f) { return _mm_set1_ps(f); }
+  static inline V Add(V a, V b) { return _mm_add_ps(a, b); }
+  static inline V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static inline V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static inline V Div(V a, V b) { return _mm_div_ps(a, b); }
+  static inline V Min(V a, V b) { return _mm_min_ps(a, b); }
+  static inline V Max(V a, V b) { return _mm_max_ps(a, b); }
+  static inline M Lt(V a, V b) { return _mm_cmplt_ps(a, b); }
+  static inline M Gt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+  static inline M Eq(V a, V b) { return _mm_cmpeq_ps(a, b); }
+  static inline M IsNan(V a) { return _mm_cmpunord_ps(a, a); }
+  static inline V Select(M m, V a, V b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+  }
+  static inline V Abs(V a) {
+    return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+  }
+  // SSE2 has no floor instruction; this is correct for |a| < 2^31.
+  static inline V Floor(V a) {
+    V t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+  }
+  static inline V Pow2(V n) {
+    __m128i i = _mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(i, 23));
+  }
+  static inline V Frexp(V x, V *m) {
+    __m128i i = _mm_castps_si128(x),
+        e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(i, 23),
+                                        _mm_set1_epi32(0xff)),
+                          _mm_set1_epi32(126));
+    i = _mm_or_si128(_mm_and_si128(i, _mm_set1_epi32(0x007fffff)),
+                     _mm_set1_epi32(0x3f000000));
+    *m = _mm_castsi128_ps(i);
+    return _mm_cvtepi32_ps(e);
+  }
+};
+typedef Sse2Ops SimdOps;
+#endif  // KALDI_CPU_KERNELS_SSE2
+
+#if defined(__AVX2__) && !defined(__AVX512F__)
+struct Avx2Ops {
+  typedef __m256 V;
+  typedef __m256 M;
+  static const int32 kWidth = 8;
+  static inline V Load(const float *p) { return _mm256_loadu_ps(p); }
+  static inline void Store(float *p, V a) { _mm256_storeu_ps(p, a); }
+  static inline V Set(float f) { return _mm256_set1_ps(f); }
+  static inline V Add(V a, V b) { return _mm256_add_ps(a, b); }
+  static inline V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static inline V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static inline V Div(V a, V b) { return _mm256_div_ps(a, b); }
+  static inline V Min(V a, V b) { return _mm256_min_ps(a, b); }
+  static inline V Max(V a, V b) { return _mm256_max_ps(a, b); }
+  static inline M Lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static inline M Gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static inline M Eq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static inline M IsNan(V a) { return _mm256_cmp_ps(a, a, _CMP_UNORD_Q); }
+  static inline V Select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+  static inline V Abs(V a) {
+    return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+  }
+  static inline V Floor(V a) { return _mm256_floor_ps(a); }
+  static inline V Pow2(V n) {
+    __m256i i = _mm256_add_epi32(_mm256_cvttps_epi32(n),
+                                 _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(i, 23));
+  }
+  static inline V Frexp(V x, V *m) {
+    __m256i i = _mm256_castps_si256(x),
+        e = _mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(i, 23),
+                                              _mm256_set1_epi32(0xff)),
+                             _mm256_set1_epi32(126));
+    i = _mm256_or_si256(_mm256_and_si256(i, _mm256_set1_epi32(0x007fffff)),
+                        _mm256_set1_epi32(0x3f000000));
+    *m = _mm256_castsi256_ps(i);
+    return _mm256_cvtepi32_ps(e);
+  }
+};
+typedef Avx2Ops SimdOps;
+#endif  // defined(__AVX2__) && !defined(__AVX512F__)
+
+#ifdef __AVX512F__
+struct Avx512Ops {
+  typedef __m512 V;
+  typedef __mmask16 M;
+  static const int32 kWidth = 16;
+  static inline V Load(const float *p) { return _mm512_loadu_ps(p); }
+  static inline void Store(float *p, V a) { _mm512_storeu_ps(p, a); }
+  static inline V Set(float f) { return _mm512_set1_ps(f); }
+  static inline V Add(V a, V b) { return _mm512_add_ps(a, b); }
+  static inline V Sub(V a, V b) { return _mm512_sub_ps(a, b); }
+  static inline V Mul(V a, V b) { return _mm512_mul_ps(a, b); }
+  static inline V Div(V a, V b) { return _mm512_div_ps(a, b); }
+  static inline V Min(V a, V b) { return _mm512_min_ps(a, b); }
+  static inline V Max(V a, V b) { return _mm512_max_ps(a, b); }
+  static inline M Lt(V a, V b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+  }
+  static inline M Gt(V a, V b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+  }
+  static inline M Eq(V a, V b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+  }
+  static inline M IsNan(V a) {
+    return _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q);
+  }
+  static inline V Select(M m, V a, V b) {
+    return _mm512_mask_blend_ps(m, b, a);
+  }
+  static inline V Abs(V a) { return _mm512_abs_ps(a); }
+  static inline V Floor(V a) {
+    return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  }
+  static inline V Pow2(V n) {
+    __m512i i = _mm512_add_epi32(_mm512_cvttps_epi32(n),
+                                 _mm512_set1_epi32(127));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(i, 23));
+  }
+  static inline V Frexp(V x, V *m) {
+    __m512i i = _mm512_castps_si512(x),
+        e = _mm512_sub_epi32(_mm512_and_si512(_mm512_srli_epi32(i, 23),
+                                              _mm512_set1_epi32(0xff)),
+                             _mm512_set1_epi32(126));
+    i = _mm512_or_si512(_mm512_and_si512(i, _mm512_set1_epi32(0x007fffff)),
+                        _mm512_set1_epi32(0x3f000000));
+    *m = _mm512_castsi512_ps(i);
+    return _mm512_cvtepi32_ps(e);
+  }
+};
+typedef Avx512Ops SimdOps;
+#endif  // __AVX512F__
+
+#if !defined(KALDI_CPU_KERNELS_SSE2) && !defined(__AVX2__) && \
+  !defined(__AVX512F__)
+typedef ScalarOps SimdOps;
+#endif
+
+
+// Inputs outside [kExpMin, kExpMax] give 0 or infinity.
+static const float kExpMin = -87.3365448f,  // log(FLT_MIN)
+    kExpMax = 88.7228394f;  // log(FLT_MAX)
+
+template<class Ops>
+struct ExpKernel {
+  typedef typename Ops::V V;
+  static inline V Compute(V x) {
+    // We write exp(x) = 2^n exp(r), with integer n and |r| <= log(2) / 2,
+    // and use a polynomial approximation for exp(r).  Clamping x first makes
+    // sure the integer arithmetic can't overflow.
+    V xc = Ops::Min(Ops::Max(x, Ops::Set(kExpMin)), Ops::Set(kExpMax)),
+        n = Ops::Floor(Ops::Add(Ops::Mul(xc, Ops::Set(1.44269504088896341f)),
+                                Ops::Set(0.5f)));
+    // log(2) is split into two parts, for accuracy.
+    V r = Ops::Sub(Ops::Sub(xc, Ops::Mul(n, Ops::Set(0.693359375f))),
+                   Ops::Mul(n, Ops::Set(-2.12194440e-4f)));
+    V p = Ops::Set(1.9875691500e-4f);
+    p = Ops::Add(Ops::Mul(p, r), Ops::Set(1.3981999507e-3f));
+    p = Ops::Add(Ops::Mul(p, r), Ops::Set(8.3334519073e-3f));
+    p = Ops::Add(Ops::Mul(p, r), Ops::Set(4.1665795894e-2f));
+    p = Ops::Add(Ops::Mul(p, r), Ops::Set(1.6666665459e-1f));
+    p = Ops::Add(Ops::Mul(p, r), Ops::Set(5.0000001201e-1f));
+    V y = Ops::Add(Ops::Add(Ops::Mul(p, Ops::Mul(r, r)), r), Ops::Set(1.0f));
+    // n may be 128 for x close to kExpMax, and 2^128 is not a valid float,
+    // so we do that case as 2^127 * 2.
+    V two_if_128 = Ops::Select(Ops::Gt(n, Ops::Set(127.0f)), Ops::Set(2.0f),
+                               Ops::Set(1.0f));
+    y = Ops::Mul(Ops::Mul(y, Ops::Pow2(Ops::Min(n, Ops::Set(127.0f)))),
+                 two_if_128);
+    y = Ops::Select(Ops::Gt(x, Ops::Set(kExpMax)),
+                    Ops::Set(std::numeric_limits<float>::infinity()), y);
+    y = Ops::Select(Ops::Lt(x, Ops::Set(kExpMin)), Ops::Set(0.0f), y);
+    return Ops::Select(Ops::IsNan(x), x, y);
+  }
+};
+
+template<class Ops>
+struct LogKernel {
+  typedef typename Ops::V V;
+  typedef typename Ops::M M;
+  static inline V Compute(V x) {
+    // Denormals are scaled up by 2^23 so that Frexp() works.
+    M denormal = Ops::Lt(x, Ops::Set(FLT_MIN));
+    V xs = Ops::Select(denormal, Ops::Mul(x, Ops::Set(8388608.0f)), x), m,
+        e = Ops::Frexp(xs, &m);
+    e = Ops::Select(denormal, Ops::Sub(e, Ops::Set(23.0f)), e);
+    // Now x = m * 2^e with 0.5 <= m < 1.  Change this to sqrt(0.5) <= m <
+    // sqrt(2), and set m to m - 1, whose log(1 + m) we approximate with a
+    // polynomial.
+    M below = Ops::Lt(m, Ops::Set(0.707106781186547524f));
+    e = Ops::Select(below, Ops::Sub(e, Ops::Set(1.0f)), e);
+    m = Ops::Sub(Ops::Select(below, Ops::Add(m, m), m), Ops::Set(1.0f));
+    V z = Ops::Mul(m, m);
+    V p = Ops::Set(7.0376836292e-2f);
+    p = Ops::Add(Ops::Mul(p, m), Ops::Set(-1.1514610310e-1f));
+    p = Ops::Add(Ops::Mul(p, m), Ops::Set(1.1676998740e-1f));
+    p = Ops::Add(Ops::Mul(p, m), Ops::Set(-1.2420140846e-1f));
+    p = Ops::Add(Ops::Mul(p, m), Ops::Set(1.4249322787e-1f));
+    p = Ops::Add(Ops::Mul(p, m), Ops::Set(-1.6668057665e-1f));
+    p = Ops::Add(Ops::Mul(p, m), Ops::Set(2.0000714765e-1f));
+    p = Ops::Add(Ops::Mul(p, m), Ops::Set(-2.4999993993e-1f));
+    p = Ops::Add(Ops::Mul(p, m), Ops::Set(3.3333331174e-1f));
+    V y = Ops::Mul(Ops::Mul(p, m), z);
+    // As in ExpKernel, log(2) is split into two parts.
+    y = Ops::Add(y, Ops::Mul(e, Ops::Set(-2.12194440e-4f)));
+    y = Ops::Sub(y, Ops::Mul(z, Ops::Set(0.5f)));
+    y = Ops::Add(Ops::Add(m, y), Ops::Mul(e, Ops::Set(0.693359375f)));
+    y = Ops::Select(Ops::Gt(x, Ops::Set(FLT_MAX)),
+                    Ops::Set(std::numeric_limits<float>::infinity()), y);
+    y = Ops::Select(Ops::Eq(x, Ops::Set(0.0f)),
+                    Ops::Set(-std::numeric_limits<float>::infinity()), y);
+    y = Ops::Select(Ops::Lt(x, Ops::Set(0.0f)),
+                    Ops::Set(std::numeric_limits<float>::quiet_NaN()), y);
+    return Ops::Select(Ops::IsNan(x), x, y);
+  }
+};
+
+template<class Ops>
+struct SigmoidKernel {
+  typedef typename Ops::V V;
+  static inline V Compute(V x) {
+    V e = ExpKernel<Ops>::Compute(Ops::Sub(Ops::Set(0.0f), x));
+    return Ops::Div(Ops::Set(1.0f), Ops::Add(Ops::Set(1.0f), e));
+  }
+};
+
+template<class Ops>
+struct TanhKernel {
+  typedef typename Ops::V V;
+  static inline V Compute(V x) {
+    // This is the rational approximation used by the Eigen library.  It
+    // reaches 1.0 (in float) at |x| = 7.9053, so we clamp there.
+    V xc = Ops::Min(Ops::Max(x, Ops::Set(-7.90531110763549805f)),
+                    Ops::Set(7.90531110763549805f)),
+        z = Ops::Mul(xc, xc), p = Ops::Set(-2.76076847742355e-16f);
+    p = Ops::Add(Ops::Mul(p, z), Ops::Set(2.00018790482477e-13f));
+    p = Ops::Add(Ops::Mul(p, z), Ops::Set(-8.60467152213735e-11f));
+    p = Ops::Add(Ops::Mul(p, z), Ops::Set(5.12229709037114e-08f));
+    p = Ops::Add(Ops::Mul(p, z), Ops::Set(1.48572235717979e-05f));
+    p = Ops::Add(Ops::Mul(p, z), Ops::Set(6.37261928875436e-04f));
+    p = Ops::Add(Ops::Mul(p, z), Ops::Set(4.89352455891786e-03f));
+    p = Ops::Mul(p, xc);
+    V q = Ops::Set(1.19825839466702e-06f);
+    q = Ops::Add(Ops::Mul(q, z), Ops::Set(1.18534705686654e-04f));
+    q = Ops::Add(Ops::Mul(q, z), Ops::Set(2.26843463243900e-03f));
+    q = Ops::Add(Ops::Mul(q, z), Ops::Set(4.89352518554385e-03f));
+    // For very small x, tanh(x) = x in float.
+    V y = Ops::Select(Ops::Lt(Ops::Abs(x), Ops::Set(0.0004f)), x,
+                      Ops::Div(p, q));
+    return Ops::Select(Ops::IsNan(x), x, y);
+  }
+};
+
+// Sets y[i] = Kernel(x[i]) for 0 <= i < dim.
+template<template<class> class Kernel>
+static void ApplyKernel(const float *x, float *y, MatrixIndexT dim) {
+  MatrixIndexT i = 0;
+  for (; i + SimdOps::kWidth <= dim; i += SimdOps::kWidth)
+    SimdOps::Store(y + i, Kernel<SimdOps>::Compute(SimdOps::Load(x + i)));
+  for (; i < dim; i++)
+    y[i] = Kernel<ScalarOps>::Compute(x[i]);
+}
+
+void CpuVecExp(const float *x, float *y, MatrixIndexT dim) {
+  ApplyKernel<ExpKernel>(x, y, dim);
+}
+
+void CpuVecExp(const double *x, double *y, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++)
+    y[i] = Exp(x[i]);
+}
+
+void CpuVecLog(const float *x, float *y, MatrixIndexT dim) {
+  ApplyKernel<LogKernel>(x, y, dim);
+}
+
+void CpuVecLog(const double *x, double *y, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++)
+    y[i] = Log(x[i]);
+}
+
+void CpuVecSigmoid(const float *x, float *y, MatrixIndexT dim) {
+  ApplyKernel<SigmoidKernel>(x, y, dim);
+}
+
+void CpuVecSigmoid(const double *x, double *y, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++) {
+    double a = x[i];
+    // We aim to avoid floating-point overflow here.
+    if (a > 0.0) {
+      y[i] = 1.0 / (1.0 + Exp(-a));
+    } else {
+      double ea = Exp(a);
+      y[i] = ea / (ea + 1.0);
+    }
+  }
+}
+
+void CpuVecTanh(const float *x, float *y, MatrixIndexT dim) {
+  ApplyKernel<TanhKernel>(x, y, dim);
+}
+
+void CpuVecTanh(const double *x, double *y, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++) {
+    double a = x[i];
+    if (a > 0.0) {
+      double inv_expa = Exp(-a);
+      y[i] = -1.0 + 2.0 / (1.0 + inv_expa * inv_expa);
+    } else {
+      double expa = Exp(a);
+      y[i] = 1.0 - 2.0 / (1.0 + expa * expa);
+    }
+  }
+}
+
+}  // namespace kaldi
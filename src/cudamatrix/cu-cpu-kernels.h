@@ -0,0 +1,70 @@
+// cudamatrix/cu-cpu-kernels.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_CUDAMATRIX_CU_CPU_KERNELS_H_
+#define KALDI_CUDAMATRIX_CU_CPU_KERNELS_H_
+
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/**
+   The functions in this file are the element-wise nonlinearities used by
+   CuMatrix and by cu::ComputeLstmNonlinearity() when we are not using a GPU;
+   they are the CPU counterparts of the kernels in cu-kernels.cu.
+
+   For float they use branch-free polynomial approximations (based on the ones
+   in the Cephes library, and for tanh on the one in Eigen) that are evaluated
+   several elements at a time using SIMD instructions.  Which instruction set
+   is used is decided at compile time: AVX-512 if __AVX512F__ is defined, AVX2
+   if __AVX2__ is defined (e.g. compile with -march=native or -mavx2), and
+   otherwise SSE2 on x86 or plain C++ on other machines.  For double, they
+   just call the functions in base/kaldi-math.h.
+
+   The accuracy of the float versions, measured against the exact values (see
+   UnitTestCpuKernelsAccuracy() in cu-math-test.cc), is:
+     - CpuVecExp(): relative error < 5.0e-07.  Results that would be smaller
+       than FLT_MIN (i.e. x < -87.33) are flushed to zero, and x > 88.72 gives
+       infinity.
+     - CpuVecLog(): absolute error < 5.0e-07 * max(1, |log(x)|).  Zero gives
+       -infinity and negative x gives NaN.
+     - CpuVecSigmoid(): absolute error < 2.0e-07, and relative error
+       < 5.0e-07 for x > -87.
+     - CpuVecTanh(): relative error < 5.0e-07.
+   NaN inputs give NaN outputs.
+
+   In all of these, 'x' and 'y' must either be the same or not overlap.
+*/
+
+void CpuVecExp(const float *x, float *y, MatrixIndexT dim);
+void CpuVecExp(const double *x, double *y, MatrixIndexT dim);
+
+void CpuVecLog(const float *x, float *y, MatrixIndexT dim);
+void CpuVecLog(const double *x, double *y, MatrixIndexT dim);
+
+void CpuVecSigmoid(const float *x, float *y, MatrixIndexT dim);
+void CpuVecSigmoid(const double *x, double *y, MatrixIndexT dim);
+
+void CpuVecTanh(const float *x, float *y, MatrixIndexT dim);
+void CpuVecTanh(const double *x, double *y, MatrixIndexT dim);
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_CPU_KERNELS_H_
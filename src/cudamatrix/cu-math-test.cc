@@ -27,6 +27,7 @@
 #include "cudamatrix/cu-matrix-lib.h"
 #include "cudamatrix/cu-math.h"
 #include "cudamatrix/cu-array.h"
+#include "cudamatrix/cu-cpu-kernels.h"
 
 #if defined(_MSC_VER)
 #include <time.h>
@@ -692,6 +693,92 @@ static void UnitTestCuDiffNormalizePerRow() {
 
 
 
+// Checks the accuracy bounds of the float versions of the functions in
+// cu-cpu-kernels.h, which are documented there.
+static void UnitTestCpuKernelsAccuracy() {
+  // The dimension is odd so that we also test the non-SIMD code for the last
+  // few elements.
+  int32 dim = 100003;
+  std::vector<float> x(dim), y(dim);
+  double max_exp_err = 0.0, max_log_err = 0.0, max_sigmoid_err = 0.0,
+      max_sigmoid_rel_err = 0.0, max_tanh_err = 0.0;
+
+  for (int32 i = 0; i < dim; i++)
+    x[i] = RandUniform() * (88.7 + 87.3) - 87.3;
+  CpuVecExp(&(x[0]), &(y[0]), dim);
+  for (int32 i = 0; i < dim; i++) {
+    double ref = std::exp(static_cast<double>(x[i]));
+    max_exp_err = std::max(max_exp_err, std::abs(y[i] - ref) / ref);
+  }
+
+  for (int32 i = 0; i < dim; i++)  // Includes denormals.
+    x[i] = std::pow(10.0, RandUniform() * 82.0 - 44.0);
+  CpuVecLog(&(x[0]), &(y[0]), dim);
+  for (int32 i = 0; i < dim; i++) {
+    double ref = std::log(static_cast<double>(x[i]));
+    max_log_err = std::max(max_log_err,
+                           std::abs(y[i] - ref) / std::max(1.0, std::abs(ref)));
+  }
+
+  for (int32 i = 0; i < dim; i++)
+    x[i] = RandUniform() * 120.0 - 87.0;
+  CpuVecSigmoid(&(x[0]), &(y[0]), dim);
+  for (int32 i = 0; i < dim; i++) {
+    double ref = 1.0 / (1.0 + std::exp(-static_cast<double>(x[i])));
+    max_sigmoid_err = std::max(max_sigmoid_err, std::abs(y[i] - ref));
+    max_sigmoid_rel_err = std::max(max_sigmoid_rel_err,
+                                   std::abs(y[i] - ref) / ref);
+  }
+
+  for (int32 i = 0; i < dim; i++)
+    x[i] = RandGauss() * 3.0;
+  CpuVecTanh(&(x[0]), &(y[0]), dim);
+  for (int32 i = 0; i < dim; i++) {
+    double ref = std::tanh(static_cast<double>(x[i]));
+    if (ref != 0.0)
+      max_tanh_err = std::max(max_tanh_err, std::abs((y[i] - ref) / ref));
+  }
+  KALDI_LOG << "Max errors of CPU kernels: exp " << max_exp_err << ", log "
+            << max_log_err << ", sigmoid " << max_sigmoid_err
+            << " (relative: " << max_sigmoid_rel_err << "), tanh "
+            << max_tanh_err;
+  KALDI_ASSERT(max_exp_err < 5.0e-07 && max_log_err < 5.0e-07 &&
+               max_sigmoid_err < 2.0e-07 && max_sigmoid_rel_err < 5.0e-07 &&
+               max_tanh_err < 5.0e-07);
+
+  // Special values.
+  const float inf = std::numeric_limits<float>::infinity(),
+      nan = std::numeric_limits<float>::quiet_NaN();
+  float special[5] = { 0.0, -1.0, inf, -inf, nan }, out[5];
+  CpuVecExp(special, out, 5);
+  KALDI_ASSERT(out[0] == 1.0 && out[2] == inf && out[3] == 0.0 &&
+               KALDI_ISNAN(out[4]));
+  CpuVecLog(special, out, 5);
+  KALDI_ASSERT(out[0] == -inf && KALDI_ISNAN(out[1]) && out[2] == inf &&
+               KALDI_ISNAN(out[3]) && KALDI_ISNAN(out[4]));
+  CpuVecSigmoid(special, out, 5);
+  KALDI_ASSERT(out[0] == 0.5 && out[2] == 1.0 && out[3] == 0.0 &&
+               KALDI_ISNAN(out[4]));
+  CpuVecTanh(special, out, 5);
+  KALDI_ASSERT(out[0] == 0.0 && out[2] == 1.0 && out[3] == -1.0 &&
+               KALDI_ISNAN(out[4]));
+
+  // Check the LSTM nonlinearity, which uses these functions, against the
+  // double version, which uses the exact functions.
+  int32 num_rows = RandInt(1, 20), cell_dim = RandInt(1, 100);
+  Matrix<float> input(num_rows, 5 * cell_dim), params(3, cell_dim),
+      output(num_rows, 2 * cell_dim);
+  input.SetRandn();
+  input.Scale(3.0);
+  params.SetRandn();
+  cu::CpuComputeLstmNonlinearity(input, params, &output);
+  Matrix<double> input_dbl(input), params_dbl(params),
+      output_dbl(num_rows, 2 * cell_dim);
+  cu::CpuComputeLstmNonlinearity(input_dbl, params_dbl, &output_dbl);
+  Matrix<float> output2(output_dbl);
+  KALDI_ASSERT(output.ApproxEqual(output2, 1.0e-05));
+}
+
 template<typename Real> void CudaMathUnitTest() {
 #if HAVE_CUDA == 1
   if (CuDevice::Instantiate().DoublePrecisionSupported())
@@ -714,6 +801,9 @@ template<typename Real> void CudaMathUnitTest() {
 
 int main() {
   SetVerboseLevel(1);
+  // The CPU kernels do not depend on the device or on Real, so we only need
+  // to test them once.
+  kaldi::UnitTestCpuKernelsAccuracy();
   int32 loop = 0;
 #if HAVE_CUDA == 1
   for (; loop < 2; loop++) {
@@ -23,6 +23,8 @@
 #include "cudamatrix/cu-matrix.h"
 #include "cudamatrix/cu-device.h"
 #include "cudamatrix/cu-kernels.h"
+#include "cudamatrix/cu-cpu-kernels.h"
+#include "matrix/matrix-threading.h"
 
 namespace kaldi {
 
@@ -457,32 +459,45 @@ void CpuComputeLstmNonlinearity(const MatrixBase<Real> &input_mat,
   MatrixBase<Real> &output_mat = *output;
   const Real *params_data = params_mat.Data();
   int32 params_stride = params_mat.Stride();
-  for (int32 r = 0; r < num_rows; r++) {
-    const Real *input_row = input_mat.RowData(r);
-    // i_scale and f_scale relate to dropout, they will normally be 1.0.
-    Real i_scale = (input_cols == cell_dim*5 ? 1.0:input_row[cell_dim*5]),
-         f_scale = (input_cols == cell_dim*5 ? 1.0:input_row[cell_dim*5 + 1]),
-         o_scale = (input_cols == cell_dim*5 ? 1.0:input_row[cell_dim*5 + 2]);
-
-    Real *output_row = output_mat.RowData(r);
-    for (int32 c = 0; c < cell_dim; c++) {
-      Real i_part = input_row[c];
-      Real f_part = input_row[c + cell_dim];
-      Real c_part = input_row[c + 2 * cell_dim];
-      Real o_part = input_row[c + 3 * cell_dim];
-      Real c_prev = input_row[c + 4 * cell_dim];
-      Real w_ic = params_data[c];
-      Real w_fc = params_data[c + params_stride];
-      Real w_oc = params_data[c + params_stride * 2];
-      Real i_t = ScalarSigmoid(i_part + w_ic * c_prev);
-      Real f_t = ScalarSigmoid(f_part + w_fc * c_prev);
-      Real c_t = f_t * f_scale * c_prev + i_t * i_scale * ScalarTanh(c_part);
-      Real o_t = ScalarSigmoid(o_part + w_oc * c_t);
-      Real m_t = o_t * o_scale * ScalarTanh(c_t);
-      output_row[c] = c_t;
-      output_row[c + cell_dim] = m_t;
+  const Real *w_ic = params_data, *w_fc = params_data + params_stride,
+      *w_oc = params_data + 2 * params_stride;
+  // For each row we compute the arguments of the sigmoid and tanh functions
+  // into temporary buffers, so that we can use the vectorized versions from
+  // cu-cpu-kernels.h.
+  MatrixParallelFor(num_rows, 5 * kMatrixTranscendentalCost * cell_dim,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    Vector<Real> buffer(4 * cell_dim, kUndefined);
+    // i_t and f_t are next to each other so we can do them in one call.
+    Real *i_t = buffer.Data(), *f_t = i_t + cell_dim,
+        *tanh_c = i_t + 2 * cell_dim, *o_t = i_t + 3 * cell_dim;
+    for (int32 r = begin; r < end; r++) {
+      const Real *input_row = input_mat.RowData(r);
+      // i_scale and f_scale relate to dropout, they will normally be 1.0.
+      Real i_scale = (input_cols == cell_dim*5 ? 1.0:input_row[cell_dim*5]),
+           f_scale = (input_cols == cell_dim*5 ? 1.0:input_row[cell_dim*5 + 1]),
+           o_scale = (input_cols == cell_dim*5 ? 1.0:input_row[cell_dim*5 + 2]);
+      const Real *i_part = input_row, *f_part = input_row + cell_dim,
+          *c_part = input_row + 2 * cell_dim,
+          *o_part = input_row + 3 * cell_dim,
+          *c_prev = input_row + 4 * cell_dim;
+      Real *c_t = output_mat.RowData(r), *m_t = c_t + cell_dim;
+
+      for (int32 c = 0; c < cell_dim; c++) {
+        i_t[c] = i_part[c] + w_ic[c] * c_prev[c];
+        f_t[c] = f_part[c] + w_fc[c] * c_prev[c];
+      }
+      CpuVecSigmoid(i_t, i_t, 2 * cell_dim);
+      CpuVecTanh(c_part, tanh_c, cell_dim);
+      for (int32 c = 0; c < cell_dim; c++) {
+        c_t[c] = f_t[c] * f_scale * c_prev[c] + i_t[c] * i_scale * tanh_c[c];
+        o_t[c] = o_part[c] + w_oc[c] * c_t[c];
+      }
+      CpuVecSigmoid(o_t, o_t, cell_dim);
+      CpuVecTanh(c_t, m_t, cell_dim);
+      for (int32 c = 0; c < cell_dim; c++)
+        m_t[c] *= o_t[c] * o_scale;
     }
-  }
+  });
 }
 
 template<typename Real>
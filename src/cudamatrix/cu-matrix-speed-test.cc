@@ -32,6 +32,7 @@
 #include "cudamatrix/cu-tp-matrix.h"
 #include "cudamatrix/cu-sp-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
+#include "cudamatrix/cu-cpu-kernels.h"
 
 using namespace kaldi;
 
@@ -424,6 +425,67 @@ template<typename Real> void TestCuMatrixSigmoid(int32 dim) {
             << dim << ", speed was " << gflops << " gigaflops.";
 }
 
+template<typename Real> void TestCuMatrixTanh(int32 dim) {
+  BaseFloat time_in_secs = 0.025;
+  CuMatrix<Real> M(dim, dim), N(dim, dim);
+  M.SetRandn();
+  N.SetRandn();
+  Timer tim;
+  int32 iter = 0;
+  for (;tim.Elapsed() < time_in_secs; iter++) {
+    N.Tanh(M);
+  }
+
+  BaseFloat fdim = dim;
+  BaseFloat gflops = (fdim * fdim * iter) / (tim.Elapsed() * 1.0e+09);
+  KALDI_LOG << "For CuMatrix::Tanh" << NameOf<Real>() << ", for dim = "
+            << dim << ", speed was " << gflops << " gigaflops.";
+}
+
+// Compares the speed of the functions in cu-cpu-kernels.h, which are used by
+// CuMatrix when there is no GPU, with the corresponding functions of
+// MatrixBase.
+template<typename Real> void TestCpuKernels(int32 dim) {
+  BaseFloat time_in_secs = 0.025;
+  Matrix<Real> M(dim, dim), N(dim, dim);
+  M.SetRandn();
+  const char *names[] = { "Exp", "Log", "Sigmoid", "Tanh" };
+  for (int32 f = 0; f < 4; f++) {
+    if (f == 1)
+      M.ApplyPowAbs(1.0);  // for Log.
+    Timer tim;
+    int32 iter = 0;
+    for (; tim.Elapsed() < time_in_secs; iter++) {
+      switch (f) {
+        case 0: N.Exp(M); break;
+        case 1: N.Log(M); break;
+        case 2: N.Sigmoid(M); break;
+        default: N.Tanh(M);
+      }
+    }
+    double matrix_speed = iter / tim.Elapsed();
+    tim.Reset();
+    iter = 0;
+    for (; tim.Elapsed() < time_in_secs; iter++) {
+      for (int32 r = 0; r < dim; r++) {
+        switch (f) {
+          case 0: CpuVecExp(M.RowData(r), N.RowData(r), dim); break;
+          case 1: CpuVecLog(M.RowData(r), N.RowData(r), dim); break;
+          case 2: CpuVecSigmoid(M.RowData(r), N.RowData(r), dim); break;
+          default: CpuVecTanh(M.RowData(r), N.RowData(r), dim);
+        }
+      }
+    }
+    double kernel_speed = iter / tim.Elapsed();
+    BaseFloat fdim = dim;
+    KALDI_LOG << "For CpuVec" << names[f] << NameOf<Real>() << ", for dim = "
+              << dim << ", speed was "
+              << (fdim * fdim * kernel_speed / 1.0e+09)
+              << " gigaflops, speedup vs. MatrixBase::" << names[f]
+              << " was " << (kernel_speed / matrix_speed);
+  }
+}
+
 template<typename Real> void TestCuMatrixHeaviside(int32 dim) {
   BaseFloat time_in_secs = 0.025;
   CuMatrix<Real> M(dim, dim), N(dim, dim);
@@ -1041,6 +1103,10 @@ template<typename Real> void CudaMatrixSpeedTest() {
     TestCuMatrixCholesky<Real>(sizes[s]);
   for (int32 s = 0; s < ns; s++)
     TestCuMatrixSigmoid<Real>(sizes[s]);
+  for (int32 s = 0; s < ns; s++)
+    TestCuMatrixTanh<Real>(sizes[s]);
+  for (int32 s = 0; s < ns; s++)
+    TestCpuKernels<Real>(sizes[s]);
   for (int32 s = 0; s < ns; s++)
     TestCuMatrixHeaviside<Real>(sizes[s]);
   for (int32 s = 0; s < ns; s++)
@@ -36,6 +36,7 @@
 #include "cudamatrix/cu-vector.h"
 #include "cudamatrix/cu-device.h"
 #include "cudamatrix/cu-kernels.h"
+#include "cudamatrix/cu-cpu-kernels.h"
 #include "cudamatrix/cu-array.h"
 #include "cudamatrix/cu-math.h"
 #include "cudamatrix/cu-sp-matrix.h"
@@ -43,9 +44,30 @@
 #include "cudamatrix/cu-block-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
 #include "cudamatrix/cublas-wrappers.h"
+#include "matrix/matrix-threading.h"
 
 namespace kaldi {
 
+// Used in the CPU versions of some element-wise operations: applies 'func',
+// which is one of the functions declared in cu-cpu-kernels.h, to each row of
+// 'src', putting the result in the corresponding row of 'dest'.
+template<typename Real>
+static void CpuApplyRowwise(void (*func)(const Real*, Real*, MatrixIndexT),
+                            const MatrixBase<Real> &src,
+                            MatrixBase<Real> *dest) {
+  MatrixIndexT num_rows = src.NumRows(), num_cols = src.NumCols();
+  if (num_cols == src.Stride() && num_cols == dest->Stride() &&
+      g_matrix_num_threads == 1) {
+    (*func)(src.Data(), dest->Data(), num_rows * num_cols);
+    return;
+  }
+  MatrixParallelFor(num_rows, kMatrixTranscendentalCost * num_cols,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT r = begin; r < end; r++)
+      (*func)(src.RowData(r), dest->RowData(r), num_cols);
+  });
+}
+
 template<typename Real>
 void CuMatrix<Real>::Resize(MatrixIndexT rows, MatrixIndexT cols,
                             MatrixResizeType resize_type,
@@ -1559,7 +1581,7 @@ void CuMatrixBase<Real>::Sigmoid(const CuMatrixBase<Real> &src) {
   } else
   #endif
   {
-    Mat().Sigmoid(src.Mat());
+    CpuApplyRowwise(CpuVecSigmoid, src.Mat(), &Mat());
   }
 }
 
@@ -1811,7 +1833,7 @@ void CuMatrixBase<Real>::Tanh(const CuMatrixBase<Real> &src) {
   } else
 #endif
   {
-    Mat().Tanh(src.Mat());
+    CpuApplyRowwise(CpuVecTanh, src.Mat(), &Mat());
   }
 }
 
@@ -2485,7 +2507,7 @@ void CuMatrixBase<Real>::Exp(const CuMatrixBase<Real> &src) {
   } else
   #endif
   {
-    Mat().Exp(src.Mat());
+    CpuApplyRowwise(CpuVecExp, src.Mat(), &Mat());
   }
 }
 
@@ -2508,7 +2530,7 @@ void CuMatrixBase<Real>::Log(const CuMatrixBase<Real> &src) {
   } else
   #endif
   {
-    Mat().Log(src.Mat());
+    CpuApplyRowwise(CpuVecLog, src.Mat(), &Mat());
   }
 }
 
@@ -0,0 +1,200 @@
+// decoder/decoder-stats-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// The decoder library is normally compiled without -DKALDI_DECODER_STATS, so
+// to test the code that collects the stats we compile the decoder itself into
+// this test with the define.  This program's instantiations of
+// LatticeFasterDecoderTpl are then used instead of the library's.
+#define KALDI_DECODER_STATS
+#include "decoder/lattice-faster-decoder.cc"
+
+#include <sstream>
+#include "decoder/decodable-matrix.h"
+
+namespace kaldi {
+
+// Creates a graph with 'num_pdfs' emitting arcs (one per pdf, with ilabel
+// pdf + 1) from state 0 to state 1, and an epsilon arc from state 1 back to
+// state 0.  State 1 is final.  When decoding with a wide beam, on frame 0
+// there is 1 active token (state 0), and on later frames there are 2
+// (states 0 and 1); on each frame 'num_pdfs' emitting arcs and one
+// nonemitting arc are expanded.
+static void CreateTestFst(int32 num_pdfs, fst::StdVectorFst *fst) {
+  fst->DeleteStates();
+  fst->AddState();
+  fst->AddState();
+  fst->SetStart(0);
+  fst->SetFinal(1, fst::TropicalWeight::One());
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++)
+    fst->AddArc(0, fst::StdArc(pdf + 1, pdf + 1,
+                               fst::TropicalWeight(RandUniform()), 1));
+  fst->AddArc(1, fst::StdArc(0, 0, fst::TropicalWeight::One(), 0));
+}
+
+static void CheckStats(const DecoderStats &stats, const Lattice &lat,
+                       int32 num_frames, int32 num_pdfs) {
+  KALDI_ASSERT(stats.frames.size() == num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    KALDI_ASSERT(stats.frames[t].num_active_tokens == (t == 0 ? 1 : 2));
+    KALDI_ASSERT(stats.frames[t].num_emitting_arcs == num_pdfs);
+    KALDI_ASSERT(stats.frames[t].num_nonemitting_arcs == 1);
+  }
+  KALDI_ASSERT(stats.num_initial_nonemitting_arcs == 0);
+  KALDI_ASSERT(stats.TotalActiveTokens() == 2 * num_frames - 1);
+  KALDI_ASSERT(stats.MaxActiveTokens() == (num_frames > 1 ? 2 : 1));
+  KALDI_ASSERT(stats.TotalEmittingArcs() ==
+               static_cast<int64>(num_frames) * num_pdfs);
+  KALDI_ASSERT(stats.TotalNonemittingArcs() == num_frames);
+  KALDI_ASSERT(stats.num_max_active_cutoffs == 0 &&
+               stats.num_min_active_cutoffs == 0);
+
+  int64 num_arcs = 0;
+  for (int32 s = 0; s < lat.NumStates(); s++)
+    num_arcs += lat.NumArcs(s);
+  KALDI_ASSERT(stats.lattice_num_states == lat.NumStates() &&
+               stats.lattice_num_arcs == num_arcs);
+}
+
+static void CheckJson(const DecoderStats &stats, const std::string &key,
+                      const std::string &escaped_key) {
+  std::ostringstream os;
+  stats.WriteJson(key, os);
+  std::string json = os.str();
+  KALDI_LOG << "JSON output is: " << json;
+  KALDI_ASSERT(json.find('\n') == json.size() - 1);
+
+  std::ostringstream expected_start;
+  expected_start << "{\"key\": \"" << escaped_key << "\", \"num_frames\": "
+                 << stats.frames.size() << ", \"total_active_tokens\": "
+                 << stats.TotalActiveTokens() << ", \"max_active_tokens\": "
+                 << stats.MaxActiveTokens() << ", \"emitting_arcs\": "
+                 << stats.TotalEmittingArcs() << ", \"nonemitting_arcs\": "
+                 << stats.TotalNonemittingArcs() << ", ";
+  KALDI_ASSERT(json.compare(0, expected_start.str().size(),
+                            expected_start.str()) == 0);
+
+  std::ostringstream active_tokens, emitting_arcs, nonemitting_arcs;
+  for (size_t t = 0; t < stats.frames.size(); t++) {
+    active_tokens << (t == 0 ? "" : ", ") << stats.frames[t].num_active_tokens;
+    emitting_arcs << (t == 0 ? "" : ", ") << stats.frames[t].num_emitting_arcs;
+    nonemitting_arcs << (t == 0 ? "" : ", ")
+                     << stats.frames[t].num_nonemitting_arcs;
+  }
+  std::ostringstream expected_end;
+  expected_end << "\"lattice_states\": " << stats.lattice_num_states
+               << ", \"lattice_arcs\": " << stats.lattice_num_arcs
+               << ", \"frame_active_tokens\": [" << active_tokens.str()
+               << "], \"frame_emitting_arcs\": [" << emitting_arcs.str()
+               << "], \"frame_nonemitting_arcs\": [" << nonemitting_arcs.str()
+               << "]}\n";
+  KALDI_ASSERT(json.size() >= expected_end.str().size() &&
+               json.compare(json.size() - expected_end.str().size(),
+                            expected_end.str().size(),
+                            expected_end.str()) == 0);
+}
+
+static void CheckTable(const DecoderStats &stats, const std::string &key,
+                       bool include_frames) {
+  std::ostringstream os;
+  stats.WriteTable(key, include_frames, os);
+  std::istringstream is(os.str());
+  std::string line;
+  KALDI_ASSERT(std::getline(is, line));
+  std::ostringstream expected_start;
+  expected_start << key << " num-frames=" << stats.frames.size()
+                 << " total-active-tokens=" << stats.TotalActiveTokens()
+                 << " max-active-tokens=" << stats.MaxActiveTokens()
+                 << " emitting-arcs=" << stats.TotalEmittingArcs()
+                 << " nonemitting-arcs=" << stats.TotalNonemittingArcs()
+                 << " max-active-cutoffs=0 min-active-cutoffs=0 ";
+  KALDI_ASSERT(line.compare(0, expected_start.str().size(),
+                            expected_start.str()) == 0);
+  std::ostringstream expected_end;
+  expected_end << " lattice-states=" << stats.lattice_num_states
+               << " lattice-arcs=" << stats.lattice_num_arcs;
+  KALDI_ASSERT(line.size() >= expected_end.str().size() &&
+               line.compare(line.size() - expected_end.str().size(),
+                            expected_end.str().size(),
+                            expected_end.str()) == 0);
+
+  size_t num_lines = 0;
+  for (; std::getline(is, line); num_lines++) {
+    std::istringstream line_is(line);
+    std::string this_key;
+    int32 t, active_tokens, emitting_arcs, nonemitting_arcs;
+    line_is >> this_key >> t >> active_tokens >> emitting_arcs
+            >> nonemitting_arcs;
+    KALDI_ASSERT(!line_is.fail() && this_key == key && t == num_lines &&
+                 active_tokens == stats.frames[t].num_active_tokens &&
+                 emitting_arcs == stats.frames[t].num_emitting_arcs &&
+                 nonemitting_arcs == stats.frames[t].num_nonemitting_arcs);
+  }
+  KALDI_ASSERT(num_lines == (include_frames ? stats.frames.size() : 0));
+}
+
+static void UnitTestDecoderStats() {
+  int32 num_pdfs = RandInt(2, 10);
+  fst::StdVectorFst fst;
+  CreateTestFst(num_pdfs, &fst);
+  LatticeFasterDecoderConfig config;
+  config.min_active = 0;  // so that the beam is always used.
+  LatticeFasterDecoder decoder(fst, config);
+
+  // Decode twice, to check that InitDecoding() resets the stats.
+  for (int32 i = 0; i < 2; i++) {
+    int32 num_frames = RandInt(1, 100);
+    Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+    loglikes.SetRandn();
+    DecodableMatrixScaled decodable(loglikes, 1.0);
+    KALDI_ASSERT(decoder.Decode(&decodable));
+    Lattice lat;
+    KALDI_ASSERT(decoder.GetRawLattice(&lat));
+    const DecoderStats &stats = decoder.Stats();
+    CheckStats(stats, lat, num_frames, num_pdfs);
+    // PruneActiveTokens() is called before frames 0, prune_interval, ...
+    KALDI_ASSERT(stats.num_prune_active_tokens ==
+                 (num_frames - 1) / config.prune_interval + 1);
+    CheckJson(stats, "utt1", "utt1");
+    CheckJson(stats, "a\"b\\c\td", "a\\\"b\\\\c\\u0009d");
+    CheckTable(stats, "utt1", false);
+    CheckTable(stats, "utt1", true);
+  }
+
+  // With max-active=1, on the frames with 2 active tokens max-active makes
+  // the cutoff tighter than the beam.
+  config.max_active = 1;
+  LatticeFasterDecoder decoder2(fst, config);
+  int32 num_frames = 20;
+  Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+  loglikes.SetRandn();
+  DecodableMatrixScaled decodable(loglikes, 1.0);
+  decoder2.Decode(&decodable);
+  KALDI_ASSERT(decoder2.Stats().frames.size() == num_frames &&
+               decoder2.Stats().num_max_active_cutoffs > 0);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++)
+    UnitTestDecoderStats();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,139 @@
+// decoder/decoder-stats.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "decoder/decoder-stats.h"
+
+namespace kaldi {
+
+bool DecoderStatsEnabled() {
+#ifdef KALDI_DECODER_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void DecoderStats::Reset() {
+  frames.clear();
+  num_initial_nonemitting_arcs = 0;
+  num_max_active_cutoffs = 0;
+  num_min_active_cutoffs = 0;
+  num_hash_resizes = 0;
+  num_prune_active_tokens = 0;
+  prune_active_tokens_seconds = 0.0;
+  lattice_num_states = 0;
+  lattice_num_arcs = 0;
+}
+
+int64 DecoderStats::TotalActiveTokens() const {
+  int64 ans = 0;
+  for (size_t t = 0; t < frames.size(); t++)
+    ans += frames[t].num_active_tokens;
+  return ans;
+}
+
+int32 DecoderStats::MaxActiveTokens() const {
+  int32 ans = 0;
+  for (size_t t = 0; t < frames.size(); t++)
+    ans = std::max(ans, frames[t].num_active_tokens);
+  return ans;
+}
+
+int64 DecoderStats::TotalEmittingArcs() const {
+  int64 ans = 0;
+  for (size_t t = 0; t < frames.size(); t++)
+    ans += frames[t].num_emitting_arcs;
+  return ans;
+}
+
+int64 DecoderStats::TotalNonemittingArcs() const {
+  int64 ans = num_initial_nonemitting_arcs;
+  for (size_t t = 0; t < frames.size(); t++)
+    ans += frames[t].num_nonemitting_arcs;
+  return ans;
+}
+
+// Writes 's' as a JSON string, with quotes and escapes.
+static void WriteJsonString(const std::string &s, std::ostream &os) {
+  os << '"';
+  for (size_t i = 0; i < s.size(); i++) {
+    char c = s[i];
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      const char *hex = "0123456789abcdef";
+      os << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+void DecoderStats::WriteJson(const std::string &key, std::ostream &os) const {
+  os << "{\"key\": ";
+  WriteJsonString(key, os);
+  os << ", \"num_frames\": " << frames.size()
+     << ", \"total_active_tokens\": " << TotalActiveTokens()
+     << ", \"max_active_tokens\": " << MaxActiveTokens()
+     << ", \"emitting_arcs\": " << TotalEmittingArcs()
+     << ", \"nonemitting_arcs\": " << TotalNonemittingArcs()
+     << ", \"max_active_cutoffs\": " << num_max_active_cutoffs
+     << ", \"min_active_cutoffs\": " << num_min_active_cutoffs
+     << ", \"hash_resizes\": " << num_hash_resizes
+     << ", \"prune_active_tokens_calls\": " << num_prune_active_tokens
+     << ", \"prune_active_tokens_seconds\": " << prune_active_tokens_seconds
+     << ", \"lattice_states\": " << lattice_num_states
+     << ", \"lattice_arcs\": " << lattice_num_arcs;
+  os << ", \"frame_active_tokens\": [";
+  for (size_t t = 0; t < frames.size(); t++)
+    os << (t == 0 ? "" : ", ") << frames[t].num_active_tokens;
+  os << "], \"frame_emitting_arcs\": [";
+  for (size_t t = 0; t < frames.size(); t++)
+    os << (t == 0 ? "" : ", ") << frames[t].num_emitting_arcs;
+  os << "], \"frame_nonemitting_arcs\": [";
+  for (size_t t = 0; t < frames.size(); t++)
+    os << (t == 0 ? "" : ", ") << frames[t].num_nonemitting_arcs;
+  os << "]}\n";
+}
+
+void DecoderStats::WriteTable(const std::string &key, bool include_frames,
+                              std::ostream &os) const {
+  os << key << " num-frames=" << frames.size()
+     << " total-active-tokens=" << TotalActiveTokens()
+     << " max-active-tokens=" << MaxActiveTokens()
+     << " emitting-arcs=" << TotalEmittingArcs()
+     << " nonemitting-arcs=" << TotalNonemittingArcs()
+     << " max-active-cutoffs=" << num_max_active_cutoffs
+     << " min-active-cutoffs=" << num_min_active_cutoffs
+     << " hash-resizes=" << num_hash_resizes
+     << " prune-active-tokens-calls=" << num_prune_active_tokens
+     << " prune-active-tokens-seconds=" << prune_active_tokens_seconds
+     << " lattice-states=" << lattice_num_states
+     << " lattice-arcs=" << lattice_num_arcs << '\n';
+  if (include_frames) {
+    for (size_t t = 0; t < frames.size(); t++)
+      os << key << ' ' << t << ' ' << frames[t].num_active_tokens << ' '
+         << frames[t].num_emitting_arcs << ' '
+         << frames[t].num_nonemitting_arcs << '\n';
+  }
+}
+
+}  // namespace kaldi
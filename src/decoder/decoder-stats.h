@@ -0,0 +1,116 @@
+// decoder/decoder-stats.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_DECODER_STATS_H_
+#define KALDI_DECODER_DECODER_STATS_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/*
+  This header provides instrumentation for the decoders: counters of the work
+  done on each frame and in each utterance, which can be used to tune the
+  beams and max-active against the real-time factor.  Collecting them costs a
+  little time in the inner loops of the decoder, so they are only collected if
+  the decoder library was compiled with -DKALDI_DECODER_STATS (e.g. by adding
+  it to EXTRA_CXXFLAGS in decoder/Makefile); otherwise the code that collects
+  them is compiled out, and the stats stay at zero.  The layout of the
+  classes does not depend on this define, so code compiled with and without
+  it can be linked together.
+*/
+
+#ifdef KALDI_DECODER_STATS
+#define KALDI_DECODER_STATS_EXPR(expr) expr
+#else
+#define KALDI_DECODER_STATS_EXPR(expr)
+#endif
+
+/// Returns true if the decoder library was compiled with
+/// -DKALDI_DECODER_STATS, i.e. if the decoders collect DecoderStats.
+bool DecoderStatsEnabled();
+
+
+/// Counters for a single frame of decoding.
+struct DecoderFrameStats {
+  /// The number of tokens active before the emitting arcs were processed.
+  int32 num_active_tokens;
+  /// The number of emitting arcs expanded (from tokens within the cutoff).
+  int32 num_emitting_arcs;
+  /// The number of nonemitting arcs expanded.
+  int32 num_nonemitting_arcs;
+
+  explicit DecoderFrameStats(int32 num_active_tokens = 0):
+      num_active_tokens(num_active_tokens), num_emitting_arcs(0),
+      num_nonemitting_arcs(0) { }
+};
+
+
+/// Counters for one utterance of decoding; see LatticeFasterDecoderTpl::Stats().
+struct DecoderStats {
+  /// Per-frame counters, indexed by frame.
+  std::vector<DecoderFrameStats> frames;
+  /// Nonemitting arcs expanded before the first frame.
+  int64 num_initial_nonemitting_arcs;
+  /// Number of frames on which max-active made the cutoff tighter than the
+  /// beam.
+  int32 num_max_active_cutoffs;
+  /// Number of frames on which min-active made the cutoff looser than the
+  /// beam.
+  int32 num_min_active_cutoffs;
+  /// Number of times the hash of active tokens was resized.
+  int32 num_hash_resizes;
+  /// Number of calls to PruneActiveTokens(), and the time they took.
+  int32 num_prune_active_tokens;
+  double prune_active_tokens_seconds;
+  /// The size of the raw lattice last output by the decoder.
+  int64 lattice_num_states;
+  int64 lattice_num_arcs;
+
+  DecoderStats() { Reset(); }
+
+  /// Sets all the counters to zero; the decoders call this at the start of
+  /// each utterance.
+  void Reset();
+
+  int64 TotalActiveTokens() const;
+  int32 MaxActiveTokens() const;
+  int64 TotalEmittingArcs() const;
+  int64 TotalNonemittingArcs() const;
+
+  /// Writes the stats for the utterance 'key' as a single-line JSON object,
+  /// with the per-frame counters as arrays.
+  void WriteJson(const std::string &key, std::ostream &os) const;
+
+  /// Writes the stats for the utterance 'key' in a text table format: one
+  /// line "<key> name1=value1 name2=value2 ..." with the per-utterance
+  /// counters, followed, if include_frames is true, by one line
+  /// "<key> <frame> <active-tokens> <emitting-arcs> <nonemitting-arcs>" per
+  /// frame.
+  void WriteTable(const std::string &key, bool include_frames,
+                  std::ostream &os) const;
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_DECODER_STATS_H_
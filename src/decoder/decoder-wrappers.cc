@@ -46,7 +46,8 @@ DecodeUtteranceLatticeFasterClass::DecodeUtteranceLatticeFasterClass(
     int64 *frame_sum, // on success, adds #frames to this.
     int32 *num_done, // on success (including partial decode), increments this.
     int32 *num_err,  // on failure, increments this.
-    int32 *num_partial):  // If partial decode (final-state not reached), increments this.
+    int32 *num_partial,  // If partial decode (final-state not reached), increments this.
+    TaskSequencer<DeterminizeLatticeClass> *determinizer):
     decoder_(decoder), decodable_(decodable), trans_model_(&trans_model),
     word_syms_(word_syms), utt_(utt), acoustic_scale_(acoustic_scale),
     determinize_(determinize), allow_partial_(allow_partial),
@@ -56,7 +57,7 @@ DecodeUtteranceLatticeFasterClass::DecodeUtteranceLatticeFasterClass(
     lattice_writer_(lattice_writer),
     like_sum_(like_sum), frame_sum_(frame_sum),
     num_done_(num_done), num_err_(num_err),
-    num_partial_(num_partial),
+    num_partial_(num_partial), determinizer_(determinizer),
     computed_(false), success_(false), partial_(false),
     clat_(NULL), lat_(NULL) { }
 
@@ -91,7 +92,10 @@ void DecodeUtteranceLatticeFasterClass::operator () () {
   if (lat_->NumStates() == 0)
     KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt_;
   fst::Connect(lat_);
-  if (determinize_) {
+  if (determinize_ && determinizer_ != NULL) {
+    // The determinization (and the removal of the acoustic scale) will be
+    // done by a DeterminizeLatticeClass object; see the destructor.
+  } else if (determinize_) {
     clat_ = new CompactLattice;
     if (!DeterminizeLatticePhonePrunedWrapper(
             *trans_model_,
@@ -156,7 +160,16 @@ DecodeUtteranceLatticeFasterClass::~DecodeUtteranceLatticeFasterClass() {
     }
 
     // Ouptut the lattices.
-    if (determinize_) { // CompactLattice output.
+    if (determinize_ && determinizer_ != NULL) {
+      KALDI_ASSERT(compact_lattice_writer_ != NULL && lat_ != NULL);
+      // This will block until a determinization thread is free.  The
+      // DeterminizeLatticeClass object takes ownership of lat_.
+      determinizer_->Run(new DeterminizeLatticeClass(
+          *trans_model_, utt_, acoustic_scale_,
+          decoder_->GetOptions().lattice_beam, decoder_->GetOptions().det_opts,
+          lat_, compact_lattice_writer_));
+      lat_ = NULL;
+    } else if (determinize_) { // CompactLattice output.
       KALDI_ASSERT(compact_lattice_writer_ != NULL && clat_ != NULL);
       if (clat_->NumStates() == 0) {
         KALDI_WARN << "Empty lattice for utterance " << utt_;
@@ -195,6 +208,41 @@ DecodeUtteranceLatticeFasterClass::~DecodeUtteranceLatticeFasterClass() {
   delete decodable_;
 }
 
+
+DeterminizeLatticeClass::DeterminizeLatticeClass(
+    const TransitionModel &trans_model,
+    const std::string &utt,
+    BaseFloat acoustic_scale,
+    BaseFloat lattice_beam,
+    const fst::DeterminizeLatticePhonePrunedOptions &det_opts,
+    Lattice *lat,
+    CompactLatticeWriter *compact_lattice_writer):
+    trans_model_(&trans_model), utt_(utt), acoustic_scale_(acoustic_scale),
+    lattice_beam_(lattice_beam), det_opts_(det_opts), lat_(lat),
+    compact_lattice_writer_(compact_lattice_writer) { }
+
+void DeterminizeLatticeClass::operator () () {
+  if (!DeterminizeLatticePhonePrunedWrapper(*trans_model_, lat_,
+                                            lattice_beam_, &clat_,
+                                            det_opts_))
+    KALDI_WARN << "Determinization finished earlier than the beam for "
+               << "utterance " << utt_;
+  delete lat_;
+  lat_ = NULL;
+  // We'll write the lattice without acoustic scaling.
+  if (acoustic_scale_ != 0.0)
+    fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale_), &clat_);
+}
+
+DeterminizeLatticeClass::~DeterminizeLatticeClass() {
+  delete lat_;  // in case operator () was not called.
+  if (clat_.NumStates() == 0) {
+    KALDI_WARN << "Empty lattice for utterance " << utt_;
+  } else {
+    compact_lattice_writer_->Write(utt_, clat_);
+  }
+}
+
 template <typename FST>
 bool DecodeUtteranceLatticeIncremental(
     LatticeIncrementalDecoderTpl<FST> &decoder, // not const but is really an input.
@@ -442,6 +490,21 @@ template bool DecodeUtteranceLatticeFaster(
     LatticeWriter *lattice_writer,
     double *like_ptr);
 
+template bool DecodeUtteranceLatticeFaster(
+    LatticeFasterDecoderTpl<fst::FlatFst> &decoder,
+    DecodableInterface &decodable,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    bool determinize,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *like_ptr);
+
 
 // Takes care of output.  Returns true on success.
 bool DecodeUtteranceLatticeSimple(
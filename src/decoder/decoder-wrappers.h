@@ -24,6 +24,7 @@
 #include "decoder/lattice-faster-decoder.h"
 #include "decoder/lattice-incremental-decoder.h"
 #include "decoder/lattice-simple-decoder.h"
+#include "util/kaldi-thread.h"
 
 // This header contains declarations from various convenience functions that are called
 // from binary-level programs such as gmm-decode-faster.cc, gmm-align-compiled.cc, and
@@ -114,9 +115,9 @@ bool DecodeUtteranceLatticeIncremental(
 /// lattice_writer, else to compact_lattice_writer.  The writers for
 /// alignments and words will only be written to if they are open.
 ///
-/// Caution: this will only link correctly if FST is either fst::Fst<fst::StdArc>,
-/// or fst::GrammarFst, as the template function is defined in the .cc file and
-/// only instantiated for those two types.
+/// Caution: this will only link correctly if FST is fst::Fst<fst::StdArc>,
+/// fst::ConstGrammarFst or fst::FlatFst, as the template function is defined in
+/// the .cc file and only instantiated for those types.
 template <typename FST>
 bool DecodeUtteranceLatticeFaster(
     LatticeFasterDecoderTpl<FST> &decoder, // not const but is really an input.
@@ -134,11 +135,54 @@ bool DecodeUtteranceLatticeFaster(
     double *like_ptr);  // puts utterance's likelihood in like_ptr on success.
 
 
+/// This class does the lattice determinization for
+/// DecodeUtteranceLatticeFasterClass, when that class is given a
+/// TaskSequencer of these objects; this moves the determinization, which can
+/// take a long time for long utterances, off the decoding threads.  The
+/// determinization takes place in operator (), and the lattice is written in
+/// the destructor.  Since TaskSequencer calls the destructors in order, the
+/// lattices are written in the order in which the utterances were decoded.
+class DeterminizeLatticeClass {
+ public:
+  // Initializer sets various variables.  NOTE: we "take ownership" of "lat",
+  // which should be the raw lattice from the decoder, with the acoustic
+  // scale still applied.  The lattice is written to compact_lattice_writer
+  // with the acoustic scale removed.
+  DeterminizeLatticeClass(
+      const TransitionModel &trans_model,
+      const std::string &utt,
+      BaseFloat acoustic_scale,
+      BaseFloat lattice_beam,
+      const fst::DeterminizeLatticePhonePrunedOptions &det_opts,
+      Lattice *lat,
+      CompactLatticeWriter *compact_lattice_writer);
+  void operator () (); // The determinization happens here.
+  ~DeterminizeLatticeClass(); // Output happens here.
+ private:
+  const TransitionModel *trans_model_;
+  std::string utt_;
+  BaseFloat acoustic_scale_;
+  BaseFloat lattice_beam_;
+  fst::DeterminizeLatticePhonePrunedOptions det_opts_;
+  Lattice *lat_;  // The input; deleted in operator ().
+  CompactLatticeWriter *compact_lattice_writer_;
+  CompactLattice clat_;  // The output.
+};
+
 /// This class basically does the same job as the function
 /// DecodeUtteranceLatticeFaster, but in a way that allows us
 /// to build a multi-threaded command line program more easily.
 /// The main computation takes place in operator (), and the output
 /// happens in the destructor.
+///
+/// If determinize == true and "determinizer" is non-NULL, the determinization
+/// is not done in operator () but by a DeterminizeLatticeClass object that
+/// the destructor gives to "determinizer", so that the decoding thread does
+/// not wait for it.  The calling code must make sure that "determinizer" is
+/// not destroyed, or waited for, before all the decoding tasks have been
+/// destroyed; and since the destructor blocks while all the determinization
+/// threads are busy, the decoding cannot get too far ahead of the
+/// determinization.
 class DecodeUtteranceLatticeFasterClass {
  public:
   // Initializer sets various variables.
@@ -161,7 +205,8 @@ class DecodeUtteranceLatticeFasterClass {
       int64 *frame_sum, // on success, adds #frames to this.
       int32 *num_done, // on success (including partial decode), increments this.
       int32 *num_err,  // on failure, increments this.
-      int32 *num_partial);  // If partial decode (final-state not reached), increments this.
+      int32 *num_partial,  // If partial decode (final-state not reached), increments this.
+      TaskSequencer<DeterminizeLatticeClass> *determinizer = NULL);
   void operator () (); // The decoding happens here.
   ~DecodeUtteranceLatticeFasterClass(); // Output happens here.
  private:
@@ -183,13 +228,15 @@ class DecodeUtteranceLatticeFasterClass {
   int32 *num_done_;
   int32 *num_err_;
   int32 *num_partial_;
+  TaskSequencer<DeterminizeLatticeClass> *determinizer_;
 
   // The following variables are stored by the computation.
   bool computed_; // operator ()  was called.
   bool success_; // decoding succeeded (possibly partial)
   bool partial_; // decoding was partial.
-  CompactLattice *clat_; // Stored output, if determinize_ == true.
-  Lattice *lat_; // Stored output, if determinize_ == false.
+  CompactLattice *clat_; // Stored output, if determinize_ == true and
+                         // determinizer_ == NULL.
+  Lattice *lat_; // Stored output, otherwise.
 };
 
 // This function DecodeUtteranceLatticeSimple is used in several decoders, and
@@ -0,0 +1,266 @@
+// decoder/flat-fst-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <sstream>
+#include "decoder/flat-fst.h"
+#include "fstext/kaldi-fst-io.h"
+#include "fstext/rand-fst.h"
+#include "util/kaldi-io.h"
+
+namespace fst {
+
+static bool ArcsEqual(const StdArc &a, const StdArc &b) {
+  return a.ilabel == b.ilabel && a.olabel == b.olabel &&
+      a.weight.Value() == b.weight.Value() && a.nextstate == b.nextstate;
+}
+
+// Checks that 'flat' is equivalent to 'fst', arc by arc.  FlatFst puts the
+// emitting arcs of each state before its epsilon arcs, so we expect the
+// emitting arcs of 'fst' in their original order followed by its epsilon
+// arcs in their original order.  This also checks the generic versions of
+// EmittingArcIterator and EpsilonArcIterator on 'fst'.
+static void CheckFlatFstEquivalent(const Fst<StdArc> &fst,
+                                   const FlatFst &flat) {
+  typedef StdArc::StateId StateId;
+  StateId num_states = CountStates(fst);
+  KALDI_ASSERT(flat.NumStates() == num_states && flat.Start() == fst.Start());
+  int64 num_arcs_total = 0;
+  for (StateId s = 0; s < num_states; s++) {
+    KALDI_ASSERT(flat.Final(s) == fst.Final(s));
+    KALDI_ASSERT(flat.NumArcs(s) == fst.NumArcs(s) &&
+                 flat.NumInputEpsilons(s) == fst.NumInputEpsilons(s));
+    num_arcs_total += fst.NumArcs(s);
+
+    std::vector<StdArc> emitting_arcs, epsilon_arcs;
+    for (ArcIterator<Fst<StdArc> > aiter(fst, s); !aiter.Done(); aiter.Next()) {
+      const StdArc &arc = aiter.Value();
+      if (arc.ilabel == 0) epsilon_arcs.push_back(arc);
+      else emitting_arcs.push_back(arc);
+    }
+    std::vector<StdArc> all_arcs(emitting_arcs);
+    all_arcs.insert(all_arcs.end(), epsilon_arcs.begin(), epsilon_arcs.end());
+
+    size_t i = 0;
+    for (ArcIterator<FlatFst> aiter(flat, s); !aiter.Done(); aiter.Next(), i++)
+      KALDI_ASSERT(i < all_arcs.size() && ArcsEqual(aiter.Value(), all_arcs[i]));
+    KALDI_ASSERT(i == all_arcs.size());
+
+    i = 0;
+    for (EmittingArcIterator<FlatFst> aiter(flat, s); !aiter.Done();
+         aiter.Next(), i++) {
+      KALDI_ASSERT(i < emitting_arcs.size());
+      StdArc arc(aiter.ILabel(), aiter.OLabel(), TropicalWeight(aiter.Cost()),
+                 aiter.NextState());
+      KALDI_ASSERT(arc.ilabel != 0 && ArcsEqual(arc, emitting_arcs[i]));
+    }
+    KALDI_ASSERT(i == emitting_arcs.size());
+    i = 0;
+    for (EmittingArcIterator<Fst<StdArc> > aiter(fst, s); !aiter.Done();
+         aiter.Next(), i++) {
+      KALDI_ASSERT(i < emitting_arcs.size());
+      StdArc arc(aiter.ILabel(), aiter.OLabel(), TropicalWeight(aiter.Cost()),
+                 aiter.NextState());
+      KALDI_ASSERT(ArcsEqual(arc, emitting_arcs[i]));
+    }
+    KALDI_ASSERT(i == emitting_arcs.size());
+
+    i = 0;
+    for (EpsilonArcIterator<FlatFst> aiter(flat, s); !aiter.Done();
+         aiter.Next(), i++) {
+      KALDI_ASSERT(i < epsilon_arcs.size());
+      StdArc arc(0, aiter.OLabel(), TropicalWeight(aiter.Cost()),
+                 aiter.NextState());
+      KALDI_ASSERT(ArcsEqual(arc, epsilon_arcs[i]));
+    }
+    KALDI_ASSERT(i == epsilon_arcs.size());
+    i = 0;
+    for (EpsilonArcIterator<Fst<StdArc> > aiter(fst, s); !aiter.Done();
+         aiter.Next(), i++) {
+      KALDI_ASSERT(i < epsilon_arcs.size());
+      StdArc arc(0, aiter.OLabel(), TropicalWeight(aiter.Cost()),
+                 aiter.NextState());
+      KALDI_ASSERT(ArcsEqual(arc, epsilon_arcs[i]));
+    }
+    KALDI_ASSERT(i == epsilon_arcs.size());
+  }
+  KALDI_ASSERT(flat.NumArcsTotal() == num_arcs_total);
+}
+
+// Overwrites the value of type T at byte 'offset' of 'data'.
+template <typename T>
+static void SetValue(size_t offset, T value, std::string *data) {
+  KALDI_ASSERT(offset + sizeof(T) <= data->size());
+  std::memcpy(&((*data)[offset]), &value, sizeof(T));
+}
+
+// Checks that FlatFst::Read() fails on 'data'.
+static void CheckReadFails(const std::string &data, const std::string &what) {
+  FlatFst flat;
+  std::istringstream is(data);
+  try {
+    flat.Read(is, true);
+  } catch (const std::exception &e) {
+    KALDI_LOG << "Reading FlatFst with " << what << " failed, as expected.";
+    return;
+  }
+  KALDI_ERR << "Reading FlatFst with " << what << " did not fail.";
+}
+
+// Checks that FlatFst::Read() rejects corrupted versions of 'data', which is
+// the output of Write() for a FlatFst created from 'fst'.
+static void TestCorruptedFlatFst(const Fst<StdArc> &fst,
+                                 const std::string &data) {
+  typedef StdArc::StateId StateId;
+  typedef StdArc::Label Label;
+  StateId num_states = CountStates(fst);
+  int64 num_arcs = 0;
+  for (StateId s = 0; s < num_states; s++)
+    num_arcs += fst.NumArcs(s);
+
+  // The layout of the data: the token "<FlatFst> ", the format and the start
+  // state (each a size byte followed by an int32), then the arrays, each an
+  // int64 size (with its size byte) followed by the raw data, then the token
+  // "</FlatFst> ".
+  size_t start_pos = 10 + 5 + 1,
+      final_costs_pos = start_pos + 4 + 9,
+      arc_offsets_pos = final_costs_pos + 4 * num_states + 9,
+      num_input_epsilons_pos = arc_offsets_pos + 8 * (num_states + 1) + 9,
+      ilabels_pos = num_input_epsilons_pos + 4 * num_states + 9,
+      nextstates_pos = ilabels_pos + 3 * (4 * num_arcs + 9);
+  KALDI_ASSERT(nextstates_pos + 4 * num_arcs + 11 == data.size());
+
+  CheckReadFails(data.substr(0, data.size() - 5), "truncated end token");
+  CheckReadFails(data.substr(0, ilabels_pos + 2), "truncated array");
+  {
+    std::string corrupted(data);
+    SetValue<StateId>(start_pos, num_states, &corrupted);
+    CheckReadFails(corrupted, "invalid start state");
+  }
+  {
+    std::string corrupted(data);
+    SetValue<int64>(arc_offsets_pos, 1, &corrupted);
+    CheckReadFails(corrupted, "invalid first arc offset");
+  }
+  {
+    std::string corrupted(data);
+    SetValue<int32>(num_input_epsilons_pos, fst.NumArcs(0) + 1, &corrupted);
+    CheckReadFails(corrupted, "too many epsilon arcs");
+  }
+  if (num_arcs == 0)
+    return;
+  {
+    std::string corrupted(data);
+    SetValue<StateId>(nextstates_pos + 4 * (num_arcs - 1), num_states,
+                      &corrupted);
+    CheckReadFails(corrupted, "too large next-state");
+    SetValue<StateId>(nextstates_pos + 4 * (num_arcs - 1), -1, &corrupted);
+    CheckReadFails(corrupted, "negative next-state");
+  }
+  {
+    // Change the last arc of the first state that has arcs from emitting to
+    // epsilon or vice versa, so that the epsilon arcs are no longer last.
+    int64 arc_index = 0;
+    StateId s = 0;
+    for (; fst.NumArcs(s) == 0; s++) { }
+    arc_index += fst.NumArcs(s) - 1;
+    for (StateId t = 0; t < s; t++)
+      arc_index += fst.NumArcs(t);
+    Label ilabel = (fst.NumInputEpsilons(s) != 0 ? 1 : 0);
+    std::string corrupted(data);
+    SetValue<Label>(ilabels_pos + 4 * arc_index, ilabel, &corrupted);
+    CheckReadFails(corrupted, "epsilon arcs out of place");
+  }
+}
+
+static void TestFlatFst() {
+  RandFstOptions opts;
+  opts.allow_empty = false;
+  VectorFst<StdArc> *vector_fst = RandFst<StdArc>(opts);
+  ConstFst<StdArc> const_fst(*vector_fst);
+
+  FlatFst flat(const_fst);
+  CheckFlatFstEquivalent(const_fst, flat);
+
+  // Write/Read round-trip.
+  std::ostringstream os;
+  flat.Write(os, true);
+  std::string data = os.str();
+  {
+    FlatFst flat2;
+    std::istringstream is(data);
+    flat2.Read(is, true);
+    CheckFlatFstEquivalent(const_fst, flat2);
+    std::ostringstream os2;
+    flat2.Write(os2, true);
+    KALDI_ASSERT(os2.str() == data);
+  }
+  TestCorruptedFlatFst(const_fst, data);
+
+  // ReadDecodingGraph() should read either format.
+  {
+    kaldi::Output ko("tmpf", true);
+    flat.Write(ko.Stream(), true);
+  }
+  Fst<StdArc> *fst_read = NULL;
+  FlatFst *flat_read = ReadDecodingGraph("tmpf", &fst_read);
+  KALDI_ASSERT(flat_read != NULL && fst_read == NULL);
+  CheckFlatFstEquivalent(const_fst, *flat_read);
+  delete flat_read;
+
+  WriteFstKaldi(*vector_fst, "tmpf");
+  flat_read = ReadDecodingGraph("tmpf", &fst_read);
+  KALDI_ASSERT(flat_read == NULL && fst_read != NULL);
+  CheckFlatFstEquivalent(*fst_read, flat);
+  delete fst_read;
+
+  // With memory_map == true, an aligned ConstFst should be mapped; anything
+  // else should still be read.
+  {
+    kaldi::Output ko("tmpf", true, false);
+    FstWriteOptions wopts("tmpf");
+    wopts.align = true;
+    const_fst.Write(ko.Stream(), wopts);
+  }
+  flat_read = ReadDecodingGraph("tmpf", &fst_read, true);
+  KALDI_ASSERT(flat_read == NULL && fst_read != NULL &&
+               fst_read->Type() == "const");
+  CheckFlatFstEquivalent(*fst_read, flat);
+  delete fst_read;
+  {
+    kaldi::Output ko("tmpf", true);
+    flat.Write(ko.Stream(), true);
+  }
+  flat_read = ReadDecodingGraph("tmpf", &fst_read, true);
+  KALDI_ASSERT(flat_read != NULL && fst_read == NULL);
+  CheckFlatFstEquivalent(const_fst, *flat_read);
+  delete flat_read;
+  unlink("tmpf");
+
+  delete vector_fst;
+}
+
+}  // namespace fst
+
+int main() {
+  for (int32 i = 0; i < 20; i++)
+    fst::TestFlatFst();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,186 @@
+// decoder/flat-fst.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/flat-fst.h"
+#include <limits>
+#include "fstext/kaldi-fst-io.h"
+#include "util/kaldi-io.h"
+
+namespace fst {
+
+void FlatFst::Init(const Fst<StdArc> &fst) {
+  StateId num_states = CountStates(fst);
+  start_ = fst.Start();
+  final_costs_.resize(num_states);
+  arc_offsets_.resize(num_states + 1);
+  num_input_epsilons_.resize(num_states);
+
+  int64 num_arcs = 0;
+  for (StateId s = 0; s < num_states; s++) {
+    final_costs_[s] = fst.Final(s).Value();
+    arc_offsets_[s] = num_arcs;
+    num_arcs += fst.NumArcs(s);
+  }
+  arc_offsets_[num_states] = num_arcs;
+
+  ilabels_.resize(num_arcs);
+  olabels_.resize(num_arcs);
+  weights_.resize(num_arcs);
+  nextstates_.resize(num_arcs);
+
+  for (StateId s = 0; s < num_states; s++) {
+    // The emitting arcs go first, then the epsilon arcs.
+    int64 num_eps = fst.NumInputEpsilons(s),
+        emitting_pos = arc_offsets_[s],
+        epsilon_pos = arc_offsets_[s + 1] - num_eps;
+    KALDI_ASSERT(num_eps <= std::numeric_limits<int32>::max());
+    num_input_epsilons_[s] = num_eps;
+    for (ArcIterator<Fst<StdArc> > aiter(fst, s); !aiter.Done();
+         aiter.Next()) {
+      const StdArc &arc = aiter.Value();
+      int64 pos = (arc.ilabel == 0 ? epsilon_pos++ : emitting_pos++);
+      ilabels_[pos] = arc.ilabel;
+      olabels_[pos] = arc.olabel;
+      weights_[pos] = arc.weight.Value();
+      nextstates_[pos] = arc.nextstate;
+    }
+    KALDI_ASSERT(emitting_pos == arc_offsets_[s + 1] - num_eps &&
+                 epsilon_pos == arc_offsets_[s + 1]);
+  }
+}
+
+// Writes the contents of 'vec' (which must be of a simple type) as raw
+// memory, preceded by its size.
+template <typename T>
+static void WriteArray(std::ostream &os, const std::vector<T> &vec) {
+  int64 size = vec.size();
+  kaldi::WriteBasicType(os, true, size);
+  if (size != 0)
+    os.write(reinterpret_cast<const char*>(vec.data()), sizeof(T) * size);
+  if (!os.good())
+    KALDI_ERR << "Error writing FlatFst to stream.";
+}
+
+template <typename T>
+static void ReadArray(std::istream &is, std::vector<T> *vec) {
+  int64 size;
+  kaldi::ReadBasicType(is, true, &size);
+  KALDI_ASSERT(size >= 0);
+  vec->resize(size);
+  if (size != 0)
+    is.read(reinterpret_cast<char*>(vec->data()), sizeof(T) * size);
+  if (!is.good())
+    KALDI_ERR << "Error reading FlatFst from stream.";
+}
+
+void FlatFst::Write(std::ostream &os, bool binary) const {
+  using namespace kaldi;
+  if (!binary)
+    KALDI_ERR << "FlatFst::Write only supports binary mode.";
+  int32 format = 1;
+  WriteToken(os, binary, "<FlatFst>");
+  WriteBasicType(os, binary, format);
+  WriteBasicType(os, binary, start_);
+  WriteArray(os, final_costs_);
+  WriteArray(os, arc_offsets_);
+  WriteArray(os, num_input_epsilons_);
+  WriteArray(os, ilabels_);
+  WriteArray(os, olabels_);
+  WriteArray(os, weights_);
+  WriteArray(os, nextstates_);
+  WriteToken(os, binary, "</FlatFst>");
+}
+
+void FlatFst::Read(std::istream &is, bool binary) {
+  using namespace kaldi;
+  if (!binary)
+    KALDI_ERR << "FlatFst::Read only supports binary mode.";
+  int32 format;
+  ExpectToken(is, binary, "<FlatFst>");
+  ReadBasicType(is, binary, &format);
+  if (format != 1)
+    KALDI_ERR << "This version of the code cannot read this FlatFst, "
+        "update your code.";
+  ReadBasicType(is, binary, &start_);
+  ReadArray(is, &final_costs_);
+  ReadArray(is, &arc_offsets_);
+  ReadArray(is, &num_input_epsilons_);
+  ReadArray(is, &ilabels_);
+  ReadArray(is, &olabels_);
+  ReadArray(is, &weights_);
+  ReadArray(is, &nextstates_);
+  ExpectToken(is, binary, "</FlatFst>");
+  size_t num_states = final_costs_.size(), num_arcs = ilabels_.size();
+  if (arc_offsets_.size() != num_states + 1 ||
+      num_input_epsilons_.size() != num_states ||
+      arc_offsets_[0] != 0 ||
+      arc_offsets_.back() != static_cast<int64>(num_arcs) ||
+      olabels_.size() != num_arcs || weights_.size() != num_arcs ||
+      nextstates_.size() != num_arcs)
+    KALDI_ERR << "Reading FlatFst: inconsistent sizes (corrupted file?)";
+  if (start_ != kNoStateId &&
+      (start_ < 0 || static_cast<size_t>(start_) >= num_states))
+    KALDI_ERR << "Reading FlatFst: invalid start state " << start_
+              << " (corrupted file?)";
+  // The decoders rely on the arc ranges, next-states and the segregation of
+  // the emitting and epsilon arcs without checking them, so we check them
+  // here.
+  for (size_t s = 0; s < num_states; s++) {
+    int64 begin = arc_offsets_[s], end = arc_offsets_[s + 1],
+        num_eps = num_input_epsilons_[s];
+    if (end < begin || num_eps < 0 || num_eps > end - begin)
+      KALDI_ERR << "Reading FlatFst: invalid arc offsets for state " << s
+                << " (corrupted file?)";
+    for (int64 a = begin; a < end; a++) {
+      if (nextstates_[a] < 0 ||
+          static_cast<size_t>(nextstates_[a]) >= num_states)
+        KALDI_ERR << "Reading FlatFst: invalid next-state " << nextstates_[a]
+                  << " (corrupted file?)";
+      if ((ilabels_[a] == 0) != (a >= end - num_eps))
+        KALDI_ERR << "Reading FlatFst: epsilon arcs of state " << s
+                  << " are not after its emitting arcs (corrupted file?)";
+    }
+  }
+}
+
+
+FlatFst *ReadDecodingGraph(std::string rxfilename, Fst<StdArc> **fst,
+                           bool memory_map) {
+  if (rxfilename == "") rxfilename = "-";  // interpret "" as stdin.
+  // A FlatFst is written in Kaldi's binary format, so it starts with "\0B";
+  // an OpenFst FST starts with a magic number whose first byte is not zero,
+  // so it will be detected as "text" and nothing will have been consumed
+  // from the stream.
+  bool binary;
+  kaldi::Input ki(rxfilename, &binary);
+  if (binary) {
+    if (memory_map)
+      KALDI_WARN << "Cannot memory-map FlatFst from "
+                 << kaldi::PrintableRxfilename(rxfilename)
+                 << "; reading it instead.";
+    FlatFst *ans = new FlatFst();
+    ans->Read(ki.Stream(), binary);
+    *fst = NULL;
+    return ans;
+  }
+  *fst = ReadFstKaldiGeneric(ki.Stream(), rxfilename, true, memory_map);
+  return NULL;
+}
+
+}  // namespace fst
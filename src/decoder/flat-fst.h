@@ -0,0 +1,323 @@
+// decoder/flat-fst.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_FLAT_FST_H_
+#define KALDI_DECODER_FLAT_FST_H_
+
+#include <string>
+#include <vector>
+#include "fst/fstlib.h"
+#include "base/kaldi-common.h"
+
+namespace fst {
+
+class FlatFst;
+
+// Declare that we'll be overriding class ArcIterator for class FlatFst.
+// This wouldn't work if we were fully using the OpenFst framework,
+// e.g. if we had FlatFst inherit from class Fst.
+template<> class ArcIterator<FlatFst>;
+
+// These iterate over only the emitting, resp. epsilon, arcs of a state; they
+// are defined below, and specialized for FlatFst.
+template<class FST> class EmittingArcIterator;
+template<class FST> class EpsilonArcIterator;
+template<> class EmittingArcIterator<FlatFst>;
+template<> class EpsilonArcIterator<FlatFst>;
+
+
+/**
+   FlatFst is a read-only representation of a decoding graph (e.g. HCLG.fst)
+   that is laid out for fast traversal by the decoders.  Like GrammarFst, it
+   does not inherit from fst::Fst and does not support its full interface--
+   only the parts that are necessary for the decoders (e.g.
+   LatticeFasterDecoderTpl) to work when templated on it.  Compared with
+   ConstFst, it avoids the virtual dispatch of the generic FST interface, and
+   stores the arcs as separate arrays of ilabels, olabels, weights and
+   next-states.
+
+   The arcs leaving each state are stored contiguously, with the emitting arcs
+   (ilabel != 0) first and the epsilon arcs after them, similar to how
+   ../cudadecoder/cuda-fst.h lays out the graph for the GPU decoder.  This
+   makes NumInputEpsilons() a single array lookup, and lets the decoders
+   visit only the emitting or only the epsilon arcs of a state (see
+   EmittingArcIterator and EpsilonArcIterator).  Note: this means that the
+   arcs are not necessarily in the same order as in the FST they were
+   converted from.
+
+   It can be created from an FST with the program make-flat-fst, and is read
+   and written in binary Kaldi format; see ReadDecodingGraph() for a function
+   that reads either this format or a normal FST.  Reading it is much faster
+   than reading an FST, as the arrays are read directly into memory.
+
+   THREAD SAFETY: all the member functions are const, so one FlatFst can be
+   shared by decoders in multiple threads.
+*/
+class FlatFst {
+ public:
+  typedef StdArc Arc;
+  typedef TropicalWeight Weight;
+  typedef Arc::StateId StateId;
+  typedef Arc::Label Label;
+
+  /// This constructor should only be used prior to calling Read() or Init().
+  FlatFst(): start_(kNoStateId) { }
+
+  /// Constructor from an FST; see Init().
+  explicit FlatFst(const Fst<StdArc> &fst) { Init(fst); }
+
+  /// Initializes this object from 'fst', which must have its states numbered
+  /// from zero without gaps (true for any VectorFst or ConstFst).
+  void Init(const Fst<StdArc> &fst);
+
+  // This Write function only supports binary mode, but the option is allowed
+  // for compatibility with other Kaldi read/write functions (it will crash if
+  // binary == false).
+  void Write(std::ostream &os, bool binary) const;
+
+  // Reads the format that Write() outputs.  Will crash if binary == false.
+  // It checks that the data is consistent (e.g. that the next-states are
+  // valid), so that a corrupted file cannot make the decoders read outside
+  // the arrays.
+  void Read(std::istream &is, bool binary);
+
+  StateId Start() const { return start_; }
+
+  Weight Final(StateId s) const { return Weight(final_costs_[s]); }
+
+  size_t NumInputEpsilons(StateId s) const { return num_input_epsilons_[s]; }
+
+  size_t NumArcs(StateId s) const {
+    return arc_offsets_[s + 1] - arc_offsets_[s];
+  }
+
+  StateId NumStates() const { return final_costs_.size(); }
+
+  /// Returns the total number of arcs in the FST.
+  int64 NumArcsTotal() const { return ilabels_.size(); }
+
+  std::string Type() const { return "flat"; }
+
+ private:
+  friend class ArcIterator<FlatFst>;
+  friend class EmittingArcIterator<FlatFst>;
+  friend class EpsilonArcIterator<FlatFst>;
+
+  StateId start_;
+  // The final-cost of each state (infinity if it is not final).
+  std::vector<float> final_costs_;
+  // The arcs leaving state s are numbered from arc_offsets_[s] to
+  // arc_offsets_[s+1] - 1; dimension is NumStates() + 1.
+  std::vector<int64> arc_offsets_;
+  // The number of arcs leaving each state that have epsilon ilabels; these
+  // are the last arcs of each state.
+  std::vector<int32> num_input_epsilons_;
+  // The arcs, indexed by arc-index.
+  std::vector<Label> ilabels_;
+  std::vector<Label> olabels_;
+  std::vector<float> weights_;
+  std::vector<StateId> nextstates_;
+};
+
+
+/**
+   This is the specialization of ArcIterator for FlatFst.  It only supports
+   the interface that the decoders use: Done(), Next() and Value().
+ */
+template<>
+class ArcIterator<FlatFst> {
+ public:
+  typedef FlatFst::Arc Arc;
+  typedef FlatFst::StateId StateId;
+
+  inline ArcIterator(const FlatFst &fst, StateId s):
+      ilabels_(fst.ilabels_.data()), olabels_(fst.olabels_.data()),
+      weights_(fst.weights_.data()), nextstates_(fst.nextstates_.data()),
+      i_(fst.arc_offsets_[s]), end_(fst.arc_offsets_[s + 1]) { }
+
+  // As in the ArcIterator of GrammarFst, we rely on the fact that the
+  // calling code needs to call Done() before accessing Value(), and copy
+  // the arc to arc_ in Done().
+  inline bool Done() {
+    if (i_ < end_) {
+      arc_.ilabel = ilabels_[i_];
+      arc_.olabel = olabels_[i_];
+      arc_.weight = TropicalWeight(weights_[i_]);
+      arc_.nextstate = nextstates_[i_];
+      return false;
+    } else {
+      return true;
+    }
+  }
+
+  inline void Next() { i_++; }
+
+  inline const Arc &Value() const { return arc_; }
+
+ private:
+  const FlatFst::Label *ilabels_;
+  const FlatFst::Label *olabels_;
+  const float *weights_;
+  const StateId *nextstates_;
+  int64 i_;
+  int64 end_;
+  Arc arc_;
+};
+
+
+/**
+   EmittingArcIterator iterates over the arcs leaving a state that have
+   nonzero ilabels, and EpsilonArcIterator over those that have epsilon
+   ilabels.  The decoders use them instead of ArcIterator.  For a general FST
+   they just skip the other arcs.  For FlatFst they visit only the range of
+   arcs that is needed, and read each field of an arc from its array only
+   when asked for it, so that e.g. the next-state of an arc that is pruned
+   away is never read.
+   Instead of Value(), they have accessors for the fields of the current arc.
+   As with ArcIterator<GrammarFst>, Done() must be called before the
+   accessors.
+ */
+template<class FST>
+class EmittingArcIterator {
+ public:
+  typedef typename FST::Arc Arc;
+  typedef typename Arc::StateId StateId;
+  typedef typename Arc::Label Label;
+
+  EmittingArcIterator(const FST &fst, StateId s): aiter_(fst, s) { }
+
+  inline bool Done() {
+    for (; !aiter_.Done(); aiter_.Next())
+      if (aiter_.Value().ilabel != 0)
+        return false;
+    return true;
+  }
+
+  inline void Next() { aiter_.Next(); }
+
+  inline Label ILabel() const { return aiter_.Value().ilabel; }
+  inline Label OLabel() const { return aiter_.Value().olabel; }
+  inline float Cost() const { return aiter_.Value().weight.Value(); }
+  inline StateId NextState() const { return aiter_.Value().nextstate; }
+
+ private:
+  ArcIterator<FST> aiter_;
+};
+
+template<class FST>
+class EpsilonArcIterator {
+ public:
+  typedef typename FST::Arc Arc;
+  typedef typename Arc::StateId StateId;
+  typedef typename Arc::Label Label;
+
+  EpsilonArcIterator(const FST &fst, StateId s): aiter_(fst, s) { }
+
+  inline bool Done() {
+    for (; !aiter_.Done(); aiter_.Next())
+      if (aiter_.Value().ilabel == 0)
+        return false;
+    return true;
+  }
+
+  inline void Next() { aiter_.Next(); }
+
+  inline Label OLabel() const { return aiter_.Value().olabel; }
+  inline float Cost() const { return aiter_.Value().weight.Value(); }
+  inline StateId NextState() const { return aiter_.Value().nextstate; }
+
+ private:
+  ArcIterator<FST> aiter_;
+};
+
+template<>
+class EmittingArcIterator<FlatFst> {
+ public:
+  typedef FlatFst::StateId StateId;
+  typedef FlatFst::Label Label;
+
+  // The emitting arcs are the first NumArcs(s) - NumInputEpsilons(s) arcs.
+  inline EmittingArcIterator(const FlatFst &fst, StateId s):
+      ilabels_(fst.ilabels_.data()), olabels_(fst.olabels_.data()),
+      weights_(fst.weights_.data()), nextstates_(fst.nextstates_.data()),
+      i_(fst.arc_offsets_[s]),
+      end_(fst.arc_offsets_[s + 1] - fst.num_input_epsilons_[s]) { }
+
+  inline bool Done() const { return i_ >= end_; }
+
+  inline void Next() { i_++; }
+
+  inline Label ILabel() const { return ilabels_[i_]; }
+  inline Label OLabel() const { return olabels_[i_]; }
+  inline float Cost() const { return weights_[i_]; }
+  inline StateId NextState() const { return nextstates_[i_]; }
+
+ private:
+  const Label *ilabels_;
+  const Label *olabels_;
+  const float *weights_;
+  const StateId *nextstates_;
+  int64 i_;
+  int64 end_;
+};
+
+template<>
+class EpsilonArcIterator<FlatFst> {
+ public:
+  typedef FlatFst::StateId StateId;
+  typedef FlatFst::Label Label;
+
+  // The epsilon arcs are the last NumInputEpsilons(s) arcs.
+  inline EpsilonArcIterator(const FlatFst &fst, StateId s):
+      olabels_(fst.olabels_.data()), weights_(fst.weights_.data()),
+      nextstates_(fst.nextstates_.data()),
+      i_(fst.arc_offsets_[s + 1] - fst.num_input_epsilons_[s]),
+      end_(fst.arc_offsets_[s + 1]) { }
+
+  inline bool Done() const { return i_ >= end_; }
+
+  inline void Next() { i_++; }
+
+  inline Label OLabel() const { return olabels_[i_]; }
+  inline float Cost() const { return weights_[i_]; }
+  inline StateId NextState() const { return nextstates_[i_]; }
+
+ private:
+  const Label *olabels_;
+  const float *weights_;
+  const StateId *nextstates_;
+  int64 i_;
+  int64 end_;
+};
+
+
+/// Reads a decoding graph from 'rxfilename', which may be either an FST in
+/// OpenFst format (as read by ReadFstKaldiGeneric()) or a FlatFst as written
+/// by make-flat-fst.  If it was a FlatFst, returns it and sets *fst to NULL;
+/// otherwise returns NULL and sets *fst to the FST that was read.  The caller
+/// owns the returned object.  If 'memory_map' is true, an FST is
+/// memory-mapped if possible, as for ReadFstKaldiGeneric(); a FlatFst is
+/// always read.
+FlatFst *ReadDecodingGraph(std::string rxfilename, Fst<StdArc> **fst,
+                           bool memory_map = false);
+
+
+}  // namespace fst
+
+#endif  // KALDI_DECODER_FLAT_FST_H_
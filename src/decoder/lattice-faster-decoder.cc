@@ -21,6 +21,7 @@
 // limitations under the License.
 
 #include "decoder/lattice-faster-decoder.h"
+#include "base/timer.h"
 #include "lat/lattice-functions.h"
 
 namespace kaldi {
@@ -62,10 +63,11 @@ void LatticeFasterDecoderTpl<FST, Token>::InitDecoding() {
   num_toks_ = 0;
   decoding_finalized_ = false;
   final_costs_.clear();
+  KALDI_DECODER_STATS_EXPR(stats_.Reset());
   StateId start_state = fst_->Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL, NULL);
+  Token *start_tok = token_pool_.New(0.0, 0.0, NULL, NULL, NULL);
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
@@ -152,6 +154,8 @@ bool LatticeFasterDecoderTpl<FST, Token>::GetRawLattice(
   KALDI_VLOG(4) << "init:" << num_toks_/2 + 3 << " buckets:"
                 << tok_map.bucket_count() << " load:" << tok_map.load_factor()
                 << " max:" << tok_map.max_load_factor();
+  KALDI_DECODER_STATS_EXPR(stats_.lattice_num_states = ofst->NumStates());
+  KALDI_DECODER_STATS_EXPR(stats_.lattice_num_arcs = 0);
   // Now create all arcs.
   for (int32 f = 0; f <= num_frames; f++) {
     for (Token *tok = active_toks_[f].toks; tok != NULL; tok = tok->next) {
@@ -172,6 +176,7 @@ bool LatticeFasterDecoderTpl<FST, Token>::GetRawLattice(
                 Weight(l->graph_cost, l->acoustic_cost - cost_offset),
                 nextstate);
         ofst->AddArc(cur_state, arc);
+        KALDI_DECODER_STATS_EXPR(stats_.lattice_num_arcs++);
       }
       if (f == num_frames) {
         if (use_final_probs && !final_costs.empty()) {
@@ -221,6 +226,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PossiblyResizeHash(size_t num_toks) {
                                       * config_.hash_ratio);
   if (new_sz > toks_.Size()) {
     toks_.SetSize(new_sz);
+    KALDI_DECODER_STATS_EXPR(stats_.num_hash_resizes++);
   }
 }
 
@@ -263,7 +269,8 @@ LatticeFasterDecoderTpl<FST, Token>::FindOrAddToken(
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks, backpointer);
+    Token *new_tok = token_pool_.New(tot_cost, extra_cost, NULL, toks,
+                                     backpointer);
     // NULL: no forward links yet
     toks = new_tok;
     num_toks_++;
@@ -340,7 +347,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneForwardLinks(
           ForwardLinkT *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_pool_.Delete(link);
           link = next_link;  // advance link but leave prev_link the same.
           *links_pruned = true;
         } else {   // keep the link and update the tok_extra_cost if needed.
@@ -428,7 +435,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneForwardLinksFinal() {
           ForwardLinkT *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_pool_.Delete(link);
           link = next_link; // advance link but leave prev_link the same.
         } else { // keep the link and update the tok_extra_cost if needed.
           if (link_extra_cost < 0.0) { // this is just a precaution.
@@ -489,7 +496,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneTokensForFrame(int32 frame_plus_o
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      token_pool_.Delete(tok);
       num_toks_--;
     } else {  // fetch next Token
       prev_tok = tok;
@@ -506,6 +513,7 @@ template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::PruneActiveTokens(BaseFloat delta) {
   int32 cur_frame_plus_one = NumFramesDecoded();
   int32 num_toks_begin = num_toks_;
+  KALDI_DECODER_STATS_EXPR(Timer timer);
   // The index "f" below represents a "frame plus one", i.e. you'd have to subtract
   // one to get the corresponding index for the decodable object.
   for (int32 f = cur_frame_plus_one - 1; f >= 0; f--) {
@@ -530,6 +538,9 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneActiveTokens(BaseFloat delta) {
   }
   KALDI_VLOG(4) << "PruneActiveTokens: pruned tokens from " << num_toks_begin
                 << " to " << num_toks_;
+  KALDI_DECODER_STATS_EXPR(stats_.num_prune_active_tokens++);
+  KALDI_DECODER_STATS_EXPR(stats_.prune_active_tokens_seconds +=
+                           timer.Elapsed());
 }
 
 template <typename FST, typename Token>
@@ -684,6 +695,7 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
       max_active_cutoff = tmp_array_[config_.max_active];
     }
     if (max_active_cutoff < beam_cutoff) { // max_active is tighter than beam.
+      KALDI_DECODER_STATS_EXPR(stats_.num_max_active_cutoffs++);
       if (adaptive_beam)
         *adaptive_beam = max_active_cutoff - best_weight + config_.beam_delta;
       return max_active_cutoff;
@@ -700,6 +712,7 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
       }
     }
     if (min_active_cutoff > beam_cutoff) { // min_active is looser than beam.
+      KALDI_DECODER_STATS_EXPR(stats_.num_min_active_cutoffs++);
       if (adaptive_beam)
         *adaptive_beam = min_active_cutoff - best_weight + config_.beam_delta;
       return min_active_cutoff;
@@ -730,6 +743,8 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
                 << adaptive_beam;
 
   PossiblyResizeHash(tok_cnt);  // This makes sure the hash is always big enough.
+  KALDI_DECODER_STATS_EXPR(stats_.frames.push_back(DecoderFrameStats(tok_cnt)));
+  KALDI_DECODER_STATS_EXPR(int32 num_arcs = 0);
 
   BaseFloat next_cutoff = std::numeric_limits<BaseFloat>::infinity();
   // pruning "online" before having seen all tokens
@@ -745,16 +760,13 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
     cost_offset = - tok->tot_cost;
-    for (fst::ArcIterator<FST> aiter(*fst_, state);
+    for (fst::EmittingArcIterator<FST> aiter(*fst_, state);
          !aiter.Done();
          aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      if (arc.ilabel != 0) {  // propagate..
-        BaseFloat new_weight = arc.weight.Value() + cost_offset -
-            decodable->LogLikelihood(frame, arc.ilabel) + tok->tot_cost;
-        if (new_weight + adaptive_beam < next_cutoff)
-          next_cutoff = new_weight + adaptive_beam;
-      }
+      BaseFloat new_weight = aiter.Cost() + cost_offset -
+          decodable->LogLikelihood(frame, aiter.ILabel()) + tok->tot_cost;
+      if (new_weight + adaptive_beam < next_cutoff)
+        next_cutoff = new_weight + adaptive_beam;
     }
   }
 
@@ -772,44 +784,45 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
     StateId state = e->key;
     Token *tok = e->val;
     if (tok->tot_cost <= cur_cutoff) {
-      for (fst::ArcIterator<FST> aiter(*fst_, state);
+      // Only the emitting arcs; and we only read the next-state and olabel
+      // of the arcs that survive pruning.
+      for (fst::EmittingArcIterator<FST> aiter(*fst_, state);
            !aiter.Done();
            aiter.Next()) {
-        const Arc &arc = aiter.Value();
-        if (arc.ilabel != 0) {  // propagate..
-          BaseFloat ac_cost = cost_offset -
-              decodable->LogLikelihood(frame, arc.ilabel),
-              graph_cost = arc.weight.Value(),
-              cur_cost = tok->tot_cost,
-              tot_cost = cur_cost + ac_cost + graph_cost;
-          if (tot_cost >= next_cutoff) continue;
-          else if (tot_cost + adaptive_beam < next_cutoff)
-            next_cutoff = tot_cost + adaptive_beam; // prune by best current token
-          // Note: the frame indexes into active_toks_ are one-based,
-          // hence the + 1.
-          Elem *e_next = FindOrAddToken(arc.nextstate,
-                                        frame + 1, tot_cost, tok, NULL);
-          // NULL: no change indicator needed
-
-          // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLinkT(e_next->val, arc.ilabel, arc.olabel,
-                                        graph_cost, ac_cost, tok->links);
-        }
+        KALDI_DECODER_STATS_EXPR(num_arcs++);
+        Label ilabel = aiter.ILabel();
+        BaseFloat ac_cost = cost_offset -
+            decodable->LogLikelihood(frame, ilabel),
+            graph_cost = aiter.Cost(),
+            cur_cost = tok->tot_cost,
+            tot_cost = cur_cost + ac_cost + graph_cost;
+        if (tot_cost >= next_cutoff) continue;
+        else if (tot_cost + adaptive_beam < next_cutoff)
+          next_cutoff = tot_cost + adaptive_beam; // prune by best current token
+        // Note: the frame indexes into active_toks_ are one-based,
+        // hence the + 1.
+        Elem *e_next = FindOrAddToken(aiter.NextState(),
+                                      frame + 1, tot_cost, tok, NULL);
+        // NULL: no change indicator needed
+
+        // Add ForwardLink from tok to next_tok (put on head of list tok->links)
+        tok->links = link_pool_.New(e_next->val, ilabel, aiter.OLabel(),
+                                    graph_cost, ac_cost, tok->links);
       } // for all arcs
     }
     e_tail = e->tail;
     toks_.Delete(e); // delete Elem
   }
+  KALDI_DECODER_STATS_EXPR(stats_.frames.back().num_emitting_arcs = num_arcs);
   return next_cutoff;
 }
 
-// static inline
 template <typename FST, typename Token>
-void LatticeFasterDecoderTpl<FST, Token>::DeleteForwardLinks(Token *tok) {
+inline void LatticeFasterDecoderTpl<FST, Token>::DeleteForwardLinks(Token *tok) {
   ForwardLinkT *l = tok->links, *m;
   while (l != NULL) {
     m = l->next;
-    delete l;
+    link_pool_.Delete(l);
     l = m;
   }
   tok->links = NULL;
@@ -845,6 +858,7 @@ void LatticeFasterDecoderTpl<FST, Token>::ProcessNonemitting(BaseFloat cutoff) {
       queue_.push_back(e);
   }
 
+  KALDI_DECODER_STATS_EXPR(int32 num_arcs = 0);
   while (!queue_.empty()) {
     const Elem *e = queue_.back();
     queue_.pop_back();
@@ -860,30 +874,35 @@ void LatticeFasterDecoderTpl<FST, Token>::ProcessNonemitting(BaseFloat cutoff) {
     // but since most states are emitting it's not a huge issue.
     DeleteForwardLinks(tok); // necessary when re-visiting
     tok->links = NULL;
-    for (fst::ArcIterator<FST> aiter(*fst_, state);
+    for (fst::EpsilonArcIterator<FST> aiter(*fst_, state);
          !aiter.Done();
-         aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      if (arc.ilabel == 0) {  // propagate nonemitting only...
-        BaseFloat graph_cost = arc.weight.Value(),
-            tot_cost = cur_cost + graph_cost;
-        if (tot_cost < cutoff) {
-          bool changed;
-
-          Elem *e_new = FindOrAddToken(arc.nextstate, frame + 1, tot_cost,
-                                          tok, &changed);
-
-          tok->links = new ForwardLinkT(e_new->val, 0, arc.olabel,
-                                        graph_cost, 0, tok->links);
-
-          // "changed" tells us whether the new token has a different
-          // cost from before, or is new [if so, add into queue].
-          if (changed && fst_->NumInputEpsilons(arc.nextstate) != 0)
-            queue_.push_back(e_new);
-        }
+         aiter.Next()) {  // propagate nonemitting only...
+      KALDI_DECODER_STATS_EXPR(num_arcs++);
+      BaseFloat graph_cost = aiter.Cost(),
+          tot_cost = cur_cost + graph_cost;
+      if (tot_cost < cutoff) {
+        bool changed;
+        StateId nextstate = aiter.NextState();
+
+        Elem *e_new = FindOrAddToken(nextstate, frame + 1, tot_cost,
+                                     tok, &changed);
+
+        tok->links = link_pool_.New(e_new->val, 0, aiter.OLabel(),
+                                    graph_cost, 0, tok->links);
+
+        // "changed" tells us whether the new token has a different
+        // cost from before, or is new [if so, add into queue].
+        if (changed && fst_->NumInputEpsilons(nextstate) != 0)
+          queue_.push_back(e_new);
       }
     } // for all arcs
   } // while queue not empty
+#ifdef KALDI_DECODER_STATS
+  if (stats_.frames.empty())
+    stats_.num_initial_nonemitting_arcs += num_arcs;
+  else
+    stats_.frames.back().num_nonemitting_arcs += num_arcs;
+#endif
 }
 
 
@@ -903,13 +922,22 @@ void LatticeFasterDecoderTpl<FST, Token>::ClearActiveTokens() { // a cleanup rou
     for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
       DeleteForwardLinks(tok);
       Token *next_tok = tok->next;
-      delete tok;
+      token_pool_.Delete(tok);
       num_toks_--;
       tok = next_tok;
     }
   }
+  if (!active_toks_.empty()) {
+    KALDI_VLOG(2) << "Peak number of tokens was " << token_pool_.PeakInUse()
+                  << " and of forward links " << link_pool_.PeakInUse()
+                  << "; decoder has allocated "
+                  << (token_pool_.BytesAllocated() +
+                      link_pool_.BytesAllocated()) << " bytes for them.";
+  }
   active_toks_.clear();
   KALDI_ASSERT(num_toks_ == 0);
+  token_pool_.ResetPeak();
+  link_pool_.ResetPeak();
 }
 
 // static
@@ -999,12 +1027,14 @@ template class LatticeFasterDecoderTpl<fst::ConstFst<fst::StdArc>, decoder::StdT
 
 template class LatticeFasterDecoderTpl<fst::ConstGrammarFst, decoder::StdToken>;
 template class LatticeFasterDecoderTpl<fst::VectorGrammarFst, decoder::StdToken>;
+template class LatticeFasterDecoderTpl<fst::FlatFst, decoder::StdToken>;
 
 template class LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> , decoder::BackpointerToken>;
 template class LatticeFasterDecoderTpl<fst::VectorFst<fst::StdArc>, decoder::BackpointerToken >;
 template class LatticeFasterDecoderTpl<fst::ConstFst<fst::StdArc>, decoder::BackpointerToken >;
 template class LatticeFasterDecoderTpl<fst::ConstGrammarFst, decoder::BackpointerToken>;
 template class LatticeFasterDecoderTpl<fst::VectorGrammarFst, decoder::BackpointerToken>;
+template class LatticeFasterDecoderTpl<fst::FlatFst, decoder::BackpointerToken>;
 
 
 } // end namespace kaldi.
@@ -26,12 +26,15 @@
 
 #include "util/stl-utils.h"
 #include "util/hash-list.h"
+#include "util/memory-pool.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
 #include "lat/determinize-lattice-pruned.h"
 #include "lat/kaldi-lattice.h"
 #include "decoder/grammar-fst.h"
+#include "decoder/flat-fst.h"
+#include "decoder/decoder-stats.h"
 
 namespace kaldi {
 
@@ -339,13 +342,19 @@ class LatticeFasterDecoderTpl {
   // whenever we call ProcessEmitting().
   inline int32 NumFramesDecoded() const { return active_toks_.size() - 1; }
 
+  /// Returns counters of the work done in decoding the current utterance
+  /// (they are reset by InitDecoding()), and the size of the last lattice
+  /// output by GetRawLattice().  These are only collected if the decoder
+  /// library was compiled with -DKALDI_DECODER_STATS; see decoder-stats.h.
+  const DecoderStats &Stats() const { return stats_; }
+
  protected:
   // we make things protected instead of private, as code in
   // LatticeFasterOnlineDecoderTpl, which inherits from this, also uses the
   // internals.
 
   // Deletes the elements of the singly linked list tok->links.
-  inline static void DeleteForwardLinks(Token *tok);
+  inline void DeleteForwardLinks(Token *tok);
 
   // head of per-frame list of Tokens (list is in topological order),
   // and something saying whether we ever pruned it using PruneForwardLinks.
@@ -461,6 +470,13 @@ class LatticeFasterDecoderTpl {
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
+  // The Tokens and ForwardLinks are allocated from these pools rather than
+  // with new and delete.  The memory is reused across utterances, so a
+  // decoder object that decodes many utterances stops allocating memory once
+  // it has seen its largest one.
+  MemoryPool<Token> token_pool_;
+  MemoryPool<ForwardLinkT> link_pool_;
+
   std::vector<const Elem* > queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
 
@@ -478,6 +494,10 @@ class LatticeFasterDecoderTpl {
   int32 num_toks_; // current total #toks allocated...
   bool warned_;
 
+  // Instrumentation; see Stats().  It is mutable because GetRawLattice(),
+  // which is const, records the lattice size.
+  mutable DecoderStats stats_;
+
   /// decoding_finalized_ is true if someone called FinalizeDecoding().  [note,
   /// calling this is optional].  If true, it's forbidden to decode more.  Also,
   /// if this is set, then the output of ComputeFinalCosts() is in the next
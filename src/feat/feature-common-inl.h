@@ -69,16 +69,36 @@ void OfflineFeatureTpl<F>::Compute(
     return;
   }
   output->Resize(rows_out, cols_out);
-  Vector<BaseFloat> window;  // windowed waveform.
   bool use_raw_log_energy = computer_.NeedRawLogEnergy();
-  for (int32 r = 0; r < rows_out; r++) {  // r is frame index.
-    BaseFloat raw_log_energy = 0.0;
-    ExtractWindow(0, wave, r, computer_.GetFrameOptions(),
-                  feature_window_function_, &window,
-                  (use_raw_log_energy ? &raw_log_energy : NULL));
+  if (batch_size_ == 1) {
+    Vector<BaseFloat> window;  // windowed waveform.
+    for (int32 r = 0; r < rows_out; r++) {  // r is frame index.
+      BaseFloat raw_log_energy = 0.0;
+      ExtractWindow(0, wave, r, computer_.GetFrameOptions(),
+                    feature_window_function_, &window,
+                    (use_raw_log_energy ? &raw_log_energy : NULL));
 
-    SubVector<BaseFloat> output_row(*output, r);
-    computer_.Compute(raw_log_energy, vtln_warp, &window, &output_row);
+      SubVector<BaseFloat> output_row(*output, r);
+      computer_.Compute(raw_log_energy, vtln_warp, &window, &output_row);
+    }
+  } else {
+    int32 padded_window_size = computer_.GetFrameOptions().PaddedWindowSize();
+    Matrix<BaseFloat> windows;  // windowed waveform, one frame per row.
+    Vector<BaseFloat> raw_log_energy;
+    for (int32 r = 0; r < rows_out; r += batch_size_) {  // r is frame index.
+      int32 num_frames = std::min(batch_size_, rows_out - r);
+      if (windows.NumRows() != num_frames) {
+        windows.Resize(num_frames, padded_window_size, kUndefined);
+        raw_log_energy.Resize(num_frames);
+      }
+      ExtractWindows(0, wave, r, computer_.GetFrameOptions(),
+                     feature_window_function_, &windows,
+                     (use_raw_log_energy ? &raw_log_energy : NULL));
+
+      SubMatrix<BaseFloat> output_rows(*output, r, num_frames, 0, cols_out);
+      computer_.ComputeBatch(raw_log_energy, vtln_warp, &windows,
+                             &output_rows);
+    }
   }
 }
 
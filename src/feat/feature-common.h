@@ -21,7 +21,9 @@
 #define KALDI_FEAT_FEATURE_COMMON_H_
 
 #include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "feat/feature-window.h"
 
 namespace kaldi {
@@ -94,6 +96,26 @@ class ExampleFeatureComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /**
+     Batched version of Compute(), that computes the features for several
+     frames at once.  The output is the same as calling Compute() for each
+     row (up to roundoff).
+     OfflineFeatureTpl uses this, rather than Compute(), to compute the
+     features of a whole file.
+     @param [in] signal_raw_log_energy  The raw log-energy of each frame (see
+         Compute()); must be ignored if this->NeedRawLogEnergy() returns false.
+     @param [in] vtln_warp  The VTLN warping factor, as for Compute().
+     @param [in] signal_frames  The frames of the signal, one per row, as
+       extracted by ExtractWindows().  Used as a workspace.
+     @param [out] features  A matrix with the same number of rows as
+         'signal_frames' and this->Dim() columns, to which the features
+         will be written.
+  */
+  void ComputeBatch(const VectorBase<BaseFloat> &signal_raw_log_energy,
+                    BaseFloat vtln_warp,
+                    MatrixBase<BaseFloat> *signal_frames,
+                    MatrixBase<BaseFloat> *features);
+
  private:
   // disallow assignment.
   ExampleFeatureComputer &operator = (const ExampleFeatureComputer &in);
@@ -116,7 +138,8 @@ class OfflineFeatureTpl {
   // using the options class, that we cache at this level.
   OfflineFeatureTpl(const Options &opts):
       computer_(opts),
-      feature_window_function_(computer_.GetFrameOptions()) { }
+      feature_window_function_(computer_.GetFrameOptions()),
+      batch_size_(64) { }
 
   // Internal (and back-compatibility) interface for computing features, which
   // requires that the user has already checked that the sampling frequency
@@ -155,16 +178,71 @@ class OfflineFeatureTpl {
 
   int32 Dim() const { return computer_.Dim(); }
 
+  /// Sets the number of frames that Compute() processes at a time, with
+  /// the computer's ComputeBatch() function (the default is 64).  If set to
+  /// 1, it processes the frames one at a time with Compute(), which is
+  /// slower; the results are the same up to roundoff.
+  void SetBatchSize(int32 batch_size) {
+    KALDI_ASSERT(batch_size > 0);
+    batch_size_ = batch_size;
+  }
+
   // Copy constructor.
   OfflineFeatureTpl(const OfflineFeatureTpl<F> &other):
       computer_(other.computer_),
-      feature_window_function_(other.feature_window_function_) { }
+      feature_window_function_(other.feature_window_function_),
+      batch_size_(other.batch_size_) { }
   private:
   // Disallow assignment.
   OfflineFeatureTpl<F> &operator =(const OfflineFeatureTpl<F> &other);
 
   F computer_;
   FeatureWindowFunction feature_window_function_;
+  int32 batch_size_;
+};
+
+
+/// OfflineFeaturePool is for programs that compute the features of several
+/// files in parallel.  OfflineFeatureTpl is not thread safe (e.g. it caches
+/// the mel banks for each VTLN warp factor), so each thread needs its own
+/// copy; a thread gets one with Get() and gives it back with Release() when
+/// done, so the copies are only made once per thread rather than once per
+/// file.
+template <class F>
+class OfflineFeaturePool {
+ public:
+  /// 'extractor' is the object to copy; it must outlive this object.
+  explicit OfflineFeaturePool(const OfflineFeatureTpl<F> &extractor):
+      extractor_(extractor) { }
+
+  OfflineFeatureTpl<F> *Get() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_extractors_.empty()) {
+      all_extractors_.push_back(new OfflineFeatureTpl<F>(extractor_));
+      return all_extractors_.back();
+    }
+    OfflineFeatureTpl<F> *ans = free_extractors_.back();
+    free_extractors_.pop_back();
+    return ans;
+  }
+
+  void Release(OfflineFeatureTpl<F> *extractor) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_extractors_.push_back(extractor);
+  }
+
+  ~OfflineFeaturePool() {
+    for (size_t i = 0; i < all_extractors_.size(); i++)
+      delete all_extractors_[i];
+  }
+
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OfflineFeaturePool);
+
+  const OfflineFeatureTpl<F> &extractor_;
+  std::mutex mutex_;
+  std::vector<OfflineFeatureTpl<F>*> all_extractors_;
+  std::vector<OfflineFeatureTpl<F>*> free_extractors_;
 };
 
 /// @} End of "addtogroup feat"
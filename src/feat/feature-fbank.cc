@@ -40,33 +40,20 @@ FbankComputer::FbankComputer(const FbankOptions &opts):
 FbankComputer::FbankComputer(const FbankComputer &other):
     opts_(other.opts_), log_energy_floor_(other.log_energy_floor_),
     mel_banks_(other.mel_banks_), srfft_(NULL) {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-      iter != mel_banks_.end();
-      ++iter)
-    iter->second = new MelBanks(*(iter->second));
   if (other.srfft_)
     srfft_ = new SplitRadixRealFft<BaseFloat>(*(other.srfft_));
 }
 
 FbankComputer::~FbankComputer() {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-      iter != mel_banks_.end(); ++iter)
-    delete iter->second;
   delete srfft_;
 }
 
-const MelBanks* FbankComputer::GetMelBanks(BaseFloat vtln_warp) {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.find(vtln_warp);
-  if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
-    mel_banks_[vtln_warp] = this_mel_banks;
-  } else {
-    this_mel_banks = iter->second;
-  }
-  return this_mel_banks;
+const MelBanks *FbankComputer::GetMelBanks(BaseFloat vtln_warp) {
+  std::shared_ptr<const MelBanks> &this_mel_banks = mel_banks_[vtln_warp];
+  if (this_mel_banks == nullptr)
+    this_mel_banks = GetSharedMelBanks(opts_.mel_opts, opts_.frame_opts,
+                                       vtln_warp);
+  return this_mel_banks.get();
 }
 
 void FbankComputer::Compute(BaseFloat signal_raw_log_energy,
@@ -122,4 +109,67 @@ void FbankComputer::Compute(BaseFloat signal_raw_log_energy,
   }
 }
 
+void FbankComputer::ComputeBatch(
+    const VectorBase<BaseFloat> &signal_raw_log_energy,
+    BaseFloat vtln_warp,
+    MatrixBase<BaseFloat> *signal_frames,
+    MatrixBase<BaseFloat> *features) {
+  int32 num_frames = signal_frames->NumRows(),
+      padded_window_size = signal_frames->NumCols();
+  KALDI_ASSERT(padded_window_size == opts_.frame_opts.PaddedWindowSize() &&
+               features->NumRows() == num_frames &&
+               features->NumCols() == this->Dim());
+
+  const MelBanks &mel_banks = *(GetMelBanks(vtln_warp));
+
+  // Compute energy after window function (not the raw one).
+  Vector<BaseFloat> log_energy;
+  if (opts_.use_energy) {
+    if (opts_.raw_energy) {
+      log_energy = signal_raw_log_energy;
+    } else {
+      log_energy.Resize(num_frames, kUndefined);
+      log_energy.AddDiagMat2(1.0, *signal_frames, kNoTrans, 0.0);
+      log_energy.ApplyFloor(std::numeric_limits<float>::epsilon());
+      log_energy.ApplyLog();
+    }
+  }
+
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> signal_frame(*signal_frames, r);
+    if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
+      srfft_->Compute(signal_frame.Data(), true);
+    else  // An alternative algorithm that works for non-powers-of-two.
+      RealFft(&signal_frame, true);
+    // Convert the FFT into a power spectrum.
+    ComputePowerSpectrum(&signal_frame);
+  }
+  SubMatrix<BaseFloat> power_spectra(*signal_frames, 0, num_frames,
+                                     0, padded_window_size / 2 + 1);
+
+  // Use magnitude instead of power if requested.
+  if (!opts_.use_power)
+    power_spectra.ApplyPow(0.5);
+
+  int32 mel_offset = ((opts_.use_energy && !opts_.htk_compat) ? 1 : 0);
+  SubMatrix<BaseFloat> mel_energies(*features, 0, num_frames,
+                                    mel_offset, opts_.mel_opts.num_bins);
+
+  // Sum with mel fiterbanks over the power spectra
+  mel_banks.Compute(power_spectra, &mel_energies);
+  if (opts_.use_log_fbank) {
+    // Avoid log of zero (which should be prevented anyway by dithering).
+    mel_energies.ApplyFloor(std::numeric_limits<float>::epsilon());
+    mel_energies.ApplyLog();  // take the log.
+  }
+
+  // Copy energy as first value (or the last, if htk_compat == true).
+  if (opts_.use_energy) {
+    if (opts_.energy_floor > 0.0)
+      log_energy.ApplyFloor(log_energy_floor_);
+    int32 energy_index = opts_.htk_compat ? opts_.mel_opts.num_bins : 0;
+    features->CopyColFromVec(log_energy, energy_index);
+  }
+}
+
 }  // namespace kaldi
@@ -22,6 +22,7 @@
 #define KALDI_FEAT_FEATURE_FBANK_H_
 
 #include <map>
+#include <memory>
 #include <string>
 
 #include "feat/feature-common.h"
@@ -126,6 +127,26 @@ class FbankComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /**
+     Batched version of Compute(), that computes the features for several
+     frames at once.  The output is the same as calling Compute() for each
+     row (up to roundoff).
+     It uses a matrix multiplication for the Mel filterbank, which is
+     considerably faster than Compute().
+     @param [in] signal_raw_log_energy  The raw log-energy of each frame (see
+         Compute()); must be ignored if this->NeedRawLogEnergy() returns false.
+     @param [in] vtln_warp  The VTLN warping factor, as for Compute().
+     @param [in] signal_frames  The frames of the signal, one per row, as
+       extracted by ExtractWindows().  Used as a workspace.
+     @param [out] features  A matrix with the same number of rows as
+         'signal_frames' and this->Dim() columns, to which the features
+         will be written.
+  */
+  void ComputeBatch(const VectorBase<BaseFloat> &signal_raw_log_energy,
+                    BaseFloat vtln_warp,
+                    MatrixBase<BaseFloat> *signal_frames,
+                    MatrixBase<BaseFloat> *features);
+
   ~FbankComputer();
 
  private:
@@ -134,7 +155,9 @@ class FbankComputer {
 
   FbankOptions opts_;
   BaseFloat log_energy_floor_;
-  std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
+  // BaseFloat is VTLN coefficient.  The MelBanks come from
+  // GetSharedMelBanks(), so they are shared with other computers.
+  std::map<BaseFloat, std::shared_ptr<const MelBanks> > mel_banks_;
   SplitRadixRealFft<BaseFloat> *srfft_;
   // Disallow assignment.
   FbankComputer &operator =(const FbankComputer &other);
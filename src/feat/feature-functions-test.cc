@@ -92,6 +92,47 @@ void UnitTestOnlineCmvn() {
   }
 }
 
+// Checks ComputePowerSpectrum(), which may use SIMD code, against the
+// definition.
+void UnitTestComputePowerSpectrum() {
+  for (int32 i = 0; i < 100; i++) {
+    int32 dim = 2 * RandInt(1, 300);
+    Vector<BaseFloat> fft(dim);
+    fft.SetRandn();
+    Vector<BaseFloat> power(fft);
+    ComputePowerSpectrum(&power);
+    AssertEqual(power(0), fft(0) * fft(0));
+    AssertEqual(power(dim / 2), fft(1) * fft(1));
+    for (int32 j = 1; j < dim / 2; j++)
+      AssertEqual(power(j), fft(2 * j) * fft(2 * j) +
+                  fft(2 * j + 1) * fft(2 * j + 1));
+  }
+}
+
+// Checks that ProcessWindows(), which may use SIMD code, gives the same
+// output as ProcessWindow() on each frame.
+void UnitTestProcessWindows() {
+  for (int32 i = 0; i < 20; i++) {
+    FrameExtractionOptions opts;
+    opts.dither = 0.0;
+    opts.frame_length_ms = RandInt(1, 30);
+    opts.preemph_coeff = (i % 3 == 0 ? 0.0 : RandUniform());
+    opts.remove_dc_offset = (i % 2 == 0);
+    FeatureWindowFunction window_function(opts);
+    int32 num_frames = RandInt(1, 10), frame_length = opts.WindowSize();
+    Matrix<BaseFloat> windows(num_frames, frame_length);
+    windows.SetRandn();
+    Matrix<BaseFloat> windows_ref(windows);
+    Vector<BaseFloat> log_energy(num_frames), log_energy_ref(num_frames);
+    ProcessWindows(opts, window_function, &windows, &log_energy);
+    for (int32 r = 0; r < num_frames; r++) {
+      SubVector<BaseFloat> window(windows_ref, r);
+      ProcessWindow(opts, window_function, &window, &(log_energy_ref(r)));
+    }
+    AssertEqual(windows_ref, windows);
+    AssertEqual(log_energy_ref, log_energy);
+  }
+}
 
 }
 
@@ -101,6 +142,8 @@ int main() {
   using namespace kaldi;
   try {
     UnitTestOnlineCmvn();
+    UnitTestComputePowerSpectrum();
+    UnitTestProcessWindows();
     std::cout << "Tests succeeded.\n";
     return 0;
   } catch (const std::exception &e) {
@@ -20,6 +20,18 @@
 // limitations under the License.
 
 
+#include "base/kaldi-types.h"
+#if (KALDI_DOUBLEPRECISION == 0)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define KALDI_FEATURE_FUNCTIONS_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KALDI_FEATURE_FUNCTIONS_SSE2
+#endif
+#endif  // KALDI_DOUBLEPRECISION == 0
 #include "feat/feature-functions.h"
 #include "matrix/matrix-functions.h"
 
@@ -41,9 +53,37 @@ void ComputePowerSpectrum(VectorBase<BaseFloat> *waveform) {
   int32 half_dim = dim/2;
   BaseFloat first_energy = (*waveform)(0) * (*waveform)(0),
       last_energy = (*waveform)(1) * (*waveform)(1);  // handle this special case
-  for (int32 i = 1; i < half_dim; i++) {
-    BaseFloat real = (*waveform)(i*2), im = (*waveform)(i*2 + 1);
-    (*waveform)(i) = real*real + im*im;
+  // Output i only overwrites inputs that were already used, since they are at
+  // 2i and 2i + 1; the SIMD loops load all of their inputs before storing.
+  BaseFloat *data = waveform->Data();
+  int32 i = 1;
+#ifdef KALDI_FEATURE_FUNCTIONS_AVX2
+  for (; i + 8 <= half_dim; i += 8) {
+    __m256 a = _mm256_loadu_ps(data + 2 * i),
+        b = _mm256_loadu_ps(data + 2 * i + 8),
+        // Within each 128-bit lane, the real and imaginary parts of 2 bins of
+        // a, then of b, so the bins are in the order 0 1 4 5 2 3 6 7.
+        real = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+        im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)),
+        energy = _mm256_add_ps(_mm256_mul_ps(real, real),
+                               _mm256_mul_ps(im, im));
+    _mm256_storeu_ps(data + i, _mm256_castpd_ps(_mm256_permute4x64_pd(
+        _mm256_castps_pd(energy), _MM_SHUFFLE(3, 1, 2, 0))));
+  }
+#endif  // KALDI_FEATURE_FUNCTIONS_AVX2
+#ifdef KALDI_FEATURE_FUNCTIONS_SSE2
+  for (; i + 4 <= half_dim; i += 4) {
+    __m128 a = _mm_loadu_ps(data + 2 * i),
+        b = _mm_loadu_ps(data + 2 * i + 4),
+        real = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+        im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_ps(data + i, _mm_add_ps(_mm_mul_ps(real, real),
+                                       _mm_mul_ps(im, im)));
+  }
+#endif  // KALDI_FEATURE_FUNCTIONS_SSE2
+  for (; i < half_dim; i++) {
+    BaseFloat real = data[i*2], im = data[i*2 + 1];
+    data[i] = real*real + im*im;
   }
   (*waveform)(0) = first_energy;
   (*waveform)(half_dim) = last_energy;  // Will actually never be used, and anyway
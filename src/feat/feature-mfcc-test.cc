@@ -653,8 +653,58 @@ void UnitTestVtln() {
   }
 }
 
+static void UnitTestMelBanks() {
+  MelBanksOptions opts(10 + Rand() % 70);
+  opts.htk_mode = (Rand() % 2 == 0);
+  FrameExtractionOptions frame_opts;
+  frame_opts.round_to_power_of_two = (Rand() % 2 == 0);
+  BaseFloat warp_factor = (Rand() % 2 == 0 ? 1.0 :
+                           0.85 + 0.3 * RandUniform());
+
+  // Check that the cache gives the same object for the same options.
+  std::shared_ptr<const MelBanks> mel_banks =
+      GetSharedMelBanks(opts, frame_opts, warp_factor);
+  KALDI_ASSERT(GetSharedMelBanks(opts, frame_opts, warp_factor) == mel_banks);
+  MelBanks mel_banks_copy(opts, frame_opts, warp_factor);
+  opts.num_bins++;
+  KALDI_ASSERT(GetSharedMelBanks(opts, frame_opts, warp_factor) != mel_banks);
+
+  // Check that the batched computation agrees with the frame-by-frame one,
+  // and with applying the bins as a matrix.
+  int32 num_bins = mel_banks->NumBins(),
+      num_fft_bins = frame_opts.PaddedWindowSize() / 2,
+      num_frames = 1 + Rand() % 20;
+  Matrix<BaseFloat> power_spectra(num_frames, num_fft_bins + 1),
+      mel_energies(num_frames, num_bins),
+      bins_matrix(num_bins, num_fft_bins + 1);
+  power_spectra.SetRandUniform();
+  power_spectra.Scale(10.0);
+  mel_banks->Compute(power_spectra, &mel_energies);
+
+  std::vector<std::pair<int32, Vector<BaseFloat> > > bins =
+      mel_banks->GetBins();
+  KALDI_ASSERT(static_cast<int32>(bins.size()) == num_bins);
+  for (int32 i = 0; i < num_bins; i++)
+    bins_matrix.Row(i).Range(bins[i].first,
+                             bins[i].second.Dim()).CopyFromVec(bins[i].second);
+  Matrix<BaseFloat> mel_energies2(num_frames, num_bins);
+  mel_energies2.AddMatMat(1.0, power_spectra, kNoTrans, bins_matrix, kTrans,
+                          0.0);
+  if (opts.htk_mode)
+    mel_energies2.ApplyFloor(1.0);
+  AssertEqual(mel_energies, mel_energies2);
+
+  for (int32 r = 0; r < num_frames; r++) {
+    Vector<BaseFloat> mel_energies_row(num_bins);
+    mel_banks_copy.Compute(power_spectra.Row(r), &mel_energies_row);
+    SubVector<BaseFloat> mel_energies_batched(mel_energies, r);
+    AssertEqual(mel_energies_row, mel_energies_batched);
+  }
+}
+
 static void UnitTestFeat() {
   UnitTestVtln();
+  UnitTestMelBanks();
   UnitTestReadWave();
   UnitTestSimple();
   UnitTestHTKCompare1();
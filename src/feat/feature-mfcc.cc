@@ -79,6 +79,76 @@ void MfccComputer::Compute(BaseFloat signal_raw_log_energy,
   }
 }
 
+void MfccComputer::ComputeBatch(
+    const VectorBase<BaseFloat> &signal_raw_log_energy,
+    BaseFloat vtln_warp,
+    MatrixBase<BaseFloat> *signal_frames,
+    MatrixBase<BaseFloat> *features) {
+  int32 num_frames = signal_frames->NumRows(),
+      padded_window_size = signal_frames->NumCols();
+  KALDI_ASSERT(padded_window_size == opts_.frame_opts.PaddedWindowSize() &&
+               features->NumRows() == num_frames &&
+               features->NumCols() == this->Dim());
+
+  const MelBanks &mel_banks = *(GetMelBanks(vtln_warp));
+
+  Vector<BaseFloat> log_energy;
+  if (opts_.use_energy) {
+    if (opts_.raw_energy) {
+      log_energy = signal_raw_log_energy;
+    } else {
+      log_energy.Resize(num_frames, kUndefined);
+      log_energy.AddDiagMat2(1.0, *signal_frames, kNoTrans, 0.0);
+      log_energy.ApplyFloor(std::numeric_limits<float>::epsilon());
+      log_energy.ApplyLog();
+    }
+  }
+
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> signal_frame(*signal_frames, r);
+    if (srfft_ != NULL)  // Compute FFT using the split-radix algorithm.
+      srfft_->Compute(signal_frame.Data(), true);
+    else  // An alternative algorithm that works for non-powers-of-two.
+      RealFft(&signal_frame, true);
+    // Convert the FFT into a power spectrum.
+    ComputePowerSpectrum(&signal_frame);
+  }
+  SubMatrix<BaseFloat> power_spectra(*signal_frames, 0, num_frames,
+                                     0, padded_window_size / 2 + 1);
+
+  Matrix<BaseFloat> mel_energies(num_frames, opts_.mel_opts.num_bins,
+                                 kUndefined);
+  mel_banks.Compute(power_spectra, &mel_energies);
+
+  // avoid log of zero (which should be prevented anyway by dithering).
+  mel_energies.ApplyFloor(std::numeric_limits<float>::epsilon());
+  mel_energies.ApplyLog();  // take the log.
+
+  features->SetZero();  // in case there were NaNs.
+  // features = mel_energies [which now have log] * dct_matrix_^T
+  features->AddMatMat(1.0, mel_energies, kNoTrans, dct_matrix_, kTrans, 0.0);
+
+  if (opts_.cepstral_lifter != 0.0)
+    features->MulColsVec(lifter_coeffs_);
+
+  if (opts_.use_energy) {
+    if (opts_.energy_floor > 0.0)
+      log_energy.ApplyFloor(log_energy_floor_);
+    features->CopyColFromVec(log_energy, 0);
+  }
+
+  if (opts_.htk_compat) {
+    // Move the energy or C0 to the last column; see Compute().
+    Vector<BaseFloat> energy(num_frames, kUndefined);
+    energy.CopyColFromMat(*features, 0);
+    if (!opts_.use_energy)
+      energy.Scale(M_SQRT2);
+    Matrix<BaseFloat> cepstra(features->ColRange(1, opts_.num_ceps - 1));
+    features->ColRange(0, opts_.num_ceps - 1).CopyFromMat(cepstra);
+    features->CopyColFromVec(energy, opts_.num_ceps - 1);
+  }
+}
+
 MfccComputer::MfccComputer(const MfccOptions &opts):
     opts_(opts), srfft_(NULL),
     mel_energies_(opts.mel_opts.num_bins) {
@@ -121,9 +191,6 @@ MfccComputer::MfccComputer(const MfccComputer &other):
     mel_banks_(other.mel_banks_),
     srfft_(NULL),
     mel_energies_(other.mel_energies_.Dim(), kUndefined) {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-       iter != mel_banks_.end(); ++iter)
-    iter->second = new MelBanks(*(iter->second));
   if (other.srfft_ != NULL)
     srfft_ = new SplitRadixRealFft<BaseFloat>(*(other.srfft_));
 }
@@ -131,25 +198,15 @@ MfccComputer::MfccComputer(const MfccComputer &other):
 
 
 MfccComputer::~MfccComputer() {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-      iter != mel_banks_.end();
-      ++iter)
-    delete iter->second;
   delete srfft_;
 }
 
 const MelBanks *MfccComputer::GetMelBanks(BaseFloat vtln_warp) {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.find(vtln_warp);
-  if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
-    mel_banks_[vtln_warp] = this_mel_banks;
-  } else {
-    this_mel_banks = iter->second;
-  }
-  return this_mel_banks;
+  std::shared_ptr<const MelBanks> &this_mel_banks = mel_banks_[vtln_warp];
+  if (this_mel_banks == nullptr)
+    this_mel_banks = GetSharedMelBanks(opts_.mel_opts, opts_.frame_opts,
+                                       vtln_warp);
+  return this_mel_banks.get();
 }
 
 
@@ -22,6 +22,7 @@
 #define KALDI_FEAT_FEATURE_MFCC_H_
 
 #include <map>
+#include <memory>
 #include <string>
 
 #include "feat/feature-common.h"
@@ -124,6 +125,26 @@ class MfccComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /**
+     Batched version of Compute(), that computes the features for several
+     frames at once.  The output is the same as calling Compute() for each
+     row (up to roundoff).
+     It uses matrix operations for the Mel filterbank, the DCT and
+     liftering, which is considerably faster than Compute().
+     @param [in] signal_raw_log_energy  The raw log-energy of each frame (see
+         Compute()); must be ignored if this->NeedRawLogEnergy() returns false.
+     @param [in] vtln_warp  The VTLN warping factor, as for Compute().
+     @param [in] signal_frames  The frames of the signal, one per row, as
+       extracted by ExtractWindows().  Used as a workspace.
+     @param [out] features  A matrix with the same number of rows as
+         'signal_frames' and this->Dim() columns, to which the features
+         will be written.
+  */
+  void ComputeBatch(const VectorBase<BaseFloat> &signal_raw_log_energy,
+                    BaseFloat vtln_warp,
+                    MatrixBase<BaseFloat> *signal_frames,
+                    MatrixBase<BaseFloat> *features);
+
   ~MfccComputer();
  private:
   // disallow assignment.
@@ -136,7 +157,9 @@ class MfccComputer {
   Vector<BaseFloat> lifter_coeffs_;
   Matrix<BaseFloat> dct_matrix_;  // matrix we left-multiply by to perform DCT.
   BaseFloat log_energy_floor_;
-  std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
+  // BaseFloat is VTLN coefficient.  The MelBanks come from
+  // GetSharedMelBanks(), so they are shared with other computers.
+  std::map<BaseFloat, std::shared_ptr<const MelBanks> > mel_banks_;
   SplitRadixRealFft<BaseFloat> *srfft_;
 
   // note: mel_energies_ is specific to the frame we're processing, it's
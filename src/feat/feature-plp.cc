@@ -58,9 +58,6 @@ PlpComputer::PlpComputer(const PlpComputer &other):
     autocorr_coeffs_(opts_.lpc_order + 1, kUndefined),
     lpc_coeffs_(opts_.lpc_order, kUndefined),
     raw_cepstrum_(opts_.lpc_order, kUndefined) {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-       iter != mel_banks_.end(); ++iter)
-    iter->second = new MelBanks(*(iter->second));
   for (std::map<BaseFloat, Vector<BaseFloat>*>::iterator
            iter = equal_loudness_.begin();
        iter != equal_loudness_.end(); ++iter)
@@ -70,9 +67,6 @@ PlpComputer::PlpComputer(const PlpComputer &other):
 }
 
 PlpComputer::~PlpComputer() {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-      iter != mel_banks_.end(); ++iter)
-    delete iter->second;
   for (std::map<BaseFloat, Vector<BaseFloat>* >::iterator
            iter = equal_loudness_.begin();
        iter != equal_loudness_.end(); ++iter)
@@ -81,17 +75,11 @@ PlpComputer::~PlpComputer() {
 }
 
 const MelBanks *PlpComputer::GetMelBanks(BaseFloat vtln_warp) {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.find(vtln_warp);
-  if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
-    mel_banks_[vtln_warp] = this_mel_banks;
-  } else {
-    this_mel_banks = iter->second;
-  }
-  return this_mel_banks;
+  std::shared_ptr<const MelBanks> &this_mel_banks = mel_banks_[vtln_warp];
+  if (this_mel_banks == nullptr)
+    this_mel_banks = GetSharedMelBanks(opts_.mel_opts, opts_.frame_opts,
+                                       vtln_warp);
+  return this_mel_banks.get();
 }
 
 const Vector<BaseFloat> *PlpComputer::GetEqualLoudness(BaseFloat vtln_warp) {
@@ -187,5 +175,21 @@ void PlpComputer::Compute(BaseFloat signal_raw_log_energy,
   }
 }
 
+void PlpComputer::ComputeBatch(
+    const VectorBase<BaseFloat> &signal_raw_log_energy,
+    BaseFloat vtln_warp,
+    MatrixBase<BaseFloat> *signal_frames,
+    MatrixBase<BaseFloat> *features) {
+  int32 num_frames = signal_frames->NumRows();
+  KALDI_ASSERT(features->NumRows() == num_frames);
+  bool need_raw_log_energy = NeedRawLogEnergy();
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> signal_frame(*signal_frames, r),
+        feature(*features, r);
+    Compute(need_raw_log_energy ? signal_raw_log_energy(r) : 0.0,
+            vtln_warp, &signal_frame, &feature);
+  }
+}
+
 
 }  // namespace kaldi
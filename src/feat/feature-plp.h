@@ -21,6 +21,7 @@
 #define KALDI_FEAT_FEATURE_PLP_H_
 
 #include <map>
+#include <memory>
 #include <string>
 
 #include "feat/feature-common.h"
@@ -138,6 +139,25 @@ class PlpComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /**
+     Batched version of Compute(), that computes the features for several
+     frames at once.  The output is the same as calling Compute() for each
+     row (up to roundoff).
+     Currently this just calls Compute() on each frame.
+     @param [in] signal_raw_log_energy  The raw log-energy of each frame (see
+         Compute()); must be ignored if this->NeedRawLogEnergy() returns false.
+     @param [in] vtln_warp  The VTLN warping factor, as for Compute().
+     @param [in] signal_frames  The frames of the signal, one per row, as
+       extracted by ExtractWindows().  Used as a workspace.
+     @param [out] features  A matrix with the same number of rows as
+         'signal_frames' and this->Dim() columns, to which the features
+         will be written.
+  */
+  void ComputeBatch(const VectorBase<BaseFloat> &signal_raw_log_energy,
+                    BaseFloat vtln_warp,
+                    MatrixBase<BaseFloat> *signal_frames,
+                    MatrixBase<BaseFloat> *features);
+
   ~PlpComputer();
  private:
 
@@ -149,7 +169,9 @@ class PlpComputer {
   Vector<BaseFloat> lifter_coeffs_;
   Matrix<BaseFloat> idft_bases_;
   BaseFloat log_energy_floor_;
-  std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
+  // BaseFloat is VTLN coefficient.  The MelBanks come from
+  // GetSharedMelBanks(), so they are shared with other computers.
+  std::map<BaseFloat, std::shared_ptr<const MelBanks> > mel_banks_;
   std::map<BaseFloat, Vector<BaseFloat>* > equal_loudness_;
   SplitRadixRealFft<BaseFloat> *srfft_;
 
@@ -84,4 +84,20 @@ void SpectrogramComputer::Compute(BaseFloat signal_raw_log_energy,
   (*feature)(0) = signal_raw_log_energy;
 }
 
+void SpectrogramComputer::ComputeBatch(
+    const VectorBase<BaseFloat> &signal_raw_log_energy,
+    BaseFloat vtln_warp,
+    MatrixBase<BaseFloat> *signal_frames,
+    MatrixBase<BaseFloat> *features) {
+  int32 num_frames = signal_frames->NumRows();
+  KALDI_ASSERT(features->NumRows() == num_frames);
+  bool need_raw_log_energy = NeedRawLogEnergy();
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> signal_frame(*signal_frames, r),
+        feature(*features, r);
+    Compute(need_raw_log_energy ? signal_raw_log_energy(r) : 0.0,
+            vtln_warp, &signal_frame, &feature);
+  }
+}
+
 }  // namespace kaldi
@@ -0,0 +1,117 @@
+// feat/feature-speed-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/feature-mfcc.h"
+#include "feat/feature-fbank.h"
+#include "feat/feature-plp.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+// Compares the batched computation of features (the default) with the
+// frame-by-frame one, checking that the results are the same and printing the
+// time taken by each.
+template <class F>
+static void CompareBatchedSpeed(const std::string &name,
+                                const typename F::Options &opts,
+                                const VectorBase<BaseFloat> &wave,
+                                int32 num_repeats) {
+  OfflineFeatureTpl<F> batched(opts), unbatched(opts);
+  unbatched.SetBatchSize(1);
+  Matrix<BaseFloat> batched_feats, unbatched_feats;
+
+  // We reset the random seed before each computation, so that dithering is
+  // the same for both versions.
+  Timer timer;
+  for (int32 i = 0; i < num_repeats; i++) {
+    srand(i);
+    unbatched.Compute(wave, 1.0, &unbatched_feats);
+  }
+  double unbatched_time = timer.Elapsed();
+  timer.Reset();
+  for (int32 i = 0; i < num_repeats; i++) {
+    srand(i);
+    batched.Compute(wave, 1.0, &batched_feats);
+  }
+  double batched_time = timer.Elapsed();
+
+  KALDI_ASSERT(batched_feats.NumRows() == unbatched_feats.NumRows() &&
+               batched_feats.NumCols() == unbatched_feats.NumCols());
+  if (!batched_feats.ApproxEqual(unbatched_feats, 1.0e-04))
+    KALDI_ERR << name << ": batched and frame-by-frame computation differ: "
+              << batched_feats.Row(0) << " vs. " << unbatched_feats.Row(0);
+
+  double audio_seconds = num_repeats * wave.Dim() /
+      opts.frame_opts.samp_freq;
+  KALDI_LOG << name << ": frame-by-frame took " << unbatched_time
+            << "s, batched took " << batched_time << "s for "
+            << audio_seconds << "s of audio; speedup is "
+            << (unbatched_time / batched_time);
+}
+
+static void UnitTestFeatureBatchedSpeed() {
+  Vector<BaseFloat> wave(16000 * 20);  // 20 seconds of audio.
+  wave.SetRandn();
+  wave.Scale(1000.0);
+  int32 num_repeats = 5;
+
+  for (int32 i = 0; i < 4; i++) {
+    MfccOptions mfcc_opts;
+    FbankOptions fbank_opts;
+    PlpOptions plp_opts;
+    // Go through a few of the configuration options that affect the batched
+    // code.
+    if (i % 2 == 1) {
+      mfcc_opts.frame_opts.dither = 0.0;
+      mfcc_opts.raw_energy = false;
+      mfcc_opts.htk_compat = true;
+      fbank_opts.frame_opts.dither = 0.0;
+      fbank_opts.use_energy = true;
+      fbank_opts.raw_energy = false;
+      fbank_opts.htk_compat = true;
+    }
+    if (i >= 2) {
+      mfcc_opts.frame_opts.snip_edges = false;
+      mfcc_opts.use_energy = false;
+      mfcc_opts.energy_floor = 1.0;
+      fbank_opts.frame_opts.snip_edges = false;
+      fbank_opts.mel_opts.num_bins = 80;
+      fbank_opts.use_power = false;
+      fbank_opts.energy_floor = 1.0;
+    }
+    CompareBatchedSpeed<MfccComputer>("MFCC", mfcc_opts, wave, num_repeats);
+    CompareBatchedSpeed<FbankComputer>("Fbank", fbank_opts, wave,
+                                       num_repeats);
+    if (i == 0)
+      CompareBatchedSpeed<PlpComputer>("PLP", plp_opts, wave, num_repeats);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  try {
+    kaldi::UnitTestFeatureBatchedSpeed();
+    std::cout << "Tests succeeded.\n";
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << e.what();
+    return 1;
+  }
+}
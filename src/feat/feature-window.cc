@@ -20,6 +20,18 @@
 // limitations under the License.
 
 
+#include "base/kaldi-types.h"
+#if (KALDI_DOUBLEPRECISION == 0)
+#if defined(__AVX__)
+#include <immintrin.h>
+#define KALDI_FEATURE_WINDOW_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KALDI_FEATURE_WINDOW_SSE2
+#endif
+#endif  // KALDI_DOUBLEPRECISION == 0
 #include "feat/feature-window.h"
 #include "matrix/matrix-functions.h"
 
@@ -160,19 +172,93 @@ void ProcessWindow(const FrameExtractionOptions &opts,
 }
 
 
-// ExtractWindow extracts a windowed frame of waveform with a power-of-two,
-// padded size.  It does mean subtraction, pre-emphasis and dithering as
-// requested.
-void ExtractWindow(int64 sample_offset,
-                   const VectorBase<BaseFloat> &wave,
-                   int32 f,  // with 0 <= f < NumFrames(feats, opts)
-                   const FrameExtractionOptions &opts,
-                   const FeatureWindowFunction &window_function,
-                   Vector<BaseFloat> *window,
-                   BaseFloat *log_energy_pre_window) {
-  KALDI_ASSERT(sample_offset >= 0 && wave.Dim() != 0);
+// Does the pre-emphasis of the 'dim' samples in 'data' (as Preemphasize())
+// and multiplies them by the window function, in one pass:
+// data[i] = (data[i] - preemph_coeff * data[i - 1]) * window[i], where
+// data[-1] is taken to be data[0].  We go from the end backward, so the
+// previous samples are read before they are modified.
+static void PreemphasizeAndWindow(BaseFloat preemph_coeff,
+                                  const BaseFloat *window,
+                                  int32 dim, BaseFloat *data) {
+  // i is the end of the samples that remain to be done.
+  int32 i = dim;
+#ifdef KALDI_FEATURE_WINDOW_AVX
+  __m256 coeff8 = _mm256_set1_ps(preemph_coeff);
+  for (; i >= 9; i -= 8) {
+    __m256 x = _mm256_loadu_ps(data + i - 8),
+        prev = _mm256_loadu_ps(data + i - 9),
+        w = _mm256_loadu_ps(window + i - 8);
+    _mm256_storeu_ps(data + i - 8, _mm256_mul_ps(
+        _mm256_sub_ps(x, _mm256_mul_ps(coeff8, prev)), w));
+  }
+#endif  // KALDI_FEATURE_WINDOW_AVX
+#ifdef KALDI_FEATURE_WINDOW_SSE2
+  __m128 coeff4 = _mm_set1_ps(preemph_coeff);
+  for (; i >= 5; i -= 4) {
+    __m128 x = _mm_loadu_ps(data + i - 4),
+        prev = _mm_loadu_ps(data + i - 5),
+        w = _mm_loadu_ps(window + i - 4);
+    _mm_storeu_ps(data + i - 4, _mm_mul_ps(
+        _mm_sub_ps(x, _mm_mul_ps(coeff4, prev)), w));
+  }
+#endif  // KALDI_FEATURE_WINDOW_SSE2
+  for (i--; i >= 1; i--)
+    data[i] = (data[i] - preemph_coeff * data[i - 1]) * window[i];
+  if (dim > 0)
+    data[0] = (data[0] - preemph_coeff * data[0]) * window[0];
+}
+
+void ProcessWindows(const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    MatrixBase<BaseFloat> *windows,
+                    VectorBase<BaseFloat> *log_energy_pre_window) {
   int32 frame_length = opts.WindowSize(),
-      frame_length_padded = opts.PaddedWindowSize();
+      num_frames = windows->NumRows();
+  KALDI_ASSERT(windows->NumCols() == frame_length);
+
+  if (opts.dither != 0.0) {
+    // We dither the frames in order, one by one, so that the random numbers
+    // are the same as with ProcessWindow().
+    for (int32 r = 0; r < num_frames; r++) {
+      SubVector<BaseFloat> window(*windows, r);
+      Dither(&window, opts.dither);
+    }
+  }
+
+  if (opts.remove_dc_offset) {
+    Vector<BaseFloat> offsets(num_frames);
+    offsets.AddColSumMat(-1.0 / frame_length, *windows, 0.0);
+    windows->AddVecToCols(1.0, offsets);
+  }
+
+  if (log_energy_pre_window != NULL) {
+    KALDI_ASSERT(log_energy_pre_window->Dim() == num_frames);
+    log_energy_pre_window->AddDiagMat2(1.0, *windows, kNoTrans, 0.0);
+    log_energy_pre_window->ApplyFloor(std::numeric_limits<float>::epsilon());
+    log_energy_pre_window->ApplyLog();
+  }
+
+  // Pre-emphasis (if preemph_coeff is zero it does nothing) and windowing.
+  KALDI_ASSERT(opts.preemph_coeff >= 0.0 && opts.preemph_coeff <= 1.0 &&
+               window_function.window.Dim() == frame_length);
+  for (int32 r = 0; r < num_frames; r++)
+    PreemphasizeAndWindow(opts.preemph_coeff, window_function.window.Data(),
+                          frame_length, windows->RowData(r));
+}
+
+
+// Copies the samples of frame f of the waveform (without any processing) to
+// 'window', which must have dimension opts.WindowSize(); it deals with edge
+// effects by reflection.  See ExtractWindow() for the meaning of the other
+// arguments.
+static void ExtractFrameSamples(int64 sample_offset,
+                                const VectorBase<BaseFloat> &wave,
+                                int32 f,
+                                const FrameExtractionOptions &opts,
+                                VectorBase<BaseFloat> *window) {
+  KALDI_ASSERT(sample_offset >= 0 && wave.Dim() != 0);
+  int32 frame_length = opts.WindowSize();
+  KALDI_ASSERT(window->Dim() == frame_length);
   int64 num_samples = sample_offset + wave.Dim(),
       start_sample = FirstSampleOfFrame(f, opts),
       end_sample = start_sample + frame_length;
@@ -184,17 +270,13 @@ void ExtractWindow(int64 sample_offset,
     KALDI_ASSERT(sample_offset == 0 || start_sample >= sample_offset);
   }
 
-  if (window->Dim() != frame_length_padded)
-    window->Resize(frame_length_padded, kUndefined);
-
   // wave_start and wave_end are start and end indexes into 'wave', for the
   // piece of wave that we're trying to extract.
   int32 wave_start = int32(start_sample - sample_offset),
       wave_end = wave_start + frame_length;
   if (wave_start >= 0 && wave_end <= wave.Dim()) {
     // the normal case-- no edge effects to consider.
-    window->Range(0, frame_length).CopyFromVec(
-        wave.Range(wave_start, frame_length));
+    window->CopyFromVec(wave.Range(wave_start, frame_length));
   } else {
     // Deal with any end effects by reflection, if needed.  This code will only
     // be reached for about two frames per utterance, so we don't concern
@@ -214,13 +296,55 @@ void ExtractWindow(int64 sample_offset,
       (*window)(s) = wave(s_in_wave);
     }
   }
+}
 
-  if (frame_length_padded > frame_length)
-    window->Range(frame_length, frame_length_padded - frame_length).SetZero();
+// ExtractWindow extracts a windowed frame of waveform with a power-of-two,
+// padded size.  It does mean subtraction, pre-emphasis and dithering as
+// requested.
+void ExtractWindow(int64 sample_offset,
+                   const VectorBase<BaseFloat> &wave,
+                   int32 f,  // with 0 <= f < NumFrames(feats, opts)
+                   const FrameExtractionOptions &opts,
+                   const FeatureWindowFunction &window_function,
+                   Vector<BaseFloat> *window,
+                   BaseFloat *log_energy_pre_window) {
+  int32 frame_length = opts.WindowSize(),
+      frame_length_padded = opts.PaddedWindowSize();
+
+  if (window->Dim() != frame_length_padded)
+    window->Resize(frame_length_padded, kUndefined);
 
   SubVector<BaseFloat> frame(*window, 0, frame_length);
+  ExtractFrameSamples(sample_offset, wave, f, opts, &frame);
+
+  if (frame_length_padded > frame_length)
+    window->Range(frame_length, frame_length_padded - frame_length).SetZero();
 
   ProcessWindow(opts, window_function, &frame, log_energy_pre_window);
 }
 
+void ExtractWindows(int64 sample_offset,
+                    const VectorBase<BaseFloat> &wave,
+                    int32 first_frame,
+                    const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    MatrixBase<BaseFloat> *windows,
+                    VectorBase<BaseFloat> *log_energy_pre_window) {
+  int32 frame_length = opts.WindowSize(),
+      frame_length_padded = opts.PaddedWindowSize(),
+      num_frames = windows->NumRows();
+  KALDI_ASSERT(windows->NumCols() == frame_length_padded);
+
+  SubMatrix<BaseFloat> frames(*windows, 0, num_frames, 0, frame_length);
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> frame(frames, r);
+    ExtractFrameSamples(sample_offset, wave, first_frame + r, opts, &frame);
+  }
+  if (frame_length_padded > frame_length)
+    windows->ColRange(frame_length,
+                      frame_length_padded - frame_length).SetZero();
+
+  ProcessWindows(opts, window_function, &frames, log_energy_pre_window);
+}
+
 }  // namespace kaldi
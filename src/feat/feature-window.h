@@ -216,6 +216,44 @@ void ExtractWindow(int64 sample_offset,
                    BaseFloat *log_energy_pre_window = NULL);
 
 
+/**
+  This is a batched version of ProcessWindow(), which processes many frames at
+  once using matrix operations, and does the pre-emphasis and windowing in a
+  single pass with SSE2 or AVX code if compiled with it; the output is the
+  same as calling ProcessWindow() on each row of 'windows' in turn (up to
+  roundoff), including the random numbers used for dithering.
+   @param [in] opts  The options class to be used
+   @param [in] window_function  The windowing function-- should have
+                    been initialized using 'opts'.
+   @param [in,out] windows  A matrix with opts.WindowSize() columns, whose
+                    rows are the frames.
+   @param [out]   log_energy_pre_window If non-NULL, a vector of dimension
+                    windows->NumRows() to which the log-energy of each frame
+                    (see ProcessWindow()) will be written.
+ */
+void ProcessWindows(const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    MatrixBase<BaseFloat> *windows,
+                    VectorBase<BaseFloat> *log_energy_pre_window = NULL);
+
+
+/**
+  This is a batched version of ExtractWindow(), which extracts the frames
+  first_frame, first_frame + 1, ... first_frame + windows->NumRows() - 1
+  into the rows of 'windows', which must have opts.PaddedWindowSize()
+  columns.  The processing is done by ProcessWindows().  The other arguments
+  are as for ExtractWindow(), except that 'log_energy_pre_window', if
+  non-NULL, must have dimension windows->NumRows().
+*/
+void ExtractWindows(int64 sample_offset,
+                    const VectorBase<BaseFloat> &wave,
+                    int32 first_frame,
+                    const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    MatrixBase<BaseFloat> *windows,
+                    VectorBase<BaseFloat> *log_energy_pre_window = NULL);
+
+
 /// @} End of "addtogroup feat"
 }  // namespace kaldi
 
@@ -22,10 +22,14 @@
 #include <float.h>
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 #include "feat/feature-functions.h"
 #include "feat/feature-window.h"
 #include "feat/mel-computations.h"
+#include "matrix/matrix-threading.h"
 
 namespace kaldi {
 
@@ -83,8 +87,11 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
               << "low-freq " << low_freq << " and high-freq "
               << high_freq;
 
-  bins_.resize(num_bins);
+  bin_offsets_.resize(num_bins);
+  weight_offsets_.resize(num_bins + 1);
   center_freqs_.Resize(num_bins);
+  // The nonzero weights of all the bins, which will be copied to weights_.
+  std::vector<BaseFloat> weights;
 
   for (int32 bin = 0; bin < num_bins; bin++) {
     BaseFloat left_mel = mel_low_freq + bin * mel_freq_delta,
@@ -123,30 +130,46 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
     KALDI_ASSERT(first_index != -1 && last_index >= first_index
                  && "You may have set --num-mel-bins too large.");
 
-    bins_[bin].first = first_index;
-    int32 size = last_index + 1 - first_index;
-    bins_[bin].second.Resize(size);
-    bins_[bin].second.CopyFromVec(this_bin.Range(first_index, size));
+    bin_offsets_[bin] = first_index;
+    weight_offsets_[bin] = weights.size();
+    weights.insert(weights.end(), this_bin.Data() + first_index,
+                   this_bin.Data() + last_index + 1);
 
     // Replicate a bug in HTK, for testing purposes.
     if (opts.htk_mode && bin == 0 && mel_low_freq != 0.0)
-      bins_[bin].second(0) = 0.0;
+      weights[weight_offsets_[bin]] = 0.0;
 
   }
+  weight_offsets_[num_bins] = weights.size();
+  weights_.Resize(weights.size(), kUndefined);
+  if (!weights.empty())
+    std::copy(weights.begin(), weights.end(), weights_.Data());
   if (debug_) {
-    for (size_t i = 0; i < bins_.size(); i++) {
-      KALDI_LOG << "bin " << i << ", offset = " << bins_[i].first
-                << ", vec = " << bins_[i].second;
+    for (int32 i = 0; i < num_bins; i++) {
+      KALDI_LOG << "bin " << i << ", offset = " << bin_offsets_[i]
+                << ", vec = " << BinWeights(i);
     }
   }
 }
 
 MelBanks::MelBanks(const MelBanks &other):
     center_freqs_(other.center_freqs_),
-    bins_(other.bins_),
+    bin_offsets_(other.bin_offsets_),
+    weight_offsets_(other.weight_offsets_),
+    weights_(other.weights_),
     debug_(other.debug_),
     htk_mode_(other.htk_mode_) { }
 
+std::vector<std::pair<int32, Vector<BaseFloat> > > MelBanks::GetBins() const {
+  int32 num_bins = NumBins();
+  std::vector<std::pair<int32, Vector<BaseFloat> > > ans(num_bins);
+  for (int32 i = 0; i < num_bins; i++) {
+    ans[i].first = bin_offsets_[i];
+    ans[i].second = BinWeights(i);
+  }
+  return ans;
+}
+
 BaseFloat MelBanks::VtlnWarpFreq(BaseFloat vtln_low_cutoff,  // upper+lower frequency cutoffs for VTLN.
                                  BaseFloat vtln_high_cutoff,
                                  BaseFloat low_freq,  // upper+lower frequency cutoffs in mel computation
@@ -225,13 +248,13 @@ BaseFloat MelBanks::VtlnWarpMelFreq(BaseFloat vtln_low_cutoff,  // upper+lower f
 // "power_spectrum" contains fft energies.
 void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
                        VectorBase<BaseFloat> *mel_energies_out) const {
-  int32 num_bins = bins_.size();
+  int32 num_bins = NumBins();
   KALDI_ASSERT(mel_energies_out->Dim() == num_bins);
 
   for (int32 i = 0; i < num_bins; i++) {
-    int32 offset = bins_[i].first;
-    const Vector<BaseFloat> &v(bins_[i].second);
-    BaseFloat energy = VecVec(v, power_spectrum.Range(offset, v.Dim()));
+    SubVector<BaseFloat> v(BinWeights(i));
+    BaseFloat energy = VecVec(v, power_spectrum.Range(bin_offsets_[i],
+                                                      v.Dim()));
     // HTK-like flooring- for testing purposes (we prefer dither)
     if (htk_mode_ && energy < 1.0) energy = 1.0;
     (*mel_energies_out)(i) = energy;
@@ -250,6 +273,149 @@ void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   }
 }
 
+void MelBanks::Compute(const MatrixBase<BaseFloat> &power_spectra,
+                       MatrixBase<BaseFloat> *mel_energies_out) const {
+  int32 num_bins = NumBins();
+  KALDI_ASSERT(num_bins > 0 &&
+               power_spectra.NumCols() >= bin_offsets_.back() +
+               weight_offsets_[num_bins] - weight_offsets_[num_bins - 1] &&
+               mel_energies_out->NumRows() == power_spectra.NumRows() &&
+               mel_energies_out->NumCols() == num_bins);
+  const int32 *bin_offsets = &(bin_offsets_[0]),
+      *weight_offsets = &(weight_offsets_[0]);
+  const BaseFloat *weights = weights_.Data();
+  const MatrixIndexT num_rows = power_spectra.NumRows(),
+      in_stride = power_spectra.Stride(),
+      out_stride = mel_energies_out->Stride();
+  // We do 4 frames at a time, so that each weight is loaded once for all of
+  // them and the 4 sums can be accumulated in parallel; the work is split
+  // between threads in units of these groups of 4.  The work per group is 4
+  // multiply-adds per nonzero weight.
+  MatrixParallelFor(
+      (num_rows + 3) / 4, 4.0 * weights_.Dim(),
+      [&power_spectra, mel_energies_out, bin_offsets, weight_offsets,
+       weights, num_bins, num_rows, in_stride,
+       out_stride](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT r = 4 * begin; r < std::min(4 * end, num_rows); r += 4) {
+      const BaseFloat *spectrum = power_spectra.RowData(r);
+      BaseFloat *out = mel_energies_out->RowData(r);
+      if (r + 4 <= num_rows) {
+        for (int32 i = 0; i < num_bins; i++) {
+          const BaseFloat *w = weights + weight_offsets[i],
+              *s = spectrum + bin_offsets[i];
+          int32 size = weight_offsets[i + 1] - weight_offsets[i];
+          BaseFloat e0 = 0.0, e1 = 0.0, e2 = 0.0, e3 = 0.0;
+          for (int32 j = 0; j < size; j++) {
+            BaseFloat wj = w[j];
+            e0 += wj * s[j];
+            e1 += wj * s[j + in_stride];
+            e2 += wj * s[j + 2 * in_stride];
+            e3 += wj * s[j + 3 * in_stride];
+          }
+          out[i] = e0;
+          out[i + out_stride] = e1;
+          out[i + 2 * out_stride] = e2;
+          out[i + 3 * out_stride] = e3;
+        }
+      } else {
+        for (MatrixIndexT k = 0; r + k < num_rows; k++) {
+          for (int32 i = 0; i < num_bins; i++) {
+            const BaseFloat *w = weights + weight_offsets[i],
+                *s = spectrum + k * in_stride + bin_offsets[i];
+            int32 size = weight_offsets[i + 1] - weight_offsets[i];
+            BaseFloat energy = 0.0;
+            for (int32 j = 0; j < size; j++)
+              energy += w[j] * s[j];
+            out[i + k * out_stride] = energy;
+          }
+        }
+      }
+    }
+  });
+  // HTK-like flooring- for testing purposes (we prefer dither)
+  if (htk_mode_)
+    mel_energies_out->ApplyFloor(1.0);
+
+  // See the assert in the non-batched version of Compute().
+  KALDI_ASSERT(!KALDI_ISNAN(mel_energies_out->Sum()));
+
+  if (debug_) {
+    fprintf(stderr, "MEL BANKS:\n");
+    for (int32 r = 0; r < mel_energies_out->NumRows(); r++) {
+      for (int32 i = 0; i < mel_energies_out->NumCols(); i++)
+        fprintf(stderr, " %f", (*mel_energies_out)(r, i));
+      fprintf(stderr, "\n");
+    }
+  }
+}
+
+namespace {
+
+// The things that the MelBanks depend on, used as the key of the cache in
+// GetSharedMelBanks().
+struct MelBanksKey {
+  int32 num_bins;
+  BaseFloat low_freq, high_freq, vtln_low, vtln_high;
+  bool debug_mel, htk_mode;
+  BaseFloat samp_freq;
+  int32 padded_window_size;
+  BaseFloat vtln_warp_factor;
+
+  MelBanksKey(const MelBanksOptions &opts,
+              const FrameExtractionOptions &frame_opts,
+              BaseFloat vtln_warp_factor):
+      num_bins(opts.num_bins), low_freq(opts.low_freq),
+      high_freq(opts.high_freq), vtln_low(opts.vtln_low),
+      vtln_high(opts.vtln_high), debug_mel(opts.debug_mel),
+      htk_mode(opts.htk_mode), samp_freq(frame_opts.samp_freq),
+      padded_window_size(frame_opts.PaddedWindowSize()),
+      vtln_warp_factor(vtln_warp_factor) { }
+
+  bool operator < (const MelBanksKey &other) const {
+    return std::tie(num_bins, low_freq, high_freq, vtln_low, vtln_high,
+                    debug_mel, htk_mode, samp_freq, padded_window_size,
+                    vtln_warp_factor) <
+        std::tie(other.num_bins, other.low_freq, other.high_freq,
+                 other.vtln_low, other.vtln_high, other.debug_mel,
+                 other.htk_mode, other.samp_freq, other.padded_window_size,
+                 other.vtln_warp_factor);
+  }
+};
+
+}  // namespace
+
+std::shared_ptr<const MelBanks> GetSharedMelBanks(
+    const MelBanksOptions &opts,
+    const FrameExtractionOptions &frame_opts,
+    BaseFloat vtln_warp_factor) {
+  // The cache holds weak pointers, so the MelBanks are deleted when the last
+  // feature computer that uses them is destroyed.
+  typedef std::map<MelBanksKey, std::weak_ptr<const MelBanks> > CacheType;
+  static std::mutex cache_mutex;
+  static CacheType cache;
+
+  MelBanksKey key(opts, frame_opts, vtln_warp_factor);
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  CacheType::iterator iter = cache.find(key);
+  if (iter != cache.end()) {
+    std::shared_ptr<const MelBanks> ans = iter->second.lock();
+    if (ans != nullptr)
+      return ans;
+  }
+  // Remove any expired entries, so the cache does not keep growing if, say,
+  // many different VTLN warping factors are used over time.
+  for (iter = cache.begin(); iter != cache.end(); ) {
+    if (iter->second.expired())
+      cache.erase(iter++);
+    else
+      ++iter;
+  }
+  std::shared_ptr<const MelBanks> ans(
+      new MelBanks(opts, frame_opts, vtln_warp_factor));
+  cache[key] = ans;
+  return ans;
+}
+
 void ComputeLifterCoeffs(BaseFloat Q, VectorBase<BaseFloat> *coeffs) {
   // Compute liftering coefficients (scaling on cepstral coeffs)
   // coeffs are numbered slightly differently from HTK: the zeroth
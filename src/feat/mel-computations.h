@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <complex>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -111,15 +112,39 @@ class MelBanks {
   void Compute(const VectorBase<BaseFloat> &fft_energies,
                VectorBase<BaseFloat> *mel_energies_out) const;
 
-  int32 NumBins() const { return bins_.size(); }
+  /// Batched version of Compute(), where each row of "fft_energies" contains
+  /// the FFT energies of one frame (it may have more columns than are used),
+  /// and the Mel energies are written to the corresponding row of
+  /// "mel_energies_out", which must have NumBins() columns.  This is done in
+  /// one pass over the frames, using only the nonzero weights of each bin
+  /// (so it takes about two multiply-adds per FFT bin per frame, since the
+  /// bins overlap by half).  This uses the matrix library's threads if
+  /// g_matrix_num_threads > 1 (see ../matrix/matrix-threading.h).
+  void Compute(const MatrixBase<BaseFloat> &fft_energies,
+               MatrixBase<BaseFloat> *mel_energies_out) const;
+
+  int32 NumBins() const { return bin_offsets_.size(); }
 
   // returns vector of central freq of each bin; needed by plp code.
   const Vector<BaseFloat> &GetCenterFreqs() const { return center_freqs_; }
 
-  const std::vector<std::pair<int32, Vector<BaseFloat> > >& GetBins() const {
-    return bins_;
+  /// Returns the index of the first FFT bin with nonzero weight in Mel bin
+  /// 'bin'.
+  int32 BinOffset(int32 bin) const { return bin_offsets_[bin]; }
+
+  /// Returns the weights of the FFT bins starting from BinOffset(bin), for Mel
+  /// bin 'bin'.
+  SubVector<BaseFloat> BinWeights(int32 bin) const {
+    return SubVector<BaseFloat>(weights_, weight_offsets_[bin],
+                                weight_offsets_[bin + 1] -
+                                weight_offsets_[bin]);
   }
 
+  /// Returns a vector, one for each bin, of a pair: (the first nonzero
+  /// fft-bin), (the vector of weights).  This is constructed on demand; it's
+  /// more efficient to use BinOffset() and BinWeights().
+  std::vector<std::pair<int32, Vector<BaseFloat> > > GetBins() const;
+
   // Copy constructor
   MelBanks(const MelBanks &other);
  private:
@@ -130,15 +155,36 @@ class MelBanks {
   // Needed by GetCenterFreqs().
   Vector<BaseFloat> center_freqs_;
 
-  // the "bins_" vector is a vector, one for each bin, of a pair:
-  // (the first nonzero fft-bin), (the vector of weights).
-  std::vector<std::pair<int32, Vector<BaseFloat> > > bins_;
+  // The filterbank is stored as a banded matrix: the nonzero weights of bin i
+  // are weights_(weight_offsets_[i]) through
+  // weights_(weight_offsets_[i + 1] - 1), and apply to the FFT bins starting
+  // from bin_offsets_[i].  bin_offsets_ has dimension NumBins() and
+  // weight_offsets_ has dimension NumBins() + 1.
+  std::vector<int32> bin_offsets_;
+  std::vector<int32> weight_offsets_;
+  Vector<BaseFloat> weights_;
 
   bool debug_;
   bool htk_mode_;
 };
 
 
+/**
+   Returns a MelBanks object for these options and VTLN warping factor from a
+   process-wide cache, creating it if needed.  The feature computers
+   (MfccComputer, FbankComputer and PlpComputer) get their filterbanks from
+   here, so that all the computers with the same configuration (e.g. in a
+   program that processes many streams at once) share the same filterbanks,
+   which are only computed once for each warping factor.  This is
+   thread-safe.  An entry is removed from the cache when nothing refers to it
+   any more.
+*/
+std::shared_ptr<const MelBanks> GetSharedMelBanks(
+    const MelBanksOptions &opts,
+    const FrameExtractionOptions &frame_opts,
+    BaseFloat vtln_warp_factor);
+
+
 // Compute liftering coefficients (scaling on cepstral coeffs)
 // coeffs are numbered slightly differently from HTK: the zeroth
 // index is C0, which is not affected.
@@ -22,7 +22,104 @@
 #include "feat/feature-fbank.h"
 #include "feat/wave-reader.h"
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 
+namespace kaldi {
+
+// Computes the filterbank features of one utterance in its operator (), which
+// is run by TaskSequencer in a separate thread, and writes them in its
+// destructor, which TaskSequencer calls in the same order as the utterances
+// were read.
+class ComputeFbankTask {
+ public:
+  // Takes the contents of 'wave_data' (leaving it empty), to avoid copying
+  // the waveform.  'channel' is the channel to use.
+  ComputeFbankTask(OfflineFeaturePool<FbankComputer> *fbank_pool,
+                   const std::string &utt,
+                   WaveData *wave_data,
+                   int32 channel,
+                   BaseFloat vtln_warp,
+                   bool subtract_mean,
+                   bool use_energy,
+                   BaseFloatMatrixWriter *kaldi_writer,
+                   TableWriter<HtkMatrixHolder> *htk_writer,
+                   DoubleWriter *utt2dur_writer,
+                   int32 *num_success):
+      fbank_pool_(fbank_pool), utt_(utt), channel_(channel),
+      vtln_warp_(vtln_warp),
+      subtract_mean_(subtract_mean), use_energy_(use_energy),
+      kaldi_writer_(kaldi_writer), htk_writer_(htk_writer),
+      utt2dur_writer_(utt2dur_writer), num_success_(num_success),
+      failed_(false) {
+    wave_data_.Swap(wave_data);
+    duration_ = wave_data_.Duration();
+  }
+
+  void operator () () {
+    Fbank *fbank = fbank_pool_->Get();
+    try {
+      SubVector<BaseFloat> waveform(wave_data_.Data(), channel_);
+      fbank->ComputeFeatures(waveform, wave_data_.SampFreq(), vtln_warp_,
+                             &features_);
+    } catch (...) {
+      failed_ = true;
+    }
+    fbank_pool_->Release(fbank);
+    WaveData().Swap(&wave_data_);  // We no longer need the waveform.
+    if (failed_)
+      return;
+    if (subtract_mean_) {
+      Vector<BaseFloat> mean(features_.NumCols());
+      mean.AddRowSumMat(1.0, features_);
+      mean.Scale(1.0 / features_.NumRows());
+      features_.AddVecToRows(-1.0, mean);
+    }
+  }
+
+  ~ComputeFbankTask() {
+    if (failed_) {
+      KALDI_WARN << "Failed to compute features for utterance " << utt_;
+      return;
+    }
+    if (kaldi_writer_->IsOpen()) {
+      kaldi_writer_->Write(utt_, features_);
+    } else {
+      std::pair<Matrix<BaseFloat>, HtkHeader> p;
+      p.first.Swap(&features_);
+      HtkHeader header = {
+        p.first.NumRows(),
+        100000,  // 10ms shift
+        static_cast<int16>(sizeof(float)*(p.first.NumCols())),
+        static_cast<uint16>(007 | // FBANK
+        (use_energy_ ? 0100 : 020000)) // energy; otherwise c0
+      };
+      p.second = header;
+      htk_writer_->Write(utt_, p);
+    }
+    if (utt2dur_writer_->IsOpen())
+      utt2dur_writer_->Write(utt_, duration_);
+    KALDI_VLOG(2) << "Processed features for key " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  OfflineFeaturePool<FbankComputer> *fbank_pool_;
+  std::string utt_;
+  WaveData wave_data_;
+  int32 channel_;
+  BaseFloat duration_;
+  BaseFloat vtln_warp_;
+  bool subtract_mean_;
+  bool use_energy_;
+  Matrix<BaseFloat> features_;
+  BaseFloatMatrixWriter *kaldi_writer_;
+  TableWriter<HtkMatrixHolder> *htk_writer_;
+  DoubleWriter *utt2dur_writer_;
+  int32 *num_success_;
+  bool failed_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -30,7 +127,10 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Create Mel-filter bank (FBANK) feature files.\n"
         "Usage:  compute-fbank-feats [options...] <wav-rspecifier> "
-        "<feats-wspecifier>\n";
+        "<feats-wspecifier>\n"
+        "With --num-threads > 1, utterances are processed in parallel (the\n"
+        "output is in the same order as the input); note that the random\n"
+        "dithering then depends on the order in which the threads run.\n";
 
     // Construct all the global objects.
     ParseOptions po(usage);
@@ -44,6 +144,7 @@ int main(int argc, char *argv[]) {
     BaseFloat min_duration = 0.0;
     std::string output_format = "kaldi";
     std::string utt2dur_wspecifier;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
     // Register the option struct.
     fbank_opts.Register(&po);
@@ -65,6 +166,8 @@ int main(int argc, char *argv[]) {
     po.Register("write-utt2dur", &utt2dur_wspecifier, "Wspecifier to write "
                 "duration of each utterance in seconds, e.g. 'ark,t:utt2dur'.");
 
+    sequencer_config.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -103,10 +206,13 @@ int main(int argc, char *argv[]) {
     DoubleWriter utt2dur_writer(utt2dur_wspecifier);
 
     int32 num_utts = 0, num_success = 0;
+    // Each thread uses its own copy of 'fbank', from this pool.
+    OfflineFeaturePool<FbankComputer> fbank_pool(fbank);
+    TaskSequencer<ComputeFbankTask> sequencer(sequencer_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
-      const WaveData &wave_data = reader.Value();
+      WaveData &wave_data = reader.Value();
       if (wave_data.Duration() < min_duration) {
         KALDI_WARN << "File: " << utt << " is too short ("
                    << wave_data.Duration() << " sec): producing no output.";
@@ -142,46 +248,14 @@ int main(int argc, char *argv[]) {
         vtln_warp_local = vtln_warp;
       }
 
-      SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        fbank.ComputeFeatures(waveform, wave_data.SampFreq(),
-                              vtln_warp_local, &features);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance " << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (int32 i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*features.NumCols()),
-          static_cast<uint16>(007 | // FBANK
-          (fbank_opts.use_energy ? 0100 : 020000)) // energy; otherwise c0
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
-      if (utt2dur_writer.IsOpen()) {
-        utt2dur_writer.Write(utt, wave_data.Duration());
-      }
+      sequencer.Run(new ComputeFbankTask(
+          &fbank_pool, utt, &wave_data, this_chan,
+          vtln_warp_local, subtract_mean, fbank_opts.use_energy, &kaldi_writer,
+          &htk_writer, &utt2dur_writer, &num_success));
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
@@ -22,6 +22,66 @@
 #include "util/common-utils.h"
 #include "feat/pitch-functions.h"
 #include "feat/wave-reader.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+// Computes the pitch features of one utterance in its operator (), which is
+// run by TaskSequencer in a separate thread, and writes them in its
+// destructor, which TaskSequencer calls in the same order as the utterances
+// were read.
+class ComputeKaldiPitchTask {
+ public:
+  // Takes the contents of 'wave_data' (leaving it empty), to avoid copying
+  // the waveform.  'channel' is the channel to use.
+  ComputeKaldiPitchTask(const PitchExtractionOptions &pitch_opts,
+                        const std::string &utt,
+                        WaveData *wave_data,
+                        int32 channel,
+                        BaseFloatMatrixWriter *feat_writer,
+                        int32 *num_done,
+                        int32 *num_err):
+      pitch_opts_(pitch_opts), utt_(utt), channel_(channel),
+      feat_writer_(feat_writer), num_done_(num_done), num_err_(num_err),
+      failed_(false) {
+    wave_data_.Swap(wave_data);
+  }
+
+  void operator () () {
+    try {
+      SubVector<BaseFloat> waveform(wave_data_.Data(), channel_);
+      ComputeKaldiPitch(pitch_opts_, waveform, &features_);
+    } catch (...) {
+      failed_ = true;
+    }
+    WaveData().Swap(&wave_data_);  // We no longer need the waveform.
+  }
+
+  ~ComputeKaldiPitchTask() {
+    if (failed_) {
+      KALDI_WARN << "Failed to compute pitch for utterance " << utt_;
+      (*num_err_)++;
+      return;
+    }
+    feat_writer_->Write(utt_, features_);
+    if (*num_done_ % 50 == 0 && *num_done_ != 0)
+      KALDI_VLOG(2) << "Processed " << *num_done_ << " utterances";
+    (*num_done_)++;
+  }
+
+ private:
+  const PitchExtractionOptions &pitch_opts_;
+  std::string utt_;
+  WaveData wave_data_;
+  int32 channel_;
+  Matrix<BaseFloat> features_;
+  BaseFloatMatrixWriter *feat_writer_;
+  int32 *num_done_;
+  int32 *num_err_;
+  bool failed_;
+};
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -36,6 +96,9 @@ int main(int argc, char *argv[]) {
         "e.g.\n"
         "compute-kaldi-pitch-feats --sample-frequency=8000 scp:wav.scp ark:- \n"
         "\n"
+        "With --num-threads > 1, utterances are processed in parallel (the output is\n"
+        "in the same order as the input).\n"
+        "\n"
         "See also: process-kaldi-pitch-feats, compute-and-process-kaldi-pitch-feats\n";
 
     ParseOptions po(usage);
@@ -45,7 +108,10 @@ int main(int argc, char *argv[]) {
                         // on the command line (in the .scp file) using sox or
                         // similar.
 
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
+
     pitch_opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -61,9 +127,10 @@ int main(int argc, char *argv[]) {
     BaseFloatMatrixWriter feat_writer(feat_wspecifier);
 
     int32 num_done = 0, num_err = 0;
+    TaskSequencer<ComputeKaldiPitchTask> sequencer(sequencer_config);
     for (; !wav_reader.Done(); wav_reader.Next()) {
       std::string utt = wav_reader.Key();
-      const WaveData &wave_data = wav_reader.Value();
+      WaveData &wave_data = wav_reader.Value();
 
       int32 num_chan = wave_data.Data().NumRows(), this_chan = channel;
       {
@@ -91,22 +158,11 @@ int main(int argc, char *argv[]) {
                   << "option).  Utterance is " << utt;
 
 
-      SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        ComputeKaldiPitch(pitch_opts, waveform, &features);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute pitch for utterance "
-                   << utt;
-        num_err++;
-        continue;
-      }
-
-      feat_writer.Write(utt, features);
-      if (num_done % 50 == 0 && num_done != 0)
-        KALDI_VLOG(2) << "Processed " << num_done << " utterances";
-      num_done++;
+      sequencer.Run(new ComputeKaldiPitchTask(pitch_opts, utt, &wave_data,
+                                              this_chan, &feat_writer,
+                                              &num_done, &num_err));
     }
+    sequencer.Wait();
     KALDI_LOG << "Done " << num_done << " utterances, " << num_err
               << " with errors.";
     return (num_done != 0 ? 0 : 1);
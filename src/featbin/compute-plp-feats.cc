@@ -22,7 +22,102 @@
 #include "feat/feature-plp.h"
 #include "feat/wave-reader.h"
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 
+namespace kaldi {
+
+// Computes the PLP features of one utterance in its operator (), which
+// is run by TaskSequencer in a separate thread, and writes them in its
+// destructor, which TaskSequencer calls in the same order as the utterances
+// were read.
+class ComputePlpTask {
+ public:
+  // Takes the contents of 'wave_data' (leaving it empty), to avoid copying
+  // the waveform.  'channel' is the channel to use.
+  ComputePlpTask(OfflineFeaturePool<PlpComputer> *plp_pool,
+                 const std::string &utt,
+                 WaveData *wave_data,
+                 int32 channel,
+                 BaseFloat vtln_warp,
+                 bool subtract_mean,
+                 BaseFloatMatrixWriter *kaldi_writer,
+                 TableWriter<HtkMatrixHolder> *htk_writer,
+                 DoubleWriter *utt2dur_writer,
+                 int32 *num_success):
+      plp_pool_(plp_pool), utt_(utt), channel_(channel),
+      vtln_warp_(vtln_warp),
+      subtract_mean_(subtract_mean),
+      kaldi_writer_(kaldi_writer), htk_writer_(htk_writer),
+      utt2dur_writer_(utt2dur_writer), num_success_(num_success),
+      failed_(false) {
+    wave_data_.Swap(wave_data);
+    duration_ = wave_data_.Duration();
+  }
+
+  void operator () () {
+    Plp *plp = plp_pool_->Get();
+    try {
+      SubVector<BaseFloat> waveform(wave_data_.Data(), channel_);
+      plp->ComputeFeatures(waveform, wave_data_.SampFreq(), vtln_warp_,
+                           &features_);
+    } catch (...) {
+      failed_ = true;
+    }
+    plp_pool_->Release(plp);
+    WaveData().Swap(&wave_data_);  // We no longer need the waveform.
+    if (failed_)
+      return;
+    if (subtract_mean_) {
+      Vector<BaseFloat> mean(features_.NumCols());
+      mean.AddRowSumMat(1.0, features_);
+      mean.Scale(1.0 / features_.NumRows());
+      features_.AddVecToRows(-1.0, mean);
+    }
+  }
+
+  ~ComputePlpTask() {
+    if (failed_) {
+      KALDI_WARN << "Failed to compute features for utterance " << utt_;
+      return;
+    }
+    if (kaldi_writer_->IsOpen()) {
+      kaldi_writer_->Write(utt_, features_);
+    } else {
+      std::pair<Matrix<BaseFloat>, HtkHeader> p;
+      p.first.Swap(&features_);
+      HtkHeader header = {
+        p.first.NumRows(),
+        100000,  // 10ms shift
+        static_cast<int16>(sizeof(float)*(p.first.NumCols())),
+        013 | // PLP
+        020000 // C0 [no option currently to use energy in PLP.
+      };
+      p.second = header;
+      htk_writer_->Write(utt_, p);
+    }
+    if (utt2dur_writer_->IsOpen())
+      utt2dur_writer_->Write(utt_, duration_);
+    KALDI_VLOG(2) << "Processed features for key " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  OfflineFeaturePool<PlpComputer> *plp_pool_;
+  std::string utt_;
+  WaveData wave_data_;
+  int32 channel_;
+  BaseFloat duration_;
+  BaseFloat vtln_warp_;
+  bool subtract_mean_;
+  Matrix<BaseFloat> features_;
+  BaseFloatMatrixWriter *kaldi_writer_;
+  TableWriter<HtkMatrixHolder> *htk_writer_;
+  DoubleWriter *utt2dur_writer_;
+  int32 *num_success_;
+  bool failed_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -30,7 +125,10 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Create PLP feature files.\n"
         "Usage:  compute-plp-feats [options...] <wav-rspecifier> "
-        "<feats-wspecifier>\n";
+        "<feats-wspecifier>\n"
+        "With --num-threads > 1, utterances are processed in parallel (the\n"
+        "output is in the same order as the input); note that the random\n"
+        "dithering then depends on the order in which the threads run.\n";
 
     // Construct all the global objects.
     ParseOptions po(usage);
@@ -44,6 +142,7 @@ int main(int argc, char *argv[]) {
     BaseFloat min_duration = 0.0;
     std::string output_format = "kaldi";
     std::string utt2dur_wspecifier;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
     // Register the options.
     po.Register("output-format", &output_format, "Format of the output "
@@ -65,6 +164,8 @@ int main(int argc, char *argv[]) {
 
     plp_opts.Register(&po);
 
+    sequencer_config.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -103,10 +204,13 @@ int main(int argc, char *argv[]) {
     DoubleWriter utt2dur_writer(utt2dur_wspecifier);
 
     int32 num_utts = 0, num_success = 0;
+    // Each thread uses its own copy of 'plp', from this pool.
+    OfflineFeaturePool<PlpComputer> plp_pool(plp);
+    TaskSequencer<ComputePlpTask> sequencer(sequencer_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
-      const WaveData &wave_data = reader.Value();
+      WaveData &wave_data = reader.Value();
       if (wave_data.Duration() < min_duration) {
         KALDI_WARN << "File: " << utt << " is too short ("
                    << wave_data.Duration() << " sec): producing no output.";
@@ -142,46 +246,14 @@ int main(int argc, char *argv[]) {
         vtln_warp_local = vtln_warp;
       }
 
-      SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        plp.ComputeFeatures(waveform, wave_data.SampFreq(),
-                            vtln_warp_local, &features);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance " << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (size_t i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*features.NumCols()),
-          013 | // PLP
-          020000 // C0 [no option currently to use energy in PLP.
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
-      if (utt2dur_writer.IsOpen()) {
-        utt2dur_writer.Write(utt, wave_data.Duration());
-      }
+      sequencer.Run(new ComputePlpTask(
+          &plp_pool, utt, &wave_data, this_chan,
+          vtln_warp_local, subtract_mean, &kaldi_writer, &htk_writer,
+          &utt2dur_writer, &num_success));
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
@@ -0,0 +1,70 @@
+// fstbin/make-flat-fst.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/kaldi-fst-io.h"
+#include "decoder/flat-fst.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    using kaldi::int32;
+
+    const char *usage =
+        "Converts a decoding graph (e.g. HCLG.fst) into the FlatFst format,\n"
+        "which is faster to load and to decode with.  Programs that read\n"
+        "their graph with ReadDecodingGraph(), such as latgen-faster-mapped,\n"
+        "accept either format.\n"
+        "\n"
+        "Usage: make-flat-fst [options] <fst-in> <flat-fst-out>\n"
+        "e.g.: make-flat-fst HCLG.fst HCLG.flat\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_in_str = po.GetArg(1),
+        flat_fst_out_str = po.GetArg(2);
+
+    Fst<StdArc> *fst = ReadFstKaldiGeneric(fst_in_str);
+    FlatFst flat_fst(*fst);
+    delete fst;
+
+    bool binary = true;  // FlatFst does not support non-binary write.
+    WriteKaldiObject(flat_fst, flat_fst_out_str, binary);
+
+    KALDI_LOG << "Converted FST with " << flat_fst.NumStates()
+              << " states and " << flat_fst.NumArcsTotal()
+              << " arcs to FlatFst format, and wrote it to "
+              << flat_fst_out_str;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -156,6 +156,23 @@ typename Arc::Weight ComposeDeterministicOnDemandFst<Arc>::Final(StateId s) {
   return Times(fst1_->Final(pr.first), fst2_->Final(pr.second));
 }
 
+template<class Arc>
+void ComposeDeterministicOnDemandFst<Arc>::Prefetch(
+    const std::vector<StateId> &states) {
+  std::vector<StateId> states1, states2;
+  states1.reserve(states.size());
+  states2.reserve(states.size());
+  for (size_t i = 0; i < states.size(); i++) {
+    KALDI_ASSERT(states[i] < static_cast<StateId>(state_vec_.size()));
+    states1.push_back(state_vec_[states[i]].first);
+    states2.push_back(state_vec_[states[i]].second);
+  }
+  kaldi::SortAndUniq(&states1);
+  kaldi::SortAndUniq(&states2);
+  fst1_->Prefetch(states1);
+  fst2_->Prefetch(states2);
+}
+
 template<class Arc>
 bool ComposeDeterministicOnDemandFst<Arc>::GetArc(StateId s, Label ilabel,
                                                   Arc *oarc) {
@@ -85,6 +85,12 @@ class DeterministicOnDemandFst {
   /// Note: ilabel must not be epsilon.
   virtual bool GetArc(StateId s, Label ilabel, Arc *oarc) = 0;
 
+  /// This is a hint that GetArc() and Final() will soon be called for the
+  /// listed states; FSTs for which it is cheaper to compute many states at
+  /// once (e.g. neural-network language models) may override it.  The
+  /// default implementation does nothing.
+  virtual void Prefetch(const std::vector<StateId> &states) { }
+
   virtual ~DeterministicOnDemandFst() { }
 };
 
@@ -155,6 +161,10 @@ class ScaleDeterministicOnDemandFst:  public DeterministicOnDemandFst<StdArc> {
     }
   }
 
+  void Prefetch(const std::vector<StateId> &states) {
+    det_fst_.Prefetch(states);
+  }
+
  private:
   float scale_;
   DeterministicOnDemandFst<StdArc> &det_fst_;
@@ -215,6 +225,9 @@ class ComposeDeterministicOnDemandFst: public DeterministicOnDemandFst<Arc> {
 
   virtual bool GetArc(StateId s, Label ilabel, Arc *oarc);
 
+  /// Passes on the hint to fst1 and fst2, for the states they are in.
+  virtual void Prefetch(const std::vector<StateId> &states);
+
  private:
   DeterministicOnDemandFst<Arc> *fst1_;
   DeterministicOnDemandFst<Arc> *fst2_;
@@ -244,6 +257,10 @@ class CacheDeterministicOnDemandFst: public DeterministicOnDemandFst<Arc> {
 
   virtual bool GetArc(StateId s, Label ilabel, Arc *oarc);
 
+  virtual void Prefetch(const std::vector<StateId> &states) {
+    fst_->Prefetch(states);
+  }
+
  private:
   // Get index for cached arc.
   inline size_t GetIndex(StateId src_state, Label ilabel);
@@ -48,13 +48,22 @@ VectorFst<StdArc> *ReadFstKaldi(std::string rxfilename) {
 static fst::FstRegisterer<VectorFst<StdArc>> VectorFst_StdArc_registerer;
 static fst::FstRegisterer<ConstFst<StdArc>> ConstFst_StdArc_registerer;
 
-Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename, bool throw_on_err) {
+Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename, bool throw_on_err,
+                                 bool memory_map) {
   if (rxfilename == "") rxfilename = "-"; // interpret "" as stdin,
   // for compatibility with OpenFst conventions.
   kaldi::Input ki(rxfilename);
+  return ReadFstKaldiGeneric(ki.Stream(), rxfilename, throw_on_err,
+                             memory_map);
+}
+
+Fst<StdArc> *ReadFstKaldiGeneric(std::istream &is,
+                                 const std::string &rxfilename,
+                                 bool throw_on_err,
+                                 bool memory_map) {
   fst::FstHeader hdr;
   // Read FstHeader which contains the type of FST
-  if (!hdr.Read(ki.Stream(), rxfilename)) {
+  if (!hdr.Read(is, rxfilename)) {
     if(throw_on_err) {
       KALDI_ERR << "Reading FST: error reading FST header from "
                 << kaldi::PrintableRxfilename(rxfilename);
@@ -77,7 +86,26 @@ Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename, bool throw_on_err) {
   }
   // Read the FST
   FstReadOptions ropts("<unspecified>", &hdr);
-  Fst<StdArc> *fst = Fst<StdArc>::Read(ki.Stream(), ropts);
+  if (memory_map) {
+    // OpenFst maps the file named in ropts.source, starting from the
+    // current position of the stream; it falls back to reading if the data
+    // is not suitably aligned.
+    if (kaldi::ClassifyRxfilename(rxfilename) != kaldi::kFileInput) {
+      KALDI_WARN << "Cannot memory-map FST from "
+                 << kaldi::PrintableRxfilename(rxfilename)
+                 << " as it is not a plain file; reading it instead.";
+    } else if (hdr.FstType() != "const" ||
+               !(hdr.GetFlags() & FstHeader::IS_ALIGNED)) {
+      KALDI_WARN << "Cannot memory-map FST from " << rxfilename
+                 << " as it is not an aligned ConstFst; reading it instead.  "
+                 << "Use e.g. fstconvert --fst_type=const --fst_align=true "
+                 << "to convert it.";
+    } else {
+      ropts.source = rxfilename;
+      ropts.mode = FstReadOptions::MAP;
+    }
+  }
+  Fst<StdArc> *fst = Fst<StdArc>::Read(is, ropts);
   if (!fst) {
     if(throw_on_err) {
       KALDI_ERR << "Could not read fst from "
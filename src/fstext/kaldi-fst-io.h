@@ -48,8 +48,25 @@ VectorFst<StdArc> *ReadFstKaldi(std::string rxfilename);
 // This version currently supports ConstFst<StdArc> or VectorFst<StdArc>
 // (const-fst can give better performance for decoding). Other
 // types could be also loaded if registered inside OpenFst.
+//
+// If memory_map == true and rxfilename is a plain file, we ask OpenFst to
+// memory-map the FST rather than read it, so loading is nearly instantaneous
+// and the memory is shared between processes that load the same file.  This
+// only has an effect for ConstFst's that were written aligned, e.g. with
+// "fstconvert --fst_type=const --fst_align=true HCLG.fst HCLG_const.fst";
+// other FSTs are read as usual (with a warning).
 Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename,
-                                 bool throw_on_err = true);
+                                 bool throw_on_err = true,
+                                 bool memory_map = false);
+
+// As ReadFstKaldiGeneric() above, but reads from the stream 'is', which the
+// caller has already opened from 'rxfilename' (e.g. to check what kind of
+// object it contains; nothing must have been consumed from it).  'rxfilename'
+// is used in messages and, if memory_map == true, to memory-map the FST.
+Fst<StdArc> *ReadFstKaldiGeneric(std::istream &is,
+                                 const std::string &rxfilename,
+                                 bool throw_on_err,
+                                 bool memory_map);
 
 // This function attempts to dynamic_cast the pointer 'fst' (which will likely
 // have been returned by ReadFstGeneric()), to the more derived
@@ -54,6 +54,7 @@ int main(int argc, char *argv[]) {
     BaseFloat log_sum_exp_prune = 0.0;
     LatticeFasterDecoderConfig latgen_config;
     TaskSequencerConfig sequencer_config; // has --num-threads option
+    int32 num_determinize_threads = 0;
 
     std::string word_syms_filename;
     latgen_config.Register(&po);
@@ -67,6 +68,10 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "If true, produce output even if end state was not reached.");
+    po.Register("num-determinize-threads", &num_determinize_threads,
+                "If > 0, the lattices are determinized by this many separate "
+                "threads rather than by the decoding threads, so that the "
+                "decoding does not wait for the determinization.");
 
     po.Read(argc, argv);
 
@@ -115,6 +120,13 @@ int main(int argc, char *argv[]) {
     Fst<StdArc> *decode_fst = NULL; // only used if there is a single
                                           // decoding graph.
 
+    // The determinizer is declared first, so that it is destroyed after the
+    // decoding tasks, which give their lattices to it.
+    TaskSequencerConfig determinizer_config;
+    determinizer_config.num_threads = num_determinize_threads;
+    TaskSequencer<DeterminizeLatticeClass> determinizer(determinizer_config);
+    TaskSequencer<DeterminizeLatticeClass> *determinizer_ptr =
+        (num_determinize_threads > 0 ? &determinizer : NULL);
     TaskSequencer<DecodeUtteranceLatticeFasterClass> sequencer(sequencer_config);
 
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
@@ -152,7 +164,9 @@ int main(int argc, char *argv[]) {
                   trans_model, word_syms, utt, acoustic_scale, determinize,
                   allow_partial, &alignment_writer, &words_writer,
                   &compact_lattice_writer, &lattice_writer,
-                  &tot_like, &frame_count, &num_done, &num_err, NULL);
+                  &tot_like, &frame_count, &num_done, &num_err, NULL,
+
+                  determinizer_ptr);
 
           sequencer.Run(task); // takes ownership of "task",
           // and will delete it when done.
@@ -194,12 +208,15 @@ int main(int argc, char *argv[]) {
                 trans_model, word_syms, utt, acoustic_scale, determinize,
                 allow_partial, &alignment_writer, &words_writer,
                 &compact_lattice_writer, &lattice_writer,
-                &tot_like, &frame_count, &num_done, &num_err, NULL);
+                &tot_like, &frame_count, &num_done, &num_err, NULL,
+
+                determinizer_ptr);
         sequencer.Run(task); // takes ownership of "task",
         // and will delete it when done.
       }
     }
     sequencer.Wait();
+    determinizer.Wait();
 
     delete decode_fst;
 
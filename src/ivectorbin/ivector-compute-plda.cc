@@ -45,6 +45,8 @@ int main(int argc, char *argv[]) {
     plda_config.Register(&po);
 
     po.Register("binary", &binary, "Write output in binary mode");
+    po.Register("matrix-num-threads", &g_matrix_num_threads,
+                "Number of threads to use for large matrix operations.");
 
     po.Read(argc, argv);
 
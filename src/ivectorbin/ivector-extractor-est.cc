@@ -38,6 +38,8 @@ int main(int argc, char *argv[]) {
     po.Register("binary", &binary, "Write output in binary mode");
     po.Register("num-threads", &g_num_threads,
                 "Number of threads used in update");
+    po.Register("matrix-num-threads", &g_matrix_num_threads,
+                "Number of threads to use for large matrix operations.");
 
     update_opts.Register(&po);
 
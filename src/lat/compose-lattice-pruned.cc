@@ -77,6 +77,12 @@ class PrunedCompactLatticeComposer {
   // out of the composed state numbered 'composed_state_to_expand'.
   void ProcessQueueElement(int32 composed_state_to_expand);
 
+  // This is used instead of calling ProcessQueueElement() one element at a
+  // time if opts_.lm_batch_size > 1: it takes batches of elements from the
+  // queue, calls det_fst_->Prefetch() for their LM states, and processes
+  // them, until num_arcs_out_ reaches 'arc_limit' or the queue is empty.
+  void ProcessQueueBatches(int32 arc_limit);
+
   // This is a part of ProcessQueueElements() that has been broken out
   // for clarity. it process the arc_index'th arc out of this source state.
   void ProcessTransition(int32 composed_src_state,
@@ -884,6 +890,36 @@ static int32 TotalNumArcs(const CompactLattice &clat) {
 }
 
 
+void PrunedCompactLatticeComposer::ProcessQueueBatches(int32 arc_limit) {
+  std::vector<int32> batch, lm_states;
+  while (num_arcs_out_ < arc_limit && !composed_state_queue_.empty()) {
+    // Each queue element produces at most one arc, so we don't take more
+    // elements than would reach 'arc_limit'.
+    int32 batch_size = std::min(opts_.lm_batch_size,
+                                arc_limit - num_arcs_out_);
+    batch.clear();
+    lm_states.clear();
+    while (static_cast<int32>(batch.size()) < batch_size &&
+           !composed_state_queue_.empty()) {
+      int32 src_composed_state = composed_state_queue_.top().second;
+      composed_state_queue_.pop();
+      batch.push_back(src_composed_state);
+      lm_states.push_back(composed_state_info_[src_composed_state].lm_state);
+    }
+    SortAndUniq(&lm_states);
+    det_fst_->Prefetch(lm_states);
+    for (size_t i = 0; i < batch.size(); i++) {
+      bool reached_final = output_reached_final_;
+      ProcessQueueElement(batch[i]);
+      // When we first reach a final-state, RecomputePruningInfo() is called,
+      // which re-creates the queue from all the composed states, including
+      // the rest of this batch; so we must not process them here.
+      if (output_reached_final_ != reached_final)
+        break;
+    }
+  }
+}
+
 void PrunedCompactLatticeComposer::Compose() {
   if (clat_in_.NumStates() == 0) {
     KALDI_WARN << "Input lattice to composition is empty.";
@@ -897,11 +933,15 @@ void PrunedCompactLatticeComposer::Compose() {
          num_arcs_out_ < opts_.max_arcs) {
     RecomputePruningInfo();
     int32 this_iter_arc_limit = GetCurrentArcLimit();
-    while (num_arcs_out_ < this_iter_arc_limit &&
-           !composed_state_queue_.empty()) {
-      int32 src_composed_state = composed_state_queue_.top().second;
-      composed_state_queue_.pop();
-      ProcessQueueElement(src_composed_state);
+    if (opts_.lm_batch_size > 1) {
+      ProcessQueueBatches(this_iter_arc_limit);
+    } else {
+      while (num_arcs_out_ < this_iter_arc_limit &&
+             !composed_state_queue_.empty()) {
+        int32 src_composed_state = composed_state_queue_.top().second;
+        composed_state_queue_.pop();
+        ProcessQueueElement(src_composed_state);
+      }
     }
     if (composed_state_queue_.empty())
       break;
@@ -121,10 +121,18 @@ struct ComposeLatticePrunedOptions {
   // heuristics will be less accurate).
   BaseFloat growth_ratio;
 
+  // 'lm_batch_size', if >1, is the number of queue elements that we take off
+  // the queue at once; the language-model states they are in are passed to
+  // the Prefetch() function of the DeterministicOnDemandFst before we expand
+  // them.  This makes a difference only for FSTs that can compute many states
+  // at once (e.g. RNNLMs), and it changes the order of expansion slightly.
+  int32 lm_batch_size;
+
   ComposeLatticePrunedOptions(): lattice_compose_beam(6.0),
                                  max_arcs(100000),
                                  initial_num_arcs(100),
-                                 growth_ratio(1.5) { }
+                                 growth_ratio(1.5),
+                                 lm_batch_size(1) { }
   void Register(OptionsItf *po) {
     po->Register("lattice-compose-beam", &lattice_compose_beam,
                  "Beam used in pruned lattice composition, which determines how "
@@ -135,6 +143,9 @@ struct ComposeLatticePrunedOptions {
     po->Register("growth-ratio", &growth_ratio, "Factor used in the lattice "
                  "composition algorithm; must be >1.0.  Affects speed vs. "
                  "the optimality of the best-first composition.");
+    po->Register("lm-batch-size", &lm_batch_size, "If >1, the number of "
+                 "states we expand at once, letting the language model compute "
+                 "their scores in one batch (useful for RNNLMs).");
   }
 };
 
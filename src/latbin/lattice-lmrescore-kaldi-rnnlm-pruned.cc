@@ -19,6 +19,8 @@
 // limitations under the License.
 
 
+#include <mutex>
+
 #include "base/kaldi-common.h"
 #include "fstext/fstext-lib.h"
 #include "rnnlm/rnnlm-lattice-rescoring.h"
@@ -28,6 +30,160 @@
 #include "lat/kaldi-lattice.h"
 #include "lat/lattice-functions.h"
 #include "lat/compose-lattice-pruned.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+// RnnlmBatchComputer objects are not thread-safe and are expensive to
+// create (they compile several computations), so the rescoring tasks take
+// them from this pool and give them back when they are done.
+class RnnlmBatchComputerPool {
+ public:
+  RnnlmBatchComputerPool(const rnnlm::RnnlmComputeStateInfo &info,
+                         int32 batch_size):
+      info_(info), batch_size_(batch_size) { }
+
+  rnnlm::RnnlmBatchComputer *Get() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_computers_.empty()) {
+      all_computers_.push_back(new rnnlm::RnnlmBatchComputer(info_,
+                                                             batch_size_));
+      return all_computers_.back();
+    }
+    rnnlm::RnnlmBatchComputer *ans = free_computers_.back();
+    free_computers_.pop_back();
+    return ans;
+  }
+
+  void Release(rnnlm::RnnlmBatchComputer *computer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_computers_.push_back(computer);
+  }
+
+  ~RnnlmBatchComputerPool() {
+    for (size_t i = 0; i < all_computers_.size(); i++) {
+      all_computers_[i]->PrintStats();
+      delete all_computers_[i];
+    }
+  }
+
+ private:
+  const rnnlm::RnnlmComputeStateInfo &info_;
+  int32 batch_size_;
+  std::mutex mutex_;
+  std::vector<rnnlm::RnnlmBatchComputer*> all_computers_;
+  std::vector<rnnlm::RnnlmBatchComputer*> free_computers_;
+};
+
+// Rescores one lattice; run by TaskSequencer so that many lattices can be
+// rescored in parallel with the same models.  The DeterministicOnDemandFst
+// wrappers, which are not thread-safe, are created for each lattice.
+class RnnlmPrunedRescoreTask {
+ public:
+  // Exactly one of 'lm_to_subtract_fst' and 'lm_to_subtract_carpa' must be
+  // non-NULL.  'computer_pool' is used only if compose_opts.lm_batch_size > 1;
+  // 'state_cache' may be NULL.
+  RnnlmPrunedRescoreTask(const ComposeLatticePrunedOptions &compose_opts,
+                         BaseFloat lm_scale, BaseFloat acoustic_scale,
+                         int32 max_ngram_order,
+                         const fst::VectorFst<fst::StdArc> *lm_to_subtract_fst,
+                         const ConstArpaLm *lm_to_subtract_carpa,
+                         const rnnlm::RnnlmComputeStateInfo &info,
+                         rnnlm::RnnlmComputeStateCache *state_cache,
+                         RnnlmBatchComputerPool *computer_pool,
+                         const std::string &key, const CompactLattice &clat,
+                         CompactLatticeWriter *clat_writer,
+                         int32 *num_done, int32 *num_err):
+      compose_opts_(compose_opts), lm_scale_(lm_scale),
+      acoustic_scale_(acoustic_scale), max_ngram_order_(max_ngram_order),
+      lm_to_subtract_fst_(lm_to_subtract_fst),
+      lm_to_subtract_carpa_(lm_to_subtract_carpa), info_(info),
+      state_cache_(state_cache), computer_pool_(computer_pool), key_(key),
+      clat_(clat), clat_writer_(clat_writer), num_done_(num_done),
+      num_err_(num_err) { }
+
+  void operator () () {
+    using fst::StdArc;
+    fst::DeterministicOnDemandFst<StdArc> *lm_to_subtract_orig;
+    if (lm_to_subtract_carpa_ != NULL)
+      lm_to_subtract_orig =
+          new ConstArpaLmDeterministicFst(*lm_to_subtract_carpa_);
+    else
+      lm_to_subtract_orig =
+          new fst::BackoffDeterministicOnDemandFst<StdArc>(
+              *lm_to_subtract_fst_);
+    fst::ScaleDeterministicOnDemandFst lm_to_subtract(-lm_scale_,
+                                                      lm_to_subtract_orig);
+
+    // If --lm-batch-size > 1, we use the version of the RNNLM FST that
+    // computes the RNNLM states in batches.
+    rnnlm::RnnlmBatchComputer *batch_computer = NULL;
+    fst::DeterministicOnDemandFst<StdArc> *lm_to_add_orig;
+    if (compose_opts_.lm_batch_size > 1) {
+      batch_computer = computer_pool_->Get();
+      lm_to_add_orig = new rnnlm::KaldiRnnlmBatchedDeterministicFst(
+          max_ngram_order_, batch_computer);
+    } else {
+      lm_to_add_orig = new rnnlm::KaldiRnnlmDeterministicFst(
+          max_ngram_order_, info_, state_cache_);
+    }
+    fst::ScaleDeterministicOnDemandFst lm_to_add(lm_scale_, lm_to_add_orig);
+
+    if (acoustic_scale_ != 1.0) {
+      fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale_), &clat_);
+    }
+    TopSortCompactLatticeIfNeeded(&clat_);
+
+    fst::ComposeDeterministicOnDemandFst<StdArc> combined_lms(
+        &lm_to_subtract, &lm_to_add);
+
+    // Composes lattice with language model.
+    CompactLattice composed_clat;
+    ComposeCompactLatticePruned(compose_opts_, clat_,
+                                &combined_lms, &composed_clat);
+    clat_.DeleteStates();
+    if (composed_clat.NumStates() != 0) {
+      if (acoustic_scale_ != 1.0) {
+        fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale_),
+                          &composed_clat);
+      }
+      clat_ = composed_clat;
+    }
+
+    delete lm_to_add_orig;
+    if (batch_computer != NULL)
+      computer_pool_->Release(batch_computer);
+    delete lm_to_subtract_orig;
+  }
+
+  ~RnnlmPrunedRescoreTask() {
+    if (clat_.NumStates() == 0) {
+      // Something went wrong.  A warning will already have been printed.
+      (*num_err_)++;
+    } else {
+      clat_writer_->Write(key_, clat_);
+      (*num_done_)++;
+    }
+  }
+
+ private:
+  const ComposeLatticePrunedOptions &compose_opts_;
+  BaseFloat lm_scale_;
+  BaseFloat acoustic_scale_;
+  int32 max_ngram_order_;
+  const fst::VectorFst<fst::StdArc> *lm_to_subtract_fst_;
+  const ConstArpaLm *lm_to_subtract_carpa_;
+  const rnnlm::RnnlmComputeStateInfo &info_;
+  rnnlm::RnnlmComputeStateCache *state_cache_;
+  RnnlmBatchComputerPool *computer_pool_;
+  std::string key_;
+  CompactLattice clat_;  // The input, and then the output.
+  CompactLatticeWriter *clat_writer_;
+  int32 *num_done_;
+  int32 *num_err_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -62,9 +218,12 @@ int main(int argc, char *argv[]) {
     ComposeLatticePrunedOptions compose_opts;
 
     int32 max_ngram_order = 3;
+    int32 state_cache_size = 0;
     BaseFloat lm_scale = 0.5;
     BaseFloat acoustic_scale = 0.1;
     bool use_carpa = false;
+    bool share_state_cache = false;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
     po.Register("lm-scale", &lm_scale, "Scaling factor for <lm-to-add>; its negative "
                 "will be applied to <lm-to-subtract>.");
@@ -75,11 +234,25 @@ int main(int argc, char *argv[]) {
         "If positive, allow RNNLM histories longer than this to be identified "
         "with each other for rescoring purposes (an approximation that "
         "saves time and reduces output lattice size).");
+    po.Register("state-cache-size", &state_cache_size,
+        "If positive, keep up to this many RNNLM states (indexed by history, "
+        "truncated as for --max-ngram-order) across lattices, so that common "
+        "histories are computed only once.  Not used with --lm-batch-size > 1.  "
+        "Note: with --max-ngram-order > 0 the state reused for a truncated "
+        "history is the one computed for the first lattice that had it, so "
+        "the output for a lattice depends on the lattices rescored before it "
+        "(and, with --share-state-cache, on the timing of the threads).");
+    po.Register("share-state-cache", &share_state_cache,
+        "If true and --num-threads > 1, the threads share the cache of "
+        "--state-cache-size; otherwise the cache is not used with more than "
+        "one thread.  This makes the output non-deterministic; see "
+        "--state-cache-size.");
     po.Register("use-const-arpa", &use_carpa, "If true, read the old-LM file "
                 "as a const-arpa file as opposed to an FST file");
 
     opts.Register(&po);
     compose_opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -102,31 +275,20 @@ int main(int argc, char *argv[]) {
     lats_wspecifier = po.GetArg(5);
 
     // for G.fst
-    fst::ScaleDeterministicOnDemandFst *lm_to_subtract_det_scale = NULL;
-    fst::BackoffDeterministicOnDemandFst<StdArc> *lm_to_subtract_det_backoff = NULL;
     VectorFst<StdArc> *lm_to_subtract_fst = NULL;
-
     // for G.carpa
     ConstArpaLm* const_arpa = NULL;
-    fst::DeterministicOnDemandFst<StdArc> *carpa_lm_to_subtract_fst = NULL;
 
     KALDI_LOG << "Reading old LMs...";
     if (use_carpa) {
       const_arpa = new ConstArpaLm();
       ReadKaldiObject(lm_to_subtract_rxfilename, const_arpa);
-      carpa_lm_to_subtract_fst = new ConstArpaLmDeterministicFst(*const_arpa);
-      lm_to_subtract_det_scale
-        = new fst::ScaleDeterministicOnDemandFst(-lm_scale,
-                                                 carpa_lm_to_subtract_fst);
     } else {
       lm_to_subtract_fst = fst::ReadAndPrepareLmFst(
           lm_to_subtract_rxfilename);
-      lm_to_subtract_det_backoff =
-        new fst::BackoffDeterministicOnDemandFst<StdArc>(*lm_to_subtract_fst);
-      lm_to_subtract_det_scale =
-           new fst::ScaleDeterministicOnDemandFst(-lm_scale,
-                                                  lm_to_subtract_det_backoff);
     }
+    if (acoustic_scale == 0.0)
+      KALDI_ERR << "Acoustic scale cannot be zero.";
 
     kaldi::nnet3::Nnet rnnlm;
     ReadKaldiObject(rnnlm_rxfilename, &rnnlm);
@@ -144,60 +306,45 @@ int main(int argc, char *argv[]) {
 
     int32 num_done = 0, num_err = 0;
 
-    rnnlm::KaldiRnnlmDeterministicFst* lm_to_add_orig = 
-         new rnnlm::KaldiRnnlmDeterministicFst(max_ngram_order, info);
-
-    for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
-      fst::DeterministicOnDemandFst<StdArc> *lm_to_add =
-         new fst::ScaleDeterministicOnDemandFst(lm_scale, lm_to_add_orig);
-
-      std::string key = compact_lattice_reader.Key();
-      CompactLattice clat = compact_lattice_reader.Value();
-      compact_lattice_reader.FreeCurrent();
-
-      // Before composing with the LM FST, we scale the lattice weights
-      // by the inverse of "lm_scale".  We'll later scale by "lm_scale".
-      // We do it this way so we can determinize and it will give the
-      // right effect (taking the "best path" through the LM) regardless
-      // of the sign of lm_scale.
-      if (acoustic_scale != 1.0) {
-        fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), &clat);
-      }
-      TopSortCompactLatticeIfNeeded(&clat);
-
-      fst::ComposeDeterministicOnDemandFst<StdArc> combined_lms(
-          lm_to_subtract_det_scale, lm_to_add);
-
-      // Composes lattice with language model.
-      CompactLattice composed_clat;
-      ComposeCompactLatticePruned(compose_opts, clat,
-                                  &combined_lms, &composed_clat);
-
-      lm_to_add_orig->Clear();
-
-      if (composed_clat.NumStates() == 0) {
-        // Something went wrong.  A warning will already have been printed.
-        num_err++;
+    rnnlm::RnnlmComputeStateCache *state_cache = NULL;
+    if (state_cache_size > 0 && compose_opts.lm_batch_size > 1) {
+      KALDI_WARN << "Not using --state-cache-size with --lm-batch-size > 1.";
+    } else if (state_cache_size > 0) {
+      if (sequencer_config.num_threads > 1 && !share_state_cache) {
+        KALDI_WARN << "Not using --state-cache-size with --num-threads > 1 "
+                   << "unless --share-state-cache=true.";
       } else {
-        if (acoustic_scale != 1.0) {
-          if (acoustic_scale == 0.0)
-            KALDI_ERR << "Acoustic scale cannot be zero.";
-          fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale),
-                            &composed_clat);
-        }
-        compact_lattice_writer.Write(key, composed_clat);
-        num_done++;
+        if (sequencer_config.num_threads > 1 && max_ngram_order > 0)
+          KALDI_WARN << "Sharing the RNNLM state cache between threads: the "
+                     << "output will depend on the timing of the threads, "
+                     << "so it is not reproducible.";
+        state_cache = new rnnlm::RnnlmComputeStateCache(state_cache_size);
       }
-      delete lm_to_add;
+    }
+    RnnlmBatchComputerPool computer_pool(info, compose_opts.lm_batch_size);
+
+    {
+      // The lattices are rescored in parallel if --num-threads > 1, and
+      // written in the original order.  The models (and the state cache, if
+      // --share-state-cache=true) are shared between the threads.
+      TaskSequencer<RnnlmPrunedRescoreTask> sequencer(sequencer_config);
+      for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
+        sequencer.Run(new RnnlmPrunedRescoreTask(
+            compose_opts, lm_scale, acoustic_scale, max_ngram_order,
+            lm_to_subtract_fst, const_arpa, info, state_cache, &computer_pool,
+            compact_lattice_reader.Key(), compact_lattice_reader.Value(),
+            &compact_lattice_writer, &num_done, &num_err));
+        compact_lattice_reader.FreeCurrent();
+      }
+      sequencer.Wait();
     }
 
+    if (state_cache != NULL) {
+      state_cache->PrintStats();
+      delete state_cache;
+    }
     delete lm_to_subtract_fst;
-    delete lm_to_add_orig;
-    delete lm_to_subtract_det_backoff;
-    delete lm_to_subtract_det_scale;
-
     delete const_arpa;
-    delete carpa_lm_to_subtract_fst;
 
     KALDI_LOG << "Overall, succeeded for " << num_done
               << " lattices, failed for " << num_err;
@@ -51,6 +51,7 @@ int main(int argc, char *argv[]) {
     rnnlm::RnnlmComputeStateComputationOptions opts;
 
     int32 max_ngram_order = 3;
+    int32 state_cache_size = 0;
     BaseFloat lm_scale = 1.0;
 
     po.Register("lm-scale", &lm_scale, "Scaling factor for language model "
@@ -59,6 +60,13 @@ int main(int argc, char *argv[]) {
         "If positive, allow RNNLM histories longer than this to be identified "
         "with each other for rescoring purposes (an approximation that "
         "saves time and reduces output lattice size).");
+    po.Register("state-cache-size", &state_cache_size,
+        "If positive, keep up to this many RNNLM states (indexed by history, "
+        "truncated as for --max-ngram-order) across lattices, so that common "
+        "histories are computed only once.  Note: with --max-ngram-order > 0 "
+        "the state reused for a truncated history is the one computed for the "
+        "first lattice that had it, so the output for a lattice depends on the "
+        "lattices rescored before it.");
     opts.Register(&po);
 
     po.Read(argc, argv);
@@ -93,7 +101,11 @@ int main(int argc, char *argv[]) {
 
     int32 n_done = 0, n_fail = 0;
 
-    rnnlm::KaldiRnnlmDeterministicFst rnnlm_fst(max_ngram_order, info);
+    rnnlm::RnnlmComputeStateCache *state_cache = NULL;
+    if (state_cache_size > 0)
+      state_cache = new rnnlm::RnnlmComputeStateCache(state_cache_size);
+    rnnlm::KaldiRnnlmDeterministicFst rnnlm_fst(max_ngram_order, info,
+                                                state_cache);
 
     for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
       std::string key = compact_lattice_reader.Key();
@@ -138,6 +150,10 @@ int main(int argc, char *argv[]) {
       rnnlm_fst.Clear();
     }
 
+    if (state_cache != NULL) {
+      state_cache->PrintStats();
+      delete state_cache;
+    }
     KALDI_LOG << "Done " << n_done << " lattices, failed for " << n_fail;
     return (n_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
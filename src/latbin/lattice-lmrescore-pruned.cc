@@ -26,6 +26,101 @@
 #include "lat/kaldi-lattice.h"
 #include "lat/lattice-functions.h"
 #include "lat/compose-lattice-pruned.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+// Rescores one lattice; run by TaskSequencer so that many lattices can be
+// rescored in parallel against the same language models.  The
+// DeterministicOnDemandFst wrappers, which are not thread-safe, are created
+// for each lattice.
+class PrunedRescoreTask {
+ public:
+  // If 'const_arpa' is non-NULL it is the LM to add, otherwise
+  // 'lm_to_add_fst' is.
+  PrunedRescoreTask(const ComposeLatticePrunedOptions &compose_opts,
+                    BaseFloat lm_scale, BaseFloat acoustic_scale,
+                    const fst::VectorFst<fst::StdArc> &lm_to_subtract_fst,
+                    const fst::VectorFst<fst::StdArc> *lm_to_add_fst,
+                    const ConstArpaLm *const_arpa,
+                    const std::string &key, const CompactLattice &clat,
+                    CompactLatticeWriter *clat_writer,
+                    int32 *num_done, int32 *num_err):
+      compose_opts_(compose_opts), lm_scale_(lm_scale),
+      acoustic_scale_(acoustic_scale),
+      lm_to_subtract_fst_(lm_to_subtract_fst), lm_to_add_fst_(lm_to_add_fst),
+      const_arpa_(const_arpa), key_(key), clat_(clat),
+      clat_writer_(clat_writer), num_done_(num_done), num_err_(num_err) { }
+
+  void operator () () {
+    using fst::StdArc;
+    fst::BackoffDeterministicOnDemandFst<StdArc> lm_to_subtract_det_backoff(
+        lm_to_subtract_fst_);
+    fst::ScaleDeterministicOnDemandFst lm_to_subtract_det_scale(
+        -lm_scale_, &lm_to_subtract_det_backoff);
+    fst::DeterministicOnDemandFst<StdArc> *lm_to_add_orig = NULL,
+        *lm_to_add = NULL;
+    if (const_arpa_ != NULL) {
+      lm_to_add = new ConstArpaLmDeterministicFst(*const_arpa_);
+    } else {
+      lm_to_add = new fst::BackoffDeterministicOnDemandFst<StdArc>(
+          *lm_to_add_fst_);
+    }
+    if (lm_scale_ != 1.0) {
+      lm_to_add_orig = lm_to_add;
+      lm_to_add = new fst::ScaleDeterministicOnDemandFst(lm_scale_,
+                                                         lm_to_add_orig);
+    }
+
+    if (acoustic_scale_ != 1.0) {
+      fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale_), &clat_);
+    }
+    TopSortCompactLatticeIfNeeded(&clat_);
+
+    fst::ComposeDeterministicOnDemandFst<StdArc> combined_lms(
+        &lm_to_subtract_det_scale, lm_to_add);
+
+    // Composes lattice with language model.
+    CompactLattice composed_clat;
+    ComposeCompactLatticePruned(compose_opts_, clat_, &combined_lms,
+                                &composed_clat);
+    clat_.DeleteStates();
+    if (composed_clat.NumStates() != 0) {
+      if (acoustic_scale_ != 1.0) {
+        fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale_),
+                          &composed_clat);
+      }
+      clat_ = composed_clat;
+    }
+    delete lm_to_add_orig;
+    delete lm_to_add;
+  }
+
+  ~PrunedRescoreTask() {
+    if (clat_.NumStates() == 0) {
+      // Something went wrong.  A warning will already have been printed.
+      (*num_err_)++;
+    } else {
+      clat_writer_->Write(key_, clat_);
+      (*num_done_)++;
+    }
+  }
+
+ private:
+  const ComposeLatticePrunedOptions &compose_opts_;
+  BaseFloat lm_scale_;
+  BaseFloat acoustic_scale_;
+  const fst::VectorFst<fst::StdArc> &lm_to_subtract_fst_;
+  const fst::VectorFst<fst::StdArc> *lm_to_add_fst_;
+  const ConstArpaLm *const_arpa_;
+  std::string key_;
+  CompactLattice clat_;  // The input, and then the output.
+  CompactLatticeWriter *clat_writer_;
+  int32 *num_done_;
+  int32 *num_err_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -60,6 +155,8 @@ int main(int argc, char *argv[]) {
     BaseFloat lm_scale = 1.0;
     BaseFloat acoustic_scale = 1.0;
     bool add_const_arpa = false;
+    bool use_mmap = false;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
     po.Register("lm-scale", &lm_scale, "Scaling factor for <lm-to-add>; its negative "
                 "will be applied to <lm-to-subtract>.");
@@ -69,7 +166,10 @@ int main(int argc, char *argv[]) {
     po.Register("add-const-arpa", &add_const_arpa, "If true, <lm-to-add> is expected "
                 "to be in const-arpa format; if false it's expected to be in FST"
                 "format.");
-
+    po.Register("use-mmap", &use_mmap,
+                "If true, memory-map <lm-to-add> if it is a const-arpa language "
+                "model, instead of reading it into memory.");
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -89,29 +189,15 @@ int main(int argc, char *argv[]) {
     VectorFst<StdArc> *lm_to_add_fst = NULL;
     ConstArpaLm const_arpa;
     if (add_const_arpa) {
-      ReadKaldiObject(lm_to_add_rxfilename, &const_arpa);
+      if (use_mmap)
+        const_arpa.ReadMapped(lm_to_add_rxfilename);
+      else
+        ReadKaldiObject(lm_to_add_rxfilename, &const_arpa);
     } else {
       lm_to_add_fst = fst::ReadAndPrepareLmFst(lm_to_add_rxfilename);
     }
-    fst::BackoffDeterministicOnDemandFst<StdArc> lm_to_subtract_det_backoff(
-        *lm_to_subtract_fst);
-    fst::ScaleDeterministicOnDemandFst lm_to_subtract_det_scale(
-        -lm_scale, &lm_to_subtract_det_backoff);
-
-
-    fst::DeterministicOnDemandFst<StdArc> *lm_to_add_orig = NULL,
-        *lm_to_add = NULL;
-    if (add_const_arpa) {
-      lm_to_add = new ConstArpaLmDeterministicFst(const_arpa);
-    } else {
-      lm_to_add = new fst::BackoffDeterministicOnDemandFst<StdArc>(
-          *lm_to_add_fst);
-    }
-    if (lm_scale != 1.0) {
-      lm_to_add_orig = lm_to_add;
-      lm_to_add = new fst::ScaleDeterministicOnDemandFst(lm_scale,
-                                                         lm_to_add_orig);
-    }
+    if (acoustic_scale == 0.0)
+      KALDI_ERR << "Acoustic scale cannot be zero.";
 
     KALDI_LOG << "Done.";
 
@@ -123,47 +209,23 @@ int main(int argc, char *argv[]) {
 
     int32 num_done = 0, num_err = 0;
 
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice &clat = clat_reader.Value();
-
-      if (acoustic_scale != 1.0) {
-        fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), &clat);
-      }
-      TopSortCompactLatticeIfNeeded(&clat);
-
-      // To avoid memory gradually increasing with time, we reconstruct the
-      // composed-LM FST for each lattice we process.
-      //   It shouldn't make a difference in which order we provide the
-      // arguments to the composition; either way should work.  They are both
-      // acceptors so the result is the same either way.
-      fst::ComposeDeterministicOnDemandFst<StdArc> combined_lms(
-          &lm_to_subtract_det_scale, lm_to_add);
-
-      CompactLattice composed_clat;
-      ComposeCompactLatticePruned(compose_opts,
-                                  clat,
-                                  &combined_lms,
-                                  &composed_clat);
-
-      if (composed_clat.NumStates() == 0) {
-        // Something went wrong.  A warning will already have been printed.
-        num_err++;
-      } else {
-        if (acoustic_scale != 1.0) {
-          if (acoustic_scale == 0.0)
-            KALDI_ERR << "Acoustic scale cannot be zero.";
-          fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale),
-                            &composed_clat);
-        }
-        compact_lattice_writer.Write(key, composed_clat);
-        num_done++;
+    {
+      // The lattices are rescored in parallel if --num-threads > 1, and
+      // written in the original order.  The LMs are shared between the
+      // threads.
+      TaskSequencer<PrunedRescoreTask> sequencer(sequencer_config);
+      for (; !clat_reader.Done(); clat_reader.Next()) {
+        sequencer.Run(new PrunedRescoreTask(
+            compose_opts, lm_scale, acoustic_scale, *lm_to_subtract_fst,
+            lm_to_add_fst, (add_const_arpa ? &const_arpa : NULL),
+            clat_reader.Key(), clat_reader.Value(), &compact_lattice_writer,
+            &num_done, &num_err));
+        clat_reader.FreeCurrent();
       }
+      sequencer.Wait();
     }
     delete lm_to_subtract_fst;
     delete lm_to_add_fst;
-    delete lm_to_add_orig;
-    delete lm_to_add;
 
     KALDI_LOG << "Overall, succeeded for " << num_done
               << " lattices, failed for " << num_err;
@@ -0,0 +1,302 @@
+// lm/const-arpa-lm-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "lm/const-arpa-lm.h"
+#include "util/kaldi-io.h"
+
+namespace kaldi {
+
+// A small trigram LM on integer symbols: <s> = 1, </s> = 2, <unk> = 3, and
+// the other words are 4 to 7.
+static const char *kTestArpa =
+    "\\data\\\n"
+    "ngram 1=7\n"
+    "ngram 2=6\n"
+    "ngram 3=4\n"
+    "\n"
+    "\\1-grams:\n"
+    "-99\t1\t-0.5\n"
+    "-1.2\t2\n"
+    "-2.0\t3\t-0.3\n"
+    "-1.5\t4\t-0.4\n"
+    "-1.6\t5\t-0.2\n"
+    "-1.7\t6\t-0.1\n"
+    "-1.8\t7\n"
+    "\n"
+    "\\2-grams:\n"
+    "-0.5\t1 4\t-0.3\n"
+    "-0.6\t1 5\n"
+    "-0.9\t3 4\t-0.1\n"
+    "-0.7\t4 5\t-0.25\n"
+    "-0.4\t5 6\n"
+    "-0.8\t6 2\n"
+    "\n"
+    "\\3-grams:\n"
+    "-0.2\t1 4 5\n"
+    "-0.15\t3 4 5\n"
+    "-0.3\t4 5 6\n"
+    "-0.1\t5 6 2\n"
+    "\n"
+    "\\end\\\n";
+
+static const int32 kBos = 1, kEos = 2, kUnk = 3, kMaxWord = 7,
+    kOov = 9;  // not in the LM.
+
+static void BuildTestLm(int32 unk_symbol, ConstArpaLm *lm) {
+  std::string arpa_filename = "tmp-const-arpa-lm-test.arpa",
+      carpa_filename = "tmp-const-arpa-lm-test.carpa";
+  {
+    Output ko(arpa_filename, false);
+    ko.Stream() << kTestArpa;
+  }
+  ArpaParseOptions options;
+  options.bos_symbol = kBos;
+  options.eos_symbol = kEos;
+  options.unk_symbol = unk_symbol;
+  BuildConstArpaLm(options, arpa_filename, carpa_filename);
+  ReadKaldiObject(carpa_filename, lm);
+  unlink(arpa_filename.c_str());
+  unlink(carpa_filename.c_str());
+}
+
+static void AssertLogprobsEqual(float a, float b) {
+  if (a == -std::numeric_limits<float>::infinity() ||
+      b == -std::numeric_limits<float>::infinity())
+    KALDI_ASSERT(a == b);
+  else
+    KALDI_ASSERT(ApproxEqual(a, b, 1.0e-05));
+}
+
+// Returns a random word: mostly words of the LM, sometimes an
+// out-of-vocabulary word.
+static int32 RandWord() {
+  return (RandInt(0, 9) == 0 ? kOov : RandInt(kEos, kMaxWord));
+}
+
+// Outputs all the words of the LM plus an out-of-vocabulary word to 'words',
+// and all histories of up to two of those words to 'hists'.
+static void GetTestHistories(std::vector<int32> *words,
+                             std::vector<std::vector<int32> > *hists) {
+  words->clear();
+  for (int32 w = kBos; w <= kMaxWord; w++)
+    words->push_back(w);
+  words->push_back(kOov);
+  hists->assign(1, std::vector<int32>());
+  for (size_t i = 0; i < words->size(); i++) {
+    hists->push_back(std::vector<int32>(1, (*words)[i]));
+    for (size_t j = 0; j < words->size(); j++) {
+      std::vector<int32> hist(2);
+      hist[0] = (*words)[i];
+      hist[1] = (*words)[j];
+      hists->push_back(hist);
+    }
+  }
+}
+
+// Checks that state-based querying gives the same log-probs as
+// GetNgramLogprob() for all histories of up to two words.
+static void UnitTestStateLogprobs(const ConstArpaLm &lm) {
+  std::vector<int32> words;
+  std::vector<std::vector<int32> > hists;
+  GetTestHistories(&words, &hists);
+  for (size_t h = 0; h < hists.size(); h++) {
+    ConstArpaLmState state;
+    lm.GetHistoryState(hists[h], &state);
+    for (size_t i = 1; i < words.size(); i++) {
+      AssertLogprobsEqual(lm.GetNgramLogprob(words[i], hists[h]),
+                          lm.GetNgramLogprob(state, words[i], NULL));
+    }
+  }
+}
+
+// Checks that following the next states given by state-based querying is
+// equivalent to keeping the word sequence, as ConstArpaLmDeterministicFst
+// used to do.
+static void UnitTestStateSequences(const ConstArpaLm &lm) {
+  for (int32 n = 0; n < 100; n++) {
+    std::vector<int32> wseq(1, kBos);
+    ConstArpaLmState state;
+    lm.GetHistoryState(wseq, &state);
+    int32 length = RandInt(1, 8);
+    for (int32 i = 0; i < length; i++) {
+      int32 word = (i + 1 == length ? kEos : RandWord());
+      ConstArpaLmState next_state;
+      float logprob = lm.GetNgramLogprob(state, word, &next_state);
+      AssertLogprobsEqual(logprob, lm.GetNgramLogprob(word, wseq));
+      if (logprob == -std::numeric_limits<float>::infinity())
+        break;
+
+      wseq.push_back(word);
+      while (wseq.size() >= lm.NgramOrder())
+        wseq.erase(wseq.begin());
+      while (!lm.HistoryStateExists(wseq))
+        wseq.erase(wseq.begin());
+      ConstArpaLmState expected_state;
+      lm.GetHistoryState(wseq, &expected_state);
+      KALDI_ASSERT(next_state.Id() == expected_state.Id());
+      KALDI_ASSERT(wseq.empty() == (next_state.Id() == -1));
+      state = next_state;
+    }
+  }
+}
+
+// Checks that 'lm1' and 'lm2' give the same log-probs for all histories of up
+// to two words.
+static void AssertSameLogprobs(const ConstArpaLm &lm1,
+                               const ConstArpaLm &lm2) {
+  KALDI_ASSERT(lm1.NgramOrder() == lm2.NgramOrder() &&
+               lm1.BosSymbol() == lm2.BosSymbol() &&
+               lm1.EosSymbol() == lm2.EosSymbol() &&
+               lm1.UnkSymbol() == lm2.UnkSymbol());
+  std::vector<int32> words;
+  std::vector<std::vector<int32> > hists;
+  GetTestHistories(&words, &hists);
+  for (size_t h = 0; h < hists.size(); h++) {
+    for (size_t i = 1; i < words.size(); i++) {
+      float logprob1 = lm1.GetNgramLogprob(words[i], hists[h]),
+          logprob2 = lm2.GetNgramLogprob(words[i], hists[h]);
+      KALDI_ASSERT(logprob1 == logprob2);
+    }
+  }
+}
+
+// Writes 'lm' in the on-disk format used before the <ConstArpaLm> tokens were
+// added (without the binary header), by converting what Write() writes.
+static void WriteOldFormat(const ConstArpaLm &lm, std::ostream &os) {
+  std::ostringstream new_os;
+  lm.Write(new_os, true);
+  std::istringstream is(new_os.str());
+  ExpectToken(is, true, "<ConstArpaLm>");
+  ExpectToken(is, true, "<LmInfo>");
+  for (int32 i = 0; i < 4; i++) {  // bos, eos, unk and the n-gram order.
+    int32 value;
+    ReadBasicType(is, true, &value);
+    WriteBasicType(os, true, value);
+  }
+  ExpectToken(is, true, "</LmInfo>");
+  ExpectToken(is, true, "<LmStates>");
+  int64 lm_states_size;
+  ReadBasicType(is, true, &lm_states_size);
+  WriteBasicType(os, true, static_cast<int32>(lm_states_size));
+  for (int64 i = 0; i < lm_states_size; i++) {
+    int32 value;
+    is.read(reinterpret_cast<char*>(&value), sizeof(value));
+    WriteBasicType(os, true, value);
+  }
+  ExpectToken(is, true, "</LmStates>");
+  const char *sections[] = { "LmUnigram", "LmOverflow" };
+  for (int32 s = 0; s < 2; s++) {
+    ExpectToken(is, true, std::string("<") + sections[s] + ">");
+    int32 size;
+    ReadBasicType(is, true, &size);
+    WriteBasicType(os, true, size);
+    for (int32 i = 0; i < size; i++) {
+      int64 address;
+      is.read(reinterpret_cast<char*>(&address), sizeof(address));
+      WriteBasicType(os, true, address);
+    }
+    ExpectToken(is, true, std::string("</") + sections[s] + ">");
+  }
+  ExpectToken(is, true, "</ConstArpaLm>");
+  KALDI_ASSERT(is.good());
+}
+
+// Checks that Write() pads the <LmStates> section so that its data is
+// 8-byte aligned relative to the start of the stream, whatever position
+// the stream starts at, and that Read() skips the padding.
+static void UnitTestWritePadding(const ConstArpaLm &lm) {
+  for (int32 prefix = 0; prefix < 8; prefix++) {
+    std::ostringstream os;
+    os << std::string(prefix, 'x');
+    lm.Write(os, true);
+    std::string str = os.str();
+    size_t token_pos = str.find("<LmStates> ");
+    KALDI_ASSERT(token_pos != std::string::npos);
+    size_t data_pos = token_pos + strlen("<LmStates> ") + 1 + sizeof(int64);
+    KALDI_ASSERT(data_pos % 8 == 0);
+
+    std::istringstream is(str.substr(prefix));
+    ConstArpaLm lm2;
+    lm2.Read(is, true);
+    AssertSameLogprobs(lm, lm2);
+  }
+}
+
+// Checks that ReadMapped() gives the same model as Read(), both when it can
+// map the file and when it has to fall back to reading it.
+static void UnitTestReadMapped(const ConstArpaLm &lm) {
+  std::string filename = "tmp-const-arpa-lm-test.carpa";
+  for (int32 i = 0; i < 4; i++) {
+    std::string rxfilename = filename;
+    if (i == 0) {
+      // A file written by Write(), which ReadMapped() maps.
+      WriteKaldiObject(lm, filename, true);
+    } else if (i == 1) {
+      // A pipe, which cannot be mapped.
+      WriteKaldiObject(lm, filename, true);
+      rxfilename = "cat " + filename + " |";
+    } else if (i == 2) {
+      // A file in the new format whose <LmStates> section is not aligned,
+      // e.g. as written by older code; we get it by padding for the wrong
+      // position in the file.
+      std::ostringstream os;
+      os << "xxx";
+      lm.Write(os, true);
+      Output ko(filename, true);
+      ko.Stream() << os.str().substr(3);
+    } else {
+      // A file in the old format.
+      Output ko(filename, true);
+      WriteOldFormat(lm, ko.Stream());
+    }
+    ConstArpaLm read_lm, mapped_lm;
+    ReadKaldiObject(filename, &read_lm);
+    mapped_lm.ReadMapped(rxfilename);
+    AssertSameLogprobs(lm, read_lm);
+    AssertSameLogprobs(read_lm, mapped_lm);
+    UnitTestStateLogprobs(mapped_lm);
+  }
+  unlink(filename.c_str());
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 2; i++) {
+    ConstArpaLm lm;
+    BuildTestLm(i == 0 ? kUnk : -1, &lm);
+    UnitTestStateLogprobs(lm);
+    UnitTestStateSequences(lm);
+    UnitTestWritePadding(lm);
+    UnitTestReadMapped(lm);
+  }
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -18,6 +18,7 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <cstring>
 #include <limits>
 #include <sstream>
 #include <utility>
@@ -510,7 +511,18 @@ void ConstArpaLm::Write(std::ostream &os, bool binary) const {
   WriteBasicType(os, binary, ngram_order_);
   WriteToken(os, binary, "</LmInfo>");
 
-  // LmStates section.
+  // LmStates section.  If we know the position in the file, we pad with
+  // spaces (which the token-reading code skips over) so that the contents of
+  // <lm_states_> start at a multiple of 8 bytes from the start of the file;
+  // this makes it possible for ReadMapped() to memory-map it.
+  std::streamoff pos = os.tellp();
+  if (pos >= 0) {
+    // the data starts after the token, a space, and lm_states_size_, which
+    // is written as one byte for its size followed by 8 bytes.
+    std::streamoff data_pos = pos + strlen("<LmStates> ") + 1 + sizeof(int64);
+    for (; data_pos % 8 != 0; data_pos++)
+      os << ' ';
+  }
   WriteToken(os, binary, "<LmStates>");
   WriteBasicType(os, binary, lm_states_size_);
   os.write(reinterpret_cast<char *>(lm_states_),
@@ -584,7 +596,24 @@ void ConstArpaLm::Read(std::istream &is, bool binary) {
   }
 }
 
-void ConstArpaLm::ReadInternal(std::istream &is, bool binary) {
+void ConstArpaLm::ReadMapped(const std::string &rxfilename) {
+  KALDI_ASSERT(!initialized_);
+  bool binary;
+  Input ki(rxfilename, &binary);
+  std::istream &is = ki.Stream();
+  if (ClassifyRxfilename(rxfilename) != kFileInput || !binary ||
+      is.peek() == 4) {
+    // We can only map plain files, in the new on-disk format.
+    KALDI_WARN << "Cannot memory-map ConstArpaLm from "
+               << PrintableRxfilename(rxfilename) << ", reading it instead.";
+    Read(is, binary);
+  } else {
+    ReadInternal(is, binary, &rxfilename);
+  }
+}
+
+void ConstArpaLm::ReadInternal(std::istream &is, bool binary,
+                               const std::string *map_filename) {
   KALDI_ASSERT(!initialized_);
   if (!binary) {
     KALDI_ERR << "text-mode reading is not implemented for ConstArpaLm.";
@@ -603,9 +632,32 @@ void ConstArpaLm::ReadInternal(std::istream &is, bool binary) {
   // LmStates section.
   ExpectToken(is, binary, "<LmStates>");
   ReadBasicType(is, binary, &lm_states_size_);
-  lm_states_ = new int32[lm_states_size_];
-  is.read(reinterpret_cast<char *>(lm_states_),
-          sizeof(int32) * lm_states_size_);
+  if (map_filename != NULL) {
+    std::streamoff pos = is.tellg();
+    int64 num_bytes = sizeof(int32) * lm_states_size_;
+    if (pos < 0 || pos % sizeof(int32) != 0) {
+      KALDI_WARN << "Cannot memory-map ConstArpaLm from " << *map_filename
+                 << " because its <LmStates> section is not aligned; "
+                 << "reading it instead.  Re-create it with arpa-to-const-arpa "
+                 << "to avoid this.";
+    } else {
+      mapped_file_ = new MemoryMappedFile();
+      if (mapped_file_->Open(*map_filename, pos, num_bytes)) {
+        // The mapping is read-only, but we never write to <lm_states_>.
+        lm_states_ = reinterpret_cast<int32*>(
+            const_cast<char*>(mapped_file_->Data()));
+        is.seekg(pos + num_bytes);
+      } else {
+        delete mapped_file_;
+        mapped_file_ = NULL;
+      }
+    }
+  }
+  if (mapped_file_ == NULL) {
+    lm_states_ = new int32[lm_states_size_];
+    is.read(reinterpret_cast<char *>(lm_states_),
+            sizeof(int32) * lm_states_size_);
+  }
   if (!is.good()) {
     KALDI_ERR << "ConstArpaLm <LmStates> section reading failed.";
   }
@@ -745,41 +797,141 @@ bool ConstArpaLm::HistoryStateExists(const std::vector<int32>& hist) const {
   return true;
 }
 
-float ConstArpaLm::GetNgramLogprob(const int32 word,
-                                   const std::vector<int32>& hist) const {
-  KALDI_ASSERT(initialized_);
-
+void ConstArpaLm::MapHistory(std::vector<int32>* hist) const {
   // If the history size plus one is larger than <ngram_order_>, remove the old
   // words.
-  std::vector<int32> mapped_hist(hist);
-  while (mapped_hist.size() >= ngram_order_) {
-    mapped_hist.erase(mapped_hist.begin(), mapped_hist.begin() + 1);
+  if (hist->size() >= ngram_order_) {
+    hist->erase(hist->begin(), hist->end() - (ngram_order_ - 1));
   }
-  KALDI_ASSERT(mapped_hist.size() + 1 <= ngram_order_);
+  KALDI_ASSERT(hist->size() + 1 <= ngram_order_);
 
   // TODO(guoguo): check with Dan if this is reasonable.
   // Maps possible out-of-vocabulary words to <unk>. If a word does not have a
   // corresponding LmState, we treat it as <unk>. We map it to <unk> if <unk> is
   // specified.
+  if (unk_symbol_ != -1) {
+    for (int32 i = 0; i < hist->size(); ++i) {
+      KALDI_ASSERT((*hist)[i] >= 0);
+      if ((*hist)[i] >= num_words_ || unigram_states_[(*hist)[i]] == NULL) {
+        (*hist)[i] = unk_symbol_;
+      }
+    }
+  }
+}
+
+float ConstArpaLm::GetNgramLogprob(const int32 word,
+                                   const std::vector<int32>& hist) const {
+  KALDI_ASSERT(initialized_);
+
+  std::vector<int32> mapped_hist(hist);
+  MapHistory(&mapped_hist);
+
   int32 mapped_word = word;
   if (unk_symbol_ != -1) {
     KALDI_ASSERT(mapped_word >= 0);
     if (mapped_word >= num_words_ || unigram_states_[mapped_word] == NULL) {
       mapped_word = unk_symbol_;
     }
-    for (int32 i = 0; i < mapped_hist.size(); ++i) {
-      KALDI_ASSERT(mapped_hist[i] >= 0);
-      if (mapped_hist[i] >= num_words_ ||
-          unigram_states_[mapped_hist[i]] == NULL) {
-        mapped_hist[i] = unk_symbol_;
-      }
-    }
   }
 
   // Loops up n-gram probability.
   return GetNgramLogprobRecurse(mapped_word, mapped_hist);
 }
 
+void ConstArpaLm::GetHistoryState(const std::vector<int32>& hist,
+                                  ConstArpaLmState *state) const {
+  KALDI_ASSERT(initialized_);
+  KALDI_ASSERT(state != NULL);
+
+  std::vector<int32> mapped_hist(hist);
+  MapHistory(&mapped_hist);
+
+  // Suffixes without an LmState contribute neither n-grams nor backoff
+  // log probabilities, so we leave them out.
+  state->suffixes_.clear();
+  for (size_t i = 0; i < mapped_hist.size(); ++i) {
+    std::vector<int32> suffix(mapped_hist.begin() + i, mapped_hist.end());
+    int32* lm_state = GetLmState(suffix);
+    if (lm_state != NULL)
+      state->suffixes_.push_back(lm_state - lm_states_);
+  }
+}
+
+float ConstArpaLm::GetNgramLogprob(const ConstArpaLmState &state,
+                                   const int32 word,
+                                   ConstArpaLmState *next_state) const {
+  KALDI_ASSERT(initialized_);
+  KALDI_ASSERT(next_state != &state);
+  KALDI_ASSERT(word >= 0);
+
+  int32 mapped_word = word;
+  bool is_oov = (word >= num_words_ || unigram_states_[word] == NULL);
+  if (is_oov) {
+    // Without <unk>, the unigram lookup in GetNgramLogprob() would fail.
+    if (unk_symbol_ == -1)
+      return -std::numeric_limits<float>::infinity();
+    mapped_word = unk_symbol_;
+  }
+
+  // Tries the histories from the longest to the shortest, as
+  // GetNgramLogprobRecurse() does; the difference is that we already know
+  // their LmStates.
+  const std::vector<int64> &suffixes = state.suffixes_;
+  float logprob = 0.0;
+  float backoff_logprob = 0.0;
+  size_t i = 0;
+  int32* child_lm_state = NULL;
+  for (; i < suffixes.size(); ++i) {
+    int32* lm_state = lm_states_ + suffixes[i];
+    int32 child_info;
+    if (GetChildInfo(mapped_word, lm_state, &child_info)) {
+      DecodeChildInfo(child_info, lm_state, &child_lm_state, &logprob);
+      break;
+    }
+    Int32AndFloat backoff_logprob_i(*(lm_state + 1));
+    backoff_logprob += backoff_logprob_i.f;
+  }
+  if (i == suffixes.size()) {
+    Int32AndFloat logprob_i(*unigram_states_[mapped_word]);
+    logprob = logprob_i.f;
+  }
+
+  if (next_state != NULL) {
+    next_state->suffixes_.clear();
+    // The history followed by an out-of-vocabulary word is not a history
+    // state (see HistoryStateExists()), and nor are its suffixes.
+    if (!is_oov) {
+      // The histories longer than suffixes[i] followed by <mapped_word> are
+      // not n-grams, so the LmStates of the new history and its suffixes are
+      // the children of suffixes[i] and of the histories after it, followed
+      // by the unigram LmState.
+      if (child_lm_state != NULL)
+        next_state->suffixes_.push_back(child_lm_state - lm_states_);
+      for (size_t j = i + 1; j < suffixes.size(); ++j) {
+        int32* lm_state = lm_states_ + suffixes[j];
+        int32 child_info;
+        if (GetChildInfo(mapped_word, lm_state, &child_info)) {
+          float child_logprob;
+          DecodeChildInfo(child_info, lm_state, &child_lm_state,
+                          &child_logprob);
+          if (child_lm_state != NULL)
+            next_state->suffixes_.push_back(child_lm_state - lm_states_);
+        }
+      }
+      next_state->suffixes_.push_back(unigram_states_[mapped_word] -
+                                      lm_states_);
+      // Reduces the history to its longest suffix that has successors.  Note
+      // that this removes the histories of <ngram_order_> words, if any.
+      std::vector<int64>::iterator iter = next_state->suffixes_.begin();
+      while (iter != next_state->suffixes_.end() &&
+             *(lm_states_ + *iter + 2) == 0)
+        ++iter;
+      next_state->suffixes_.erase(next_state->suffixes_.begin(), iter);
+    }
+  }
+  return logprob + backoff_logprob;
+}
+
 float ConstArpaLm::GetNgramLogprobRecurse(
     const int32 word, const std::vector<int32>& hist) const {
   KALDI_ASSERT(initialized_);
@@ -1014,53 +1166,43 @@ ConstArpaLmDeterministicFst::ConstArpaLmDeterministicFst(
     const ConstArpaLm& lm) : lm_(lm) {
   // Creates a history state for <s>.
   std::vector<Label> bos_state(1, lm_.BosSymbol());
-  state_to_wseq_.push_back(bos_state);
-  wseq_to_state_[bos_state] = 0;
+  lm_states_.resize(1);
+  lm_.GetHistoryState(bos_state, &(lm_states_[0]));
+  id_to_state_[lm_states_[0].Id()] = 0;
   start_state_ = 0;
 }
 
 fst::StdArc::Weight ConstArpaLmDeterministicFst::Final(StateId s) {
   // At this point, we should have created the state.
-  KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
-  const std::vector<Label>& wseq = state_to_wseq_[s];
-  float logprob = lm_.GetNgramLogprob(lm_.EosSymbol(), wseq);
+  KALDI_ASSERT(static_cast<size_t>(s) < lm_states_.size());
+  float logprob = lm_.GetNgramLogprob(lm_states_[s], lm_.EosSymbol(), NULL);
   return Weight(-logprob);
 }
 
 bool ConstArpaLmDeterministicFst::GetArc(StateId s,
                                          Label ilabel, fst::StdArc *oarc) {
   // At this point, we should have created the state.
-  KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
-  std::vector<Label> wseq = state_to_wseq_[s];
+  KALDI_ASSERT(static_cast<size_t>(s) < lm_states_.size());
 
-  float logprob = lm_.GetNgramLogprob(ilabel, wseq);
+  // Looks up the n-gram and the next state in ConstArpaLm. Note that OOV and
+  // backoff have been taken care of in ConstArpaLm.
+  ConstArpaLmState next_lm_state;
+  float logprob = lm_.GetNgramLogprob(lm_states_[s], ilabel, &next_lm_state);
   if (logprob == -std::numeric_limits<float>::infinity()) {
     return false;
   }
 
-  // Locates the next state in ConstArpaLm. Note that OOV and backoff have been
-  // taken care of in ConstArpaLm.
-  wseq.push_back(ilabel);
-  while (wseq.size() >= lm_.NgramOrder()) {
-    // History state has at most lm_.NgramOrder() -1 words in the state.
-    wseq.erase(wseq.begin(), wseq.begin() + 1);
-  }
-  while (!lm_.HistoryStateExists(wseq)) {
-    KALDI_ASSERT(wseq.size() > 0);
-    wseq.erase(wseq.begin(), wseq.begin() + 1);
-  }
-
-  std::pair<const std::vector<Label>, StateId> wseq_state_pair(
-      wseq, static_cast<Label>(state_to_wseq_.size()));
+  std::pair<const int64, StateId> id_state_pair(
+      next_lm_state.Id(), static_cast<StateId>(lm_states_.size()));
 
-  // Attemps to insert the current <wseq_state_pair>. If the pair already exists
+  // Attemps to insert the current <id_state_pair>. If the pair already exists
   // then it returns false.
   typedef MapType::iterator IterType;
-  std::pair<IterType, bool> result = wseq_to_state_.insert(wseq_state_pair);
+  std::pair<IterType, bool> result = id_to_state_.insert(id_state_pair);
 
-  // If the pair was just inserted, then also add it to <state_to_wseq_>.
+  // If the pair was just inserted, then also add it to <lm_states_>.
   if (result.second == true)
-    state_to_wseq_.push_back(wseq);
+    lm_states_.push_back(next_lm_state);
 
   // Creates the arc.
   oarc->ilabel = ilabel;
@@ -27,6 +27,7 @@
 #include "fstext/deterministic-fst.h"
 #include "lm/arpa-file-parser.h"
 #include "util/common-utils.h"
+#include "util/kaldi-mmap.h"
 
 namespace kaldi {
 
@@ -194,6 +195,17 @@ namespace kaldi {
        of LmState whose address differs too much from the parent address. See
        above how we handle the leaf case.
     5. With the information in step 4, create the class ConstArpaLm.
+
+    GetNgramLogprob() looks up the history from the unigram level for every
+    query, and again for every backoff step. When the queries come from
+    states of the FST format language model (as in
+    ConstArpaLmDeterministicFst), we can avoid this by using state-based
+    querying, similar to KenLM. A ConstArpaLmState stores the LmStates of the
+    history and of all its suffixes. A query from it does one binary search in
+    the children of each of those LmStates, from the longest history to the
+    shortest. The same searches give the LmStates of the successor history.
+    Each history with an LmState has a distinct id, which callers can use to
+    identify states.
 */
 
 // Forward declaration of Auxiliary struct ArpaLine.
@@ -208,6 +220,29 @@ union Int32AndFloat {
   Int32AndFloat(float input_f) : f(input_f) {}
 };
 
+class ConstArpaLm;
+
+// A history state of a ConstArpaLm, for state-based querying; see
+// ConstArpaLm::GetNgramLogprob(const ConstArpaLmState&, ...).  It is created
+// by ConstArpaLm::GetHistoryState() or by a query.
+class ConstArpaLmState {
+ public:
+  // The default-constructed state is the empty history.
+  ConstArpaLmState() { }
+
+  // Returns an id that uniquely identifies the history among the history
+  // states of the LM; it is the offset of the history's LmState in the LM, or
+  // -1 for the empty history.
+  int64 Id() const { return suffixes_.empty() ? -1 : suffixes_[0]; }
+
+ private:
+  friend class ConstArpaLm;
+  // Offsets in ConstArpaLm::lm_states_ of the LmStates of the history and of
+  // its suffixes, longest first.  Suffixes that have no LmState are skipped,
+  // as they would not affect the result of a query.
+  std::vector<int64> suffixes_;
+};
+
 class ConstArpaLm {
  public:
 
@@ -217,6 +252,7 @@ class ConstArpaLm {
     lm_states_ = NULL;
     unigram_states_ = NULL;
     overflow_buffer_ = NULL;
+    mapped_file_ = NULL;
     memory_assigned_ = false;
     initialized_ = false;
     ngram_order_ = 0;
@@ -233,7 +269,8 @@ class ConstArpaLm {
       unk_symbol_(unk_symbol), ngram_order_(ngram_order),
       num_words_(num_words), overflow_buffer_size_(overflow_buffer_size),
       lm_states_size_(lm_states_size), unigram_states_(unigram_states),
-      overflow_buffer_(overflow_buffer), lm_states_(lm_states) {
+      overflow_buffer_(overflow_buffer), lm_states_(lm_states),
+      mapped_file_(NULL) {
     KALDI_ASSERT(unigram_states_ != NULL);
     KALDI_ASSERT(overflow_buffer_ != NULL);
     KALDI_ASSERT(lm_states_ != NULL);
@@ -249,7 +286,10 @@ class ConstArpaLm {
 
   ~ConstArpaLm() {
     if (memory_assigned_) {
-      delete[] lm_states_;
+      if (mapped_file_ != NULL)
+        delete mapped_file_;  // lm_states_ points into the mapped file.
+      else
+        delete[] lm_states_;
       delete[] unigram_states_;
       delete[] overflow_buffer_;
     }
@@ -259,6 +299,15 @@ class ConstArpaLm {
   // ReadInternalOldFormat() to do the actual reading.
   void Read(std::istream &is, bool binary);
 
+  // Reads the ConstArpaLm format language model from 'rxfilename', like
+  // ReadKaldiObject() would, except that if 'rxfilename' is a plain file the
+  // <LmStates> section (which is nearly all of the model) is memory-mapped
+  // instead of read.  This makes loading nearly instantaneous, and lets
+  // processes that load the same model share its memory.  It falls back to
+  // reading the model if it cannot be mapped, e.g. if it is a pipe, or was
+  // written by older code that did not align the <LmStates> section.
+  void ReadMapped(const std::string &rxfilename);
+
   // Writes the language model in ConstArpaLm format.
   void Write(std::ostream &os, bool binary) const;
 
@@ -274,6 +323,24 @@ class ConstArpaLm {
   // <hist> will be a state in the FST format language model.
   bool HistoryStateExists(const std::vector<int32>& hist) const;
 
+  // Sets <state> to the history state of <hist>, for state-based querying.
+  // Like in GetNgramLogprob(), old words are removed if <hist> is too long and
+  // out-of-vocabulary words are mapped to <unk>.  Leading words are also
+  // removed until the history has an LmState; this does not affect the log
+  // probabilities.
+  void GetHistoryState(const std::vector<int32>& hist,
+                       ConstArpaLmState *state) const;
+
+  // State-based version of GetNgramLogprob(): returns the log probability of
+  // <word> given the history <state>.  If <next_state> is not NULL, it is set
+  // to the state of the history followed by <word>, reduced to its longest
+  // suffix that has successors (i.e. to a state of the FST format language
+  // model, see HistoryStateExists()); if <word> is out of vocabulary, this is
+  // the empty history.  <next_state> is not set if the log probability is
+  // -infinity, and it may not be the same object as <state>.
+  float GetNgramLogprob(const ConstArpaLmState &state, const int32 word,
+                        ConstArpaLmState *next_state) const;
+
   int32 BosSymbol() const { return bos_symbol_; }
   int32 EosSymbol() const { return eos_symbol_; }
   int32 UnkSymbol() const { return unk_symbol_; }
@@ -281,8 +348,11 @@ class ConstArpaLm {
   bool Initialized() const { return initialized_; }
 
  private:
-  // Function that loads data from stream to the class.
-  void ReadInternal(std::istream &is, bool binary);
+  // Function that loads data from stream to the class.  If 'map_filename'
+  // is non-NULL it is the name of the file that 'is' reads from, and we try
+  // to memory-map the <LmStates> section from it.
+  void ReadInternal(std::istream &is, bool binary,
+                    const std::string *map_filename = NULL);
 
   // Function that loads data from stream to the class. This is a deprecated one
   // that handles the old on-disk format. We keep this for back-compatibility
@@ -290,6 +360,10 @@ class ConstArpaLm {
   // format, ReadInternal() will be called.
   void ReadInternalOldFormat(std::istream &is, bool binary);
 
+  // Removes the old words of <hist> if it is too long to be the history of an
+  // n-gram, and maps out-of-vocabulary words to <unk>, if <unk> is defined.
+  void MapHistory(std::vector<int32>* hist) const;
+
   // Loops up n-gram probability for given word sequence. Backoff is handled by
   // recursively calling this function.
   float GetNgramLogprobRecurse(const int32 word,
@@ -384,6 +458,10 @@ class ConstArpaLm {
   //
   // x = 1 + 1 + 1 + 2 * children.size() = 3 + 2 * children.size()
   int32* lm_states_;
+
+  // If the model was read by ReadMapped() and <lm_states_> was memory-mapped,
+  // this is the mapped file; otherwise NULL.
+  MemoryMappedFile *mapped_file_;
 };
 
 /**
@@ -410,11 +488,11 @@ class ConstArpaLmDeterministicFst
   virtual bool GetArc(StateId s, Label ilabel, fst::StdArc* oarc);
 
  private:
-  typedef unordered_map<std::vector<Label>,
-                        StateId, VectorHasher<Label> > MapType;
+  // Maps ConstArpaLmState::Id() to the state.
+  typedef unordered_map<int64, StateId> MapType;
   StateId start_state_;
-  MapType wseq_to_state_;
-  std::vector<std::vector<Label> > state_to_wseq_;
+  MapType id_to_state_;
+  std::vector<ConstArpaLmState> lm_states_;
   const ConstArpaLm& lm_;
 };
 
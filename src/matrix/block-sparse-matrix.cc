@@ -0,0 +1,444 @@
+// matrix/block-sparse-matrix.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "base/kaldi-types.h"
+#if (KALDI_DOUBLEPRECISION == 0)
+#if defined(__AVX__)
+#include <immintrin.h>
+#define KALDI_BLOCK_SPARSE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KALDI_BLOCK_SPARSE_SSE2
+#endif
+#endif  // KALDI_DOUBLEPRECISION == 0
+#include "base/io-funcs.h"
+#include "matrix/block-sparse-matrix.h"
+#include "matrix/matrix-threading.h"
+
+namespace kaldi {
+
+// Each of the structs ScalarOps, Sse2Ops and AvxOps provides what the
+// block-sparse kernel needs: a vector V of kLanes BaseFloat values, with
+// MulAdd(acc, a, b) returning acc + a * b lane by lane.  The SIMD versions are
+// only used when BaseFloat is float.
+
+struct ScalarOps {
+  typedef BaseFloat V;
+  static const int32 kLanes = 1;
+  static inline V Zero() { return 0.0; }
+  static inline V Load(const BaseFloat *p) { return *p; }
+  static inline void Store(BaseFloat *p, V a) { *p = a; }
+  static inline V Set(BaseFloat f) { return f; }
+  static inline V MulAdd(V acc, V a, V b) { return acc + a * b; }
+};
+
+#ifdef KALDI_BLOCK_SPARSE_SSE2
+struct Sse2Ops {
+  typedef __m128 V;
+  static const int32 kLanes = 4;
+  static inline V Zero() { return _mm_setzero_ps(); }
+  static inline V Load(const float *p) { return _mm_loadu_ps(p); }
+  static inline void Store(float *p, V a) { _mm_storeu_ps(p, a); }
+  static inline V Set(float f) { return _mm_set1_ps(f); }
+  static inline V MulAdd(V acc, V a, V b) {
+    return _mm_add_ps(acc, _mm_mul_ps(a, b));
+  }
+};
+#endif  // KALDI_BLOCK_SPARSE_SSE2
+
+#ifdef KALDI_BLOCK_SPARSE_AVX
+struct AvxOps {
+  typedef __m256 V;
+  static const int32 kLanes = 8;
+  static inline V Zero() { return _mm256_setzero_ps(); }
+  static inline V Load(const float *p) { return _mm256_loadu_ps(p); }
+  static inline void Store(float *p, V a) { _mm256_storeu_ps(p, a); }
+  static inline V Set(float f) { return _mm256_set1_ps(f); }
+  static inline V MulAdd(V acc, V a, V b) {
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a, b, acc);
+#else
+    return _mm256_add_ps(acc, _mm256_mul_ps(a, b));
+#endif
+  }
+};
+#endif  // KALDI_BLOCK_SPARSE_AVX
+
+// The number of rows of the input that we give to each thread at a time.
+static const int32 kBlockSparseRows = 8;
+
+// Computes rows [row_begin, row_end) of out = beta * out + A * B^T, where the
+// arrays describe the block-sparse matrix B as in class BlockSparseMatrix, and
+// the block size is kBlockSize, which is a multiple of Ops::kLanes.
+template <class Ops, int32 kBlockSize>
+static void BlockSparseForward(const MatrixBase<BaseFloat> &A,
+                               const int32 *row_offsets,
+                               const int32 *col_indexes,
+                               const BaseFloat *values,
+                               MatrixIndexT out_dim,
+                               BaseFloat beta,
+                               MatrixIndexT row_begin,
+                               MatrixIndexT row_end,
+                               MatrixBase<BaseFloat> *out) {
+  typedef typename Ops::V V;
+  // kRows is the number of rows of the input that we process at once; each
+  // block of parameters is loaded once for all of them.  We use as many as we
+  // can while keeping the kRows * kVecs accumulators in registers.
+  const int32 kVecs = kBlockSize / Ops::kLanes, kRows = (kVecs <= 2 ? 8 : 4);
+  MatrixIndexT num_block_rows = (out_dim + kBlockSize - 1) / kBlockSize;
+  for (MatrixIndexT i0 = row_begin; i0 < row_end; i0 += kRows) {
+    MatrixIndexT num_i = std::min<MatrixIndexT>(kRows, row_end - i0);
+    // If there are fewer than kRows rows left we repeat the last one, which
+    // is simpler than having a separate loop for them.
+    const BaseFloat *in[kRows];
+    for (int32 i = 0; i < kRows; i++)
+      in[i] = A.RowData(i0 + std::min<MatrixIndexT>(i, num_i - 1));
+    for (MatrixIndexT r = 0; r < num_block_rows; r++) {
+      V acc[kRows][kVecs];
+      for (int32 i = 0; i < kRows; i++)
+        for (int32 v = 0; v < kVecs; v++)
+          acc[i][v] = Ops::Zero();
+      for (int32 k = row_offsets[r]; k < row_offsets[r + 1]; k++) {
+        const BaseFloat *w = values + static_cast<size_t>(k) * kBlockSize;
+        int32 c = col_indexes[k];
+        V wv[kVecs];
+        for (int32 v = 0; v < kVecs; v++)
+          wv[v] = Ops::Load(w + v * Ops::kLanes);
+        for (int32 i = 0; i < kRows; i++) {
+          V x = Ops::Set(in[i][c]);
+          for (int32 v = 0; v < kVecs; v++)
+            acc[i][v] = Ops::MulAdd(acc[i][v], x, wv[v]);
+        }
+      }
+      MatrixIndexT j0 = r * kBlockSize,
+          num_j = std::min<MatrixIndexT>(kBlockSize, out_dim - j0);
+      for (MatrixIndexT i = 0; i < num_i; i++) {
+        BaseFloat buf[kBlockSize], *out_row = out->RowData(i0 + i) + j0;
+        for (int32 v = 0; v < kVecs; v++)
+          Ops::Store(buf + v * Ops::kLanes, acc[i][v]);
+        if (beta == 0.0) {
+          for (MatrixIndexT j = 0; j < num_j; j++)
+            out_row[j] = buf[j];
+        } else {
+          for (MatrixIndexT j = 0; j < num_j; j++)
+            out_row[j] = beta * out_row[j] + buf[j];
+        }
+      }
+    }
+  }
+}
+
+
+void BlockSparseMatrix::CopyFromMat(const MatrixBase<BaseFloat> &mat,
+                                    int32 block_size) {
+  if (!(block_size == 1 || block_size == 2 || block_size == 4 ||
+        block_size == 8 || block_size == 16))
+    KALDI_ERR << "Invalid block size " << block_size
+              << " for BlockSparseMatrix (must be 1, 2, 4, 8 or 16)";
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  block_size_ = block_size;
+  MatrixIndexT num_block_rows = NumBlockRows();
+  row_offsets_.resize(num_block_rows + 1);
+  col_indexes_.clear();
+  std::vector<BaseFloat> values;
+  for (MatrixIndexT r = 0; r < num_block_rows; r++) {
+    row_offsets_[r] = col_indexes_.size();
+    MatrixIndexT i0 = r * block_size,
+        num_i = std::min<MatrixIndexT>(block_size, num_rows_ - i0);
+    for (MatrixIndexT j = 0; j < num_cols_; j++) {
+      bool nonzero = false;
+      for (MatrixIndexT i = 0; i < num_i; i++)
+        if (mat(i0 + i, j) != 0.0) nonzero = true;
+      if (!nonzero)
+        continue;
+      KALDI_ASSERT(col_indexes_.size() <
+                   static_cast<size_t>(std::numeric_limits<int32>::max()));
+      col_indexes_.push_back(j);
+      for (MatrixIndexT i = 0; i < block_size; i++)
+        values.push_back(i < num_i ? mat(i0 + i, j) : 0.0);
+    }
+  }
+  row_offsets_[num_block_rows] = col_indexes_.size();
+  values_.Resize(values.size(), kUndefined);
+  if (!values.empty())
+    std::copy(values.begin(), values.end(), values_.Data());
+}
+
+void BlockSparseMatrix::CopyToMat(MatrixBase<BaseFloat> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  mat->SetZero();
+  MatrixIndexT num_block_rows = NumBlockRows();
+  for (MatrixIndexT r = 0; r < num_block_rows; r++) {
+    MatrixIndexT i0 = r * block_size_,
+        num_i = std::min<MatrixIndexT>(block_size_, num_rows_ - i0);
+    for (int32 k = row_offsets_[r]; k < row_offsets_[r + 1]; k++) {
+      const BaseFloat *w = values_.Data() +
+          static_cast<size_t>(k) * block_size_;
+      for (MatrixIndexT i = 0; i < num_i; i++)
+        (*mat)(i0 + i, col_indexes_[k]) = w[i];
+    }
+  }
+}
+
+BaseFloat BlockSparseMatrix::Density() const {
+  double num_blocks = static_cast<double>(NumBlockRows()) * num_cols_;
+  return (num_blocks == 0.0 ? 1.0 : NumBlocks() / num_blocks);
+}
+
+void BlockSparseMatrix::Check() const {
+  MatrixIndexT num_block_rows = NumBlockRows();
+  bool ok = (num_rows_ >= 0 && num_cols_ >= 0 &&
+             row_offsets_.size() == static_cast<size_t>(num_block_rows + 1) &&
+             row_offsets_[0] == 0 &&
+             row_offsets_.back() == static_cast<int32>(col_indexes_.size()) &&
+             values_.Dim() == static_cast<MatrixIndexT>(
+                 col_indexes_.size() * block_size_));
+  for (MatrixIndexT r = 0; ok && r < num_block_rows; r++) {
+    if (row_offsets_[r + 1] < row_offsets_[r]) ok = false;
+    for (int32 k = row_offsets_[r]; ok && k < row_offsets_[r + 1]; k++)
+      if (col_indexes_[k] < 0 || col_indexes_[k] >= num_cols_ ||
+          (k > row_offsets_[r] && col_indexes_[k] <= col_indexes_[k - 1]))
+        ok = false;
+  }
+  if (!ok)
+    KALDI_ERR << "BlockSparseMatrix has inconsistent contents (corrupted "
+              << "file?)";
+}
+
+void BlockSparseMatrix::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<BlockSparseMatrix>");
+  WriteBasicType(os, binary, num_rows_);
+  WriteBasicType(os, binary, num_cols_);
+  WriteBasicType(os, binary, block_size_);
+  WriteIntegerVector(os, binary, row_offsets_);
+  WriteIntegerVector(os, binary, col_indexes_);
+  values_.Write(os, binary);
+  WriteToken(os, binary, "</BlockSparseMatrix>");
+}
+
+void BlockSparseMatrix::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<BlockSparseMatrix>");
+  ReadBasicType(is, binary, &num_rows_);
+  ReadBasicType(is, binary, &num_cols_);
+  ReadBasicType(is, binary, &block_size_);
+  if (!(block_size_ == 1 || block_size_ == 2 || block_size_ == 4 ||
+        block_size_ == 8 || block_size_ == 16))
+    KALDI_ERR << "Reading BlockSparseMatrix: invalid block size "
+              << block_size_;
+  ReadIntegerVector(is, binary, &row_offsets_);
+  ReadIntegerVector(is, binary, &col_indexes_);
+  values_.Read(is, binary);
+  ExpectToken(is, binary, "</BlockSparseMatrix>");
+  Check();
+}
+
+void BlockSparseMatrix::Swap(BlockSparseMatrix *other) {
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  std::swap(block_size_, other->block_size_);
+  row_offsets_.swap(other->row_offsets_);
+  col_indexes_.swap(other->col_indexes_);
+  values_.Swap(&(other->values_));
+}
+
+
+void AddMatBlockSparseMatTrans(const MatrixBase<BaseFloat> &A,
+                               const BlockSparseMatrix &B,
+                               BaseFloat beta,
+                               MatrixBase<BaseFloat> *out) {
+  KALDI_ASSERT(A.NumCols() == B.num_cols_ && out->NumRows() == A.NumRows() &&
+               out->NumCols() == B.num_rows_);
+  MatrixIndexT num_rows = A.NumRows(), out_dim = B.num_rows_;
+  if (num_rows == 0 || out_dim == 0)
+    return;
+  const int32 *row_offsets = &(B.row_offsets_[0]),
+      *col_indexes = (B.col_indexes_.empty() ? NULL : &(B.col_indexes_[0]));
+  const BaseFloat *values = B.values_.Data();
+  int32 block_size = B.block_size_;
+  MatrixIndexT num_groups = (num_rows + kBlockSparseRows - 1) /
+      kBlockSparseRows;
+  MatrixParallelFor(
+      num_groups, 2.0 * kBlockSparseRows * B.values_.Dim(),
+      [=, &A](MatrixIndexT begin, MatrixIndexT end) {
+        MatrixIndexT row_begin = begin * kBlockSparseRows,
+            row_end = std::min(num_rows, end * kBlockSparseRows);
+        switch (block_size) {
+          case 1:
+            BlockSparseForward<ScalarOps, 1>(A, row_offsets, col_indexes,
+                                             values, out_dim, beta,
+                                             row_begin, row_end, out);
+            break;
+          case 2:
+            BlockSparseForward<ScalarOps, 2>(A, row_offsets, col_indexes,
+                                             values, out_dim, beta,
+                                             row_begin, row_end, out);
+            break;
+#if defined(KALDI_BLOCK_SPARSE_AVX)
+          case 4:
+            BlockSparseForward<Sse2Ops, 4>(A, row_offsets, col_indexes,
+                                           values, out_dim, beta,
+                                           row_begin, row_end, out);
+            break;
+          case 8:
+            BlockSparseForward<AvxOps, 8>(A, row_offsets, col_indexes,
+                                          values, out_dim, beta,
+                                          row_begin, row_end, out);
+            break;
+          case 16:
+            BlockSparseForward<AvxOps, 16>(A, row_offsets, col_indexes,
+                                           values, out_dim, beta,
+                                           row_begin, row_end, out);
+            break;
+#elif defined(KALDI_BLOCK_SPARSE_SSE2)
+          case 4:
+            BlockSparseForward<Sse2Ops, 4>(A, row_offsets, col_indexes,
+                                           values, out_dim, beta,
+                                           row_begin, row_end, out);
+            break;
+          case 8:
+            BlockSparseForward<Sse2Ops, 8>(A, row_offsets, col_indexes,
+                                           values, out_dim, beta,
+                                           row_begin, row_end, out);
+            break;
+          case 16:
+            BlockSparseForward<Sse2Ops, 16>(A, row_offsets, col_indexes,
+                                            values, out_dim, beta,
+                                            row_begin, row_end, out);
+            break;
+#else
+          case 4:
+            BlockSparseForward<ScalarOps, 4>(A, row_offsets, col_indexes,
+                                             values, out_dim, beta,
+                                             row_begin, row_end, out);
+            break;
+          case 8:
+            BlockSparseForward<ScalarOps, 8>(A, row_offsets, col_indexes,
+                                             values, out_dim, beta,
+                                             row_begin, row_end, out);
+            break;
+          case 16:
+            BlockSparseForward<ScalarOps, 16>(A, row_offsets, col_indexes,
+                                              values, out_dim, beta,
+                                              row_begin, row_end, out);
+            break;
+#endif
+          default:
+            KALDI_ERR << "Invalid block size " << block_size;
+        }
+      });
+}
+
+void AddMatBlockSparseMat(const MatrixBase<BaseFloat> &A,
+                          const BlockSparseMatrix &B,
+                          MatrixBase<BaseFloat> *out) {
+  KALDI_ASSERT(A.NumCols() == B.num_rows_ && out->NumRows() == A.NumRows() &&
+               out->NumCols() == B.num_cols_);
+  MatrixIndexT num_rows = A.NumRows(), in_dim = B.num_rows_,
+      num_block_rows = B.NumBlockRows();
+  int32 block_size = B.block_size_;
+  MatrixParallelFor(
+      num_rows, 2.0 * B.values_.Dim(),
+      [=, &A, &B](MatrixIndexT begin, MatrixIndexT end) {
+        for (MatrixIndexT t = begin; t < end; t++) {
+          const BaseFloat *a = A.RowData(t);
+          BaseFloat *out_row = out->RowData(t);
+          for (MatrixIndexT r = 0; r < num_block_rows; r++) {
+            MatrixIndexT i0 = r * block_size,
+                num_i = std::min<MatrixIndexT>(block_size, in_dim - i0);
+            for (int32 k = B.row_offsets_[r]; k < B.row_offsets_[r + 1];
+                 k++) {
+              const BaseFloat *w = B.values_.Data() +
+                  static_cast<size_t>(k) * block_size;
+              BaseFloat sum = 0.0;
+              for (MatrixIndexT i = 0; i < num_i; i++)
+                sum += a[i0 + i] * w[i];
+              out_row[B.col_indexes_[k]] += sum;
+            }
+          }
+        }
+      });
+}
+
+
+// Returns the sum of squares of each block of 'mat' (of 'block_size' rows by
+// one column), indexed by block-row times mat.NumCols() plus column.
+static void ComputeBlockSumsq(const MatrixBase<BaseFloat> &mat,
+                              int32 block_size,
+                              std::vector<BaseFloat> *sumsq) {
+  KALDI_ASSERT(block_size > 0);
+  MatrixIndexT num_rows = mat.NumRows(), num_cols = mat.NumCols(),
+      num_block_rows = (num_rows + block_size - 1) / block_size;
+  sumsq->assign(static_cast<size_t>(num_block_rows) * num_cols, 0.0);
+  for (MatrixIndexT i = 0; i < num_rows; i++) {
+    const BaseFloat *row = mat.RowData(i);
+    BaseFloat *dest = &((*sumsq)[static_cast<size_t>(i / block_size) *
+                                 num_cols]);
+    for (MatrixIndexT j = 0; j < num_cols; j++)
+      dest[j] += row[j] * row[j];
+  }
+}
+
+BaseFloat BlockSparsity(const MatrixBase<BaseFloat> &mat, int32 block_size) {
+  std::vector<BaseFloat> sumsq;
+  ComputeBlockSumsq(mat, block_size, &sumsq);
+  if (sumsq.empty())
+    return 0.0;
+  size_t num_zero = 0;
+  for (size_t b = 0; b < sumsq.size(); b++)
+    if (sumsq[b] == 0.0) num_zero++;
+  return num_zero / static_cast<BaseFloat>(sumsq.size());
+}
+
+MatrixIndexT PruneMatrixBlocks(int32 block_size, BaseFloat sparsity,
+                               MatrixBase<BaseFloat> *mat) {
+  KALDI_ASSERT(sparsity >= 0.0 && sparsity <= 1.0);
+  std::vector<BaseFloat> sumsq;
+  ComputeBlockSumsq(*mat, block_size, &sumsq);
+  size_t num_blocks = sumsq.size(),
+      num_prune = static_cast<size_t>(sparsity * num_blocks);
+  if (num_prune == 0)
+    return 0;
+  std::vector<std::pair<BaseFloat, size_t> > blocks(num_blocks);
+  for (size_t b = 0; b < num_blocks; b++)
+    blocks[b] = std::pair<BaseFloat, size_t>(sumsq[b], b);
+  std::nth_element(blocks.begin(), blocks.begin() + (num_prune - 1),
+                   blocks.end());
+  MatrixIndexT num_rows = mat->NumRows(), num_cols = mat->NumCols(),
+      num_pruned = 0;
+  for (size_t n = 0; n < num_prune; n++) {
+    if (blocks[n].first == 0.0)
+      continue;
+    MatrixIndexT i0 = (blocks[n].second / num_cols) * block_size,
+        j = blocks[n].second % num_cols,
+        num_i = std::min<MatrixIndexT>(block_size, num_rows - i0);
+    for (MatrixIndexT i = 0; i < num_i; i++)
+      (*mat)(i0 + i, j) = 0.0;
+    num_pruned++;
+  }
+  return num_pruned;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,145 @@
+// matrix/block-sparse-matrix.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_MATRIX_BLOCK_SPARSE_MATRIX_H_
+#define KALDI_MATRIX_BLOCK_SPARSE_MATRIX_H_
+
+#include <vector>
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/**
+   BlockSparseMatrix stores a matrix in which most of the blocks of
+   BlockSize() consecutive rows by one column are zero (the last block-row may
+   be shorter, if the number of rows is not a multiple of the block size).
+   Only the nonzero blocks are stored: for each block-row, the column indexes
+   of its nonzero blocks, and their values.  It is intended for neural-net
+   inference with pruned parameter matrices (see PruneMatrixBlocks() and
+   BlockSparseAffineComponent in ../nnet3/nnet-block-sparse-component.h); the
+   blocks correspond to groups of outputs that share an input, so that
+   AddMatBlockSparseMatTrans() can compute BlockSize() outputs at a time with
+   SIMD instructions.  The block sizes for which this is fast are 4, 8 and 16.
+ */
+class BlockSparseMatrix {
+ public:
+  BlockSparseMatrix(): num_rows_(0), num_cols_(0), block_size_(1) { }
+
+  BlockSparseMatrix(const MatrixBase<BaseFloat> &mat, int32 block_size):
+      num_rows_(0), num_cols_(0), block_size_(1) {
+    CopyFromMat(mat, block_size);
+  }
+
+  /// Copies the nonzero blocks of 'mat' (resizing *this as needed).
+  /// 'block_size' must be 1, 2, 4, 8 or 16.
+  void CopyFromMat(const MatrixBase<BaseFloat> &mat, int32 block_size);
+
+  /// Copies the represented values to 'mat', which must have the same
+  /// dimensions as *this.
+  void CopyToMat(MatrixBase<BaseFloat> *mat) const;
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+  int32 BlockSize() const { return block_size_; }
+
+  /// Returns the number of nonzero (stored) blocks.
+  MatrixIndexT NumBlocks() const { return col_indexes_.size(); }
+
+  /// Returns the proportion of the blocks that are stored, between 0 and 1.
+  BaseFloat Density() const;
+
+  void Write(std::ostream &os, bool binary) const;
+
+  void Read(std::istream &is, bool binary);
+
+  void Swap(BlockSparseMatrix *other);
+
+ private:
+  friend void AddMatBlockSparseMatTrans(const MatrixBase<BaseFloat> &A,
+                                        const BlockSparseMatrix &B,
+                                        BaseFloat beta,
+                                        MatrixBase<BaseFloat> *out);
+  friend void AddMatBlockSparseMat(const MatrixBase<BaseFloat> &A,
+                                   const BlockSparseMatrix &B,
+                                   MatrixBase<BaseFloat> *out);
+
+  MatrixIndexT NumBlockRows() const {
+    return (num_rows_ + block_size_ - 1) / block_size_;
+  }
+
+  void Check() const;
+
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  int32 block_size_;
+  // The blocks of block-row r are numbered row_offsets_[r] through
+  // row_offsets_[r + 1] - 1; has dimension NumBlockRows() + 1.
+  std::vector<int32> row_offsets_;
+  // The column index of each block, in increasing order within each
+  // block-row.
+  std::vector<int32> col_indexes_;
+  // The values of block k are values_(k * block_size_) through
+  // values_(k * block_size_ + block_size_ - 1), with zeros for any rows past
+  // the end of the matrix.
+  Vector<BaseFloat> values_;
+};
+
+/// Does out = beta * out + A * B^T, where B is block-sparse with the same
+/// number of columns as A, and 'out' is A.NumRows() by B.NumRows().  If beta
+/// is zero, the previous contents of 'out' are ignored (even if they are NaN).
+/// The time taken is proportional to the number of nonzero blocks of B; it
+/// is only faster than a dense AddMatMat() if most of the blocks are zero
+/// (how many depends on the BLAS and on the instruction set we were compiled
+/// for; see the speed test in matrix-lib-speed-test.cc).  This uses the
+/// matrix library's threads if g_matrix_num_threads > 1 (see
+/// matrix-threading.h).
+void AddMatBlockSparseMatTrans(const MatrixBase<BaseFloat> &A,
+                               const BlockSparseMatrix &B,
+                               BaseFloat beta,
+                               MatrixBase<BaseFloat> *out);
+
+/// Does out += A * B, where B is block-sparse, A has B.NumRows() columns and
+/// 'out' is A.NumRows() by B.NumCols().  This is what is needed for the
+/// backprop through a block-sparse layer; it is not as optimized as
+/// AddMatBlockSparseMatTrans().
+void AddMatBlockSparseMat(const MatrixBase<BaseFloat> &A,
+                          const BlockSparseMatrix &B,
+                          MatrixBase<BaseFloat> *out);
+
+/// Returns the proportion of the blocks of 'mat' (of 'block_size' consecutive
+/// rows by one column, as in class BlockSparseMatrix) that are all zero.
+BaseFloat BlockSparsity(const MatrixBase<BaseFloat> &mat, int32 block_size);
+
+/// Sets to zero the blocks of 'mat' (of 'block_size' consecutive rows by one
+/// column, as in class BlockSparseMatrix) that have the smallest 2-norms, so
+/// that a proportion 'sparsity' (rounded down) of the blocks are zero.  Blocks
+/// that were already zero count towards that proportion.  Returns the number
+/// of blocks that were newly set to zero.
+MatrixIndexT PruneMatrixBlocks(int32 block_size, BaseFloat sparsity,
+                               MatrixBase<BaseFloat> *mat);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_BLOCK_SPARSE_MATRIX_H_
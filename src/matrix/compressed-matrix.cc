@@ -21,6 +21,14 @@
 
 #include "matrix/compressed-matrix.h"
 #include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KALDI_COMPRESSED_MATRIX_SSE2
+#endif
 
 namespace kaldi {
 
@@ -457,31 +465,24 @@ void CompressedMatrix::ComputeColHeader(
 inline uint8 CompressedMatrix::FloatToChar(
     float p0, float p25, float p75, float p100,
     float value) {
-  int ans;
-  if (value < p25) {  // range [ p0, p25 ) covered by
-    // characters 0 .. 64.  We round to the closest int.
-    float f = (value - p0) / (p25 - p0);
-    ans = static_cast<int>(f * 64 + 0.5);
-    // Note: the checks on the next two lines
-    // are necessary in pathological cases when all the elements in a row
-    // are the same and the percentile_* values are separated by one.
-    if (ans < 0) ans = 0;
-    if (ans > 64) ans = 64;
-  } else if (value < p75) {  // range [ p25, p75 )covered
-    // by characters 64 .. 192.  We round to the closest int.
-    float f = (value - p25) / (p75 - p25);
-    ans = 64 + static_cast<int>(f * 128 + 0.5);
-    if (ans < 64) ans = 64;
-    if (ans > 192) ans = 192;
-  } else {  // range [ p75, p100 ] covered by
-    // characters 192 .. 255.  Note: this last range
-    // has fewer characters than the left range, because
-    // we go up to 255, not 256.
-    float f = (value - p75) / (p100 - p75);
-    ans = 192 + static_cast<int>(f * 63 + 0.5);
-    if (ans < 192) ans = 192;
-    if (ans > 255) ans = 255;
-  }
+  // The range [ p0, p25 ) is covered by characters 0 .. 64, the range
+  // [ p25, p75 ) by characters 64 .. 192 and the range [ p75, p100 ] by
+  // characters 192 .. 255; note, this last range has fewer characters than the
+  // left range, because we go up to 255, not 256.  We round to the closest
+  // int.  This is written with conditional selects rather than branches
+  // because the branches would be hard to predict.
+  bool below_p25 = (value < p25), below_p75 = (value < p75);
+  float low = below_p25 ? p0 : (below_p75 ? p25 : p75),
+      high = below_p25 ? p25 : (below_p75 ? p75 : p100);
+  int offset = below_p25 ? 0 : (below_p75 ? 64 : 192),
+      num_chars = below_p25 ? 64 : (below_p75 ? 128 : 63);
+  float f = (value - low) / (high - low);
+  int ans = offset + static_cast<int>(f * num_chars + 0.5);
+  // Note: the checks on the next two lines are necessary in pathological cases
+  // when all the elements in a row are the same and the percentile_* values
+  // are separated by one.
+  ans = std::max(ans, offset);
+  ans = std::min(ans, offset + num_chars);
   return static_cast<uint8>(ans);
 }
 
@@ -490,13 +491,125 @@ inline uint8 CompressedMatrix::FloatToChar(
 inline float CompressedMatrix::CharToFloat(
     float p0, float p25, float p75, float p100,
     uint8 value) {
-  if (value <= 64) {
-    return p0 + (p25 - p0) * value * (1/64.0);
-  } else if (value <= 192) {
-    return p25 + (p75 - p25) * (value - 64) * (1/128.0);
-  } else {
-    return p75 + (p100 - p75) * (value - 192) * (1/63.0);
+  // This is the inverse of FloatToChar().  Characters 0 .. 64 map linearly to
+  // [ p0, p25 ], characters 64 .. 192 to [ p25, p75 ] and characters 192 .. 255
+  // to [ p75, p100 ].  We use conditional selects instead of branches, and
+  // only single-precision arithmetic; the SIMD versions of this in
+  // CharsToFloats() do the same operations, so they give the same results.
+  bool above_64 = (value > 64), above_192 = (value > 192);
+  float low = above_192 ? p75 : (above_64 ? p25 : p0),
+      high = above_192 ? p100 : (above_64 ? p75 : p25),
+      inv_num_chars = above_192 ? (1.0f / 63) :
+      (above_64 ? (1.0f / 128) : (1.0f / 64));
+  int offset = above_192 ? 192 : (above_64 ? 64 : 0);
+  return low + (high - low) * inv_num_chars * (value - offset);
+}
+
+// The functions CharsToFloatsAvx2() and CharsToFloatsSse2() do what
+// CharToFloat() does for elements 0, 1, ... of 'byte_data', 8 or 16 at a time,
+// and return the number of elements they did (the rest are left for the
+// scalar code).  For each of the three ranges of characters, 'low' is the
+// value of its first character and 'scale' is (high - low) * inv_num_chars
+// in CharToFloat().
+
+#ifdef __AVX2__
+static int32 CharsToFloatsAvx2(const float *low, const float *scale,
+                               const uint8 *byte_data, int32 num,
+                               float *out) {
+  const __m256 low0 = _mm256_set1_ps(low[0]), low1 = _mm256_set1_ps(low[1]),
+      low2 = _mm256_set1_ps(low[2]), scale0 = _mm256_set1_ps(scale[0]),
+      scale1 = _mm256_set1_ps(scale[1]), scale2 = _mm256_set1_ps(scale[2]);
+  const __m256i c64 = _mm256_set1_epi32(64), c128 = _mm256_set1_epi32(128),
+      c192 = _mm256_set1_epi32(192);
+  int32 i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m256i value = _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+        reinterpret_cast<const __m128i*>(byte_data + i))),
+        above_64 = _mm256_cmpgt_epi32(value, c64),
+        above_192 = _mm256_cmpgt_epi32(value, c192),
+        offset = _mm256_add_epi32(_mm256_and_si256(above_64, c64),
+                                  _mm256_and_si256(above_192, c128));
+    __m256 mask_64 = _mm256_castsi256_ps(above_64),
+        mask_192 = _mm256_castsi256_ps(above_192),
+        this_low = _mm256_blendv_ps(_mm256_blendv_ps(low0, low1, mask_64),
+                                    low2, mask_192),
+        this_scale = _mm256_blendv_ps(_mm256_blendv_ps(scale0, scale1,
+                                                       mask_64),
+                                      scale2, mask_192),
+        diff = _mm256_cvtepi32_ps(_mm256_sub_epi32(value, offset));
+    _mm256_storeu_ps(out + i, _mm256_add_ps(this_low,
+                                            _mm256_mul_ps(this_scale, diff)));
   }
+  return i;
+}
+#endif  // __AVX2__
+
+#if defined(KALDI_COMPRESSED_MATRIX_SSE2) && !defined(__AVX2__)
+// Returns b where 'mask' is set and a elsewhere.
+static inline __m128 Sse2Select(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+static int32 CharsToFloatsSse2(const float *low, const float *scale,
+                               const uint8 *byte_data, int32 num,
+                               float *out) {
+  const __m128 low0 = _mm_set1_ps(low[0]), low1 = _mm_set1_ps(low[1]),
+      low2 = _mm_set1_ps(low[2]), scale0 = _mm_set1_ps(scale[0]),
+      scale1 = _mm_set1_ps(scale[1]), scale2 = _mm_set1_ps(scale[2]);
+  const __m128i zero = _mm_setzero_si128(), c64 = _mm_set1_epi32(64),
+      c128 = _mm_set1_epi32(128), c192 = _mm_set1_epi32(192);
+  int32 i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m128i bytes = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(byte_data + i)),
+        shorts_lo = _mm_unpacklo_epi8(bytes, zero),
+        shorts_hi = _mm_unpackhi_epi8(bytes, zero),
+        values[4] = { _mm_unpacklo_epi16(shorts_lo, zero),
+                      _mm_unpackhi_epi16(shorts_lo, zero),
+                      _mm_unpacklo_epi16(shorts_hi, zero),
+                      _mm_unpackhi_epi16(shorts_hi, zero) };
+    for (int32 j = 0; j < 4; j++) {
+      __m128i value = values[j],
+          above_64 = _mm_cmpgt_epi32(value, c64),
+          above_192 = _mm_cmpgt_epi32(value, c192),
+          offset = _mm_add_epi32(_mm_and_si128(above_64, c64),
+                                 _mm_and_si128(above_192, c128));
+      __m128 mask_64 = _mm_castsi128_ps(above_64),
+          mask_192 = _mm_castsi128_ps(above_192),
+          this_low = Sse2Select(mask_192, Sse2Select(mask_64, low0, low1),
+                                low2),
+          this_scale = Sse2Select(mask_192,
+                                  Sse2Select(mask_64, scale0, scale1), scale2),
+          diff = _mm_cvtepi32_ps(_mm_sub_epi32(value, offset));
+      _mm_storeu_ps(out + i + 4 * j,
+                    _mm_add_ps(this_low, _mm_mul_ps(this_scale, diff)));
+    }
+  }
+  return i;
+}
+#endif  // defined(KALDI_COMPRESSED_MATRIX_SSE2) && !defined(__AVX2__)
+
+// static
+inline void CompressedMatrix::CharsToFloats(
+    const GlobalHeader &global_header, const PerColHeader &col_header,
+    const uint8 *byte_data, int32 num, float *out) {
+  float p0 = Uint16ToFloat(global_header, col_header.percentile_0),
+      p25 = Uint16ToFloat(global_header, col_header.percentile_25),
+      p75 = Uint16ToFloat(global_header, col_header.percentile_75),
+      p100 = Uint16ToFloat(global_header, col_header.percentile_100);
+  int32 i = 0;
+#if defined(__AVX2__) || defined(KALDI_COMPRESSED_MATRIX_SSE2)
+  float low[3] = { p0, p25, p75 },
+      scale[3] = { (p25 - p0) * (1.0f / 64), (p75 - p25) * (1.0f / 128),
+                   (p100 - p75) * (1.0f / 63) };
+#ifdef __AVX2__
+  i = CharsToFloatsAvx2(low, scale, byte_data, num, out);
+#else
+  i = CharsToFloatsSse2(low, scale, byte_data, num, out);
+#endif
+#endif
+  for (; i < num; i++)
+    out[i] = CharToFloat(p0, p25, p75, p100, byte_data[i]);
 }
 
 
@@ -610,6 +723,41 @@ void CompressedMatrix::Read(std::istream &is, bool binary) {
     KALDI_ERR << "Failed to read data.";
 }
 
+template<typename Real>
+void CompressedMatrix::CopyColumnsToMat(int32 row_offset,
+                                        int32 col_offset,
+                                        MatrixBase<Real> *dest) const {
+  const GlobalHeader *h = reinterpret_cast<const GlobalHeader*>(data_);
+  KALDI_ASSERT(static_cast<DataFormat>(h->format) == kOneByteWithColHeaders);
+  const PerColHeader *per_col_header =
+      reinterpret_cast<const PerColHeader*>(h + 1);
+  const uint8 *byte_data =
+      reinterpret_cast<const uint8*>(per_col_header + h->num_cols);
+  int32 num_rows = h->num_rows,
+      tgt_rows = dest->NumRows(), tgt_cols = dest->NumCols();
+  per_col_header += col_offset;
+  byte_data += row_offset + col_offset * num_rows;
+
+  // The data is stored column by column.  Rather than writing each column to
+  // 'dest' with a stride, which is slow, we decompress a block of columns into
+  // a buffer and then copy the block to 'dest' row by row.
+  const int32 block_size = 16;
+  std::vector<float> buffer(block_size * tgt_rows);
+  for (int32 c = 0; c < tgt_cols; c += block_size) {
+    int32 this_block_size = std::min(block_size, tgt_cols - c);
+    for (int32 i = 0; i < this_block_size; i++)
+      CharsToFloats(*h, per_col_header[c + i],
+                    byte_data + (c + i) * num_rows, tgt_rows,
+                    &(buffer[i * tgt_rows]));
+    for (int32 r = 0; r < tgt_rows; r++) {
+      Real *dest_row = dest->RowData(r) + c;
+      const float *buffer_row = &(buffer[r]);
+      for (int32 i = 0; i < this_block_size; i++)
+        dest_row[i] = buffer_row[i * tgt_rows];
+    }
+  }
+}
+
 template<typename Real>
 void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat,
                                  MatrixTransposeType trans) const {
@@ -632,19 +780,7 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat,
 
   DataFormat format = static_cast<DataFormat>(h->format);
   if (format == kOneByteWithColHeaders) {
-    PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-    uint8 *byte_data = reinterpret_cast<uint8*>(per_col_header +
-                                                h->num_cols);
-    for (int32 i = 0; i < num_cols; i++, per_col_header++) {
-      float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-      for (int32 j = 0; j < num_rows; j++, byte_data++) {
-        float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-        (*mat)(j, i) = f;
-      }
-    }
+    CopyColumnsToMat(0, 0, mat);
   } else if (format == kTwoByte) {
     const uint16 *data = reinterpret_cast<const uint16*>(h + 1);
     float min_value = h->min_value,
@@ -786,34 +922,12 @@ void CompressedMatrix::CopyToMat(int32 row_offset,
   KALDI_ASSERT(col_offset+dest->NumCols() <= this->NumCols());
   // everything is OK
   GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
-  int32 num_rows = h->num_rows, num_cols = h->num_cols,
+  int32 num_cols = h->num_cols,
       tgt_cols = dest->NumCols(), tgt_rows = dest->NumRows();
 
   DataFormat format = static_cast<DataFormat>(h->format);
   if (format == kOneByteWithColHeaders) {
-    PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-    uint8 *byte_data = reinterpret_cast<uint8*>(per_col_header +
-                                                h->num_cols);
-
-    uint8 *start_of_subcol = byte_data+row_offset;  // skip appropriate
-    // number of columns
-    start_of_subcol += col_offset*num_rows;  // skip appropriate number of rows
-
-    per_col_header += col_offset;  // skip the appropriate number of headers
-
-    for (int32 i = 0;
-         i < tgt_cols;
-         i++, per_col_header++, start_of_subcol+=num_rows) {
-      byte_data = start_of_subcol;
-      float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-      for (int32 j = 0; j < tgt_rows; j++, byte_data++) {
-        float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-        (*dest)(j, i) = f;
-      }
-    }
+    CopyColumnsToMat(row_offset, col_offset, dest);
   } else if (format == kTwoByte) {
     const uint16 *data = reinterpret_cast<const uint16*>(h+1) + col_offset +
         (num_cols * row_offset);
@@ -849,6 +963,77 @@ template void CompressedMatrix::CopyToMat(int32,
                                           int32,
                                           MatrixBase<double> *dest) const;
 
+template<typename Real>
+void CompressedMatrix::CopyRowsToMat(const std::vector<MatrixIndexT> &rows,
+                                     MatrixBase<Real> *dest) const {
+  int32 num_rows = this->NumRows(), num_cols = this->NumCols(),
+      tgt_rows = rows.size();
+  KALDI_ASSERT(dest->NumRows() == tgt_rows && dest->NumCols() == num_cols);
+  for (int32 r = 0; r < tgt_rows; r++)
+    KALDI_ASSERT(rows[r] >= 0 && rows[r] < num_rows);
+  if (tgt_rows == 0)
+    return;
+
+  const GlobalHeader *h = reinterpret_cast<const GlobalHeader*>(data_);
+  DataFormat format = static_cast<DataFormat>(h->format);
+  if (format == kOneByteWithColHeaders) {
+    const PerColHeader *per_col_header =
+        reinterpret_cast<const PerColHeader*>(h + 1);
+    const uint8 *byte_data =
+        reinterpret_cast<const uint8*>(per_col_header + num_cols);
+    // We work on a block of columns at a time, so that we only need to work
+    // out the percentiles once per column and the bytes we read for one row
+    // are likely to be in cache for the next.
+    const int32 block_size = 16;
+    float p0[block_size], p25[block_size], p75[block_size], p100[block_size];
+    for (int32 c = 0; c < num_cols; c += block_size) {
+      int32 this_block_size = std::min(block_size, num_cols - c);
+      for (int32 i = 0; i < this_block_size; i++) {
+        const PerColHeader &col_header = per_col_header[c + i];
+        p0[i] = Uint16ToFloat(*h, col_header.percentile_0);
+        p25[i] = Uint16ToFloat(*h, col_header.percentile_25);
+        p75[i] = Uint16ToFloat(*h, col_header.percentile_75);
+        p100[i] = Uint16ToFloat(*h, col_header.percentile_100);
+      }
+      const uint8 *block_data = byte_data + c * num_rows;
+      for (int32 r = 0; r < tgt_rows; r++) {
+        Real *dest_row = dest->RowData(r) + c;
+        const uint8 *src = block_data + rows[r];
+        for (int32 i = 0; i < this_block_size; i++)
+          dest_row[i] = CharToFloat(p0[i], p25[i], p75[i], p100[i],
+                                    src[i * num_rows]);
+      }
+    }
+  } else if (format == kTwoByte) {
+    const uint16 *data = reinterpret_cast<const uint16*>(h + 1);
+    float min_value = h->min_value,
+        increment = h->range * (1.0 / 65535.0);
+    for (int32 r = 0; r < tgt_rows; r++) {
+      const uint16 *row_data = data + (num_cols * rows[r]);
+      Real *dest_row = dest->RowData(r);
+      for (int32 c = 0; c < num_cols; c++)
+        dest_row[c] = min_value + row_data[c] * increment;
+    }
+  } else {
+    KALDI_ASSERT(format == kOneByte);
+    const uint8 *data = reinterpret_cast<const uint8*>(h + 1);
+    float min_value = h->min_value,
+        increment = h->range * (1.0 / 255.0);
+    for (int32 r = 0; r < tgt_rows; r++) {
+      const uint8 *row_data = data + (num_cols * rows[r]);
+      Real *dest_row = dest->RowData(r);
+      for (int32 c = 0; c < num_cols; c++)
+        dest_row[c] = min_value + row_data[c] * increment;
+    }
+  }
+}
+
+// instantiate the templates.
+template void CompressedMatrix::CopyRowsToMat(
+    const std::vector<MatrixIndexT> &rows, MatrixBase<float> *dest) const;
+template void CompressedMatrix::CopyRowsToMat(
+    const std::vector<MatrixIndexT> &rows, MatrixBase<double> *dest) const;
+
 void CompressedMatrix::Clear() {
   if (data_ != NULL) {
     delete [] static_cast<float*>(data_);
@@ -133,7 +133,9 @@ class CompressedMatrix {
   CompressedMatrix &operator = (const MatrixBase<Real> &mat); // assignment operator.
 
   /// Copies contents to matrix.  Note: mat must have the correct size.
-  /// The kTrans case uses a temporary.
+  /// The kTrans case uses a temporary.  'mat' may be a SubMatrix, to
+  /// decompress directly into part of a larger matrix (see
+  /// AppendGeneralMatrixRows()).
   template<typename Real>
   void CopyToMat(MatrixBase<Real> *mat,
                  MatrixTransposeType trans = kNoTrans) const;
@@ -168,6 +170,14 @@ class CompressedMatrix {
                  int32 column_offset,
                  MatrixBase<Real> *dest) const;
 
+  /// Copies the rows listed in 'rows' into 'dest', so that row i of 'dest' is
+  /// row rows[i] of this matrix; requires dest->NumRows() == rows.size() and
+  /// dest->NumCols() == NumCols().  This is much faster than calling
+  /// CopyRowToVec() for each row, and avoids decompressing the whole matrix.
+  template<typename Real>
+  void CopyRowsToMat(const std::vector<MatrixIndexT> &rows,
+                     MatrixBase<Real> *dest) const;
+
   void Swap(CompressedMatrix *other) { std::swap(data_, other->data_); }
 
   void Clear();
@@ -268,6 +278,20 @@ class CompressedMatrix {
                                   float p75, float p100,
                                   uint8 value);
 
+  // this is used only in the kOneByteWithColHeaders compression format.  It
+  // decompresses 'num' bytes of the column whose header is 'col_header' into
+  // 'out'.
+  static inline void CharsToFloats(const GlobalHeader &global_header,
+                                   const PerColHeader &col_header,
+                                   const uint8 *byte_data, int32 num,
+                                   float *out);
+
+  // this is used only in the kOneByteWithColHeaders compression format.  It
+  // does the work of CopyToMat(row_offset, col_offset, dest).
+  template<typename Real>
+  void CopyColumnsToMat(int32 row_offset, int32 col_offset,
+                        MatrixBase<Real> *dest) const;
+
   void *data_; // first GlobalHeader, then PerColHeader (repeated), then
   // the byte data for each column (repeated).  Note: don't intersperse
   // the byte data with the PerColHeaders, because of alignment issues.
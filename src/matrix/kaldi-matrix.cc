@@ -28,6 +28,7 @@
 #include "matrix/jama-eig.h"
 #include "matrix/compressed-matrix.h"
 #include "matrix/sparse-matrix.h"
+#include "matrix/matrix-threading.h"
 
 static_assert(int(kaldi::kNoTrans) == int(CblasNoTrans) && int(kaldi::kTrans) == int(CblasTrans), 
     "kaldi::kNoTrans and kaldi::kTrans must be equal to the appropriate CBLAS library constants!");
@@ -180,9 +181,35 @@ void MatrixBase<Real>::AddMatMat(const Real alpha,
                || (transA == kTrans && transB == kTrans && A.num_rows_ == B.num_cols_ && A.num_cols_ == num_rows_ && B.num_rows_ == num_cols_));
   KALDI_ASSERT(&A !=  this && &B != this);
   if (num_rows_ == 0) return;
-  cblas_Xgemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
-              transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_, stride_);
-
+  MatrixIndexT inner_dim = (transA == kNoTrans ? A.num_cols_ : A.num_rows_);
+  double work_per_element = 2.0 * inner_dim;
+  if (g_matrix_num_threads > 1 && num_rows_ >= num_cols_) {
+    // Split up the rows of *this, which are rows (or columns, if transA ==
+    // kTrans) of A.  Only the inner dimension of A is used by cblas_Xgemm(),
+    // so we can pass A's original dimensions.
+    MatrixParallelFor(num_rows_, work_per_element * num_cols_,
+                      [&](MatrixIndexT begin, MatrixIndexT end) {
+      const Real *A_data = A.data_ +
+          (transA == kNoTrans ? begin * A.stride_ : begin);
+      cblas_Xgemm(alpha, transA, A_data, A.num_rows_, A.num_cols_, A.stride_,
+                  transB, B.data_, B.stride_, beta, data_ + begin * stride_,
+                  end - begin, num_cols_, stride_);
+    });
+  } else if (g_matrix_num_threads > 1) {
+    // Split up the columns of *this, which are columns (or rows, if transB ==
+    // kTrans) of B.
+    MatrixParallelFor(num_cols_, work_per_element * num_rows_,
+                      [&](MatrixIndexT begin, MatrixIndexT end) {
+      const Real *B_data = B.data_ +
+          (transB == kNoTrans ? begin : begin * B.stride_);
+      cblas_Xgemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
+                  transB, B_data, B.stride_, beta, data_ + begin,
+                  num_rows_, end - begin, stride_);
+    });
+  } else {
+    cblas_Xgemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
+                transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_, stride_);
+  }
 }
 
 template<typename Real>
@@ -639,18 +666,17 @@ void MatrixBase<Real>::AddMatMatElements(const Real alpha,
                                          const Real beta) {
     KALDI_ASSERT(A.NumRows() == B.NumRows() && A.NumCols() == B.NumCols());
     KALDI_ASSERT(A.NumRows() == NumRows() && A.NumCols() == NumCols());
-    Real *data = data_;
-    const Real *dataA = A.Data();
-    const Real *dataB = B.Data();
-
-    for (MatrixIndexT i = 0; i < num_rows_; i++) {
-        for (MatrixIndexT j = 0; j < num_cols_; j++) {
-            data[j] = beta*data[j] + alpha*dataA[j]*dataB[j];
+    MatrixParallelFor(num_rows_, num_cols_,
+                      [&](MatrixIndexT begin, MatrixIndexT end) {
+        for (MatrixIndexT i = begin; i < end; i++) {
+            Real *data = RowData(i);
+            const Real *dataA = A.RowData(i);
+            const Real *dataB = B.RowData(i);
+            for (MatrixIndexT j = 0; j < num_cols_; j++) {
+                data[j] = beta*data[j] + alpha*dataA[j]*dataB[j];
+            }
         }
-        data += Stride();
-        dataA += A.Stride();
-        dataB += B.Stride();
-    }
+    });
 }
 
 #if !defined(HAVE_ATLAS) && !defined(USE_KALDI_SVD)
@@ -878,9 +904,14 @@ void MatrixBase<Real>::CopyFromMat(const MatrixBase<OtherReal> &M,
     int32 this_stride = stride_, other_stride = M.Stride();
     Real *this_data = data_;
     const OtherReal *other_data = M.Data();
-    for (MatrixIndexT i = 0; i < num_rows_; i++)
-      for (MatrixIndexT j = 0; j < num_cols_; j++)
-        this_data[i * this_stride + j] = other_data[j * other_stride + i];
+    // The reads are not contiguous, so we count each element as a few
+    // operations when deciding whether to use multiple threads.
+    MatrixParallelFor(num_rows_, 4.0 * num_cols_,
+                      [&](MatrixIndexT begin, MatrixIndexT end) {
+      for (MatrixIndexT i = begin; i < end; i++)
+        for (MatrixIndexT j = 0; j < num_cols_; j++)
+          this_data[i * this_stride + j] = other_data[j * other_stride + i];
+    });
   }
 }
 
@@ -1168,6 +1199,26 @@ void MatrixBase<Real>::DivElements(const MatrixBase<Real> &a) {
 
 template<typename Real>
 Real MatrixBase<Real>::Sum() const {
+  if (g_matrix_num_threads > 1 && num_rows_ > 1) {
+    // Sum each row separately, and then add up the row sums in order, so
+    // that the result does not depend on how the rows were divided up
+    // among threads.
+    std::vector<double> row_sums(num_rows_);
+    MatrixParallelFor(num_rows_, num_cols_,
+                      [&](MatrixIndexT begin, MatrixIndexT end) {
+      for (MatrixIndexT i = begin; i < end; i++) {
+        const Real *row_data = RowData(i);
+        double row_sum = 0.0;
+        for (MatrixIndexT j = 0; j < num_cols_; j++)
+          row_sum += row_data[j];
+        row_sums[i] = row_sum;
+      }
+    });
+    double sum = 0.0;
+    for (MatrixIndexT i = 0; i < num_rows_; i++)
+      sum += row_sums[i];
+    return (Real)sum;
+  }
   double sum = 0.0;
 
   for (MatrixIndexT i = 0; i < num_rows_; i++) {
@@ -2101,41 +2152,47 @@ void Matrix<Real>::Transpose() {
 template<typename Real>
 void MatrixBase<Real>::Heaviside(const MatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
-  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_;
-  Real *row_data = data_;
-  const Real *src_row_data = src.Data();
-  for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++)
-      row_data[col] = (src_row_data[col] > 0 ? 1.0 : 0.0);
-  }
+  MatrixIndexT num_cols = num_cols_;
+  MatrixParallelFor(num_rows_, num_cols,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT row = begin; row < end; row++) {
+      Real *row_data = RowData(row);
+      const Real *src_row_data = src.RowData(row);
+      for (MatrixIndexT col = 0; col < num_cols; col++)
+        row_data[col] = (src_row_data[col] > 0 ? 1.0 : 0.0);
+    }
+  });
 }
 
 template<typename Real>
 void MatrixBase<Real>::Exp(const MatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
-  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_;
-  Real *row_data = data_;
-  const Real *src_row_data = src.Data();
-  for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++)
-      row_data[col] = kaldi::Exp(src_row_data[col]);
-  }
+  MatrixIndexT num_cols = num_cols_;
+  MatrixParallelFor(num_rows_, kMatrixTranscendentalCost * num_cols,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT row = begin; row < end; row++) {
+      Real *row_data = RowData(row);
+      const Real *src_row_data = src.RowData(row);
+      for (MatrixIndexT col = 0; col < num_cols; col++)
+        row_data[col] = kaldi::Exp(src_row_data[col]);
+    }
+  });
 }
 
 template<typename Real>
 void MatrixBase<Real>::Pow(const MatrixBase<Real> &src, Real power) {
   KALDI_ASSERT(SameDim(*this, src));
-  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_;
-  Real *row_data = data_;
-  const Real *src_row_data = src.Data();
-  for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++) {
-      row_data[col] = pow(src_row_data[col], power);
+  MatrixIndexT num_cols = num_cols_;
+  MatrixParallelFor(num_rows_, kMatrixTranscendentalCost * num_cols,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT row = begin; row < end; row++) {
+      Real *row_data = RowData(row);
+      const Real *src_row_data = src.RowData(row);
+      for (MatrixIndexT col = 0; col < num_cols; col++) {
+        row_data[col] = pow(src_row_data[col], power);
+      }
     }
-  }
+  });
 }
 
 template<typename Real>
@@ -2185,47 +2242,53 @@ void MatrixBase<Real>::Ceiling(const MatrixBase<Real> &src, Real ceiling_val) {
 template<typename Real>
 void MatrixBase<Real>::Log(const MatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
-  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_;
-  Real *row_data = data_;
-  const Real *src_row_data = src.Data();
-  for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++)
-      row_data[col] = kaldi::Log(src_row_data[col]);
-  }
+  MatrixIndexT num_cols = num_cols_;
+  MatrixParallelFor(num_rows_, kMatrixTranscendentalCost * num_cols,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT row = begin; row < end; row++) {
+      Real *row_data = RowData(row);
+      const Real *src_row_data = src.RowData(row);
+      for (MatrixIndexT col = 0; col < num_cols; col++)
+        row_data[col] = kaldi::Log(src_row_data[col]);
+    }
+  });
 }
 
 template<typename Real>
 void MatrixBase<Real>::ExpSpecial(const MatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
-  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_;
-  Real *row_data = data_;
-  const Real *src_row_data = src.Data();
-  for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++)
-      row_data[col] = (src_row_data[col] < Real(0) ? kaldi::Exp(src_row_data[col]) : (src_row_data[col] + Real(1)));
-  }
+  MatrixIndexT num_cols = num_cols_;
+  MatrixParallelFor(num_rows_, kMatrixTranscendentalCost * num_cols,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT row = begin; row < end; row++) {
+      Real *row_data = RowData(row);
+      const Real *src_row_data = src.RowData(row);
+      for (MatrixIndexT col = 0; col < num_cols; col++)
+        row_data[col] = (src_row_data[col] < Real(0) ? kaldi::Exp(src_row_data[col]) : (src_row_data[col] + Real(1)));
+    }
+  });
 }
 
 template<typename Real>
 void MatrixBase<Real>::ExpLimited(const MatrixBase<Real> &src, Real lower_limit, Real upper_limit) {
   KALDI_ASSERT(SameDim(*this, src));
-  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_;
-  Real *row_data = data_;
-  const Real *src_row_data = src.Data();
-  for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++) {
-      const Real x = src_row_data[col];
-      if (!(x >= lower_limit))
-	row_data[col] = kaldi::Exp(lower_limit);
-      else if (x > upper_limit)
-	row_data[col] = kaldi::Exp(upper_limit);
-      else
-	row_data[col] = kaldi::Exp(x);
+  MatrixIndexT num_cols = num_cols_;
+  MatrixParallelFor(num_rows_, kMatrixTranscendentalCost * num_cols,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT row = begin; row < end; row++) {
+      Real *row_data = RowData(row);
+      const Real *src_row_data = src.RowData(row);
+      for (MatrixIndexT col = 0; col < num_cols; col++) {
+        const Real x = src_row_data[col];
+        if (!(x >= lower_limit))
+          row_data[col] = kaldi::Exp(lower_limit);
+        else if (x > upper_limit)
+          row_data[col] = kaldi::Exp(upper_limit);
+        else
+          row_data[col] = kaldi::Exp(x);
+      }
     }
-  }
+  });
 }
 
 template<typename Real>
@@ -2774,28 +2837,34 @@ void MatrixBase<Real>::Tanh(const MatrixBase<Real> &src) {
         dst_vec(this->data_, num_rows_ * num_cols_);
     dst_vec.Tanh(src_vec);
   } else {
-    for (MatrixIndexT r = 0; r < num_rows_; r++) {
-      SubVector<Real> src_vec(src, r), dest_vec(*this, r);
-      dest_vec.Tanh(src_vec);
-    }
+    MatrixParallelFor(num_rows_, kMatrixTranscendentalCost * num_cols_,
+                      [&](MatrixIndexT begin, MatrixIndexT end) {
+      for (MatrixIndexT r = begin; r < end; r++) {
+        SubVector<Real> src_vec(src, r), dest_vec(*this, r);
+        dest_vec.Tanh(src_vec);
+      }
+    });
   }
 }
 
 template<typename Real>
 void MatrixBase<Real>::SoftHinge(const MatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
-  int32 num_rows = num_rows_, num_cols = num_cols_;
-  for (MatrixIndexT r = 0; r < num_rows; r++) {
-    Real *row_data = this->RowData(r);
-    const Real *src_row_data = src.RowData(r);
-    for (MatrixIndexT c = 0; c < num_cols; c++) {
-      Real x = src_row_data[c], y;
-      if (x > 10.0) y = x; // avoid exponentiating large numbers; function
-      // approaches y=x.
-      else y = Log1p(kaldi::Exp(x)); // these defined in kaldi-math.h
-      row_data[c] = y;
+  int32 num_cols = num_cols_;
+  MatrixParallelFor(num_rows_, 2 * kMatrixTranscendentalCost * num_cols,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT r = begin; r < end; r++) {
+      Real *row_data = this->RowData(r);
+      const Real *src_row_data = src.RowData(r);
+      for (MatrixIndexT c = 0; c < num_cols; c++) {
+        Real x = src_row_data[c], y;
+        if (x > 10.0) y = x; // avoid exponentiating large numbers; function
+        // approaches y=x.
+        else y = Log1p(kaldi::Exp(x)); // these defined in kaldi-math.h
+        row_data[c] = y;
+      }
     }
-  }
+  });
 }
 
 template<typename Real>
@@ -2990,10 +3059,13 @@ void MatrixBase<Real>::Sigmoid(const MatrixBase<Real> &src) {
         dst_vec(this->data_, num_rows_ * num_cols_);
     dst_vec.Sigmoid(src_vec);
   } else {
-    for (MatrixIndexT r = 0; r < num_rows_; r++) {
-      SubVector<Real> src_vec(src, r), dest_vec(*this, r);
-      dest_vec.Sigmoid(src_vec);
-    }
+    MatrixParallelFor(num_rows_, kMatrixTranscendentalCost * num_cols_,
+                      [&](MatrixIndexT begin, MatrixIndexT end) {
+      for (MatrixIndexT r = begin; r < end; r++) {
+        SubVector<Real> src_vec(src, r), dest_vec(*this, r);
+        dest_vec.Sigmoid(src_vec);
+      }
+    });
   }
 }
 
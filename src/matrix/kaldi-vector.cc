@@ -28,6 +28,7 @@
 #include "matrix/cblas-wrappers.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
+#include "matrix/matrix-threading.h"
 #include "matrix/sp-matrix.h"
 #include "matrix/sparse-matrix.h"
 
@@ -798,9 +799,12 @@ void VectorBase<Real>::ApplyLogAndCopy(const VectorBase<Real> &v) {
 
 template<typename Real>
 void VectorBase<Real>::ApplyExp() {
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] = Exp(data_[i]);
-  }
+  MatrixParallelFor(dim_, kMatrixTranscendentalCost,
+                    [this](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT i = begin; i < end; i++) {
+      data_[i] = Exp(data_[i]);
+    }
+  });
 }
 
 template<typename Real>
@@ -899,17 +903,20 @@ void VectorBase<double>::Tanh(const VectorBase<double> &src) {
 template<typename Real>
 void VectorBase<Real>::Tanh(const VectorBase<Real> &src) {
   KALDI_ASSERT(dim_ == src.dim_);
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    Real x = src.data_[i];
-    if (x > 0.0) {
-      Real inv_expx = Exp(-x);
-      x = -1.0 + 2.0 / (1.0 + inv_expx * inv_expx);
-    } else {
-      Real expx = Exp(x);
-      x = 1.0 - 2.0 / (1.0 + expx * expx);
+  MatrixParallelFor(dim_, kMatrixTranscendentalCost,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT i = begin; i < end; i++) {
+      Real x = src.data_[i];
+      if (x > 0.0) {
+        Real inv_expx = Exp(-x);
+        x = -1.0 + 2.0 / (1.0 + inv_expx * inv_expx);
+      } else {
+        Real expx = Exp(x);
+        x = 1.0 - 2.0 / (1.0 + expx * expx);
+      }
+      data_[i] = x;
     }
-    data_[i] = x;
-  }
+  });
 }
 #endif
 
@@ -937,17 +944,20 @@ void VectorBase<double>::Sigmoid(const VectorBase<double> &src) {
 template<typename Real>
 void VectorBase<Real>::Sigmoid(const VectorBase<Real> &src) {
   KALDI_ASSERT(dim_ == src.dim_);
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    Real x = src.data_[i];
-    // We aim to avoid floating-point overflow here.
-    if (x > 0.0) {
-      x = 1.0 / (1.0 + Exp(-x));
-    } else {
-      Real ex = Exp(x);
-      x = ex / (ex + 1.0);
+  MatrixParallelFor(dim_, kMatrixTranscendentalCost,
+                    [&](MatrixIndexT begin, MatrixIndexT end) {
+    for (MatrixIndexT i = begin; i < end; i++) {
+      Real x = src.data_[i];
+      // We aim to avoid floating-point overflow here.
+      if (x > 0.0) {
+        x = 1.0 / (1.0 + Exp(-x));
+      } else {
+        Real ex = Exp(x);
+        x = ex / (ex + 1.0);
+      }
+      data_[i] = x;
     }
-    data_[i] = x;
-  }
+  });
 }
 #endif
 
@@ -254,6 +254,84 @@ static void UnitTestAddVecToColsSpeed() {
   CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
 }
 
+template<typename Real>
+static void UnitTestCompressedMatrixSpeed() {
+  Timer t;
+  // The sizes are typical of speech features in nnet3 examples.
+  int32 num_rows = 300, num_cols = 40;
+  CompressionMethod methods[] = { kSpeechFeature, kTwoByteAuto, kOneByteAuto };
+  const char *names[] = { "SpeechFeature", "TwoByteAuto", "OneByteAuto" };
+  for (int32 i = 0; i < 3; i++) {
+    Matrix<Real> M(num_rows, num_cols);
+    M.SetRandn();
+    CompressedMatrix cmat(M, methods[i]);
+
+    int32 iter = 0;
+    BaseFloat time_in_secs = 0.02;
+    Timer t1;
+    for (; t1.Elapsed() < time_in_secs; iter++)
+      cmat.CopyToMat(&M);
+    BaseFloat elements_per_sec = num_rows * num_cols * iter / t1.Elapsed();
+    CsvResult<Real>(std::string("CompressedMatrix::CopyToMat,") + names[i],
+                    num_cols, elements_per_sec * 1.0e-09, "gigaelements/s");
+
+    iter = 0;
+    Timer t2;
+    for (; t2.Elapsed() < time_in_secs; iter++)
+      cmat.CopyFromMat(M, methods[i]);
+    elements_per_sec = num_rows * num_cols * iter / t2.Elapsed();
+    CsvResult<Real>(std::string("CompressedMatrix::CopyFromMat,") + names[i],
+                    num_cols, elements_per_sec * 1.0e-09, "gigaelements/s");
+  }
+  CsvResult<Real>(__func__, 3, t.Elapsed(), "seconds");
+}
+
+// Compares the block-sparse matrix product with the dense one, for typical
+// sizes of TDNN-F layers, at various block sizes and sparsities.
+template<typename Real>
+static void UnitTestBlockSparseMatrixSpeed() {
+  Timer t;
+  int32 num_rows = 128, input_dim = 1536, output_dim = 1536;
+  Matrix<BaseFloat> M(num_rows, input_dim), P(num_rows, output_dim);
+  M.SetRandn();
+  BaseFloat time_in_secs = 0.05;
+  {
+    Matrix<BaseFloat> N(output_dim, input_dim);
+    N.SetRandn();
+    int32 iter = 0;
+    Timer t1;
+    for (; t1.Elapsed() < time_in_secs; iter++)
+      P.AddMatMat(1.0, M, kNoTrans, N, kTrans, 0.0);
+    BaseFloat gflops = 2.0 * num_rows * input_dim * output_dim * iter /
+        (t1.Elapsed() * 1.0e+09);
+    CsvResult<Real>("AddMatMat,dense", output_dim, gflops,
+                    "effective-gigaflops");
+  }
+  int32 block_sizes[] = { 4, 8, 16 };
+  BaseFloat sparsities[] = { 0.5, 0.75, 0.9, 0.95 };
+  for (int32 b = 0; b < 3; b++) {
+    for (int32 s = 0; s < 4; s++) {
+      Matrix<BaseFloat> N(output_dim, input_dim);
+      N.SetRandn();
+      PruneMatrixBlocks(block_sizes[b], sparsities[s], &N);
+      BlockSparseMatrix sN(N, block_sizes[b]);
+      int32 iter = 0;
+      Timer t1;
+      for (; t1.Elapsed() < time_in_secs; iter++)
+        AddMatBlockSparseMatTrans(M, sN, 0.0, &P);
+      // We count the flops of the dense product, so this is comparable with
+      // the number above.
+      BaseFloat gflops = 2.0 * num_rows * input_dim * output_dim * iter /
+          (t1.Elapsed() * 1.0e+09);
+      std::ostringstream name;
+      name << "AddMatBlockSparseMatTrans,block-size=" << block_sizes[b]
+           << ",sparsity=" << sparsities[s];
+      CsvResult<Real>(name.str(), output_dim, gflops, "effective-gigaflops");
+    }
+  }
+  CsvResult<Real>(__func__, 12, t.Elapsed(), "seconds");
+}
+
 template<typename Real> static void MatrixUnitSpeedTest() {
   UnitTestRealFftSpeed<Real>();
   UnitTestSplitRadixRealFftSpeed<Real>();
@@ -263,6 +341,10 @@ template<typename Real> static void MatrixUnitSpeedTest() {
   UnitTestAddColSumMatSpeed<Real>();
   UnitTestAddVecToRowsSpeed<Real>();
   UnitTestAddVecToColsSpeed<Real>();
+  UnitTestCompressedMatrixSpeed<Real>();
+  // The block-sparse code only exists for BaseFloat.
+  if (sizeof(Real) == sizeof(BaseFloat))
+    UnitTestBlockSparseMatrixSpeed<Real>();
 }
 
 } // namespace kaldi
@@ -26,6 +26,7 @@
 #include "matrix/matrix-lib.h"
 #include "util/stl-utils.h"
 #include <numeric>
+#include <thread>
 #include <time.h> // This is only needed for UnitTestSvdSpeed, you can
 // comment it (and that function) out if it causes problems.  
 #include <matrix/cblas-wrappers.h>
@@ -4185,6 +4186,21 @@ template<typename Real> static void UnitTestCompressedMatrix() {
       }
     }
 
+    // test CopyRowsToMat, decompressing into part of a larger matrix.
+    if (num_rows > 0) {
+      std::vector<MatrixIndexT> rows(RandInt(1, 2 * num_rows));
+      for (size_t i = 0; i < rows.size(); i++)
+        rows[i] = RandInt(0, num_rows - 1);
+      Matrix<Real> big_mat(rows.size() + 2, num_cols + 3);
+      SubMatrix<Real> sub_mat(big_mat, 1, rows.size(), 2, num_cols);
+      cmat.CopyRowsToMat(rows, &sub_mat);
+      for (size_t i = 0; i < rows.size(); i++)
+        for (MatrixIndexT k = 0; k < num_cols; k++)
+          AssertEqual(sub_mat(i, k), M2(rows[i], k));
+      KALDI_ASSERT(big_mat.Row(0).Sum() == 0.0 &&
+                   big_mat.Row(rows.size() + 1).Sum() == 0.0);
+    }
+
     // test CopyColToVec
     for (MatrixIndexT i = 0; i < num_cols; i++) {
       Vector<Real> V(num_rows);
@@ -4431,6 +4447,26 @@ template<typename Real> static void UnitTestGeneralMatrix() {
   unlink("tmpf");
 }
 
+// Checks that CopyToMat() for the kOneByteWithColHeaders format, which may use
+// SIMD code, gives exactly the same result as CopyColToVec(), which uses the
+// scalar code, for all the byte values.
+static void UnitTestCompressedMatrixSimd() {
+  for (int32 n = 0; n < 10; n++) {
+    MatrixIndexT num_rows = RandInt(1, 600), num_cols = RandInt(1, 20);
+    Matrix<BaseFloat> mat(num_rows, num_cols);
+    mat.SetRandn();
+    CompressedMatrix cmat(mat, kSpeechFeature);
+    Matrix<BaseFloat> mat2(num_rows, num_cols);
+    cmat.CopyToMat(&mat2);
+    for (MatrixIndexT c = 0; c < num_cols; c++) {
+      Vector<BaseFloat> col(num_rows);
+      cmat.CopyColToVec(c, &col);
+      for (MatrixIndexT r = 0; r < num_rows; r++)
+        KALDI_ASSERT(mat2(r, c) == col(r));
+    }
+  }
+}
+
 template<typename Real>
 static void UnitTestExtractCompressedMatrix() {
   for (int32 i = 0; i < 30; i++) {
@@ -4589,7 +4625,238 @@ template<typename Real> static void UnitTestTriVecSolver() {
 }
 
 
+// Checks that the multi-threaded versions of matrix operations give the same
+// results as the single-threaded ones.
+template<typename Real> static void UnitTestMatrixThreadingOnce() {
+  int32 num_rows = 100 + Rand() % 400, num_cols = 100 + Rand() % 400,
+      inner_dim = 50 + Rand() % 100;
+  Matrix<Real> A(num_rows, inner_dim), B(inner_dim, num_cols),
+      C(num_rows, num_cols), D(num_rows, num_cols);
+  A.SetRandn();
+  B.SetRandn();
+  C.SetRandn();
+  D.SetRandn();
+  // use a sub-matrix sometimes so that the stride differs from num_cols.
+  SubMatrix<Real> Csub(C, 0, num_rows, 0, num_cols - (Rand() % 2));
+
+  int32 saved_num_threads = g_matrix_num_threads;
+  std::vector<Matrix<Real> > results[2];
+  std::vector<Real> sums[2];
+  for (int32 i = 0; i < 2; i++) {
+    g_matrix_num_threads = (i == 0 ? 1 : 2 + Rand() % 4);
+    std::vector<Matrix<Real> > &res = results[i];
+    Matrix<Real> BtA(num_cols, num_rows);
+    BtA.SetZero();
+    res.resize(8);
+    res[0].Resize(num_rows, num_cols);
+    res[0].AddMatMat(1.0, A, kNoTrans, B, kNoTrans, 0.0);
+    res[1] = D;
+    Matrix<Real> At(A, kTrans), Bt(B, kTrans);
+    res[1].AddMatMat(0.5, At, kTrans, Bt, kTrans, 2.0);
+    res[2].Resize(num_cols, num_rows);
+    res[2].AddMatMat(1.0, Bt, kNoTrans, A, kTrans, 0.0);
+    res[3].Resize(Csub.NumRows(), Csub.NumCols());
+    res[3].Exp(Csub);
+    res[4].Resize(Csub.NumRows(), Csub.NumCols());
+    res[4].Sigmoid(Csub);
+    res[5].Resize(Csub.NumCols(), Csub.NumRows());
+    res[5].CopyFromMat(Csub, kTrans);
+    res[6] = D;
+    res[6].AddMatMatElements(0.5, C, D, 1.0);
+    res[7].Resize(num_rows, num_cols);
+    res[7].SoftHinge(C);
+    sums[i].push_back(C.Sum());
+    sums[i].push_back(Csub.Sum());
+  }
+  g_matrix_num_threads = saved_num_threads;
+
+  for (size_t j = 0; j < results[0].size(); j++) {
+    if (j < 3)  // AddMatMat may not be bitwise identical.
+      KALDI_ASSERT(results[0][j].ApproxEqual(results[1][j], 0.0001));
+    else
+      KALDI_ASSERT(results[0][j].Equal(results[1][j]));
+  }
+  for (size_t j = 0; j < sums[0].size(); j++)
+    AssertEqual(sums[0][j], sums[1][j]);
+}
+
+template<typename Real> static void UnitTestMatrixThreading() {
+  for (int32 i = 0; i < 5; i++)
+    UnitTestMatrixThreadingOnce<Real>();
+  // Check that things work when we call matrix operations from several
+  // threads at once.
+  int32 saved_num_threads = g_matrix_num_threads;
+  g_matrix_num_threads = 3;
+  std::vector<std::thread> threads;
+  for (int32 i = 0; i < 4; i++) {
+    threads.push_back(std::thread([] {
+      for (int32 j = 0; j < 5; j++) {
+        Matrix<Real> A(200, 300), B(300, 400), C(200, 400), D(200, 400);
+        A.SetRandn();
+        B.SetRandn();
+        C.AddMatMat(1.0, A, kNoTrans, B, kNoTrans, 0.0);
+        for (int32 r = 0; r < 200; r++)
+          D.Row(r).AddMatVec(1.0, B, kTrans, A.Row(r), 0.0);
+        KALDI_ASSERT(C.ApproxEqual(D, 0.0001));
+      }
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+  g_matrix_num_threads = saved_num_threads;
+}
+
+
+static void UnitTestQuantizedMatrix() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 num_rows = 1 + Rand() % 70,
+        num_cols = 1 + Rand() % 100, other_rows = 1 + Rand() % 50;
+    Matrix<BaseFloat> M(num_rows, num_cols), N(other_rows, num_cols);
+    M.SetRandn();
+    N.SetRandn();
+    M.Row(0).SetZero();  // check that all-zero rows are handled.
+    QuantizedMatrix qM(M), qN(N);
+    KALDI_ASSERT(qM.NumRows() == num_rows && qM.NumCols() == num_cols);
+
+    Matrix<BaseFloat> M2(num_rows, num_cols), N2(other_rows, num_cols);
+    qM.CopyToMat(&M2);
+    qN.CopyToMat(&N2);
+    for (int32 r = 0; r < num_rows; r++) {
+      BaseFloat max_abs = M.Row(r).Max() > -M.Row(r).Min() ?
+          M.Row(r).Max() : -M.Row(r).Min();
+      AssertEqual(qM.RowScale(r), max_abs / 127.0);
+      for (int32 c = 0; c < num_cols; c++)
+        KALDI_ASSERT(std::abs(M(r, c) - M2(r, c)) <=
+                     0.5001 * qM.RowScale(r));
+    }
+
+    bool binary = (Rand() % 2 == 0);
+    std::ostringstream os;
+    qM.Write(os, binary);
+    QuantizedMatrix qM3;
+    std::istringstream is(os.str());
+    qM3.Read(is, binary);
+    Matrix<BaseFloat> M3(num_rows, num_cols);
+    qM3.CopyToMat(&M3);
+    // In text mode the scales are written with limited precision.
+    KALDI_ASSERT(binary ? M3.Equal(M2) : M3.ApproxEqual(M2, 1.0e-05));
+
+    // Apart from roundoff, the only difference from the product of the
+    // quantized N with M comes from the quantization of the rows of M, which
+    // is to at least 7 bits.
+    BaseFloat beta = (Rand() % 2 == 0 ? 0.0 : 0.5);
+    Matrix<BaseFloat> P(num_rows, other_rows), P2(num_rows, other_rows);
+    P.SetRandn();
+    P2.CopyFromMat(P);
+    if (beta == 0.0)
+      P(0, 0) = std::numeric_limits<BaseFloat>::quiet_NaN();
+    AddMatQuantizedMatTrans(M, qN, beta, &P);
+    P2.AddMatMat(1.0, M, kNoTrans, N2, kTrans, beta);
+    Matrix<BaseFloat> N2_abs(N2);
+    N2_abs.ApplyPowAbs(1.0);
+    for (int32 r = 0; r < num_rows; r++) {
+      BaseFloat max_abs = M.Row(r).Max() > -M.Row(r).Min() ?
+          M.Row(r).Max() : -M.Row(r).Min();
+      for (int32 c = 0; c < other_rows; c++) {
+        BaseFloat max_error = 0.5 * max_abs / 63.0 * N2_abs.Row(c).Sum() +
+            1.0e-04 * (1.0 + std::abs(P2(r, c)));
+        KALDI_ASSERT(std::abs(P(r, c) - P2(r, c)) <= max_error);
+      }
+    }
+  }
+
+  // Check that the multi-threaded product is the same.
+  Matrix<BaseFloat> M(300, 257), N(200, 257);
+  M.SetRandn();
+  N.SetRandn();
+  QuantizedMatrix qN(N);
+  Matrix<BaseFloat> P(300, 200), P2(300, 200);
+  AddMatQuantizedMatTrans(M, qN, 0.0, &P);
+  int32 saved_num_threads = g_matrix_num_threads;
+  g_matrix_num_threads = 3;
+  AddMatQuantizedMatTrans(M, qN, 0.0, &P2);
+  g_matrix_num_threads = saved_num_threads;
+  KALDI_ASSERT(P.Equal(P2));
+}
+
+
+static void UnitTestBlockSparseMatrix() {
+  int32 block_sizes[] = { 1, 2, 4, 8, 16 };
+  for (int32 i = 0; i < 10; i++) {
+    int32 block_size = block_sizes[Rand() % 5],
+        num_rows = 1 + Rand() % 70, num_cols = 1 + Rand() % 100,
+        other_rows = 1 + Rand() % 50;
+    Matrix<BaseFloat> M(num_rows, num_cols), N(other_rows, num_cols);
+    M.SetRandn();
+    N.SetRandn();
+    BaseFloat sparsity = RandUniform();
+    MatrixIndexT num_pruned = PruneMatrixBlocks(block_size, sparsity, &N);
+    int32 num_blocks = ((other_rows + block_size - 1) / block_size) *
+        num_cols;
+    AssertEqual(BlockSparsity(N, block_size),
+                static_cast<int32>(sparsity * num_blocks) /
+                static_cast<BaseFloat>(num_blocks));
+    KALDI_ASSERT(num_pruned == static_cast<int32>(sparsity * num_blocks));
+    // Pruning again to the same sparsity does nothing.
+    KALDI_ASSERT(PruneMatrixBlocks(block_size, sparsity, &N) == 0);
+
+    BlockSparseMatrix sN(N, block_size);
+    KALDI_ASSERT(sN.NumRows() == other_rows && sN.NumCols() == num_cols &&
+                 sN.BlockSize() == block_size &&
+                 sN.NumBlocks() == num_blocks - num_pruned);
+    AssertEqual(sN.Density(), 1.0 - BlockSparsity(N, block_size));
+    Matrix<BaseFloat> N2(other_rows, num_cols);
+    sN.CopyToMat(&N2);
+    KALDI_ASSERT(N2.Equal(N));
+
+    bool binary = (Rand() % 2 == 0);
+    std::ostringstream os;
+    sN.Write(os, binary);
+    BlockSparseMatrix sN3;
+    std::istringstream is(os.str());
+    sN3.Read(is, binary);
+    Matrix<BaseFloat> N3(other_rows, num_cols);
+    sN3.CopyToMat(&N3);
+    KALDI_ASSERT(binary ? N3.Equal(N) : N3.ApproxEqual(N, 1.0e-05));
+
+    BaseFloat beta = (Rand() % 2 == 0 ? 0.0 : 0.5);
+    Matrix<BaseFloat> P(num_rows, other_rows), P2(num_rows, other_rows);
+    P.SetRandn();
+    P2.CopyFromMat(P);
+    if (beta == 0.0)
+      P(0, 0) = std::numeric_limits<BaseFloat>::quiet_NaN();
+    AddMatBlockSparseMatTrans(M, sN, beta, &P);
+    P2.AddMatMat(1.0, M, kNoTrans, N, kTrans, beta);
+    KALDI_ASSERT(P.ApproxEqual(P2, 1.0e-05));
+
+    Matrix<BaseFloat> Q(num_rows, num_cols), Q2(num_rows, num_cols);
+    Q.SetRandn();
+    Q2.CopyFromMat(Q);
+    AddMatBlockSparseMat(P2, sN, &Q);
+    Q2.AddMatMat(1.0, P2, kNoTrans, N, kNoTrans, 1.0);
+    KALDI_ASSERT(Q.ApproxEqual(Q2, 1.0e-05));
+  }
+
+  // Check that the multi-threaded product is the same.
+  Matrix<BaseFloat> M(301, 257), N(203, 257);
+  M.SetRandn();
+  N.SetRandn();
+  PruneMatrixBlocks(8, 0.75, &N);
+  BlockSparseMatrix sN(N, 8);
+  Matrix<BaseFloat> P(301, 203), P2(301, 203);
+  AddMatBlockSparseMatTrans(M, sN, 0.0, &P);
+  int32 saved_num_threads = g_matrix_num_threads;
+  g_matrix_num_threads = 3;
+  AddMatBlockSparseMatTrans(M, sN, 0.0, &P2);
+  g_matrix_num_threads = saved_num_threads;
+  KALDI_ASSERT(P.Equal(P2));
+}
+
+
 template<typename Real> static void MatrixUnitTest(bool full_test) {
+  UnitTestMatrixThreading<Real>();
+  UnitTestQuantizedMatrix();
+  UnitTestBlockSparseMatrix();
   UnitTestLinearCgd<Real>();
   UnitTestGeneralMatrix<BaseFloat>();
   UnitTestTridiagonalize<Real>();
@@ -4603,6 +4870,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestCompressedMatrix<Real>();
   UnitTestCompressedMatrix2<Real>();
   UnitTestExtractCompressedMatrix<Real>();
+  UnitTestCompressedMatrixSimd();
   UnitTestResize<Real>();
   UnitTestResizeCopyDataDifferentStrideType<Real>();
   UnitTestNonsymmetricPower<Real>();
@@ -33,6 +33,9 @@
 #include "matrix/sparse-matrix.h"
 #include "matrix/optimization.h"
 #include "matrix/numpy-array.h"
+#include "matrix/matrix-threading.h"
+#include "matrix/quantized-matrix.h"
+#include "matrix/block-sparse-matrix.h"
 
 #endif
 
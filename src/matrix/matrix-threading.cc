@@ -0,0 +1,175 @@
+// matrix/matrix-threading.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "matrix/matrix-threading.h"
+
+namespace kaldi {
+
+int32 g_matrix_num_threads = 1;
+
+namespace internal {
+
+// This represents one call to MatrixParallelFor(); its ranges are done by the
+// calling thread and by the helper threads, whichever gets to them first.
+struct MatrixParallelJob {
+  const std::function<void(MatrixIndexT, MatrixIndexT)> *func;
+  MatrixIndexT n;
+  MatrixIndexT range_size;  // The size of each range, except the last.
+  int32 num_ranges;
+  std::atomic<int32> next_range;
+  // The number of helper threads that have been given this job and have not
+  // finished it.  Protected by the mutex of MatrixThreadPool.
+  int32 num_helpers_running;
+
+  // Does ranges of this job until there are none left.
+  void Run() {
+    int32 r;
+    while ((r = next_range++) < num_ranges) {
+      MatrixIndexT begin = r * range_size,
+          end = std::min(n, begin + range_size);
+      (*func)(begin, end);
+    }
+  }
+};
+
+// Set in the threads of MatrixThreadPool, and in the thread that called
+// MatrixParallelFor() while it is doing its part of the work, so that matrix
+// operations called from inside a MatrixParallelFor() are not parallelized
+// again.
+static thread_local bool is_matrix_pool_thread = false;
+
+class MatrixThreadPool {
+ public:
+  MatrixThreadPool(): num_reserved_(0), stop_(false) { }
+
+  /// Runs 'job' in the calling thread and in up to 'max_helpers' threads of
+  /// the pool, and returns when it is done.
+  void Run(MatrixParallelJob *job, int32 max_helpers) {
+    int32 num_helpers;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Only g_matrix_num_threads - 1 threads may be working for the callers
+      // of MatrixParallelFor() at any one time.
+      num_helpers = std::min(max_helpers,
+                             g_matrix_num_threads - 1 - num_reserved_);
+      if (num_helpers > 0) {
+        // Make sure there are enough threads; the ones that are not reserved
+        // are all waiting for work.
+        while (static_cast<int32>(threads_.size()) <
+               num_reserved_ + num_helpers)
+          threads_.push_back(std::thread(&MatrixThreadPool::WorkerLoop,
+                                         this));
+        num_reserved_ += num_helpers;
+        job->num_helpers_running = num_helpers;
+        for (int32 i = 0; i < num_helpers; i++)
+          queue_.push_back(job);
+      }
+    }
+    if (num_helpers > 0)
+      work_cond_.notify_all();
+    // Matrix operations called from inside the job should not be
+    // parallelized again.
+    is_matrix_pool_thread = true;
+    job->Run();
+    is_matrix_pool_thread = false;
+    if (num_helpers > 0) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_cond_.wait(lock, [job] { return job->num_helpers_running == 0; });
+    }
+  }
+
+  ~MatrixThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_cond_.notify_all();
+    for (size_t i = 0; i < threads_.size(); i++)
+      threads_[i].join();
+  }
+
+ private:
+  void WorkerLoop() {
+    is_matrix_pool_thread = true;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      work_cond_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty())
+        return;  // stop_ is set.
+      MatrixParallelJob *job = queue_.front();
+      queue_.pop_front();
+      lock.unlock();
+      job->Run();
+      lock.lock();
+      num_reserved_--;
+      if (--job->num_helpers_running == 0)
+        done_cond_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable work_cond_;  // Notified when jobs are queued.
+  std::condition_variable done_cond_;  // Notified when a job is finished.
+  std::vector<std::thread> threads_;
+  // Each job appears here once for each helper thread that should work on it.
+  std::deque<MatrixParallelJob*> queue_;
+  // The number of threads that are working on jobs or are about to (i.e.
+  // num-running + queue_.size()).
+  int32 num_reserved_;
+  bool stop_;
+};
+
+void MatrixParallelForInternal(
+    MatrixIndexT n, double work_per_item,
+    const std::function<void(MatrixIndexT, MatrixIndexT)> &func) {
+  int32 num_threads = g_matrix_num_threads;
+  if (is_matrix_pool_thread || num_threads <= 1) {
+    func(0, n);
+    return;
+  }
+  // Divide the work into at most num_threads ranges, each with at least
+  // kMatrixMinWorkPerThread of work.
+  double max_ranges = n * work_per_item / kMatrixMinWorkPerThread;
+  int32 num_ranges = std::min<double>(std::min(num_threads, n), max_ranges);
+  if (num_ranges <= 1) {
+    func(0, n);
+    return;
+  }
+  static MatrixThreadPool pool;
+  MatrixParallelJob job;
+  job.func = &func;
+  job.n = n;
+  job.range_size = (n + num_ranges - 1) / num_ranges;
+  job.num_ranges = (n + job.range_size - 1) / job.range_size;
+  job.next_range = 0;
+  job.num_helpers_running = 0;
+  pool.Run(&job, job.num_ranges - 1);
+}
+
+}  // namespace internal
+
+}  // namespace kaldi
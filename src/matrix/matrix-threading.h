@@ -0,0 +1,87 @@
+// matrix/matrix-threading.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_MATRIX_MATRIX_THREADING_H_
+#define KALDI_MATRIX_MATRIX_THREADING_H_
+
+#include <functional>
+#include "matrix/matrix-common.h"
+
+// This header provides the (optional) multi-threading of the matrix library.
+// By default the matrix library is single-threaded, and we also normally link
+// with a single-threaded BLAS, because most Kaldi jobs get their parallelism
+// from running many processes, or from RunMultiThreaded() (see
+// ../util/kaldi-thread.h).  For programs that do a few large matrix
+// operations, such as PLDA or iVector-extractor estimation, you can set
+// g_matrix_num_threads to make large operations (e.g. large AddMatMat()
+// calls, and element-wise operations such as Exp() and Log() on large
+// matrices) use a pool of threads owned by the matrix library.
+
+namespace kaldi {
+
+extern int32 g_matrix_num_threads;  // Maximum number of threads the matrix
+// library may use to parallelize a single operation, including the thread
+// that calls it.  This is 1 by default, meaning no multi-threading.  The
+// extra g_matrix_num_threads - 1 threads are shared by all callers, so even
+// if matrix operations are called from several threads at once (e.g. in
+// RunMultiThreaded()) the matrix library will not add more than that many
+// threads.  Programs that want this should register it with their
+// ParseOptions, as:
+// po.Register("matrix-num-threads", &g_matrix_num_threads,
+//             "Number of threads to use for large matrix operations.");
+
+/// The rough cost of exp(), log() and similar functions, relative to an
+/// addition; for use in the 'work_per_item' argument of MatrixParallelFor().
+const double kMatrixTranscendentalCost = 10.0;
+
+namespace internal {
+// The amount of work, measured in the same units as the 'work_per_item'
+// argument of MatrixParallelFor() (roughly, in additions), below which it is
+// not worth giving work to another thread.
+const double kMatrixMinWorkPerThread = 50000.0;
+
+void MatrixParallelForInternal(
+    MatrixIndexT n, double work_per_item,
+    const std::function<void(MatrixIndexT, MatrixIndexT)> &func);
+}  // namespace internal
+
+/// Calls func(begin, end) for ranges [begin, end) that together cover
+/// [0, n), possibly in parallel using the matrix library's threads.
+/// 'work_per_item' is a rough estimate of the cost of each of the n items,
+/// e.g. the number of columns if we are looping over the rows of a matrix
+/// and doing something cheap to each element; it is used to decide whether
+/// it is worth using more than one thread.  If g_matrix_num_threads is 1,
+/// the work is too small, or we are already in one of the matrix library's
+/// threads, this just calls func(0, n).  Since the threads may be busy with
+/// work for other callers, the number of threads actually used varies; 'func'
+/// must not depend on how the range is split up, and must not throw.
+template<class F>
+inline void MatrixParallelFor(MatrixIndexT n, double work_per_item,
+                              const F &func) {
+  if (g_matrix_num_threads > 1 && n > 1 &&
+      n * work_per_item >= 2 * internal::kMatrixMinWorkPerThread)
+    internal::MatrixParallelForInternal(n, work_per_item, func);
+  else
+    func(0, n);
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_MATRIX_THREADING_H_
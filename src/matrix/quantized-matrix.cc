@@ -0,0 +1,440 @@
+// matrix/quantized-matrix.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KALDI_QUANTIZED_MATRIX_SSE2
+#endif
+#include "base/io-funcs.h"
+#include "matrix/kaldi-vector.h"
+#include "matrix/matrix-threading.h"
+#include "matrix/quantized-matrix.h"
+
+namespace kaldi {
+
+// Each of the structs ScalarIntOps, Sse2IntOps, Avx2IntOps, Avx512IntOps and
+// Avx512VnniIntOps provides what the integer matrix-multiplication kernel
+// needs: a vector V of kLanes int32 values, and Dot4(acc, a, b), which for
+// each lane adds to 'acc' the dot product of the 4 unsigned bytes in that lane
+// of 'a' with the 4 signed bytes in that lane of 'b'.  The quantized inputs,
+// which are the unsigned operand, are offset by kInputMax + 1 so they are
+// positive; kInputMax is 63 where Dot4() uses pmaddubsw, since that saturates
+// at 16 bits if both operands are large.
+
+struct ScalarIntOps {
+  typedef int32 V;
+  static const int32 kLanes = 1;
+  static const int32 kInputMax = 127;
+  static inline V Zero() { return 0; }
+  static inline V Load(const int8 *p) {
+    V ans;
+    memcpy(&ans, p, sizeof(ans));
+    return ans;
+  }
+  static inline V Broadcast(const uint8 *p) {
+    V ans;
+    memcpy(&ans, p, sizeof(ans));
+    return ans;
+  }
+  static inline V Dot4(V acc, V a, V b) {
+    uint8 x[4];
+    int8 y[4];
+    memcpy(x, &a, 4);
+    memcpy(y, &b, 4);
+    return acc + x[0] * y[0] + x[1] * y[1] + x[2] * y[2] + x[3] * y[3];
+  }
+  static inline void Store(int32 *p, V a) { *p = a; }
+};
+
+#ifdef KALDI_QUANTIZED_MATRIX_SSE2
+struct Sse2IntOps {
+  typedef __m128i V;
+  static const int32 kLanes = 4;
+  static const int32 kInputMax = 127;
+  static inline V Zero() { return _mm_setzero_si128(); }
+  static inline V Load(const int8 *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+  static inline V Broadcast(const uint8 *p) {
+    int32 i;
+    memcpy(&i, p, sizeof(i));
+    return _mm_set1_epi32(i);
+  }
+  // SSE2 has no multiply-add on bytes, so we widen to 16 bits, use pmaddwd
+  // and add adjacent pairs of the results.
+  static inline V Dot4(V acc, V a, V b) {
+    __m128i zero = _mm_setzero_si128(),
+        a_lo = _mm_unpacklo_epi8(a, zero), a_hi = _mm_unpackhi_epi8(a, zero),
+        b_lo = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8),
+        b_hi = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+    __m128 p_lo = _mm_castsi128_ps(_mm_madd_epi16(a_lo, b_lo)),
+        p_hi = _mm_castsi128_ps(_mm_madd_epi16(a_hi, b_hi));
+    __m128i even = _mm_castps_si128(
+        _mm_shuffle_ps(p_lo, p_hi, _MM_SHUFFLE(2, 0, 2, 0))),
+        odd = _mm_castps_si128(
+            _mm_shuffle_ps(p_lo, p_hi, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(acc, _mm_add_epi32(even, odd));
+  }
+  static inline void Store(int32 *p, V a) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a);
+  }
+};
+#endif  // KALDI_QUANTIZED_MATRIX_SSE2
+
+#ifdef __AVX2__
+struct Avx2IntOps {
+  typedef __m256i V;
+  static const int32 kLanes = 8;
+  static const int32 kInputMax = 63;
+  static inline V Zero() { return _mm256_setzero_si256(); }
+  static inline V Load(const int8 *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+  static inline V Broadcast(const uint8 *p) {
+    int32 i;
+    memcpy(&i, p, sizeof(i));
+    return _mm256_set1_epi32(i);
+  }
+  static inline V Dot4(V acc, V a, V b) {
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(
+        _mm256_maddubs_epi16(a, b), _mm256_set1_epi16(1)));
+  }
+  static inline void Store(int32 *p, V a) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a);
+  }
+};
+#endif  // __AVX2__
+
+#ifdef __AVX512BW__
+struct Avx512IntOps {
+  typedef __m512i V;
+  static const int32 kLanes = 16;
+  static const int32 kInputMax = 63;
+  static inline V Zero() { return _mm512_setzero_si512(); }
+  static inline V Load(const int8 *p) { return _mm512_loadu_si512(p); }
+  static inline V Broadcast(const uint8 *p) {
+    int32 i;
+    memcpy(&i, p, sizeof(i));
+    return _mm512_set1_epi32(i);
+  }
+  static inline V Dot4(V acc, V a, V b) {
+    return _mm512_add_epi32(acc, _mm512_madd_epi16(
+        _mm512_maddubs_epi16(a, b), _mm512_set1_epi16(1)));
+  }
+  static inline void Store(int32 *p, V a) { _mm512_storeu_si512(p, a); }
+};
+#endif  // __AVX512BW__
+
+#ifdef __AVX512VNNI__
+struct Avx512VnniIntOps: public Avx512IntOps {
+  static const int32 kInputMax = 127;
+  static inline V Dot4(V acc, V a, V b) {
+    return _mm512_dpbusd_epi32(acc, a, b);
+  }
+};
+#endif  // __AVX512VNNI__
+
+#if defined(__AVX512VNNI__)
+typedef Avx512VnniIntOps IntOps;
+#elif defined(__AVX512BW__)
+typedef Avx512IntOps IntOps;
+#elif defined(__AVX2__)
+typedef Avx2IntOps IntOps;
+#elif defined(KALDI_QUANTIZED_MATRIX_SSE2)
+typedef Sse2IntOps IntOps;
+#else
+typedef ScalarIntOps IntOps;
+#endif
+
+// The rows of B (i.e. the columns of the output) are processed in panels of
+// kPanelWidth; the kernel multiplies 4 rows of A by a whole panel.
+static const MatrixIndexT kPanelWidth = 2 * IntOps::kLanes;
+// The quantized inputs are offset by this to make them positive.
+static const int32 kInputOffset = IntOps::kInputMax + 1;
+
+
+// Computes the products of 4 quantized input rows starting at 'a', with
+// 'a_stride' bytes between rows, with one panel 'b' of the quantized matrix,
+// over 4 * num_k4 columns, and stores the results in 'out' in the order
+// out[r * kPanelWidth + c].
+template<class Ops>
+static inline void MultiplyPanel(const uint8 *a, MatrixIndexT a_stride,
+                                 const int8 *b, MatrixIndexT num_k4,
+                                 int32 *out) {
+  typedef typename Ops::V V;
+  const MatrixIndexT L = Ops::kLanes;
+  V s00 = Ops::Zero(), s01 = Ops::Zero(), s10 = Ops::Zero(),
+      s11 = Ops::Zero(), s20 = Ops::Zero(), s21 = Ops::Zero(),
+      s30 = Ops::Zero(), s31 = Ops::Zero();
+  const uint8 *a1 = a + a_stride, *a2 = a1 + a_stride, *a3 = a2 + a_stride;
+  for (MatrixIndexT k = 0; k < 4 * num_k4; k += 4, b += 8 * L) {
+    V b0 = Ops::Load(b), b1 = Ops::Load(b + 4 * L), x;
+    x = Ops::Broadcast(a + k);
+    s00 = Ops::Dot4(s00, x, b0);
+    s01 = Ops::Dot4(s01, x, b1);
+    x = Ops::Broadcast(a1 + k);
+    s10 = Ops::Dot4(s10, x, b0);
+    s11 = Ops::Dot4(s11, x, b1);
+    x = Ops::Broadcast(a2 + k);
+    s20 = Ops::Dot4(s20, x, b0);
+    s21 = Ops::Dot4(s21, x, b1);
+    x = Ops::Broadcast(a3 + k);
+    s30 = Ops::Dot4(s30, x, b0);
+    s31 = Ops::Dot4(s31, x, b1);
+  }
+  Ops::Store(out, s00);
+  Ops::Store(out + L, s01);
+  Ops::Store(out + 2 * L, s10);
+  Ops::Store(out + 3 * L, s11);
+  Ops::Store(out + 4 * L, s20);
+  Ops::Store(out + 5 * L, s21);
+  Ops::Store(out + 6 * L, s30);
+  Ops::Store(out + 7 * L, s31);
+}
+
+// Quantizes one row 'x' of the input, of dimension 'dim', to integers in
+// [-kInputMax, kInputMax] plus kInputOffset, which are written to 'out';
+// returns the scale.
+static BaseFloat QuantizeInputRow(const BaseFloat *x, MatrixIndexT dim,
+                                  uint8 *out) {
+  MatrixIndexT j = 0;
+  BaseFloat max_abs = 0.0;
+#ifdef KALDI_QUANTIZED_MATRIX_SSE2
+  __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)),
+      m = _mm_setzero_ps();
+  for (; j + 4 <= dim; j += 4)
+    m = _mm_max_ps(m, _mm_and_ps(_mm_loadu_ps(x + j), abs_mask));
+  m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+  m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+  max_abs = _mm_cvtss_f32(m);
+#endif
+  for (; j < dim; j++)
+    max_abs = std::max(max_abs, std::abs(x[j]));
+  BaseFloat inv_scale = (max_abs > 0.0 && max_abs - max_abs == 0.0 ?
+                         IntOps::kInputMax / max_abs : 0.0);
+  j = 0;
+#ifdef KALDI_QUANTIZED_MATRIX_SSE2
+  __m128 inv = _mm_set1_ps(inv_scale);
+  __m128i offset = _mm_set1_epi16(kInputOffset);
+  for (; j + 16 <= dim; j += 16) {
+    // _mm_cvtps_epi32 rounds to the nearest integer.
+    __m128i v0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(x + j), inv)),
+        v1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(x + j + 4), inv)),
+        v2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(x + j + 8), inv)),
+        v3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(x + j + 12), inv)),
+        w0 = _mm_add_epi16(_mm_packs_epi32(v0, v1), offset),
+        w1 = _mm_add_epi16(_mm_packs_epi32(v2, v3), offset);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j),
+                     _mm_packus_epi16(w0, w1));
+  }
+#endif
+  for (; j < dim; j++) {
+    BaseFloat f = x[j] * inv_scale;
+    out[j] = static_cast<int32>(f + (f >= 0.0 ? 0.5 : -0.5)) + kInputOffset;
+  }
+  return max_abs / IntOps::kInputMax;
+}
+
+
+inline size_t QuantizedMatrix::Index(MatrixIndexT i, MatrixIndexT j) const {
+  // The panel of kPanelWidth rows that row i is in is stored as a sequence of
+  // groups of 4 columns; within each group, the 4 values for each row are
+  // together, so that the kernel can load a vector of them for kLanes rows.
+  size_t num_k4 = (num_cols_ + 3) / 4, panel = i / kPanelWidth;
+  return (panel * num_k4 + j / 4) * 4 * kPanelWidth +
+      (i % kPanelWidth) * 4 + j % 4;
+}
+
+void QuantizedMatrix::Resize(MatrixIndexT num_rows, MatrixIndexT num_cols) {
+  KALDI_ASSERT(num_rows >= 0 && num_cols >= 0);
+  num_rows_ = num_rows;
+  num_cols_ = num_cols;
+  size_t num_panels = (num_rows + kPanelWidth - 1) / kPanelWidth,
+      num_k4 = (num_cols + 3) / 4;
+  row_scales_.assign(num_rows, 0.0);
+  row_sums_.assign(num_rows, 0);
+  data_.assign(num_panels * kPanelWidth * num_k4 * 4, 0);
+}
+
+void QuantizedMatrix::CopyFromMat(const MatrixBase<BaseFloat> &mat) {
+  Resize(mat.NumRows(), mat.NumCols());
+  for (MatrixIndexT i = 0; i < num_rows_; i++) {
+    const BaseFloat *src = mat.RowData(i);
+    BaseFloat max_abs = 0.0;
+    for (MatrixIndexT j = 0; j < num_cols_; j++)
+      max_abs = std::max(max_abs, std::abs(src[j]));
+    if (!(max_abs - max_abs == 0.0))  // inf or NaN.
+      KALDI_ERR << "Quantizing a matrix that contains " << max_abs;
+    BaseFloat inv_scale = (max_abs > 0.0 ? 127.0 / max_abs : 0.0);
+    row_scales_[i] = max_abs / 127.0;
+    int32 sum = 0;
+    for (MatrixIndexT j = 0; j < num_cols_; j++) {
+      BaseFloat f = src[j] * inv_scale;
+      int32 q = static_cast<int32>(f + (f >= 0.0 ? 0.5 : -0.5));
+      data_[Index(i, j)] = q;
+      sum += q;
+    }
+    row_sums_[i] = sum;
+  }
+}
+
+void QuantizedMatrix::CopyToMat(MatrixBase<BaseFloat> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  for (MatrixIndexT i = 0; i < num_rows_; i++) {
+    BaseFloat *dest = mat->RowData(i), scale = row_scales_[i];
+    for (MatrixIndexT j = 0; j < num_cols_; j++)
+      dest[j] = scale * data_[Index(i, j)];
+  }
+}
+
+void QuantizedMatrix::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedMatrix>");
+  WriteBasicType(os, binary, num_rows_);
+  WriteBasicType(os, binary, num_cols_);
+  Vector<BaseFloat> row_scales(num_rows_);
+  std::copy(row_scales_.begin(), row_scales_.end(), row_scales.Data());
+  row_scales.Write(os, binary);
+  std::vector<int8> values(static_cast<size_t>(num_rows_) * num_cols_);
+  for (MatrixIndexT i = 0; i < num_rows_; i++)
+    for (MatrixIndexT j = 0; j < num_cols_; j++)
+      values[static_cast<size_t>(i) * num_cols_ + j] = data_[Index(i, j)];
+  WriteIntegerVector(os, binary, values);
+  WriteToken(os, binary, "</QuantizedMatrix>");
+}
+
+void QuantizedMatrix::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<QuantizedMatrix>");
+  MatrixIndexT num_rows, num_cols;
+  ReadBasicType(is, binary, &num_rows);
+  ReadBasicType(is, binary, &num_cols);
+  Vector<BaseFloat> row_scales;
+  row_scales.Read(is, binary);
+  std::vector<int8> values;
+  ReadIntegerVector(is, binary, &values);
+  if (num_rows < 0 || num_cols < 0 || row_scales.Dim() != num_rows ||
+      values.size() != static_cast<size_t>(num_rows) * num_cols)
+    KALDI_ERR << "Reading QuantizedMatrix: inconsistent sizes (corrupted "
+              << "file?)";
+  Resize(num_rows, num_cols);
+  std::copy(row_scales.Data(), row_scales.Data() + num_rows,
+            row_scales_.begin());
+  for (MatrixIndexT i = 0; i < num_rows; i++) {
+    int32 sum = 0;
+    for (MatrixIndexT j = 0; j < num_cols; j++) {
+      int8 v = values[static_cast<size_t>(i) * num_cols + j];
+      if (v < -127)
+        KALDI_ERR << "Reading QuantizedMatrix: value out of range.";
+      data_[Index(i, j)] = v;
+      sum += v;
+    }
+    row_sums_[i] = sum;
+  }
+  ExpectToken(is, binary, "</QuantizedMatrix>");
+}
+
+void QuantizedMatrix::Swap(QuantizedMatrix *other) {
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  row_scales_.swap(other->row_scales_);
+  row_sums_.swap(other->row_sums_);
+  data_.swap(other->data_);
+}
+
+
+void AddMatQuantizedMatTrans(const MatrixBase<BaseFloat> &A,
+                             const QuantizedMatrix &B,
+                             BaseFloat beta,
+                             MatrixBase<BaseFloat> *out) {
+  KALDI_ASSERT(A.NumCols() == B.num_cols_ && out->NumRows() == A.NumRows() &&
+               out->NumCols() == B.num_rows_);
+  MatrixIndexT num_rows = A.NumRows(), num_cols = A.NumCols(),
+      num_k4 = (num_cols + 3) / 4, a_stride = 4 * num_k4,
+      padded_rows = 4 * ((num_rows + 3) / 4);
+  if (num_rows == 0 || B.num_rows_ == 0)
+    return;
+  if (num_cols == 0) {
+    if (beta == 0.0) out->SetZero();
+    else out->Scale(beta);
+    return;
+  }
+
+  // Quantize the rows of A.  The padding (extra columns up to a multiple of
+  // 4, and extra rows up to a multiple of 4) represents zeros.  We keep the
+  // buffer so that we don't have to allocate it each time.
+  static thread_local std::vector<uint8> a_data;
+  static thread_local std::vector<BaseFloat> a_scales;
+  a_data.resize(static_cast<size_t>(padded_rows) * a_stride);
+  a_scales.resize(padded_rows);
+  uint8 *a_ptr = &(a_data[0]);
+  BaseFloat *a_scale_ptr = &(a_scales[0]);
+  MatrixParallelFor(
+      num_rows, 2.0 * num_cols,
+      [=, &A](MatrixIndexT begin, MatrixIndexT end) {
+        for (MatrixIndexT i = begin; i < end; i++) {
+          uint8 *row = a_ptr + static_cast<size_t>(i) * a_stride;
+          a_scale_ptr[i] = QuantizeInputRow(A.RowData(i), num_cols, row);
+          memset(row + num_cols, kInputOffset, a_stride - num_cols);
+        }
+      });
+  memset(a_ptr + static_cast<size_t>(num_rows) * a_stride, kInputOffset,
+         static_cast<size_t>(padded_rows - num_rows) * a_stride);
+
+  MatrixIndexT b_rows = B.num_rows_,
+      num_panels = (b_rows + kPanelWidth - 1) / kPanelWidth;
+  const int8 *b_data = &(B.data_[0]);
+  const BaseFloat *b_scales = &(B.row_scales_[0]);
+  const int32 *b_sums = &(B.row_sums_[0]);
+  MatrixParallelFor(
+      num_panels, 2.0 * kPanelWidth * num_rows * num_cols,
+      [=](MatrixIndexT begin, MatrixIndexT end) {
+        int32 dots[4 * kPanelWidth];
+        for (MatrixIndexT p = begin; p < end; p++) {
+          const int8 *b = b_data + static_cast<size_t>(p) * num_k4 * 4 *
+              kPanelWidth;
+          MatrixIndexT j0 = p * kPanelWidth,
+              num_j = std::min(kPanelWidth, b_rows - j0);
+          for (MatrixIndexT i0 = 0; i0 < num_rows; i0 += 4) {
+            MultiplyPanel<IntOps>(a_ptr + static_cast<size_t>(i0) * a_stride,
+                                  a_stride, b, num_k4, dots);
+            MatrixIndexT num_i = std::min<MatrixIndexT>(4, num_rows - i0);
+            for (MatrixIndexT i = 0; i < num_i; i++) {
+              BaseFloat a_scale = a_scale_ptr[i0 + i],
+                  *out_row = out->RowData(i0 + i) + j0;
+              const int32 *dots_row = dots + i * kPanelWidth;
+              for (MatrixIndexT j = 0; j < num_j; j++) {
+                // Remove the contribution of the offset of the inputs.
+                int32 dot = dots_row[j] - kInputOffset * b_sums[j0 + j];
+                BaseFloat prod = a_scale * b_scales[j0 + j] * dot;
+                out_row[j] = (beta == 0.0 ? prod : beta * out_row[j] + prod);
+              }
+            }
+          }
+        }
+      });
+}
+
+}  // namespace kaldi
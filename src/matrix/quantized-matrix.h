@@ -0,0 +1,121 @@
+// matrix/quantized-matrix.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_MATRIX_QUANTIZED_MATRIX_H_
+#define KALDI_MATRIX_QUANTIZED_MATRIX_H_
+
+#include <vector>
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/**
+   QuantizedMatrix stores a matrix in 8-bit form with one scale per row: element
+   (i, j) is represented as RowScale(i) * q(i, j), where q(i, j) is an integer in
+   the range [-127, 127] and RowScale(i) is the largest absolute value in row i,
+   divided by 127.  It is intended for quantized neural-net inference (see
+   QuantizedAffineComponent in ../nnet3/nnet-quantized-component.h): the
+   parameter matrices are quantized once, and AddMatQuantizedMatTrans()
+   multiplies by them using integer arithmetic.
+
+   In memory the values are stored in an interleaved order that suits the
+   integer matrix-multiplication kernel (which depends on the instruction set
+   we were compiled for); on disk they are stored row by row, one byte each.
+ */
+class QuantizedMatrix {
+ public:
+  QuantizedMatrix(): num_rows_(0), num_cols_(0) { }
+
+  explicit QuantizedMatrix(const MatrixBase<BaseFloat> &mat):
+      num_rows_(0), num_cols_(0) { CopyFromMat(mat); }
+
+  /// Quantizes the matrix 'mat' (resizing *this as needed).
+  void CopyFromMat(const MatrixBase<BaseFloat> &mat);
+
+  /// Copies the represented values to 'mat', which must have the same
+  /// dimensions as *this.
+  void CopyToMat(MatrixBase<BaseFloat> *mat) const;
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+
+  /// Returns the scale of row i, so element (i, j) is represented as
+  /// RowScale(i) times an integer in [-127, 127].
+  BaseFloat RowScale(MatrixIndexT i) const {
+    KALDI_PARANOID_ASSERT(static_cast<UnsignedMatrixIndexT>(i) <
+                          static_cast<UnsignedMatrixIndexT>(num_rows_));
+    return row_scales_[i];
+  }
+
+  void Write(std::ostream &os, bool binary) const;
+
+  void Read(std::istream &is, bool binary);
+
+  void Swap(QuantizedMatrix *other);
+
+ private:
+  friend void AddMatQuantizedMatTrans(const MatrixBase<BaseFloat> &A,
+                                      const QuantizedMatrix &B,
+                                      BaseFloat beta,
+                                      MatrixBase<BaseFloat> *out);
+
+  // Sets the dimensions and allocates the (zeroed) storage.
+  void Resize(MatrixIndexT num_rows, MatrixIndexT num_cols);
+
+  // Returns the position of element (i, j) in data_.
+  inline size_t Index(MatrixIndexT i, MatrixIndexT j) const;
+
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  // The scale of each row; has dimension num_rows_.
+  std::vector<BaseFloat> row_scales_;
+  // The sum of the integer values in each row (this is needed because the
+  // integer kernels work with unsigned, offset versions of the inputs).
+  std::vector<int32> row_sums_;
+  // The integer values, in the order given by Index(), padded with zeros.
+  std::vector<int8> data_;
+};
+
+/// Does out = beta * out + A * B^T, where B is a quantized matrix with the same
+/// number of columns as A, and 'out' is A.NumRows() by B.NumRows().  The rows
+/// of A are quantized to 8 bits on the fly (each with its own scale) and the
+/// matrix product is computed with integer arithmetic.  If beta is zero, the
+/// previous contents of 'out' are ignored (even if they are NaN).  This uses
+/// the matrix library's threads if g_matrix_num_threads > 1 (see
+/// matrix-threading.h).
+///
+/// Note: this is only faster than the floating-point AddMatMat() (with a good
+/// BLAS) if we were compiled with support for AVX2 or, better, AVX-512 with
+/// the VNNI instructions (e.g. with -march=native); with plain SSE2 it is
+/// slower.  If we were compiled with AVX2 but not VNNI, the inputs are
+/// quantized to 7 bits instead of 8, to avoid overflow.
+void AddMatQuantizedMatTrans(const MatrixBase<BaseFloat> &A,
+                             const QuantizedMatrix &B,
+                             BaseFloat beta,
+                             MatrixBase<BaseFloat> *out);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_QUANTIZED_MATRIX_H_
@@ -49,6 +49,7 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
     TaskSequencerConfig sequencer_config; // has --num-threads option
+    int32 num_determinize_threads = 0;
 
     std::string word_syms_filename;
     sequencer_config.Register(&po);
@@ -56,6 +57,10 @@ int main(int argc, char *argv[]) {
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial, "If true, produce output even if end state was not reached.");
+    po.Register("num-determinize-threads", &num_determinize_threads,
+                "If > 0, the lattices are determinized by this many separate "
+                "threads rather than by the decoding threads, so that the "
+                "decoding does not wait for the determinization.");
 
     po.Read(argc, argv);
 
@@ -88,6 +93,13 @@ int main(int argc, char *argv[]) {
       KALDI_ERR << "Could not open table for writing lattices: "
                  << lattice_wspecifier;
 
+    // The determinizer is declared first, so that it is destroyed after the
+    // decoding tasks, which give their lattices to it.
+    TaskSequencerConfig determinizer_config;
+    determinizer_config.num_threads = num_determinize_threads;
+    TaskSequencer<DeterminizeLatticeClass> determinizer(determinizer_config);
+    TaskSequencer<DeterminizeLatticeClass> *determinizer_ptr =
+        (num_determinize_threads > 0 ? &determinizer : NULL);
     TaskSequencer<DecodeUtteranceLatticeFasterClass> sequencer(sequencer_config);
 
     Int32VectorWriter words_writer(words_wspecifier);
@@ -138,7 +150,8 @@ int main(int argc, char *argv[]) {
                   trans_model, word_syms, utt, acoustic_scale, determinize,
                   allow_partial, &alignment_writer, &words_writer,
                   &compact_lattice_writer, &lattice_writer,
-                  &tot_like, &frame_count, &num_done, &num_err, NULL);
+                  &tot_like, &frame_count, &num_done, &num_err, NULL,
+                  determinizer_ptr);
 
           sequencer.Run(task); // takes ownership of "task",
                                // and will delete it when done.
@@ -178,13 +191,15 @@ int main(int argc, char *argv[]) {
                 trans_model, word_syms, utt, acoustic_scale, determinize,
                 allow_partial, &alignment_writer, &words_writer,
                 &compact_lattice_writer, &lattice_writer,
-                &tot_like, &frame_count, &num_done, &num_err, NULL);
+                &tot_like, &frame_count, &num_done, &num_err, NULL,
+                determinizer_ptr);
 
         sequencer.Run(task); // takes ownership of "task",
                              // and will delete it when done.
       }
     }
     sequencer.Wait(); // Waits for all tasks to be done.
+    determinizer.Wait();
     delete decode_fst;
 
     double elapsed = timer.Elapsed();
@@ -17,6 +17,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fstream>
 #include "nnet3/decodable-simple-looped.h"
 #include "nnet3/nnet-utils.h"
 #include "nnet3/nnet-compile-looped.h"
@@ -82,13 +83,83 @@ void DecodableNnetSimpleLoopedInfo::Init(
                                  num_sequences,
                                  &request1, &request2, &request3);
 
-  CompileLooped(*nnet, opts.optimize_config, request1, request2, request3,
-                &computation);
-  computation.ComputeCudaIndexes();
+  if (opts.computation_cache.empty() || !ReadComputationCache(*nnet)) {
+    CompileLooped(*nnet, opts.optimize_config, request1, request2, request3,
+                  &computation);
+    computation.ComputeCudaIndexes();  // NnetComputation::Read() does this.
+    if (!opts.computation_cache.empty()) {
+      try {
+        WriteComputationCache(*nnet);
+      } catch (const std::exception &e) {
+        KALDI_WARN << "Error writing computation cache "
+                   << opts.computation_cache << ": " << e.what();
+      }
+    }
+  }
   KALDI_VLOG(3) << "Computation is:\n"
                 << NnetComputationPrintInserter{computation, *nnet};
 }
 
+bool DecodableNnetSimpleLoopedInfo::ReadComputationCache(const Nnet &nnet) {
+  const std::string &filename = opts.computation_cache;
+  std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+  if (!is.is_open()) {
+    KALDI_LOG << "Computation cache " << filename << " does not exist yet; "
+              << "it will be created.";
+    return false;
+  }
+  try {
+    bool binary;
+    if (!InitKaldiInputStream(is, &binary))
+      KALDI_ERR << "Could not initialize stream";
+    uint64 structure_hash;
+    ExpectToken(is, binary, "<LoopedComputationCache>");
+    ExpectToken(is, binary, "<StructureHash>");
+    ReadBasicType(is, binary, &structure_hash);
+    NnetOptimizeOptions optimize_config;
+    optimize_config.Read(is, binary);
+    ComputationRequest cached_request1, cached_request2, cached_request3;
+    cached_request1.Read(is, binary);
+    cached_request2.Read(is, binary);
+    cached_request3.Read(is, binary);
+    if (structure_hash != NnetStructureHash(nnet) ||
+        !(optimize_config == opts.optimize_config) ||
+        !(cached_request1 == request1) || !(cached_request2 == request2) ||
+        !(cached_request3 == request3)) {
+      KALDI_WARN << "Not using computation cache " << filename
+                 << " because it was written for a different neural net or "
+                 << "with different options; it will be overwritten.";
+      return false;
+    }
+    computation.Read(is, binary);
+    ExpectToken(is, binary, "</LoopedComputationCache>");
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Error reading computation cache " << filename
+               << " (will recompile): " << e.what();
+    return false;
+  }
+  KALDI_LOG << "Read looped computation from cache " << filename;
+  return true;
+}
+
+void DecodableNnetSimpleLoopedInfo::WriteComputationCache(
+    const Nnet &nnet) const {
+  const std::string &filename = opts.computation_cache;
+  bool binary = true;
+  CacheFileOutput ko(filename);
+  WriteToken(ko.Stream(), binary, "<LoopedComputationCache>");
+  WriteToken(ko.Stream(), binary, "<StructureHash>");
+  WriteBasicType(ko.Stream(), binary, NnetStructureHash(nnet));
+  opts.optimize_config.Write(ko.Stream(), binary);
+  request1.Write(ko.Stream(), binary);
+  request2.Write(ko.Stream(), binary);
+  request3.Write(ko.Stream(), binary);
+  computation.Write(ko.Stream(), binary);
+  WriteToken(ko.Stream(), binary, "</LoopedComputationCache>");
+  ko.Close();
+  KALDI_LOG << "Wrote looped computation to cache " << filename;
+}
+
 
 DecodableNnetSimpleLooped::DecodableNnetSimpleLooped(
     const DecodableNnetSimpleLoopedInfo &info,
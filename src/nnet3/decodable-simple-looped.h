@@ -49,6 +49,7 @@ struct NnetSimpleLoopedComputationOptions {
   int32 frames_per_chunk;
   BaseFloat acoustic_scale;
   bool debug_computation;
+  std::string computation_cache;
   NnetOptimizeOptions optimize_config;
   NnetComputeOptions compute_config;
   NnetSimpleLoopedComputationOptions():
@@ -83,6 +84,12 @@ struct NnetSimpleLoopedComputationOptions {
                    "if needed.");
     opts->Register("debug-computation", &debug_computation, "If true, turn on "
                    "debug for the actual computation (very verbose!)");
+    opts->Register("computation-cache", &computation_cache,
+                   "If set, the name of a file in which the compiled looped "
+                   "computation is cached between runs.  It is ignored (and "
+                   "overwritten) if it was written for a neural net with a "
+                   "different structure or with different options, so it is "
+                   "safe to share it between jobs.");
 
     // register the optimization options with the prefix "optimization".
     ParseOptions optimization_opts("optimization", opts);
@@ -151,6 +158,15 @@ class DecodableNnetSimpleLoopedInfo  {
 
   // The compiled, 'looped' computation.
   NnetComputation computation;
+
+ private:
+  // Reads 'computation' from the file opts.computation_cache if it exists and
+  // was written for the same network structure, options and computation
+  // requests; returns true if it was read.
+  bool ReadComputationCache(const Nnet &nnet);
+  // Writes 'computation' to the file opts.computation_cache, together with
+  // what ReadComputationCache() needs to check that it is usable.
+  void WriteComputationCache(const Nnet &nnet) const;
 };
 
 /*
@@ -64,7 +64,11 @@ DecodableAmNnetSimple::DecodableAmNnetSimple(
     const MatrixBase<BaseFloat> *online_ivectors,
     int32 online_ivector_period,
     CachingOptimizingCompiler *compiler):
-    compiler_(am_nnet.GetNnet(), opts.optimize_config, opts.compiler_config),
+    // If 'compiler' is supplied, compiler_ is unused; don't let it read or
+    // write the computation cache file.
+    compiler_(am_nnet.GetNnet(), opts.optimize_config,
+              compiler != NULL ? CachingOptimizingCompilerOptions() :
+              opts.compiler_config),
     decodable_nnet_(opts, am_nnet.GetNnet(), am_nnet.Priors(),
                     feats, compiler != NULL ? compiler : &compiler_,
                     ivector, online_ivectors,
@@ -310,6 +314,14 @@ void DecodableNnetSimple::CheckAndFixConfigs() {
 }
 
 
+// Returns a copy of 'config' with the computation cache file unset.
+static CachingOptimizingCompilerOptions WithoutCacheFile(
+    const CachingOptimizingCompilerOptions &config) {
+  CachingOptimizingCompilerOptions ans(config);
+  ans.cache_filename = "";
+  return ans;
+}
+
 DecodableAmNnetSimpleParallel::DecodableAmNnetSimpleParallel(
     const NnetSimpleComputationOptions &opts,
     const TransitionModel &trans_model,
@@ -318,7 +330,10 @@ DecodableAmNnetSimpleParallel::DecodableAmNnetSimpleParallel(
     const VectorBase<BaseFloat> *ivector,
     const MatrixBase<BaseFloat> *online_ivectors,
     int32 online_ivector_period):
-    compiler_(am_nnet.GetNnet(), opts.optimize_config, opts.compiler_config),
+    // compiler_ only lives for one utterance, so don't let it read or write
+    // the computation cache file (parallel decoders would race on it).
+    compiler_(am_nnet.GetNnet(), opts.optimize_config,
+              WithoutCacheFile(opts.compiler_config)),
     trans_model_(trans_model),
     feats_copy_(NULL),
     ivector_copy_(NULL),
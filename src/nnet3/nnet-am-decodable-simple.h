@@ -94,6 +94,13 @@ struct NnetSimpleComputationOptions {
                    "input frames");
     opts->Register("debug-computation", &debug_computation, "If true, turn on "
                    "debug for the actual computation (very verbose!)");
+    opts->Register("computation-cache", &compiler_config.cache_filename,
+                   "If set, the name of a file in which the compiled "
+                   "computations are cached between runs: they are read from "
+                   "it at startup and it is rewritten at exit if anything new "
+                   "had to be compiled.  It is ignored (and overwritten) if it "
+                   "was written for a neural net with a different structure, "
+                   "so it is safe to share it between jobs.");
 
     // register the optimization options with the prefix "optimization".
     ParseOptions optimization_opts("optimization", opts);
@@ -361,6 +368,8 @@ class DecodableAmNnetSimpleParallel: public DecodableInterface {
             would be quite complicated, and in any case multi-threaded
             decoding probably makes the most sense when using CPU, and
             in that case we don't expect the compilation phase to dominate.
+            For the same reason, it ignores opts.compiler_config.cache_filename
+            (the --computation-cache option).
 
      This constructor takes features as input, and you can either supply a
      single iVector input, estimated in batch-mode ('ivector'), or 'online'
@@ -34,7 +34,7 @@ NnetBatchComputer::NnetBatchComputer(
     const VectorBase<BaseFloat> &priors):
     opts_(opts),
     nnet_(nnet),
-    compiler_(nnet_, opts.optimize_config),
+    compiler_(nnet_, opts.optimize_config, opts.compiler_config),
     log_priors_(priors),
     num_full_minibatches_(0) {
   log_priors_.ApplyLog();
@@ -0,0 +1,194 @@
+// nnet3/nnet-block-sparse-component.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nnet3/nnet-block-sparse-component.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Reads the 'block-size' and 'sparsity' values from the config line, for
+// InitFromConfig().
+static void GetBlockSparseConfig(ConfigLine *cfl, int32 *block_size,
+                                 BaseFloat *sparsity) {
+  *block_size = 4;
+  *sparsity = 0.9;
+  cfl->GetValue("block-size", block_size);
+  cfl->GetValue("sparsity", sparsity);
+  if (*sparsity < 0.0 || *sparsity > 1.0)
+    KALDI_ERR << "Bad sparsity " << *sparsity << " in config line "
+              << cfl->WholeLine();
+}
+
+// Prints the block size and the proportion of the blocks that are stored.
+static void PrintBlockSparseStats(std::ostream &os,
+                                  const std::vector<BlockSparseMatrix> &mats) {
+  double num_blocks = 0.0, num_stored = 0.0;
+  for (size_t i = 0; i < mats.size(); i++) {
+    num_stored += mats[i].NumBlocks();
+    if (mats[i].Density() != 0.0)
+      num_blocks += mats[i].NumBlocks() / mats[i].Density();
+  }
+  os << ", block-size=" << (mats.empty() ? 0 : mats[0].BlockSize())
+     << ", block-density=" << (num_blocks == 0.0 ? 1.0 :
+                               num_stored / num_blocks);
+}
+
+
+BlockSparseAffineComponent::BlockSparseAffineComponent(
+    const BlockSparseAffineComponent &other):
+    CompactAffineComponent(other),
+    linear_params_(other.linear_params_) { }
+
+BlockSparseAffineComponent::BlockSparseAffineComponent(
+    const CuMatrixBase<BaseFloat> &linear_params,
+    const CuVectorBase<BaseFloat> &bias_params,
+    int32 block_size):
+    CompactAffineComponent(bias_params) {
+  KALDI_ASSERT(linear_params.NumRows() > 0 &&
+               (bias_params.Dim() == 0 ||
+                bias_params.Dim() == linear_params.NumRows()));
+  Matrix<BaseFloat> linear_params_cpu(linear_params);
+  linear_params_.CopyFromMat(linear_params_cpu, block_size);
+}
+
+void BlockSparseAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  int32 block_size;
+  BaseFloat sparsity;
+  GetBlockSparseConfig(cfl, &block_size, &sparsity);
+  AffineComponent affine;
+  affine.InitFromConfig(cfl);
+  Matrix<BaseFloat> linear_params(affine.LinearParams());
+  PruneMatrixBlocks(block_size, sparsity, &linear_params);
+  BlockSparseAffineComponent temp(CuMatrix<BaseFloat>(linear_params),
+                                  affine.BiasParams(), block_size);
+  linear_params_.Swap(&temp.linear_params_);
+  bias_params_.Swap(&temp.bias_params_);
+}
+
+void BlockSparseAffineComponent::AddMatParamsTrans(
+    int32 i, const MatrixBase<BaseFloat> &in, BaseFloat beta,
+    MatrixBase<BaseFloat> *out) const {
+  AddMatBlockSparseMatTrans(in, linear_params_, beta, out);
+}
+
+void BlockSparseAffineComponent::AddMatParams(
+    int32 i, const MatrixBase<BaseFloat> &in,
+    MatrixBase<BaseFloat> *out) const {
+  AddMatBlockSparseMat(in, linear_params_, out);
+}
+
+void BlockSparseAffineComponent::CopyParamsToMat(
+    int32 i, MatrixBase<BaseFloat> *dest) const {
+  linear_params_.CopyToMat(dest);
+}
+
+void BlockSparseAffineComponent::WriteParams(std::ostream &os,
+                                             bool binary) const {
+  linear_params_.Write(os, binary);
+}
+
+void BlockSparseAffineComponent::ReadParams(std::istream &is, bool binary,
+                                            int32 num_matrices) {
+  KALDI_ASSERT(num_matrices == 1);
+  linear_params_.Read(is, binary);
+}
+
+void BlockSparseAffineComponent::PrintParamsInfo(
+    std::ostringstream &os) const {
+  PrintBlockSparseStats(os, std::vector<BlockSparseMatrix>(1, linear_params_));
+}
+
+
+BlockSparseTdnnComponent::BlockSparseTdnnComponent(
+    const BlockSparseTdnnComponent &other):
+    CompactTdnnComponent(other),
+    linear_params_(other.linear_params_) { }
+
+BlockSparseTdnnComponent::BlockSparseTdnnComponent(const TdnnComponent &tdnn,
+                                                   int32 block_size):
+    CompactTdnnComponent(tdnn),
+    linear_params_(tdnn.TimeOffsets().size()) {
+  Matrix<BaseFloat> linear_params(tdnn.LinearParams());
+  int32 input_dim = tdnn.InputDim();
+  for (size_t i = 0; i < time_offsets_.size(); i++) {
+    SubMatrix<BaseFloat> part(linear_params, 0, linear_params.NumRows(),
+                              i * input_dim, input_dim);
+    linear_params_[i].CopyFromMat(part, block_size);
+  }
+  Check();
+}
+
+void BlockSparseTdnnComponent::InitFromConfig(ConfigLine *cfl) {
+  int32 block_size;
+  BaseFloat sparsity;
+  GetBlockSparseConfig(cfl, &block_size, &sparsity);
+  TdnnComponent tdnn;
+  tdnn.InitFromConfig(cfl);
+  Matrix<BaseFloat> linear_params(tdnn.LinearParams());
+  PruneMatrixBlocks(block_size, sparsity, &linear_params);
+  tdnn.LinearParams().CopyFromMat(linear_params);
+  BlockSparseTdnnComponent temp(tdnn, block_size);
+  time_offsets_.swap(temp.time_offsets_);
+  linear_params_.swap(temp.linear_params_);
+  bias_params_.Swap(&temp.bias_params_);
+}
+
+void BlockSparseTdnnComponent::AddMatParamsTrans(
+    int32 i, const MatrixBase<BaseFloat> &in, BaseFloat beta,
+    MatrixBase<BaseFloat> *out) const {
+  AddMatBlockSparseMatTrans(in, linear_params_[i], beta, out);
+}
+
+void BlockSparseTdnnComponent::AddMatParams(
+    int32 i, const MatrixBase<BaseFloat> &in,
+    MatrixBase<BaseFloat> *out) const {
+  AddMatBlockSparseMat(in, linear_params_[i], out);
+}
+
+void BlockSparseTdnnComponent::CopyParamsToMat(
+    int32 i, MatrixBase<BaseFloat> *dest) const {
+  linear_params_[i].CopyToMat(dest);
+}
+
+void BlockSparseTdnnComponent::WriteParams(std::ostream &os,
+                                           bool binary) const {
+  for (size_t i = 0; i < linear_params_.size(); i++)
+    linear_params_[i].Write(os, binary);
+}
+
+void BlockSparseTdnnComponent::ReadParams(std::istream &is, bool binary,
+                                          int32 num_matrices) {
+  linear_params_.resize(num_matrices);
+  for (size_t i = 0; i < linear_params_.size(); i++) {
+    linear_params_[i].Read(is, binary);
+    KALDI_ASSERT(linear_params_[i].NumRows() == OutputDim() &&
+                 linear_params_[i].NumCols() == InputDim() &&
+                 linear_params_[i].BlockSize() ==
+                 linear_params_[0].BlockSize());
+  }
+}
+
+void BlockSparseTdnnComponent::PrintParamsInfo(
+    std::ostringstream &os) const {
+  PrintBlockSparseStats(os, linear_params_);
+}
+
+} // namespace nnet3
+} // namespace kaldi
@@ -0,0 +1,166 @@
+// nnet3/nnet-block-sparse-component.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET3_NNET_BLOCK_SPARSE_COMPONENT_H_
+#define KALDI_NNET3_NNET_BLOCK_SPARSE_COMPONENT_H_
+
+#include "nnet3/nnet-common.h"
+#include "nnet3/nnet-component-itf.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-compact-component.h"
+#include "matrix/block-sparse-matrix.h"
+#include <iostream>
+
+namespace kaldi {
+namespace nnet3 {
+
+/// @file  nnet-block-sparse-component.h
+///
+/// Contains components that are versions of affine-type components whose
+/// parameter matrices have been pruned so that most of their blocks (of a few
+/// consecutive rows by one column) are zero.  The parameters are stored as
+/// class BlockSparseMatrix, and Propagate() only does the multiplications for
+/// the nonzero blocks; see AddMatBlockSparseMatTrans() in
+/// ../matrix/block-sparse-matrix.h, including how sparse the matrices need to
+/// be for this to be faster than the dense computation.
+///
+/// The parameters are pruned by the 'prune-blocks' directive of the --edits
+/// option of nnet3-copy or nnet3-am-copy, or by the program nnet3-prune (see
+/// PruneNnetBlocks() in nnet-utils.h); that leaves them as the normal
+/// floating-point components, which can still be trained.  CollapseModel()
+/// then replaces the components that are sparse enough with the components
+/// in this file when preparing the model for test (see
+/// ConvertToBlockSparse() in nnet-utils.h).  These components are not
+/// updatable.  Most of their work is done by the base classes in
+/// nnet-compact-component.h; in particular the computation is always done on
+/// the CPU.
+
+
+/**
+   BlockSparseAffineComponent is a block-sparse version of AffineComponent (or
+   of its child classes such as NaturalGradientAffineComponent, or of
+   FixedAffineComponent or LinearComponent).  The bias is optional, and is
+   stored as a dense vector.
+
+   This is normally created by ConvertToBlockSparse().  For testing purposes
+   it may be initialized from a config line, which accepts the same values as
+   AffineComponent, plus 'block-size' (default 4) and 'sparsity' (default 0.9);
+   the parameters of the AffineComponent that would be initialized are pruned
+   with PruneMatrixBlocks() to the given sparsity, e.g. "input-dim=100
+   output-dim=200 block-size=8 sparsity=0.75".
+*/
+class BlockSparseAffineComponent: public CompactAffineComponent {
+ public:
+  BlockSparseAffineComponent() { }
+
+  BlockSparseAffineComponent(const BlockSparseAffineComponent &other);
+
+  /// Initializes from dense parameters (keeping only their nonzero blocks of
+  /// size 'block_size'); 'bias_params' may be empty, meaning there is no
+  /// bias.
+  BlockSparseAffineComponent(const CuMatrixBase<BaseFloat> &linear_params,
+                             const CuVectorBase<BaseFloat> &bias_params,
+                             int32 block_size);
+
+  virtual int32 InputDim() const { return linear_params_.NumCols(); }
+  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual std::string Type() const { return "BlockSparseAffineComponent"; }
+
+  virtual Component* Copy() const {
+    return new BlockSparseAffineComponent(*this);
+  }
+
+  const BlockSparseMatrix &LinearParams() const { return linear_params_; }
+
+ protected:
+  virtual void AddMatParamsTrans(int32 i, const MatrixBase<BaseFloat> &in,
+                                 BaseFloat beta,
+                                 MatrixBase<BaseFloat> *out) const;
+  virtual void AddMatParams(int32 i, const MatrixBase<BaseFloat> &in,
+                            MatrixBase<BaseFloat> *out) const;
+  virtual void CopyParamsToMat(int32 i, MatrixBase<BaseFloat> *dest) const;
+  virtual void WriteParams(std::ostream &os, bool binary) const;
+  virtual void ReadParams(std::istream &is, bool binary, int32 num_matrices);
+  virtual void PrintParamsInfo(std::ostringstream &os) const;
+
+ private:
+  BlockSparseMatrix linear_params_;
+};
+
+
+/**
+   BlockSparseTdnnComponent is a block-sparse version of TdnnComponent.  The
+   parameter matrix for each time offset is stored separately, and the bias,
+   if present, is stored as a dense vector.
+
+   This is normally created by ConvertToBlockSparse().  For testing purposes
+   it may be initialized from a config line, which accepts the same values as
+   TdnnComponent, plus 'block-size' and 'sparsity' as for
+   BlockSparseAffineComponent, e.g. "input-dim=100 output-dim=200
+   time-offsets=-1,0,1 block-size=4 sparsity=0.9".
+*/
+class BlockSparseTdnnComponent: public CompactTdnnComponent {
+ public:
+  BlockSparseTdnnComponent() { }
+
+  BlockSparseTdnnComponent(const BlockSparseTdnnComponent &other);
+
+  /// Initializes from a TdnnComponent, keeping only the nonzero blocks of size
+  /// 'block_size' of its parameters.
+  BlockSparseTdnnComponent(const TdnnComponent &tdnn, int32 block_size);
+
+  virtual int32 InputDim() const {
+    return linear_params_.empty() ? 0 : linear_params_[0].NumCols();
+  }
+  virtual int32 OutputDim() const {
+    return linear_params_.empty() ? 0 : linear_params_[0].NumRows();
+  }
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual std::string Type() const { return "BlockSparseTdnnComponent"; }
+
+  virtual Component* Copy() const {
+    return new BlockSparseTdnnComponent(*this);
+  }
+
+ protected:
+  virtual void AddMatParamsTrans(int32 i, const MatrixBase<BaseFloat> &in,
+                                 BaseFloat beta,
+                                 MatrixBase<BaseFloat> *out) const;
+  virtual void AddMatParams(int32 i, const MatrixBase<BaseFloat> &in,
+                            MatrixBase<BaseFloat> *out) const;
+  virtual void CopyParamsToMat(int32 i, MatrixBase<BaseFloat> *dest) const;
+  virtual void WriteParams(std::ostream &os, bool binary) const;
+  virtual void ReadParams(std::istream &is, bool binary, int32 num_matrices);
+  virtual void PrintParamsInfo(std::ostringstream &os) const;
+
+ private:
+  // The parameters for each time offset: linear_params_[i] is of dimension
+  // OutputDim() by InputDim(), and is the corresponding column range of the
+  // TdnnComponent's linear parameters.
+  std::vector<BlockSparseMatrix> linear_params_;
+};
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+
+#endif
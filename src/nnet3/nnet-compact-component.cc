@@ -0,0 +1,268 @@
+// nnet3/nnet-compact-component.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <set>
+#include <sstream>
+#include "nnet3/nnet-compact-component.h"
+#include "nnet3/nnet-computation-graph.h"
+#include "nnet3/nnet-parse.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+
+void CompactLinearComponent::AddCuMatParamsTrans(
+    int32 i, const CuMatrixBase<BaseFloat> &in, BaseFloat beta,
+    CuMatrixBase<BaseFloat> *out) const {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Matrix<BaseFloat> in_cpu(in),
+        out_cpu(out->NumRows(), out->NumCols(), kUndefined);
+    if (beta != 0.0)
+      out->CopyToMat(&out_cpu);
+    AddMatParamsTrans(i, in_cpu, beta, &out_cpu);
+    out->CopyFromMat(out_cpu);
+    return;
+  }
+#endif
+  AddMatParamsTrans(i, in.Mat(), beta, &(out->Mat()));
+}
+
+void CompactLinearComponent::AddCuMatParams(
+    int32 i, const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Matrix<BaseFloat> in_cpu(in), out_cpu(*out);
+    AddMatParams(i, in_cpu, &out_cpu);
+    out->CopyFromMat(out_cpu);
+    return;
+  }
+#endif
+  AddMatParams(i, in.Mat(), &(out->Mat()));
+}
+
+BaseFloat CompactLinearComponent::PropagateBias(
+    CuMatrixBase<BaseFloat> *out) const {
+  if (bias_params_.Dim() == 0)
+    return 0.0;
+  out->CopyRowsFromVec(bias_params_);
+  return 1.0;
+}
+
+void CompactLinearComponent::PrintParamsStats(std::ostringstream &os) const {
+  int32 num_matrices = NumParamMatrices(),
+      input_dim = InputDim(), output_dim = OutputDim();
+  Matrix<BaseFloat> linear_params(output_dim, input_dim * num_matrices,
+                                  kUndefined);
+  for (int32 i = 0; i < num_matrices; i++) {
+    SubMatrix<BaseFloat> part(linear_params, 0, output_dim,
+                              i * input_dim, input_dim);
+    CopyParamsToMat(i, &part);
+  }
+  PrintParameterStats(os, "linear-params",
+                      CuMatrix<BaseFloat>(linear_params));
+  if (bias_params_.Dim() == 0)
+    os << ", has-bias=false";
+  else
+    PrintParameterStats(os, "bias", bias_params_, true);
+}
+
+void CompactLinearComponent::CheckBias() const {
+  KALDI_ASSERT(OutputDim() > 0 &&
+               (bias_params_.Dim() == 0 || bias_params_.Dim() == OutputDim()));
+}
+
+
+std::string CompactAffineComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info();
+  PrintParamsInfo(stream);
+  PrintParamsStats(stream);
+  return stream.str();
+}
+
+void* CompactAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  BaseFloat beta = PropagateBias(out);
+  AddCuMatParamsTrans(0, in, beta, out);
+  return NULL;
+}
+
+void CompactAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &out_deriv,
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *in_deriv) const {
+  NVTX_RANGE("CompactAffineComponent::Backprop");
+  if (in_deriv != NULL)
+    AddCuMatParams(0, out_deriv, in_deriv);
+}
+
+void CompactAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<" + Type() + ">");
+  WriteToken(os, binary, "<LinearParams>");
+  WriteParams(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</" + Type() + ">");
+}
+
+void CompactAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<" + Type() + ">", "<LinearParams>");
+  ReadParams(is, binary, 1);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</" + Type() + ">");
+  CheckBias();
+}
+
+
+void CompactTdnnComponent::Check() const {
+  KALDI_ASSERT(!time_offsets_.empty() &&
+               std::set<int32>(time_offsets_.begin(),
+                               time_offsets_.end()).size() ==
+               time_offsets_.size());
+  CheckBias();
+}
+
+std::string CompactTdnnComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info();
+  stream << ", time-offsets=";
+  for (size_t i = 0; i < time_offsets_.size(); i++) {
+    if (i != 0) stream << ',';
+    stream << time_offsets_[i];
+  }
+  PrintParamsInfo(stream);
+  PrintParamsStats(stream);
+  return stream.str();
+}
+
+void* CompactTdnnComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes_in,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  const TdnnComponent::PrecomputedIndexes *indexes =
+      dynamic_cast<const TdnnComponent::PrecomputedIndexes*>(indexes_in);
+  KALDI_ASSERT(indexes != NULL &&
+               indexes->row_offsets.size() == time_offsets_.size());
+  BaseFloat beta = PropagateBias(out);
+  for (size_t i = 0; i < time_offsets_.size(); i++) {
+    CuSubMatrix<BaseFloat> in_part = TdnnComponent::GetInputPart(
+        in, out->NumRows(), indexes->row_stride, indexes->row_offsets[i]);
+    AddCuMatParamsTrans(i, in_part, beta, out);
+    beta = 1.0;
+  }
+  return NULL;
+}
+
+void CompactTdnnComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes_in,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &out_deriv,
+    void*, // memo
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *in_deriv) const {
+  NVTX_RANGE("CompactTdnnComponent::Backprop");
+  const TdnnComponent::PrecomputedIndexes *indexes =
+      dynamic_cast<const TdnnComponent::PrecomputedIndexes*>(indexes_in);
+  KALDI_ASSERT(indexes != NULL &&
+               indexes->row_offsets.size() == time_offsets_.size());
+  if (in_deriv == NULL)
+    return;
+  for (size_t i = 0; i < time_offsets_.size(); i++) {
+    CuSubMatrix<BaseFloat> in_deriv_part = TdnnComponent::GetInputPart(
+        *in_deriv, out_deriv.NumRows(), indexes->row_stride,
+        indexes->row_offsets[i]);
+    AddCuMatParams(i, out_deriv, &in_deriv_part);
+  }
+}
+
+void CompactTdnnComponent::GetInputIndexes(
+    const MiscComputationInfo &misc_info,
+    const Index &output_index,
+    std::vector<Index> *desired_indexes) const {
+  KALDI_ASSERT(output_index.t != kNoTime);
+  size_t size = time_offsets_.size();
+  desired_indexes->resize(size);
+  for (size_t i = 0; i < size; i++) {
+    (*desired_indexes)[i].n = output_index.n;
+    (*desired_indexes)[i].t = output_index.t + time_offsets_[i];
+    (*desired_indexes)[i].x = output_index.x;
+  }
+}
+
+bool CompactTdnnComponent::IsComputable(
+    const MiscComputationInfo &misc_info,
+    const Index &output_index,
+    const IndexSet &input_index_set,
+    std::vector<Index> *used_inputs) const {
+  KALDI_ASSERT(output_index.t != kNoTime);
+  size_t size = time_offsets_.size();
+  Index index(output_index);
+  if (used_inputs != NULL) {
+    used_inputs->clear();
+    used_inputs->reserve(size);
+  }
+  for (size_t i = 0; i < size; i++) {
+    index.t = output_index.t + time_offsets_[i];
+    if (input_index_set(index)) {
+      if (used_inputs != NULL)
+        used_inputs->push_back(index);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CompactTdnnComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<" + Type() + ">");
+  WriteToken(os, binary, "<TimeOffsets>");
+  WriteIntegerVector(os, binary, time_offsets_);
+  WriteToken(os, binary, "<LinearParams>");
+  WriteParams(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</" + Type() + ">");
+}
+
+void CompactTdnnComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<" + Type() + ">", "<TimeOffsets>");
+  ReadIntegerVector(is, binary, &time_offsets_);
+  ExpectToken(is, binary, "<LinearParams>");
+  ReadParams(is, binary, time_offsets_.size());
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</" + Type() + ">");
+  Check();
+}
+
+} // namespace nnet3
+} // namespace kaldi
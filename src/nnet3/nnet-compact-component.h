@@ -0,0 +1,224 @@
+// nnet3/nnet-compact-component.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET3_NNET_COMPACT_COMPONENT_H_
+#define KALDI_NNET3_NNET_COMPACT_COMPONENT_H_
+
+#include "nnet3/nnet-common.h"
+#include "nnet3/nnet-component-itf.h"
+#include "nnet3/nnet-convolutional-component.h"
+#include <iostream>
+#include <sstream>
+
+namespace kaldi {
+namespace nnet3 {
+
+/// @file  nnet-compact-component.h
+///
+/// Contains base classes for the inference-only versions of affine-type
+/// components whose parameter matrices are stored in some compact format, for
+/// faster computation on CPU: see nnet-quantized-component.h and
+/// nnet-block-sparse-component.h.  The child classes say how the parameters
+/// are stored and how to multiply by them; the classes here do the rest (the
+/// bias, the indexes, I/O and so on).  The multiplications are always done on
+/// the CPU; if a GPU is in use the data is copied to main memory and back,
+/// which is slow.
+
+
+/**
+   CompactLinearComponent is the common base class of CompactAffineComponent
+   and CompactTdnnComponent.  It has a number of parameter matrices (one per
+   time offset for CompactTdnnComponent), all of dimension OutputDim() by
+   InputDim(), which are stored by the child class, and an optional bias which
+   is stored here as a dense vector.
+ */
+class CompactLinearComponent: public Component {
+ public:
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+
+ protected:
+  CompactLinearComponent() { }
+  explicit CompactLinearComponent(const CuVectorBase<BaseFloat> &bias_params):
+      bias_params_(bias_params) { }
+  CompactLinearComponent(const CompactLinearComponent &other):
+      bias_params_(other.bias_params_) { }
+
+  // The following functions are to be implemented by the child class.
+
+  // Returns the number of parameter matrices.
+  virtual int32 NumParamMatrices() const = 0;
+  // Does out = beta * out + in * params^T, where 'params' is the i'th
+  // parameter matrix.
+  virtual void AddMatParamsTrans(int32 i, const MatrixBase<BaseFloat> &in,
+                                 BaseFloat beta,
+                                 MatrixBase<BaseFloat> *out) const = 0;
+  // Does out += in * params, where 'params' is the i'th parameter matrix.
+  virtual void AddMatParams(int32 i, const MatrixBase<BaseFloat> &in,
+                            MatrixBase<BaseFloat> *out) const = 0;
+  // Copies the i'th parameter matrix to 'dest', which will be of dimension
+  // OutputDim() by InputDim().
+  virtual void CopyParamsToMat(int32 i, MatrixBase<BaseFloat> *dest) const = 0;
+  // Writes the parameter matrices.
+  virtual void WriteParams(std::ostream &os, bool binary) const = 0;
+  // Reads 'num_matrices' parameter matrices, as written by WriteParams().
+  virtual void ReadParams(std::istream &is, bool binary,
+                          int32 num_matrices) = 0;
+  // May be overridden to print things about the storage format in Info().
+  virtual void PrintParamsInfo(std::ostringstream &os) const { }
+
+  // Does out = beta * out + in * params^T, where 'params' is the i'th
+  // parameter matrix, copying the data to and from the CPU if needed.
+  void AddCuMatParamsTrans(int32 i, const CuMatrixBase<BaseFloat> &in,
+                           BaseFloat beta, CuMatrixBase<BaseFloat> *out) const;
+  // Does out += in * params, where 'params' is the i'th parameter matrix,
+  // copying the data to and from the CPU if needed.
+  void AddCuMatParams(int32 i, const CuMatrixBase<BaseFloat> &in,
+                      CuMatrixBase<BaseFloat> *out) const;
+
+  // Does the part of Propagate() that is the same for the child classes:
+  // sets 'out' to the bias (if there is one), and returns the 'beta' to use
+  // for the first call to AddCuMatParamsTrans().
+  BaseFloat PropagateBias(CuMatrixBase<BaseFloat> *out) const;
+
+  // Prints the statistics of the parameters (all the parameter matrices,
+  // appended column-wise) and of the bias, for Info().
+  void PrintParamsStats(std::ostringstream &os) const;
+
+  // Checks the dimension of the bias.
+  void CheckBias() const;
+
+  // The bias; empty if there is no bias.
+  CuVector<BaseFloat> bias_params_;
+};
+
+
+/**
+   CompactAffineComponent is the base class of the compact versions of
+   AffineComponent (or of its child classes such as
+   NaturalGradientAffineComponent, or of FixedAffineComponent or
+   LinearComponent), which have one parameter matrix.
+*/
+class CompactAffineComponent: public CompactLinearComponent {
+ public:
+  virtual std::string Info() const;
+  virtual int32 Properties() const { return kSimpleComponent|kBackpropAdds; }
+
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &, // out_value
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+ protected:
+  CompactAffineComponent() { }
+  explicit CompactAffineComponent(const CuVectorBase<BaseFloat> &bias_params):
+      CompactLinearComponent(bias_params) { }
+  CompactAffineComponent(const CompactAffineComponent &other):
+      CompactLinearComponent(other) { }
+
+  virtual int32 NumParamMatrices() const { return 1; }
+};
+
+
+/**
+   CompactTdnnComponent is the base class of the compact versions of
+   TdnnComponent, which have a parameter matrix for each time offset (the
+   corresponding column range of the TdnnComponent's linear parameters).  It
+   uses the same precomputed indexes as TdnnComponent.
+*/
+class CompactTdnnComponent: public CompactLinearComponent {
+ public:
+  virtual std::string Info() const;
+  virtual int32 Properties() const { return kReordersIndexes|kBackpropAdds; }
+
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  virtual void ReorderIndexes(std::vector<Index> *input_indexes,
+                              std::vector<Index> *output_indexes) const {
+    TdnnComponent::ReorderIndexesInternal(input_indexes, output_indexes);
+  }
+
+  virtual void GetInputIndexes(const MiscComputationInfo &misc_info,
+                               const Index &output_index,
+                               std::vector<Index> *desired_indexes) const;
+
+  virtual bool IsComputable(const MiscComputationInfo &misc_info,
+                            const Index &output_index,
+                            const IndexSet &input_index_set,
+                            std::vector<Index> *used_inputs) const;
+
+  // Note: the precomputed indexes are of type
+  // TdnnComponent::PrecomputedIndexes.
+  virtual ComponentPrecomputedIndexes* PrecomputeIndexes(
+      const MiscComputationInfo &misc_info,
+      const std::vector<Index> &input_indexes,
+      const std::vector<Index> &output_indexes,
+      bool need_backprop) const {
+    return TdnnComponent::PrecomputeIndexesInternal(
+        time_offsets_, input_indexes, output_indexes);
+  }
+
+  const std::vector<int32> &TimeOffsets() const { return time_offsets_; }
+
+ protected:
+  CompactTdnnComponent() { }
+  // Copies the time offsets and the bias from 'tdnn'; the child class
+  // should set up the parameters and then call Check().
+  explicit CompactTdnnComponent(const TdnnComponent &tdnn):
+      CompactLinearComponent(tdnn.BiasParams()),
+      time_offsets_(tdnn.TimeOffsets()) { }
+  CompactTdnnComponent(const CompactTdnnComponent &other):
+      CompactLinearComponent(other), time_offsets_(other.time_offsets_) { }
+
+  virtual int32 NumParamMatrices() const { return time_offsets_.size(); }
+
+  void Check() const;
+
+  std::vector<int32> time_offsets_;
+};
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+
+#endif
@@ -594,6 +594,11 @@ void NnetComputer::GetOutputDestructive(const std::string &node_name,
 }
 
 
+CuMatrixBase<BaseFloat> &NnetComputer::GetMatrix(int32 matrix_index) {
+  KALDI_ASSERT(static_cast<size_t>(matrix_index) < matrices_.size());
+  return matrices_[matrix_index];
+}
+
 void NnetComputer::CheckNoPendingIo() {
   const std::vector<NnetComputation::Command> &c = computation_.commands;
   while (program_counter_ < static_cast<int32>(c.size()) &&
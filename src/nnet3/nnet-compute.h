@@ -124,6 +124,13 @@ class NnetComputer {
   void GetOutputDestructive(const std::string &output_name,
                             CuMatrix<BaseFloat> *output);
 
+  // Returns the matrix with index 'matrix_index' in the computation (see
+  // NnetComputation::matrices); it will be empty if that matrix is not
+  // allocated at this point in the computation.  This is for code that needs
+  // to save and restore the state of a looped computation between chunks, such
+  // as rnnlm::RnnlmBatchComputer.  The matrix may be modified but not resized.
+  CuMatrixBase<BaseFloat> &GetMatrix(int32 matrix_index);
+
 
   ~NnetComputer();
  private:
@@ -552,15 +552,29 @@ class TdnnComponent: public UpdatableComponent {
   };
 
   CuMatrixBase<BaseFloat> &LinearParams() { return linear_params_; }
+  const CuMatrixBase<BaseFloat> &LinearParams() const { return linear_params_; }
 
   // This allows you to resize the vector in order to add a bias where
   // there previously was none-- obviously this should be done carefully.
   CuVector<BaseFloat> &BiasParams() { return bias_params_; }
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+
+  const std::vector<int32> &TimeOffsets() const { return time_offsets_; }
 
   BaseFloat OrthonormalConstraint() const { return orthonormal_constraint_; }
 
   void ConsolidateMemory();
- private:
+
+  // The following static functions do the index-related work of
+  // ReorderIndexes() and PrecomputeIndexes(), which depends only on the time
+  // offsets; they are public so that CompactTdnnComponent (see
+  // nnet-compact-component.h) can share them.
+  static void ReorderIndexesInternal(std::vector<Index> *input_indexes,
+                                     std::vector<Index> *output_indexes);
+  static PrecomputedIndexes *PrecomputeIndexesInternal(
+      const std::vector<int32> &time_offsets,
+      const std::vector<Index> &input_indexes,
+      const std::vector<Index> &output_indexes);
 
   // This static function is a utility function that extracts a CuSubMatrix
   // representing a subset of rows of 'input_matrix'.
@@ -572,6 +586,8 @@ class TdnnComponent: public UpdatableComponent {
       int32 row_stride,
       int32 row_offset);
 
+ private:
+
   // see the definition for more explanation.
   static void ModifyComputationIo(time_height_convolution::ConvolutionComputationIo *io);
 
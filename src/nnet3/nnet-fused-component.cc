@@ -0,0 +1,259 @@
+// nnet3/nnet-fused-component.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <sstream>
+#include "nnet3/nnet-fused-component.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-parse.h"
+#include "matrix/matrix-threading.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Does out = scale * f(out + bias) + offset for rows [begin, end) of 'out',
+// where f is ReLU if apply_relu is true and the identity otherwise; 'bias' is
+// only used if add_bias is true.
+template<bool add_bias, bool apply_relu>
+static void ApplyPostProcessingRows(const BaseFloat *bias,
+                                    const BaseFloat *scale,
+                                    const BaseFloat *offset,
+                                    MatrixIndexT begin, MatrixIndexT end,
+                                    MatrixBase<BaseFloat> *out) {
+  MatrixIndexT num_cols = out->NumCols();
+  for (MatrixIndexT r = begin; r < end; r++) {
+    BaseFloat *row = out->RowData(r);
+    for (MatrixIndexT c = 0; c < num_cols; c++) {
+      BaseFloat x = row[c];
+      if (add_bias) x += bias[c];
+      if (apply_relu) x = std::max(x, BaseFloat(0.0));
+      row[c] = x * scale[c] + offset[c];
+    }
+  }
+}
+
+
+FusedAffineComponent::FusedAffineComponent(
+    const FusedAffineComponent &other):
+    linear_part_(other.linear_part_->Copy()),
+    bias_(other.bias_),
+    apply_relu_(other.apply_relu_),
+    scale_(other.scale_),
+    offset_(other.offset_) { }
+
+FusedAffineComponent::FusedAffineComponent(
+    Component *linear_part,
+    const CuVectorBase<BaseFloat> &bias,
+    bool apply_relu):
+    linear_part_(linear_part),
+    bias_(linear_part->OutputDim()),
+    apply_relu_(apply_relu),
+    scale_(linear_part->OutputDim()),
+    offset_(linear_part->OutputDim()) {
+  if (bias.Dim() != 0)
+    bias_.CopyFromVec(bias);
+  scale_.Set(1.0);
+  Check();
+}
+
+void FusedAffineComponent::Check() const {
+  KALDI_ASSERT(linear_part_ != NULL && OutputDim() > 0 &&
+               bias_.Dim() == OutputDim() &&
+               scale_.Dim() == OutputDim() &&
+               offset_.Dim() == OutputDim());
+}
+
+int32 FusedAffineComponent::Properties() const {
+  // We need the output in Backprop() to know where the ReLU was active.
+  return (linear_part_->Properties() &
+          (kSimpleComponent|kReordersIndexes|kBackpropAdds|
+           kInputContiguous|kOutputContiguous)) | kBackpropNeedsOutput;
+}
+
+std::string FusedAffineComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info()
+         << ", linear-part={" << linear_part_->Info() << "}";
+  PrintParameterStats(stream, "bias", bias_, true);
+  stream << ", apply-relu=" << (apply_relu_ ? "true" : "false");
+  PrintParameterStats(stream, "scale", scale_, true);
+  PrintParameterStats(stream, "offset", offset_, true);
+  return stream.str();
+}
+
+void FusedAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  bool apply_relu = true;
+  cfl->GetValue("apply-relu", &apply_relu);
+  AffineComponent affine;
+  affine.InitFromConfig(cfl);
+  FusedAffineComponent temp(new LinearComponent(affine.LinearParams()),
+                            affine.BiasParams(), apply_relu);
+  std::swap(linear_part_, temp.linear_part_);
+  bias_.Swap(&temp.bias_);
+  apply_relu_ = temp.apply_relu_;
+  scale_.Swap(&temp.scale_);
+  offset_.Swap(&temp.offset_);
+}
+
+void FusedAffineComponent::AddScaleAndOffset(
+    const CuVectorBase<BaseFloat> &scale,
+    const CuVectorBase<BaseFloat> &offset) {
+  int32 dim = OutputDim(), block_dim = scale.Dim();
+  KALDI_ASSERT(block_dim > 0 && dim % block_dim == 0 &&
+               offset.Dim() == block_dim);
+  CuVector<BaseFloat> full_scale(dim, kUndefined), full_offset(dim, kUndefined);
+  for (int32 i = 0; i < dim / block_dim; i++) {
+    full_scale.Range(i * block_dim, block_dim).CopyFromVec(scale);
+    full_offset.Range(i * block_dim, block_dim).CopyFromVec(offset);
+  }
+  // scale2 * (scale1 * x + offset1) + offset2
+  //   = (scale2 * scale1) * x + (scale2 * offset1 + offset2).
+  scale_.MulElements(full_scale);
+  offset_.MulElements(full_scale);
+  offset_.AddVec(1.0, full_offset);
+  if (apply_relu_ && scale_.Min() <= 0.0)
+    KALDI_ERR << "FusedAffineComponent with ReLU requires a positive scale.";
+}
+
+void FusedAffineComponent::SetLinearPart(Component *linear_part) {
+  KALDI_ASSERT(linear_part->InputDim() == InputDim() &&
+               linear_part->OutputDim() == OutputDim());
+  delete linear_part_;
+  linear_part_ = linear_part;
+}
+
+void FusedAffineComponent::ApplyPostProcessing(
+    bool add_bias, CuMatrixBase<BaseFloat> *out) const {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    if (add_bias)
+      out->AddVecToRows(1.0, bias_);
+    if (apply_relu_)
+      out->ApplyFloor(0.0);
+    out->MulColsVec(scale_);
+    out->AddVecToRows(1.0, offset_);
+    return;
+  }
+#endif
+  MatrixBase<BaseFloat> *mat = &(out->Mat());
+  const BaseFloat *bias = bias_.Vec().Data(),
+      *scale = scale_.Vec().Data(),
+      *offset = offset_.Vec().Data();
+  bool apply_relu = apply_relu_;
+  MatrixParallelFor(mat->NumRows(), mat->NumCols(),
+                    [=](MatrixIndexT begin, MatrixIndexT end) {
+    if (add_bias) {
+      if (apply_relu)
+        ApplyPostProcessingRows<true, true>(bias, scale, offset,
+                                            begin, end, mat);
+      else
+        ApplyPostProcessingRows<true, false>(bias, scale, offset,
+                                             begin, end, mat);
+    } else {
+      if (apply_relu)
+        ApplyPostProcessingRows<false, true>(bias, scale, offset,
+                                             begin, end, mat);
+      else
+        ApplyPostProcessingRows<false, false>(bias, scale, offset,
+                                              begin, end, mat);
+    }
+  });
+}
+
+void* FusedAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  // If the linear part adds to its output we initialize the output with the
+  // bias, which saves a pass over the data compared with zeroing it and
+  // adding the bias later.
+  bool linear_part_adds = (linear_part_->Properties() & kPropagateAdds) != 0;
+  if (linear_part_adds)
+    out->CopyRowsFromVec(bias_);
+  void *memo = linear_part_->Propagate(indexes, in, out);
+  KALDI_ASSERT(memo == NULL);
+  ApplyPostProcessing(!linear_part_adds, out);
+  return NULL;
+}
+
+void FusedAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in_value,
+    const CuMatrixBase<BaseFloat> &out_value,
+    const CuMatrixBase<BaseFloat> &out_deriv,
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *in_deriv) const {
+  NVTX_RANGE("FusedAffineComponent::Backprop");
+  if (in_deriv == NULL)
+    return;
+  // 'linear_deriv' is the derivative w.r.t. the output of the linear part.
+  CuMatrix<BaseFloat> linear_deriv(out_deriv.NumRows(), out_deriv.NumCols(),
+                                   kUndefined);
+  if (apply_relu_) {
+    // Since the scale is positive, the ReLU was active where
+    // out_value > offset.
+    linear_deriv.CopyFromMat(out_value);
+    linear_deriv.AddVecToRows(-1.0, offset_);
+    linear_deriv.ApplyHeaviside();
+    linear_deriv.MulElements(out_deriv);
+  } else {
+    linear_deriv.CopyFromMat(out_deriv);
+  }
+  linear_deriv.MulColsVec(scale_);
+  linear_part_->Backprop(debug_info, indexes, in_value, out_value,
+                         linear_deriv, NULL, NULL, in_deriv);
+}
+
+void FusedAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<FusedAffineComponent>");
+  WriteToken(os, binary, "<LinearPart>");
+  linear_part_->Write(os, binary);
+  WriteToken(os, binary, "<Bias>");
+  bias_.Write(os, binary);
+  WriteToken(os, binary, "<ApplyRelu>");
+  WriteBasicType(os, binary, apply_relu_);
+  WriteToken(os, binary, "<Scale>");
+  scale_.Write(os, binary);
+  WriteToken(os, binary, "<Offset>");
+  offset_.Write(os, binary);
+  WriteToken(os, binary, "</FusedAffineComponent>");
+}
+
+void FusedAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<FusedAffineComponent>", "<LinearPart>");
+  delete linear_part_;
+  linear_part_ = ReadNew(is, binary);
+  ExpectToken(is, binary, "<Bias>");
+  bias_.Read(is, binary);
+  ExpectToken(is, binary, "<ApplyRelu>");
+  ReadBasicType(is, binary, &apply_relu_);
+  ExpectToken(is, binary, "<Scale>");
+  scale_.Read(is, binary);
+  ExpectToken(is, binary, "<Offset>");
+  offset_.Read(is, binary);
+  ExpectToken(is, binary, "</FusedAffineComponent>");
+  Check();
+}
+
+
+} // namespace nnet3
+} // namespace kaldi
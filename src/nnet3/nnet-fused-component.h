@@ -0,0 +1,172 @@
+// nnet3/nnet-fused-component.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#ifndef KALDI_NNET3_NNET_FUSED_COMPONENT_H_
+#define KALDI_NNET3_NNET_FUSED_COMPONENT_H_
+
+#include "nnet3/nnet-common.h"
+#include "nnet3/nnet-component-itf.h"
+#include <iostream>
+
+namespace kaldi {
+namespace nnet3 {
+
+/// @file  nnet-fused-component.h
+///
+/// Contains FusedAffineComponent, which is used at test time to do the work of
+/// an affine-type component and the element-wise components that follow it
+/// (such as ReLU and batch-norm) in one step.
+
+
+/**
+   FusedAffineComponent computes
+
+     y = scale * f(W x + b) + offset
+
+   where W x is computed by a 'linear part' (a LinearComponent, TdnnComponent
+   without bias, or the quantized versions QuantizedAffineComponent and
+   QuantizedTdnnComponent), b is a bias, f is the ReLU function if
+   apply-relu=true and the identity otherwise, and 'scale' and 'offset' are
+   per-dimension (as for a batch-norm component in test mode).
+
+   This is not something you would put in a config file: these components are
+   created by CollapseModel() (see nnet-utils.h) at test time, from sequences
+   like TdnnComponent -> RectifiedLinearComponent -> BatchNormComponent ->
+   GeneralDropoutComponent that appear in TDNN-F networks.  The point is that
+   the bias, the nonlinearity and the scale and offset are applied in a single
+   pass over the output of the matrix multiplication, instead of each
+   component writing its own output matrix.  For testing purposes it may be
+   initialized from a config line, which accepts the same values as
+   AffineComponent plus 'apply-relu' (default: true); the scale and offset are
+   then 1 and 0.
+
+   The component is not updatable.  Backprop() is supported (for the
+   derivative w.r.t. the input only).
+*/
+class FusedAffineComponent: public Component {
+ public:
+  FusedAffineComponent(): linear_part_(NULL), apply_relu_(false) { }
+
+  FusedAffineComponent(const FusedAffineComponent &other);
+
+  /// Constructor.  Takes ownership of 'linear_part', which must not add a
+  /// bias of its own (this is not checked); 'bias' may be empty, meaning
+  /// zero.  The scale and offset are set to 1 and 0; see
+  /// AddScaleAndOffset().
+  FusedAffineComponent(Component *linear_part,
+                       const CuVectorBase<BaseFloat> &bias,
+                       bool apply_relu);
+
+  virtual int32 InputDim() const { return linear_part_->InputDim(); }
+  virtual int32 OutputDim() const { return linear_part_->OutputDim(); }
+  virtual std::string Info() const;
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual std::string Type() const { return "FusedAffineComponent"; }
+  virtual int32 Properties() const;
+
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const { return new FusedAffineComponent(*this); }
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  // The following functions are forwarded to the linear part, which may be
+  // a TdnnComponent (or its quantized version) that is not simple.
+  virtual void GetInputIndexes(const MiscComputationInfo &misc_info,
+                               const Index &output_index,
+                               std::vector<Index> *desired_indexes) const {
+    linear_part_->GetInputIndexes(misc_info, output_index, desired_indexes);
+  }
+  virtual bool IsComputable(const MiscComputationInfo &misc_info,
+                            const Index &output_index,
+                            const IndexSet &input_index_set,
+                            std::vector<Index> *used_inputs) const {
+    return linear_part_->IsComputable(misc_info, output_index,
+                                      input_index_set, used_inputs);
+  }
+  virtual void ReorderIndexes(std::vector<Index> *input_indexes,
+                              std::vector<Index> *output_indexes) const {
+    linear_part_->ReorderIndexes(input_indexes, output_indexes);
+  }
+  virtual ComponentPrecomputedIndexes* PrecomputeIndexes(
+      const MiscComputationInfo &misc_info,
+      const std::vector<Index> &input_indexes,
+      const std::vector<Index> &output_indexes,
+      bool need_backprop) const {
+    return linear_part_->PrecomputeIndexes(misc_info, input_indexes,
+                                           output_indexes, need_backprop);
+  }
+
+  /// Modifies the component so that its output is followed by the
+  /// transform y -> scale * y + offset.  If apply-relu is true, 'scale' must
+  /// be positive (so that Backprop() can work out where the ReLU was
+  /// active).  The dimension of 'scale' and 'offset' may be a divisor of
+  /// OutputDim(), in which case they are repeated (as for batch-norm
+  /// components with block-dim < dim).
+  void AddScaleAndOffset(const CuVectorBase<BaseFloat> &scale,
+                         const CuVectorBase<BaseFloat> &offset);
+
+  const Component &LinearPart() const { return *linear_part_; }
+  /// Replaces the linear part (e.g. with a quantized version of it); takes
+  /// ownership of 'linear_part', which must have the same dimensions.
+  void SetLinearPart(Component *linear_part);
+
+  const CuVector<BaseFloat> &Bias() const { return bias_; }
+  bool ApplyRelu() const { return apply_relu_; }
+  const CuVector<BaseFloat> &OutputScale() const { return scale_; }
+  const CuVector<BaseFloat> &OutputOffset() const { return offset_; }
+
+  virtual ~FusedAffineComponent() { delete linear_part_; }
+
+ private:
+  void Check() const;
+
+  // Applies the bias (if add_bias is true), the ReLU (if apply_relu_ is true)
+  // and the scale and offset to 'out', in a single pass over it if we are
+  // using the CPU.
+  void ApplyPostProcessing(bool add_bias,
+                           CuMatrixBase<BaseFloat> *out) const;
+
+  Component *linear_part_;
+  CuVector<BaseFloat> bias_;
+  bool apply_relu_;
+  CuVector<BaseFloat> scale_;
+  CuVector<BaseFloat> offset_;
+
+  FusedAffineComponent &operator= (const FusedAffineComponent &other);
+};
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+
+#endif
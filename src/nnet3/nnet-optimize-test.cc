@@ -23,6 +23,7 @@
 #include "nnet3/nnet-test-utils.h"
 #include "nnet3/nnet-optimize.h"
 #include "nnet3/nnet-compute.h"
+#include "nnet3/nnet-utils.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -300,6 +301,66 @@ static void UnitTestNnetOptimize() {
   }
 }
 
+// This tests that computations are written to and read back from the file
+// given by the cache_filename option, and that a cache file written for a
+// different network is not used.
+static void UnitTestComputationCacheFile() {
+  std::string filename = "tmp.computation_cache";
+  std::remove(filename.c_str());
+
+  NnetGenerationOptions gen_config;
+  std::vector<std::string> configs;
+  GenerateConfigSequence(gen_config, &configs);
+  Nnet nnet;
+  for (size_t j = 0; j < configs.size(); j++) {
+    std::istringstream is(configs[j]);
+    nnet.ReadConfig(is);
+  }
+  ComputationRequest request;
+  std::vector<Matrix<BaseFloat> > inputs;
+  ComputeExampleComputationRequestSimple(nnet, &request, &inputs);
+
+  NnetOptimizeOptions opt_config;
+  CachingOptimizingCompilerOptions compiler_config;
+  compiler_config.cache_filename = filename;
+  std::string computation_str;
+  {
+    CachingOptimizingCompiler compiler(nnet, opt_config, compiler_config);
+    std::ostringstream os;
+    compiler.Compile(request)->Print(os, nnet);
+    computation_str = os.str();
+    // the destructor writes the cache.
+  }
+  {
+    CachingOptimizingCompiler compiler(nnet, opt_config);
+    KALDI_ASSERT(compiler.ReadCacheFile(filename));
+    std::ostringstream os;
+    compiler.Compile(request)->Print(os, nnet);
+    KALDI_ASSERT(os.str() == computation_str);
+  }
+  {
+    // Changing the structure of the network invalidates the cache.
+    Nnet nnet2(nnet);
+    for (int32 n = 0; n < nnet2.NumNodes(); n++) {
+      if (nnet2.IsComponentNode(n)) {
+        nnet2.SetNodeName(n, nnet2.GetNodeName(n) + "-renamed");
+        break;
+      }
+    }
+    KALDI_ASSERT(NnetStructureHash(nnet2) != NnetStructureHash(nnet));
+    CachingOptimizingCompiler compiler(nnet2, opt_config);
+    KALDI_ASSERT(!compiler.ReadCacheFile(filename));
+  }
+  {
+    // ... and so does changing the optimization options.
+    NnetOptimizeOptions opt_config2;
+    opt_config2.optimize_row_ops = false;
+    CachingOptimizingCompiler compiler(nnet, opt_config2);
+    KALDI_ASSERT(!compiler.ReadCacheFile(filename));
+  }
+  std::remove(filename.c_str());
+}
+
 
 
 } // namespace nnet3
@@ -317,6 +378,7 @@ int main() {
   CuDevice::Instantiate().SelectGpuId("yes");
 #endif
   UnitTestNnetOptimize();
+  UnitTestComputationCacheFile();
 
   KALDI_LOG << "Nnet tests succeeded.";
 
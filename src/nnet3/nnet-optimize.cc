@@ -18,6 +18,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fstream>
 #include <iomanip>
 #include "nnet3/nnet-optimize.h"
 #include "nnet3/nnet-optimize-utils.h"
@@ -640,7 +641,11 @@ CachingOptimizingCompiler::CachingOptimizingCompiler(
     seconds_taken_optimize_(0.0), seconds_taken_expand_(0.0),
     seconds_taken_check_(0.0), seconds_taken_indexes_(0.0),
     seconds_taken_io_(0.0), cache_(config.cache_capacity),
-    nnet_left_context_(-1), nnet_right_context_(-1) { }
+    cache_modified_(false),
+    nnet_left_context_(-1), nnet_right_context_(-1) {
+  if (!config_.cache_filename.empty())
+    ReadCacheFile(config_.cache_filename);
+}
 
 CachingOptimizingCompiler::CachingOptimizingCompiler(
     const Nnet &nnet,
@@ -651,7 +656,11 @@ CachingOptimizingCompiler::CachingOptimizingCompiler(
     seconds_taken_optimize_(0.0), seconds_taken_expand_(0.0),
     seconds_taken_check_(0.0), seconds_taken_indexes_(0.0),
     seconds_taken_io_(0.0), cache_(config.cache_capacity),
-    nnet_left_context_(-1), nnet_right_context_(-1) { }
+    cache_modified_(false),
+    nnet_left_context_(-1), nnet_right_context_(-1) {
+  if (!config_.cache_filename.empty())
+    ReadCacheFile(config_.cache_filename);
+}
 
 void CachingOptimizingCompiler::GetSimpleNnetContext(
     int32 *nnet_left_context, int32 *nnet_right_context) {
@@ -692,7 +701,79 @@ void CachingOptimizingCompiler::WriteCache(std::ostream &os, bool binary) {
   seconds_taken_io_ += timer.Elapsed();
 }
 
+bool CachingOptimizingCompiler::ReadCacheFile(const std::string &filename) {
+  std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+  if (!is.is_open()) {
+    KALDI_LOG << "Computation cache " << filename << " does not exist yet; "
+              << "it will be created.";
+    return false;
+  }
+  Timer timer;
+  try {
+    bool binary;
+    if (!InitKaldiInputStream(is, &binary))
+      KALDI_ERR << "Could not initialize stream";
+    uint64 structure_hash;
+    ExpectToken(is, binary, "<NnetComputationCache>");
+    ExpectToken(is, binary, "<StructureHash>");
+    ReadBasicType(is, binary, &structure_hash);
+    if (structure_hash != NnetStructureHash(nnet_)) {
+      KALDI_WARN << "Not using computation cache " << filename
+                 << " because it was written for a different neural net; "
+                 << "it will be overwritten.";
+      return false;
+    }
+    NnetOptimizeOptions opt_config_cached;
+    opt_config_cached.Read(is, binary);
+    if (!(opt_config_ == opt_config_cached)) {
+      KALDI_WARN << "Not using computation cache " << filename
+                 << " because it was written with different optimization "
+                 << "options; it will be overwritten.";
+      return false;
+    }
+    cache_.Read(is, binary);
+    ExpectToken(is, binary, "</NnetComputationCache>");
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Error reading computation cache " << filename
+               << " (will recompile): " << e.what();
+    return false;
+  }
+  seconds_taken_io_ += timer.Elapsed();
+  KALDI_LOG << "Read computation cache from " << filename;
+  if (GetVerboseLevel() >= 2) {
+    Timer timer;
+    cache_.Check(nnet_);
+    seconds_taken_check_ += timer.Elapsed();
+  }
+  return true;
+}
+
+void CachingOptimizingCompiler::WriteCacheFile(const std::string &filename) {
+  Timer timer;
+  bool binary = true;
+  CacheFileOutput ko(filename);
+  WriteToken(ko.Stream(), binary, "<NnetComputationCache>");
+  WriteToken(ko.Stream(), binary, "<StructureHash>");
+  WriteBasicType(ko.Stream(), binary, NnetStructureHash(nnet_));
+  opt_config_.Write(ko.Stream(), binary);
+  cache_.Write(ko.Stream(), binary);
+  WriteToken(ko.Stream(), binary, "</NnetComputationCache>");
+  ko.Close();
+  seconds_taken_io_ += timer.Elapsed();
+  KALDI_LOG << "Wrote computation cache to " << filename;
+}
+
 CachingOptimizingCompiler::~CachingOptimizingCompiler() {
+  if (!config_.cache_filename.empty() && cache_modified_) {
+    try {
+      WriteCacheFile(config_.cache_filename);
+    } catch (const std::exception &e) {
+      // Don't let an exception escape from the destructor; failing to write
+      // the cache should not make the program fail.
+      KALDI_WARN << "Error writing computation cache "
+                 << config_.cache_filename << ": " << e.what();
+    }
+  }
   if (seconds_taken_total_ > 0.0 || seconds_taken_io_ > 0.0) {
     std::ostringstream os;
     double seconds_taken_misc = seconds_taken_total_ - seconds_taken_compile_
@@ -733,6 +814,7 @@ std::shared_ptr<const NnetComputation> CachingOptimizingCompiler::CompileInterna
     if (computation == NULL)
       computation = CompileNoShortcut(request);
     KALDI_ASSERT(computation != NULL);
+    cache_modified_ = true;
     return cache_.Insert(request, computation);
   }
 }
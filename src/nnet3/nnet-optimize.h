@@ -21,6 +21,7 @@
 #ifndef KALDI_NNET3_NNET_OPTIMIZE_H_
 #define KALDI_NNET3_NNET_OPTIMIZE_H_
 
+#include <atomic>
 #include "nnet3/nnet-compile.h"
 #include "nnet3/nnet-analyze.h"
 #include "nnet3/nnet-optimize-utils.h"
@@ -192,6 +193,14 @@ void Optimize(const NnetOptimizeOptions &config,
 struct CachingOptimizingCompilerOptions {
   bool use_shortcut;
   int32 cache_capacity;
+  // If nonempty, the name of a file that the compiled computations are read
+  // from when the CachingOptimizingCompiler is constructed, and written to
+  // (if anything new was compiled) when it is destroyed.  It is not registered
+  // by Register() below, as the training programs have their own options for
+  // this (--read-cache and --write-cache); it is registered as
+  // --computation-cache by NnetSimpleComputationOptions, for the decoding
+  // programs.
+  std::string cache_filename;
 
   CachingOptimizingCompilerOptions():
       use_shortcut(true),
@@ -242,6 +251,23 @@ class CachingOptimizingCompiler {
   void ReadCache(std::istream &is, bool binary);
   void WriteCache(std::ostream &os, bool binary);
 
+  /// Reads the computations from the file 'filename', which should have been
+  /// written by WriteCacheFile(), if it exists.  Unlike ReadCache(), this checks
+  /// that the file was written for a network with the same structure (see
+  /// NnetStructureHash()) and does not fail if it wasn't, or if the file is
+  /// unreadable: it just prints a warning and leaves the cache as it was.
+  /// Returns true if the computations were read.  This is called from the
+  /// constructor if config.cache_filename is set.
+  bool ReadCacheFile(const std::string &filename);
+
+  /// Writes the computations to the file 'filename', together with the hash
+  /// of the network structure.  The file is written under a temporary name
+  /// and then renamed, so that other processes that are reading it at the
+  /// same time (e.g. other jobs of a parallel decoding run) never see a
+  /// partially written file.  This is called from the destructor if
+  /// config.cache_filename is set and something new was compiled.
+  void WriteCacheFile(const std::string &filename);
+
 
   // GetSimpleNnetContext() is equivalent to calling:
   // ComputeSimpleNnetContext(nnet_, &nnet_left_context,
@@ -301,6 +327,10 @@ class CachingOptimizingCompiler {
 
   ComputationCache cache_;
 
+  // True if any computation has been compiled and added to cache_ since it was
+  // read from config_.cache_filename, i.e. if we need to write it back.
+  std::atomic<bool> cache_modified_;
+
   // These following two variables are only used by the function GetSimpleNnetContext().
   int32 nnet_left_context_;
   int32 nnet_right_context_;
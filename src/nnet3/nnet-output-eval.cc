@@ -0,0 +1,127 @@
+// nnet3/nnet-output-eval.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nnet3/nnet-output-eval.h"
+#include "base/timer.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+
+int64 ReadNnetEvalUtterances(const std::string &feature_rspecifier,
+                             const std::string &ivector_rspecifier,
+                             const std::string &online_ivector_rspecifier,
+                             const std::string &utt2spk_rspecifier,
+                             std::vector<NnetEvalUtterance*> *utts) {
+  SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+  RandomAccessBaseFloatMatrixReader online_ivector_reader(
+      online_ivector_rspecifier);
+  RandomAccessBaseFloatVectorReaderMapped ivector_reader(
+      ivector_rspecifier, utt2spk_rspecifier);
+  int64 num_frames = 0;
+  for (; !feature_reader.Done(); feature_reader.Next()) {
+    std::string utt = feature_reader.Key();
+    if (feature_reader.Value().NumRows() == 0) {
+      KALDI_WARN << "Zero-length utterance: " << utt;
+      continue;
+    }
+    NnetEvalUtterance *info = new NnetEvalUtterance();
+    info->features = feature_reader.Value();
+    if (!ivector_rspecifier.empty()) {
+      if (!ivector_reader.HasKey(utt)) {
+        KALDI_WARN << "No iVector available for utterance " << utt;
+        delete info;
+        continue;
+      }
+      info->ivector = ivector_reader.Value(utt);
+    }
+    if (!online_ivector_rspecifier.empty()) {
+      if (!online_ivector_reader.HasKey(utt)) {
+        KALDI_WARN << "No online iVector available for utterance " << utt;
+        delete info;
+        continue;
+      }
+      info->online_ivectors = online_ivector_reader.Value(utt);
+    }
+    num_frames += info->features.NumRows();
+    utts->push_back(info);
+  }
+  return num_frames;
+}
+
+void ComputeNnetOutput(const NnetSimpleComputationOptions &opts,
+                       const Nnet &nnet,
+                       int32 online_ivector_period,
+                       const NnetEvalUtterance &utt,
+                       CachingOptimizingCompiler *compiler,
+                       Matrix<BaseFloat> *output) {
+  Vector<BaseFloat> priors;
+  DecodableNnetSimple nnet_computer(
+      opts, nnet, priors, utt.features, compiler,
+      (utt.ivector.Dim() != 0 ? &utt.ivector : NULL),
+      (utt.online_ivectors.NumRows() != 0 ? &utt.online_ivectors : NULL),
+      online_ivector_period);
+  output->Resize(nnet_computer.NumFrames(), nnet_computer.OutputDim());
+  for (int32 t = 0; t < nnet_computer.NumFrames(); t++) {
+    SubVector<BaseFloat> row(*output, t);
+    nnet_computer.GetOutputForFrame(t, &row);
+  }
+}
+
+double EvaluateNnetOutput(const NnetSimpleComputationOptions &opts,
+                          const Nnet &nnet,
+                          int32 online_ivector_period,
+                          bool set_output,
+                          const std::vector<NnetEvalUtterance*> &utts,
+                          BaseFloat *relative_change) {
+  KALDI_ASSERT(!utts.empty());
+  CachingOptimizingCompiler compiler(nnet, opts.optimize_config,
+                                     opts.compiler_config);
+  // Compute the first utterance once before we start the timer, so that the
+  // time taken to compile the computation is mostly not included (the output
+  // is computed in fixed-size chunks, so the computations are reused).
+  Matrix<BaseFloat> output;
+  ComputeNnetOutput(opts, nnet, online_ivector_period, *(utts[0]), &compiler,
+                    &output);
+  double diff_sumsq = 0.0, ref_sumsq = 0.0;
+  Timer timer;
+  double elapsed = 0.0;
+  for (size_t i = 0; i < utts.size(); i++) {
+    timer.Reset();
+    ComputeNnetOutput(opts, nnet, online_ivector_period, *(utts[i]),
+                      &compiler, &output);
+    elapsed += timer.Elapsed();
+    if (set_output) {
+      utts[i]->output.Swap(&output);
+    } else {
+      ref_sumsq += TraceMatMat(utts[i]->output, utts[i]->output, kTrans);
+      output.AddMat(-1.0, utts[i]->output);
+      diff_sumsq += TraceMatMat(output, output, kTrans);
+    }
+  }
+  if (!set_output && relative_change != NULL)
+    *relative_change = (ref_sumsq > 0.0 ? std::sqrt(diff_sumsq / ref_sumsq) :
+                        0.0);
+  return elapsed;
+}
+
+
+} // namespace nnet3
+} // namespace kaldi
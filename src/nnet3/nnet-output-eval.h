@@ -0,0 +1,90 @@
+// nnet3/nnet-output-eval.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_NNET_OUTPUT_EVAL_H_
+#define KALDI_NNET3_NNET_OUTPUT_EVAL_H_
+
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "nnet3/nnet-am-decodable-simple.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+/// @file  nnet-output-eval.h
+///
+/// Contains utilities used by programs such as nnet3-quantize and nnet3-prune
+/// that modify a network for faster inference, to measure how much the
+/// modification changes the output of the network on some data, and how long
+/// the computation takes.
+
+
+/// An utterance on which we compare the output of a modified network with
+/// that of the original network.
+struct NnetEvalUtterance {
+  Matrix<BaseFloat> features;
+  Vector<BaseFloat> ivector;  // empty if not used.
+  Matrix<BaseFloat> online_ivectors;  // empty if not used.
+  Matrix<BaseFloat> output;  // output of the original network.
+};
+
+
+/// Reads the features from 'feature_rspecifier', together with the iVectors
+/// from 'ivector_rspecifier' (per speaker if 'utt2spk_rspecifier' is
+/// nonempty) or 'online_ivector_rspecifier' if these are nonempty, and
+/// appends them to 'utts' (the caller should delete them, e.g. with
+/// DeletePointers()).  Utterances that are empty or for which the iVectors are
+/// missing are skipped with a warning.  Their 'output' is not set.  Returns
+/// the total number of frames read.
+int64 ReadNnetEvalUtterances(const std::string &feature_rspecifier,
+                             const std::string &ivector_rspecifier,
+                             const std::string &online_ivector_rspecifier,
+                             const std::string &utt2spk_rspecifier,
+                             std::vector<NnetEvalUtterance*> *utts);
+
+/// Computes the output of 'nnet' on the utterance 'utt' (as the decoding
+/// programs would, i.e. in chunks as specified by 'opts'), and puts it in
+/// 'output'.
+void ComputeNnetOutput(const NnetSimpleComputationOptions &opts,
+                       const Nnet &nnet,
+                       int32 online_ivector_period,
+                       const NnetEvalUtterance &utt,
+                       CachingOptimizingCompiler *compiler,
+                       Matrix<BaseFloat> *output);
+
+/// Computes the output of 'nnet' (which should already have been prepared for
+/// test) on all the utterances in 'utts', which must be nonempty, and returns
+/// the time taken in seconds, not including the time taken to compile the
+/// computation.  If 'set_output' is true, the output is stored in the
+/// utterances; otherwise, if 'relative_change' is not NULL, it is set to the
+/// relative change in the output versus the stored output, measured as
+/// ||output - ref_output||_F / ||ref_output||_F over all the utterances.
+double EvaluateNnetOutput(const NnetSimpleComputationOptions &opts,
+                          const Nnet &nnet,
+                          int32 online_ivector_period,
+                          bool set_output,
+                          const std::vector<NnetEvalUtterance*> &utts,
+                          BaseFloat *relative_change);
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+#endif // KALDI_NNET3_NNET_OUTPUT_EVAL_H_
@@ -0,0 +1,152 @@
+// nnet3/nnet-quantized-component.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nnet3/nnet-quantized-component.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Returns the values represented by 'params' as a Matrix.
+static void DequantizeMatrix(const QuantizedMatrix &params,
+                             Matrix<BaseFloat> *dest) {
+  dest->Resize(params.NumRows(), params.NumCols(), kUndefined);
+  params.CopyToMat(dest);
+}
+
+
+QuantizedAffineComponent::QuantizedAffineComponent(
+    const QuantizedAffineComponent &other):
+    CompactAffineComponent(other),
+    linear_params_(other.linear_params_) { }
+
+QuantizedAffineComponent::QuantizedAffineComponent(
+    const CuMatrixBase<BaseFloat> &linear_params,
+    const CuVectorBase<BaseFloat> &bias_params):
+    CompactAffineComponent(bias_params) {
+  KALDI_ASSERT(linear_params.NumRows() > 0 &&
+               (bias_params.Dim() == 0 ||
+                bias_params.Dim() == linear_params.NumRows()));
+  Matrix<BaseFloat> linear_params_cpu(linear_params);
+  linear_params_.CopyFromMat(linear_params_cpu);
+}
+
+void QuantizedAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  AffineComponent affine;
+  affine.InitFromConfig(cfl);
+  QuantizedAffineComponent temp(affine.LinearParams(), affine.BiasParams());
+  linear_params_.Swap(&temp.linear_params_);
+  bias_params_.Swap(&temp.bias_params_);
+}
+
+void QuantizedAffineComponent::AddMatParamsTrans(
+    int32 i, const MatrixBase<BaseFloat> &in, BaseFloat beta,
+    MatrixBase<BaseFloat> *out) const {
+  AddMatQuantizedMatTrans(in, linear_params_, beta, out);
+}
+
+void QuantizedAffineComponent::AddMatParams(
+    int32 i, const MatrixBase<BaseFloat> &in,
+    MatrixBase<BaseFloat> *out) const {
+  Matrix<BaseFloat> linear_params;
+  DequantizeMatrix(linear_params_, &linear_params);
+  out->AddMatMat(1.0, in, kNoTrans, linear_params, kNoTrans, 1.0);
+}
+
+void QuantizedAffineComponent::CopyParamsToMat(
+    int32 i, MatrixBase<BaseFloat> *dest) const {
+  linear_params_.CopyToMat(dest);
+}
+
+void QuantizedAffineComponent::WriteParams(std::ostream &os,
+                                           bool binary) const {
+  linear_params_.Write(os, binary);
+}
+
+void QuantizedAffineComponent::ReadParams(std::istream &is, bool binary,
+                                          int32 num_matrices) {
+  KALDI_ASSERT(num_matrices == 1);
+  linear_params_.Read(is, binary);
+}
+
+
+QuantizedTdnnComponent::QuantizedTdnnComponent(
+    const QuantizedTdnnComponent &other):
+    CompactTdnnComponent(other),
+    linear_params_(other.linear_params_) { }
+
+QuantizedTdnnComponent::QuantizedTdnnComponent(const TdnnComponent &tdnn):
+    CompactTdnnComponent(tdnn),
+    linear_params_(tdnn.TimeOffsets().size()) {
+  Matrix<BaseFloat> linear_params(tdnn.LinearParams());
+  int32 input_dim = tdnn.InputDim();
+  for (size_t i = 0; i < time_offsets_.size(); i++) {
+    SubMatrix<BaseFloat> part(linear_params, 0, linear_params.NumRows(),
+                              i * input_dim, input_dim);
+    linear_params_[i].CopyFromMat(part);
+  }
+  Check();
+}
+
+void QuantizedTdnnComponent::InitFromConfig(ConfigLine *cfl) {
+  TdnnComponent tdnn;
+  tdnn.InitFromConfig(cfl);
+  QuantizedTdnnComponent temp(tdnn);
+  time_offsets_.swap(temp.time_offsets_);
+  linear_params_.swap(temp.linear_params_);
+  bias_params_.Swap(&temp.bias_params_);
+}
+
+void QuantizedTdnnComponent::AddMatParamsTrans(
+    int32 i, const MatrixBase<BaseFloat> &in, BaseFloat beta,
+    MatrixBase<BaseFloat> *out) const {
+  AddMatQuantizedMatTrans(in, linear_params_[i], beta, out);
+}
+
+void QuantizedTdnnComponent::AddMatParams(
+    int32 i, const MatrixBase<BaseFloat> &in,
+    MatrixBase<BaseFloat> *out) const {
+  Matrix<BaseFloat> linear_params;
+  DequantizeMatrix(linear_params_[i], &linear_params);
+  out->AddMatMat(1.0, in, kNoTrans, linear_params, kNoTrans, 1.0);
+}
+
+void QuantizedTdnnComponent::CopyParamsToMat(
+    int32 i, MatrixBase<BaseFloat> *dest) const {
+  linear_params_[i].CopyToMat(dest);
+}
+
+void QuantizedTdnnComponent::WriteParams(std::ostream &os,
+                                         bool binary) const {
+  for (size_t i = 0; i < linear_params_.size(); i++)
+    linear_params_[i].Write(os, binary);
+}
+
+void QuantizedTdnnComponent::ReadParams(std::istream &is, bool binary,
+                                        int32 num_matrices) {
+  linear_params_.resize(num_matrices);
+  for (size_t i = 0; i < linear_params_.size(); i++) {
+    linear_params_[i].Read(is, binary);
+    KALDI_ASSERT(linear_params_[i].NumRows() == OutputDim() &&
+                 linear_params_[i].NumCols() == InputDim());
+  }
+}
+
+} // namespace nnet3
+} // namespace kaldi
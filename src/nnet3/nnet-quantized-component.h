@@ -0,0 +1,155 @@
+// nnet3/nnet-quantized-component.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET3_NNET_QUANTIZED_COMPONENT_H_
+#define KALDI_NNET3_NNET_QUANTIZED_COMPONENT_H_
+
+#include "nnet3/nnet-common.h"
+#include "nnet3/nnet-component-itf.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-compact-component.h"
+#include "matrix/quantized-matrix.h"
+#include <iostream>
+
+namespace kaldi {
+namespace nnet3 {
+
+/// @file  nnet-quantized-component.h
+///
+/// Contains components that are 8-bit quantized versions of affine-type
+/// components, for faster inference on CPU.  Their parameter matrices are
+/// stored as class QuantizedMatrix (one byte per element plus a scale per
+/// row), and in Propagate() the rows of the input are quantized on the fly and
+/// the matrix product is done with integer arithmetic; see
+/// AddMatQuantizedMatTrans() in ../matrix/quantized-matrix.h for the
+/// details, including which instruction sets this is fast for.
+///
+/// These components are not updatable, and are normally created from trained
+/// models by QuantizeNnet() (see nnet-utils.h), e.g. via the program
+/// nnet3-quantize or the --quantize option of the decoding programs.  Most of
+/// their work is done by the base classes in nnet-compact-component.h; in
+/// particular the integer computation is always done on the CPU.  Backprop() is
+/// supported (it uses the quantized parameters, but does not quantize
+/// anything else) so that these can be used as fixed layers in training, but
+/// that is not what they are intended for.
+
+
+/**
+   QuantizedAffineComponent is a quantized version of AffineComponent (or of
+   its child classes such as NaturalGradientAffineComponent, or of
+   FixedAffineComponent or LinearComponent).  The bias is optional, and is not
+   quantized.
+
+   This is normally created by QuantizeNnet().  For testing purposes it may be
+   initialized from a config line, which accepts the same values as
+   AffineComponent, e.g. "input-dim=100 output-dim=200"; the result is the
+   quantized version of the AffineComponent that would be initialized.
+*/
+class QuantizedAffineComponent: public CompactAffineComponent {
+ public:
+  QuantizedAffineComponent() { }
+
+  QuantizedAffineComponent(const QuantizedAffineComponent &other);
+
+  /// Initializes from unquantized parameters; 'bias_params' may be empty,
+  /// meaning there is no bias.
+  QuantizedAffineComponent(const CuMatrixBase<BaseFloat> &linear_params,
+                           const CuVectorBase<BaseFloat> &bias_params);
+
+  virtual int32 InputDim() const { return linear_params_.NumCols(); }
+  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual std::string Type() const { return "QuantizedAffineComponent"; }
+
+  virtual Component* Copy() const {
+    return new QuantizedAffineComponent(*this);
+  }
+
+  const QuantizedMatrix &LinearParams() const { return linear_params_; }
+
+ protected:
+  virtual void AddMatParamsTrans(int32 i, const MatrixBase<BaseFloat> &in,
+                                 BaseFloat beta,
+                                 MatrixBase<BaseFloat> *out) const;
+  virtual void AddMatParams(int32 i, const MatrixBase<BaseFloat> &in,
+                            MatrixBase<BaseFloat> *out) const;
+  virtual void CopyParamsToMat(int32 i, MatrixBase<BaseFloat> *dest) const;
+  virtual void WriteParams(std::ostream &os, bool binary) const;
+  virtual void ReadParams(std::istream &is, bool binary, int32 num_matrices);
+
+ private:
+  QuantizedMatrix linear_params_;
+};
+
+
+/**
+   QuantizedTdnnComponent is a quantized version of TdnnComponent.  The
+   parameter matrix for each time offset is quantized separately (so each has
+   its own row scales), and the bias, if present, is not quantized.
+
+   This is normally created by QuantizeNnet().  For testing purposes it may be
+   initialized from a config line, which accepts the same values as
+   TdnnComponent, e.g. "input-dim=100 output-dim=200 time-offsets=-1,0,1".
+*/
+class QuantizedTdnnComponent: public CompactTdnnComponent {
+ public:
+  QuantizedTdnnComponent() { }
+
+  QuantizedTdnnComponent(const QuantizedTdnnComponent &other);
+
+  /// Initializes from a TdnnComponent.
+  explicit QuantizedTdnnComponent(const TdnnComponent &tdnn);
+
+  virtual int32 InputDim() const {
+    return linear_params_.empty() ? 0 : linear_params_[0].NumCols();
+  }
+  virtual int32 OutputDim() const {
+    return linear_params_.empty() ? 0 : linear_params_[0].NumRows();
+  }
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual std::string Type() const { return "QuantizedTdnnComponent"; }
+
+  virtual Component* Copy() const {
+    return new QuantizedTdnnComponent(*this);
+  }
+
+ protected:
+  virtual void AddMatParamsTrans(int32 i, const MatrixBase<BaseFloat> &in,
+                                 BaseFloat beta,
+                                 MatrixBase<BaseFloat> *out) const;
+  virtual void AddMatParams(int32 i, const MatrixBase<BaseFloat> &in,
+                            MatrixBase<BaseFloat> *out) const;
+  virtual void CopyParamsToMat(int32 i, MatrixBase<BaseFloat> *dest) const;
+  virtual void WriteParams(std::ostream &os, bool binary) const;
+  virtual void ReadParams(std::istream &is, bool binary, int32 num_matrices);
+
+ private:
+  // The parameters for each time offset: linear_params_[i] is of dimension
+  // OutputDim() by InputDim(), and is the quantized version of the
+  // corresponding column range of the TdnnComponent's linear parameters.
+  std::vector<QuantizedMatrix> linear_params_;
+};
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+
+#endif
@@ -21,6 +21,9 @@
 #include "nnet3/nnet-nnet.h"
 #include "nnet3/nnet-simple-component.h"
 #include "nnet3/nnet-test-utils.h"
+#include "nnet3/nnet-am-decodable-simple.h"
+#include "nnet3/nnet-fused-component.h"
+#include "nnet3/nnet-block-sparse-component.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -100,6 +103,287 @@ void UnitTestConvertRepeatedToBlockAffineComposite() {
   }
 }
 
+// Computes the output of 'nnet' for the input 'input'.
+static void ComputeNnetOutput(const Nnet &nnet,
+                              const Matrix<BaseFloat> &input,
+                              Matrix<BaseFloat> *output) {
+  NnetSimpleComputationOptions opts;
+  opts.frames_per_chunk = RandInt(5, 25);
+  CachingOptimizingCompiler compiler(nnet);
+  Vector<BaseFloat> priors;
+  DecodableNnetSimple decodable(opts, nnet, priors, input, &compiler);
+  output->Resize(decodable.NumFrames(), decodable.OutputDim());
+  for (int32 t = 0; t < decodable.NumFrames(); t++) {
+    SubVector<BaseFloat> row(*output, t);
+    decodable.GetOutputForFrame(t, &row);
+  }
+}
+
+void UnitTestQuantizeNnet() {
+  std::string config =
+    "component name=tdnn1 type=TdnnComponent input-dim=40 output-dim=200 "
+    "time-offsets=-1,0,1\n"
+    "component name=relu1 type=RectifiedLinearComponent dim=200\n"
+    "component name=linear2 type=LinearComponent input-dim=200 "
+    "output-dim=50\n"
+    "component name=tdnn2 type=TdnnComponent input-dim=50 output-dim=200 "
+    "time-offsets=-2,0 use-bias=false\n"
+    "component name=relu2 type=RectifiedLinearComponent dim=200\n"
+    "component name=affine3 type=NaturalGradientAffineComponent "
+    "input-dim=200 output-dim=30\n"
+    "\n"
+    "input-node name=input dim=40\n"
+    "component-node name=tdnn1 component=tdnn1 input=input\n"
+    "component-node name=relu1 component=relu1 input=tdnn1\n"
+    "component-node name=linear2 component=linear2 input=relu1\n"
+    "component-node name=tdnn2 component=tdnn2 input=linear2\n"
+    "component-node name=relu2 component=relu2 input=tdnn2\n"
+    "component-node name=affine3 component=affine3 input=relu2\n"
+    "output-node name=output input=affine3\n";
+
+  Nnet nnet;
+  std::istringstream is(config);
+  nnet.ReadConfig(is);
+
+  Nnet quantized_nnet(nnet);
+  KALDI_ASSERT(QuantizeNnet("*", &quantized_nnet) == 4);
+  KALDI_ASSERT(quantized_nnet.GetComponent(0)->Type() ==
+               "QuantizedTdnnComponent" &&
+               quantized_nnet.GetComponent(2)->Type() ==
+               "QuantizedAffineComponent");
+  KALDI_LOG << "Info for quantized nnet is: " << NnetInfo(quantized_nnet);
+
+  Matrix<BaseFloat> input(RandInt(20, 60), 40);
+  input.SetRandn();
+  Matrix<BaseFloat> output, quantized_output;
+  ComputeNnetOutput(nnet, input, &output);
+  ComputeNnetOutput(quantized_nnet, input, &quantized_output);
+  Matrix<BaseFloat> diff(quantized_output);
+  diff.AddMat(-1.0, output);
+  BaseFloat relative_diff = diff.FrobeniusNorm() / output.FrobeniusNorm();
+  KALDI_LOG << "Relative difference of quantized output is " << relative_diff;
+  KALDI_ASSERT(relative_diff < 0.05);
+
+  // Check that the quantized nnet can be written and read.
+  bool binary = (RandInt(0, 1) == 0);
+  std::ostringstream os;
+  quantized_nnet.Write(os, binary);
+  Nnet quantized_nnet2;
+  std::istringstream is2(os.str());
+  quantized_nnet2.Read(is2, binary);
+  Matrix<BaseFloat> quantized_output2;
+  ComputeNnetOutput(quantized_nnet2, input, &quantized_output2);
+  KALDI_ASSERT(quantized_output2.ApproxEqual(quantized_output,
+                                             binary ? 1.0e-06 : 1.0e-04));
+
+  // Check that the edit directive quantizes only the components we ask for.
+  Nnet nnet2(nnet);
+  std::istringstream edit_is("quantize name=tdnn*");
+  ReadEditConfig(edit_is, &nnet2);
+  KALDI_ASSERT(nnet2.GetComponent(0)->Type() == "QuantizedTdnnComponent" &&
+               nnet2.GetComponent(2)->Type() == "LinearComponent" &&
+               nnet2.GetComponent(3)->Type() == "QuantizedTdnnComponent");
+}
+
+void UnitTestCollapseModelFusion() {
+  // Two TDNN-F-like layers: tdnnf2 has a factored TDNN (linear part with no
+  // bias, then affine part), ReLU, batchnorm, dropout and a bypass
+  // connection.
+  std::string config =
+    "component name=tdnn1 type=TdnnComponent input-dim=20 output-dim=64 "
+    "time-offsets=-1,0,1\n"
+    "component name=relu1 type=RectifiedLinearComponent dim=64\n"
+    "component name=batchnorm1 type=BatchNormComponent dim=64\n"
+    "component name=dropout1 type=GeneralDropoutComponent dim=64 "
+    "dropout-proportion=0.1 continuous=true\n"
+    "component name=tdnnf2.linear type=TdnnComponent input-dim=64 "
+    "output-dim=16 time-offsets=-1,0 use-bias=false\n"
+    "component name=tdnnf2.affine type=TdnnComponent input-dim=16 "
+    "output-dim=64 time-offsets=0,1\n"
+    "component name=relu2 type=RectifiedLinearComponent dim=64\n"
+    "component name=batchnorm2 type=BatchNormComponent dim=64 "
+    "block-dim=32\n"
+    "component name=dropout2 type=GeneralDropoutComponent dim=64 "
+    "dropout-proportion=0.1 continuous=true\n"
+    "component name=noop2 type=NoOpComponent dim=64\n"
+    "component name=prefinal type=LinearComponent input-dim=64 "
+    "output-dim=32\n"
+    "component name=relu3 type=RectifiedLinearComponent dim=32\n"
+    "component name=final type=NaturalGradientAffineComponent "
+    "input-dim=32 output-dim=30\n"
+    "\n"
+    "input-node name=input dim=20\n"
+    "component-node name=tdnn1 component=tdnn1 input=input\n"
+    "component-node name=relu1 component=relu1 input=tdnn1\n"
+    "component-node name=batchnorm1 component=batchnorm1 input=relu1\n"
+    "component-node name=dropout1 component=dropout1 input=batchnorm1\n"
+    "component-node name=tdnnf2.linear component=tdnnf2.linear "
+    "input=dropout1\n"
+    "component-node name=tdnnf2.affine component=tdnnf2.affine "
+    "input=tdnnf2.linear\n"
+    "component-node name=relu2 component=relu2 input=tdnnf2.affine\n"
+    "component-node name=batchnorm2 component=batchnorm2 input=relu2\n"
+    "component-node name=dropout2 component=dropout2 input=batchnorm2\n"
+    "component-node name=noop2 component=noop2 "
+    "input=Sum(Scale(0.66, dropout1), dropout2)\n"
+    "component-node name=prefinal component=prefinal input=noop2\n"
+    "component-node name=relu3 component=relu3 input=prefinal\n"
+    "component-node name=final component=final input=relu3\n"
+    "output-node name=output input=final\n";
+
+  Nnet nnet;
+  std::istringstream is(config);
+  nnet.ReadConfig(is);
+  // this sets up random batchnorm stats.
+  SetBatchnormTestMode(true, &nnet);
+  SetDropoutTestMode(true, &nnet);
+
+  Nnet fused_nnet(nnet);
+  CollapseModel(CollapseModelConfig(), &fused_nnet);
+  KALDI_LOG << "Info for fused nnet is: " << NnetInfo(fused_nnet);
+  int32 num_fused = 0;
+  for (int32 c = 0; c < fused_nnet.NumComponents(); c++)
+    if (fused_nnet.GetComponent(c)->Type() == "FusedAffineComponent")
+      num_fused++;
+  // tdnn1 with relu1, batchnorm1 and dropout1; tdnnf2.affine with relu2,
+  // batchnorm2 and dropout2; and prefinal with relu3.  (dropout1 is also
+  // used by noop2, but that doesn't matter as it is not the input of a
+  // fused component).
+  KALDI_ASSERT(num_fused == 3);
+  KALDI_ASSERT(fused_nnet.GetComponentIndex("relu1") == -1 &&
+               fused_nnet.GetComponentIndex("batchnorm2") == -1);
+
+  Matrix<BaseFloat> input(RandInt(20, 60), 20);
+  input.SetRandn();
+  Matrix<BaseFloat> output, fused_output;
+  ComputeNnetOutput(nnet, input, &output);
+  ComputeNnetOutput(fused_nnet, input, &fused_output);
+  KALDI_ASSERT(fused_output.ApproxEqual(output, 1.0e-04));
+
+  // Check that fusing can be turned off.
+  Nnet unfused_nnet(nnet);
+  CollapseModelConfig unfused_config;
+  unfused_config.fuse_affine = false;
+  CollapseModel(unfused_config, &unfused_nnet);
+  for (int32 c = 0; c < unfused_nnet.NumComponents(); c++)
+    KALDI_ASSERT(unfused_nnet.GetComponent(c)->Type() !=
+                 "FusedAffineComponent");
+
+  // Check that the fused nnet can be written and read.
+  bool binary = (RandInt(0, 1) == 0);
+  std::ostringstream os;
+  fused_nnet.Write(os, binary);
+  Nnet fused_nnet2;
+  std::istringstream is2(os.str());
+  fused_nnet2.Read(is2, binary);
+  Matrix<BaseFloat> fused_output2;
+  ComputeNnetOutput(fused_nnet2, input, &fused_output2);
+  KALDI_ASSERT(fused_output2.ApproxEqual(fused_output,
+                                         binary ? 1.0e-06 : 1.0e-04));
+
+  // Quantizing the fused nnet quantizes the linear parts of the fused
+  // components.
+  Nnet quantized_nnet(fused_nnet);
+  KALDI_ASSERT(QuantizeNnet("*", &quantized_nnet) == 5);
+  Matrix<BaseFloat> quantized_output;
+  ComputeNnetOutput(quantized_nnet, input, &quantized_output);
+  quantized_output.AddMat(-1.0, output);
+  BaseFloat relative_diff = quantized_output.FrobeniusNorm() /
+      output.FrobeniusNorm();
+  KALDI_LOG << "Relative difference of quantized fused output is "
+            << relative_diff;
+  KALDI_ASSERT(relative_diff < 0.05);
+}
+
+void UnitTestPruneNnetBlocks() {
+  std::string config =
+    "component name=tdnn1 type=TdnnComponent input-dim=40 output-dim=200 "
+    "time-offsets=-1,0,1\n"
+    "component name=relu1 type=RectifiedLinearComponent dim=200\n"
+    "component name=linear2 type=LinearComponent input-dim=200 "
+    "output-dim=50\n"
+    "component name=tdnn2 type=TdnnComponent input-dim=50 output-dim=200 "
+    "time-offsets=-2,0 use-bias=false\n"
+    "component name=relu2 type=RectifiedLinearComponent dim=200\n"
+    "component name=affine3 type=NaturalGradientAffineComponent "
+    "input-dim=200 output-dim=30\n"
+    "\n"
+    "input-node name=input dim=40\n"
+    "component-node name=tdnn1 component=tdnn1 input=input\n"
+    "component-node name=relu1 component=relu1 input=tdnn1\n"
+    "component-node name=linear2 component=linear2 input=relu1\n"
+    "component-node name=tdnn2 component=tdnn2 input=linear2\n"
+    "component-node name=relu2 component=relu2 input=tdnn2\n"
+    "component-node name=affine3 component=affine3 input=relu2\n"
+    "output-node name=output input=affine3\n";
+
+  Nnet nnet;
+  std::istringstream is(config);
+  nnet.ReadConfig(is);
+
+  // Pruning leaves the components as they were.
+  std::istringstream edit_is("prune-blocks block-size=8 sparsity=0.9");
+  ReadEditConfig(edit_is, &nnet);
+  KALDI_ASSERT(nnet.GetComponent(0)->Type() == "TdnnComponent" &&
+               nnet.GetComponent(2)->Type() == "LinearComponent");
+  const LinearComponent *linear2 =
+      dynamic_cast<const LinearComponent*>(nnet.GetComponent(2));
+  AssertEqual(BlockSparsity(Matrix<BaseFloat>(linear2->Params()), 8),
+              static_cast<int32>(0.9 * 7 * 200) / (7 * 200.0));
+
+  // Preparing for test converts them to block-sparse form; tdnn1 and tdnn2
+  // are fused with the following ReLUs, so for those it is the linear part
+  // that is converted.
+  Nnet sparse_nnet(nnet);
+  CollapseModel(CollapseModelConfig(), &sparse_nnet);
+  int32 num_block_sparse = 0;
+  for (int32 c = 0; c < sparse_nnet.NumComponents(); c++) {
+    const Component *component = sparse_nnet.GetComponent(c);
+    const FusedAffineComponent *fused =
+        dynamic_cast<const FusedAffineComponent*>(component);
+    if (fused != NULL)
+      component = &(fused->LinearPart());
+    if (component->Type() == "BlockSparseAffineComponent" ||
+        component->Type() == "BlockSparseTdnnComponent")
+      num_block_sparse++;
+  }
+  KALDI_ASSERT(num_block_sparse == 4);
+  // Blocks of 16 rows would be less sparse than required, so we use 8.
+  const BlockSparseAffineComponent *sparse_linear2 =
+      dynamic_cast<const BlockSparseAffineComponent*>(
+          sparse_nnet.GetComponent(sparse_nnet.GetComponentIndex("linear2")));
+  KALDI_ASSERT(sparse_linear2 != NULL &&
+               sparse_linear2->LinearParams().BlockSize() == 8);
+  KALDI_LOG << "Info for block-sparse nnet is: " << NnetInfo(sparse_nnet);
+
+  Matrix<BaseFloat> input(RandInt(20, 60), 40);
+  input.SetRandn();
+  Matrix<BaseFloat> output, sparse_output;
+  ComputeNnetOutput(nnet, input, &output);
+  ComputeNnetOutput(sparse_nnet, input, &sparse_output);
+  KALDI_ASSERT(sparse_output.ApproxEqual(output, 1.0e-04));
+
+  // Check that the conversion can be turned off.
+  Nnet dense_nnet(nnet);
+  CollapseModelConfig dense_config;
+  dense_config.min_block_sparsity = 1.1;
+  CollapseModel(dense_config, &dense_nnet);
+  KALDI_ASSERT(dense_nnet.GetComponent(dense_nnet.GetComponentIndex(
+      "linear2"))->Type() == "LinearComponent");
+
+  // Check that the block-sparse nnet can be written and read.
+  bool binary = (RandInt(0, 1) == 0);
+  std::ostringstream os;
+  sparse_nnet.Write(os, binary);
+  Nnet sparse_nnet2;
+  std::istringstream is2(os.str());
+  sparse_nnet2.Read(is2, binary);
+  Matrix<BaseFloat> sparse_output2;
+  ComputeNnetOutput(sparse_nnet2, input, &sparse_output2);
+  KALDI_ASSERT(sparse_output2.ApproxEqual(sparse_output,
+                                          binary ? 1.0e-06 : 1.0e-04));
+}
+
 } // namespace nnet3
 } // namespace kaldi
 
@@ -111,6 +395,9 @@ int main() {
   UnitTestNnetContext();
   UnitTestConvertRepeatedToBlockAffine();
   UnitTestConvertRepeatedToBlockAffineComposite();
+  UnitTestQuantizeNnet();
+  UnitTestCollapseModelFusion();
+  UnitTestPruneNnetBlocks();
 
   KALDI_LOG << "Nnet tests succeeded.";
 
@@ -18,13 +18,22 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
+#ifdef _MSC_VER
+#include <process.h>  // for getpid()
+#endif
 #include "nnet3/nnet-utils.h"
 #include "nnet3/nnet-graph.h"
 #include "nnet3/nnet-simple-component.h"
 #include "nnet3/nnet-normalize-component.h"
 #include "nnet3/nnet-general-component.h"
 #include "nnet3/nnet-convolutional-component.h"
+#include "nnet3/nnet-quantized-component.h"
+#include "nnet3/nnet-fused-component.h"
+#include "nnet3/nnet-block-sparse-component.h"
 #include "nnet3/nnet-parse.h"
 #include "nnet3/nnet-computation-graph.h"
 #include "nnet3/nnet-diagnostics.h"
@@ -489,6 +498,157 @@ void ConvertRepeatedToBlockAffine(Nnet *nnet) {
   }
 }
 
+// Returns a newly created quantized version of 'component', or NULL if it is
+// not of a type that we can quantize.
+static Component *NewQuantizedComponent(const Component *component) {
+  if (const AffineComponent *affine =
+      dynamic_cast<const AffineComponent*>(component)) {
+    return new QuantizedAffineComponent(affine->LinearParams(),
+                                        affine->BiasParams());
+  } else if (const FixedAffineComponent *fixed_affine =
+             dynamic_cast<const FixedAffineComponent*>(component)) {
+    return new QuantizedAffineComponent(fixed_affine->LinearParams(),
+                                        fixed_affine->BiasParams());
+  } else if (const LinearComponent *linear =
+             dynamic_cast<const LinearComponent*>(component)) {
+    return new QuantizedAffineComponent(linear->Params(),
+                                        CuVector<BaseFloat>());
+  } else if (const TdnnComponent *tdnn =
+             dynamic_cast<const TdnnComponent*>(component)) {
+    return new QuantizedTdnnComponent(*tdnn);
+  } else if (const FusedAffineComponent *fused =
+             dynamic_cast<const FusedAffineComponent*>(component)) {
+    // quantize the linear part and keep the rest.
+    Component *linear_part = NewQuantizedComponent(&(fused->LinearPart()));
+    if (linear_part == NULL)
+      return NULL;
+    FusedAffineComponent *ans =
+        dynamic_cast<FusedAffineComponent*>(fused->Copy());
+    ans->SetLinearPart(linear_part);
+    return ans;
+  }
+  return NULL;
+}
+
+int32 QuantizeNnet(const std::string &name_pattern, Nnet *nnet) {
+  int32 num_quantized = 0;
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    if (!NameMatchesPattern(nnet->GetComponentName(c).c_str(),
+                            name_pattern.c_str()))
+      continue;
+    Component *quantized = NewQuantizedComponent(nnet->GetComponent(c));
+    if (quantized != NULL) {
+      nnet->SetComponent(c, quantized);  // deletes the old component.
+      num_quantized++;
+    }
+  }
+  return num_quantized;
+}
+
+int32 PruneNnetBlocks(const std::string &name_pattern, int32 block_size,
+                      BaseFloat sparsity, Nnet *nnet) {
+  if (!(block_size == 4 || block_size == 8 || block_size == 16))
+    KALDI_ERR << "Invalid block size " << block_size
+              << " for pruning (must be 4, 8 or 16).";
+  int32 num_pruned = 0;
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    if (!NameMatchesPattern(nnet->GetComponentName(c).c_str(),
+                            name_pattern.c_str()))
+      continue;
+    Component *component = nnet->GetComponent(c);
+    CuMatrixBase<BaseFloat> *params = NULL;
+    if (AffineComponent *affine =
+        dynamic_cast<AffineComponent*>(component))
+      params = &(affine->LinearParams());
+    else if (LinearComponent *linear =
+             dynamic_cast<LinearComponent*>(component))
+      params = &(linear->Params());
+    else if (TdnnComponent *tdnn = dynamic_cast<TdnnComponent*>(component))
+      params = &(tdnn->LinearParams());
+    if (params == NULL)
+      continue;
+    Matrix<BaseFloat> params_cpu(*params);
+    MatrixIndexT num_blocks = PruneMatrixBlocks(block_size, sparsity,
+                                                &params_cpu);
+    params->CopyFromMat(params_cpu);
+    KALDI_VLOG(2) << "Pruned " << num_blocks << " blocks of component "
+                  << nnet->GetComponentName(c);
+    num_pruned++;
+  }
+  return num_pruned;
+}
+
+// Returns a newly created block-sparse version of 'component', or NULL if it
+// is not of a type that we can convert or if its parameters are not sparse
+// enough.
+static Component *NewBlockSparseComponent(const Component *component,
+                                          BaseFloat min_sparsity) {
+  const CuMatrixBase<BaseFloat> *params = NULL;
+  const CuVectorBase<BaseFloat> *bias = NULL;
+  CuVector<BaseFloat> no_bias;
+  const TdnnComponent *tdnn = dynamic_cast<const TdnnComponent*>(component);
+  if (const AffineComponent *affine =
+      dynamic_cast<const AffineComponent*>(component)) {
+    params = &(affine->LinearParams());
+    bias = &(affine->BiasParams());
+  } else if (const FixedAffineComponent *fixed_affine =
+             dynamic_cast<const FixedAffineComponent*>(component)) {
+    params = &(fixed_affine->LinearParams());
+    bias = &(fixed_affine->BiasParams());
+  } else if (const LinearComponent *linear =
+             dynamic_cast<const LinearComponent*>(component)) {
+    params = &(linear->Params());
+    bias = &no_bias;
+  } else if (tdnn != NULL) {
+    params = &(tdnn->LinearParams());
+  } else if (const FusedAffineComponent *fused =
+             dynamic_cast<const FusedAffineComponent*>(component)) {
+    // convert the linear part and keep the rest.
+    Component *linear_part = NewBlockSparseComponent(&(fused->LinearPart()),
+                                                     min_sparsity);
+    if (linear_part == NULL)
+      return NULL;
+    FusedAffineComponent *ans =
+        dynamic_cast<FusedAffineComponent*>(fused->Copy());
+    ans->SetLinearPart(linear_part);
+    return ans;
+  } else {
+    return NULL;
+  }
+  // Use the largest block size at which the parameters are sparse enough.
+  // (PruneNnetBlocks() only allows these block sizes.)
+  // The blocks of a TdnnComponent's parameters don't cross the boundaries
+  // between time offsets, so we can work out the sparsity from the whole
+  // matrix.
+  Matrix<BaseFloat> params_cpu(*params);
+  int32 block_sizes[] = { 16, 8, 4 };
+  for (int32 i = 0; i < 3; i++) {
+    int32 block_size = block_sizes[i];
+    if (BlockSparsity(params_cpu, block_size) < min_sparsity)
+      continue;
+    if (tdnn != NULL)
+      return new BlockSparseTdnnComponent(*tdnn, block_size);
+    else
+      return new BlockSparseAffineComponent(*params, *bias, block_size);
+  }
+  return NULL;
+}
+
+int32 ConvertToBlockSparse(BaseFloat min_sparsity, Nnet *nnet) {
+  int32 num_converted = 0;
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    Component *block_sparse = NewBlockSparseComponent(nnet->GetComponent(c),
+                                                      min_sparsity);
+    if (block_sparse != NULL) {
+      KALDI_VLOG(2) << "Converting component " << nnet->GetComponentName(c)
+                    << " to block-sparse form.";
+      nnet->SetComponent(c, block_sparse);  // deletes the old component.
+      num_converted++;
+    }
+  }
+  return num_converted;
+}
+
 std::string NnetInfo(const Nnet &nnet) {
   std::ostringstream ostr;
   if (IsSimpleNnet(nnet)) {
@@ -506,6 +666,70 @@ std::string NnetInfo(const Nnet &nnet) {
   return ostr.str();
 }
 
+// Adds the characters of 's' to the 64-bit FNV-1a hash 'hash'.  We don't use
+// std::hash because its value is allowed to differ between builds, and the
+// hash is written to disk.
+static void HashString(const std::string &s, uint64 *hash) {
+  for (size_t i = 0; i < s.size(); i++) {
+    *hash ^= static_cast<unsigned char>(s[i]);
+    *hash *= 1099511628211ULL;
+  }
+  // separator, so that e.g. "ab","c" and "a","bc" hash differently.
+  *hash ^= 0xff;
+  *hash *= 1099511628211ULL;
+}
+
+uint64 NnetStructureHash(const Nnet &nnet) {
+  uint64 ans = 14695981039346656037ULL;
+  std::vector<std::string> config_lines;
+  nnet.GetConfigLines(true, &config_lines);
+  for (size_t i = 0; i < config_lines.size(); i++)
+    HashString(config_lines[i], &ans);
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    const Component *comp = nnet.GetComponent(c);
+    std::ostringstream ostr;
+    ostr << nnet.GetComponentName(c) << ' ' << comp->Type() << ' '
+         << comp->InputDim() << ' ' << comp->OutputDim() << ' '
+         << comp->Properties();
+    if (!(comp->Properties() & kSimpleComponent))
+      ostr << ' ' << comp->Info();
+    HashString(ostr.str(), &ans);
+  }
+  return ans;
+}
+
+// Returns the name of the temporary file that CacheFileOutput writes
+// 'filename' to.  'object' makes it unique among the threads of this process.
+static std::string CacheFileTmpName(const std::string &filename,
+                                    const void *object) {
+  std::ostringstream os;
+  os << filename << ".tmp." << getpid() << '.' << std::hex
+     << reinterpret_cast<size_t>(object);
+  return os.str();
+}
+
+CacheFileOutput::CacheFileOutput(const std::string &filename):
+    filename_(filename), tmp_filename_(CacheFileTmpName(filename, this)),
+    output_(tmp_filename_, true) { }
+
+void CacheFileOutput::Close() {
+  if (!output_.Close())
+    KALDI_ERR << "Error writing " << tmp_filename_;
+  if (std::rename(tmp_filename_.c_str(), filename_.c_str()) != 0) {
+    std::remove(tmp_filename_.c_str());
+    KALDI_ERR << "Could not rename " << tmp_filename_ << " to "
+              << filename_ << ": " << strerror(errno);
+  }
+  tmp_filename_.clear();
+}
+
+CacheFileOutput::~CacheFileOutput() {
+  if (!tmp_filename_.empty()) {  // Close() was not called or failed.
+    output_.Close();
+    std::remove(tmp_filename_.c_str());
+  }
+}
+
 void SetDropoutProportion(BaseFloat dropout_proportion,
                           Nnet *nnet) {
   for (int32 c = 0; c < nnet->NumComponents(); c++) {
@@ -1274,6 +1498,26 @@ void ReadEditConfig(std::istream &edit_config_is, Nnet *nnet) {
       }
       KALDI_LOG << "Converted " << num_components_changed
                 << " components to FixedAffineComponent.";
+    } else if (directive == "quantize") {
+      std::string name_pattern = "*";
+      config_line.GetValue("name", &name_pattern);
+      int32 num_quantized = QuantizeNnet(name_pattern, nnet);
+      KALDI_LOG << "Quantized " << num_quantized << " components.";
+    } else if (directive == "prune-blocks") {
+      std::string name_pattern = "*";
+      int32 block_size = 4;
+      BaseFloat sparsity = -1.0;
+      config_line.GetValue("name", &name_pattern);
+      config_line.GetValue("block-size", &block_size);
+      if (!config_line.GetValue("sparsity", &sparsity))
+        KALDI_ERR << "Edit directive prune-blocks requires 'sparsity' to be "
+            "specified.";
+      if (sparsity < 0.0 || sparsity > 1.0)
+        KALDI_ERR << "Sparsity must be between 0 and 1 in prune-blocks "
+            "command.";
+      int32 num_pruned = PruneNnetBlocks(name_pattern, block_size, sparsity,
+                                         nnet);
+      KALDI_LOG << "Pruned " << num_pruned << " components.";
     } else if (directive == "remove-orphan-nodes") {
       bool remove_orphan_inputs = false;
       config_line.GetValue("remove-orphan-inputs", &remove_orphan_inputs);
@@ -1672,6 +1916,15 @@ class ModelCollapser {
     int32 input_component_index = input_node.u.component_index;
     int32 combined_component_index = CollapseComponents(input_component_index,
                                                         component_index);
+    // Fusing is only done if the input is not scaled (ReLU does not commute
+    // with a negative scale) and nothing else uses the output of the input
+    // node, as otherwise we'd be doing the matrix multiplication twice.
+    if (combined_component_index == -1 && config_.fuse_affine &&
+        descriptor.NumParts() == 1 &&
+        descriptor.Part(0).GetScaleForNode(input_node_index) == 1.0 &&
+        NumConsumers(input_node_index) == 1)
+      combined_component_index = FuseComponents(input_component_index,
+                                                component_index);
     if (combined_component_index == -1)
       return false;  // these components were not of types that can be
                      // collapsed.
@@ -1695,6 +1948,146 @@ class ModelCollapser {
   }
 
 
+  // Returns the number of nodes (of any type) that take the output of node
+  // 'node_index' as input.
+  int32 NumConsumers(int32 node_index) {
+    int32 ans = 0;
+    for (int32 n = 0; n < nnet_->NumNodes(); n++) {
+      const NetworkNode &node = nnet_->GetNode(n);
+      if (node.node_type == kDescriptor) {
+        std::vector<int32> dependencies;
+        node.descriptor.GetNodeDependencies(&dependencies);
+        if (std::find(dependencies.begin(), dependencies.end(),
+                      node_index) != dependencies.end())
+          ans++;
+      } else if (node.node_type == kDimRange) {
+        if (node.u.node_index == node_index)
+          ans++;
+      }
+    }
+    return ans;
+  }
+
+  /**
+     Splits an affine-type component into a 'linear part' suitable for
+     FusedAffineComponent, which is newly allocated and output to
+     'linear_part', and a bias, which is output to 'bias' (it may be empty,
+     meaning no bias).  Handles AffineComponent and its child classes,
+     FixedAffineComponent, LinearComponent, TdnnComponent,
+     QuantizedAffineComponent and QuantizedTdnnComponent (for the quantized
+     components, the bias stays in the linear part).  Returns false if
+     'component' is of some other type.
+   */
+  bool GetLinearPartAndBias(const Component *component,
+                            Component **linear_part,
+                            CuVector<BaseFloat> *bias) {
+    const AffineComponent *affine_component =
+        dynamic_cast<const AffineComponent*>(component);
+    const FixedAffineComponent *fixed_affine_component =
+        dynamic_cast<const FixedAffineComponent*>(component);
+    const TdnnComponent *tdnn_component =
+        dynamic_cast<const TdnnComponent*>(component);
+    bias->Resize(0);
+    if (affine_component != NULL) {
+      *linear_part = new LinearComponent(affine_component->LinearParams());
+      *bias = affine_component->BiasParams();
+    } else if (fixed_affine_component != NULL) {
+      *linear_part = new LinearComponent(
+          fixed_affine_component->LinearParams());
+      *bias = fixed_affine_component->BiasParams();
+    } else if (tdnn_component != NULL) {
+      TdnnComponent *new_tdnn_component =
+          dynamic_cast<TdnnComponent*>(tdnn_component->Copy());
+      bias->Swap(&(new_tdnn_component->BiasParams()));
+      *linear_part = new_tdnn_component;
+    } else if (dynamic_cast<const LinearComponent*>(component) != NULL ||
+               dynamic_cast<const CompactLinearComponent*>(component) !=
+               NULL) {
+      *linear_part = component->Copy();
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  /**
+     Tries to produce a FusedAffineComponent that's equivalent to running the
+     component 'component_index2' with input given by 'component_index1'.  This
+     handles the cases where 'component_index2' is of type
+     RectifiedLinearComponent or BatchNormComponent and 'component_index1' is
+     of an affine type supported by GetLinearPartAndBias(); and the cases
+     where 'component_index1' is already a FusedAffineComponent and
+     'component_index2' is a BatchNormComponent, DropoutComponent or
+     GeneralDropoutComponent.  The batchnorm and dropout components must be
+     in test mode.
+
+     Returns -1 if this code can't produce a combined component.
+   */
+  int32 FuseComponents(int32 component_index1,
+                       int32 component_index2) {
+    const Component *component1 = nnet_->GetComponent(component_index1),
+        *component2 = nnet_->GetComponent(component_index2);
+    const FusedAffineComponent *fused_component1 =
+        dynamic_cast<const FusedAffineComponent*>(component1);
+    const BatchNormComponent *batchnorm_component2 =
+        dynamic_cast<const BatchNormComponent*>(component2);
+    const DropoutComponent *dropout_component2 =
+        dynamic_cast<const DropoutComponent*>(component2);
+    const GeneralDropoutComponent *general_dropout_component2 =
+        dynamic_cast<const GeneralDropoutComponent*>(component2);
+    bool is_relu =
+        (dynamic_cast<const RectifiedLinearComponent*>(component2) != NULL);
+
+    if (general_dropout_component2 != NULL) {
+      // In test mode this does nothing.
+      if (fused_component1 != NULL && general_dropout_component2->TestMode())
+        return component_index1;
+      return -1;
+    }
+    if (!is_relu && batchnorm_component2 == NULL &&
+        dropout_component2 == NULL)
+      return -1;
+    if (batchnorm_component2 != NULL &&
+        batchnorm_component2->Offset().Dim() == 0)
+      return -1;  // not in test mode.
+    if (dropout_component2 != NULL &&
+        (fused_component1 == NULL || !dropout_component2->TestMode() ||
+         dropout_component2->DropoutProportion() >= 1.0))
+      return -1;
+    if (is_relu && fused_component1 != NULL)
+      return -1;
+
+    std::ostringstream new_component_name_os;
+    new_component_name_os << nnet_->GetComponentName(component_index1)
+                          << "." << nnet_->GetComponentName(component_index2);
+    std::string new_component_name = new_component_name_os.str();
+    int32 new_component_index = nnet_->GetComponentIndex(new_component_name);
+    if (new_component_index >= 0)
+      return new_component_index;  // we previously created this.
+
+    FusedAffineComponent *new_component = NULL;
+    if (fused_component1 != NULL) {
+      new_component = dynamic_cast<FusedAffineComponent*>(
+          fused_component1->Copy());
+    } else {
+      Component *linear_part;
+      CuVector<BaseFloat> bias;
+      if (!GetLinearPartAndBias(component1, &linear_part, &bias))
+        return -1;
+      new_component = new FusedAffineComponent(linear_part, bias, is_relu);
+    }
+    if (batchnorm_component2 != NULL) {
+      new_component->AddScaleAndOffset(batchnorm_component2->Scale(),
+                                       batchnorm_component2->Offset());
+    } else if (dropout_component2 != NULL) {
+      // In test mode, DropoutComponent scales by 1 - dropout-proportion.
+      CuVector<BaseFloat> scale(1), offset(1);
+      scale.Set(1.0 - dropout_component2->DropoutProportion());
+      new_component->AddScaleAndOffset(scale, offset);
+    }
+    return nnet_->AddComponent(new_component_name, new_component);
+  }
+
   /**
      Tries to produce a component that's equivalent to running the component
      'component_index2' with input given by 'component_index1'.  This handles
@@ -2117,6 +2510,13 @@ void CollapseModel(const CollapseModelConfig &config,
                    Nnet *nnet) {
   ModelCollapser c(config, nnet);
   c.Collapse();
+  if (config.min_block_sparsity <= 1.0) {
+    int32 num_converted = ConvertToBlockSparse(config.min_block_sparsity,
+                                               nnet);
+    if (num_converted != 0)
+      KALDI_LOG << "Converted " << num_converted
+                << " components to block-sparse form.";
+  }
 }
 
 bool UpdateNnetWithMaxChange(const Nnet &delta_nnet,
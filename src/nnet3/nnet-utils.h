@@ -164,6 +164,56 @@ void FreezeNaturalGradient(bool freeze, Nnet *nnet);
 /// NaturalGradientRepeatedAffineComponent to BlockAffineComponent in nnet.
 void ConvertRepeatedToBlockAffine(Nnet *nnet);
 
+/**
+   Replaces the affine-type components of 'nnet' whose names match
+   'name_pattern' (see NameMatchesPattern() in nnet-parse.h; "*" matches all of
+   them) with 8-bit quantized versions, for faster inference on CPU:
+   AffineComponent and its child classes such as
+   NaturalGradientAffineComponent, FixedAffineComponent and LinearComponent
+   become QuantizedAffineComponent, and TdnnComponent becomes
+   QuantizedTdnnComponent; see nnet-quantized-component.h.  For
+   FusedAffineComponent (created by CollapseModel()), the linear part is
+   quantized.  Returns the number of components that were quantized.  The
+   resulting nnet is only suitable for inference.  You should call
+   CollapseModel() first, if you are going to, because it cannot fold
+   batch-norm or scale components into the quantized parameters.
+*/
+int32 QuantizeNnet(const std::string &name_pattern, Nnet *nnet);
+
+/**
+   This function sets to zero the blocks of 'block_size' consecutive rows by
+   one column of the parameter matrices of the components whose names match
+   'name_pattern' (which may contain '*'), choosing the blocks with the
+   smallest 2-norms, so that a proportion 'sparsity' of the blocks of each
+   matrix are zero; see PruneMatrixBlocks() in ../matrix/block-sparse-matrix.h.
+   This applies to AffineComponent and its child classes such as
+   NaturalGradientAffineComponent, LinearComponent and TdnnComponent.  The
+   components stay as they are, so the nnet may be trained further (although
+   training will not keep the pruned blocks at zero); when the model is
+   prepared for test, CollapseModel() converts the ones that are sparse enough
+   to block-sparse components.  'block_size' must be 4, 8 or 16, which are the
+   block sizes that ConvertToBlockSparse() uses (smaller blocks are supported
+   by BlockSparseMatrix, but are not fast enough to be worth using).  Returns
+   the number of components that were pruned.
+*/
+int32 PruneNnetBlocks(const std::string &name_pattern, int32 block_size,
+                      BaseFloat sparsity, Nnet *nnet);
+
+/**
+   This function replaces the affine-type components whose parameter matrices
+   have at least a proportion 'min_sparsity' of zero blocks (for a block size
+   of 16, 8 or 4 rows, whichever is the largest that qualifies) with
+   block-sparse versions, whose Propagate() only does the multiplications for
+   the nonzero blocks: AffineComponent and its child classes,
+   FixedAffineComponent and LinearComponent become BlockSparseAffineComponent
+   and TdnnComponent becomes BlockSparseTdnnComponent; see
+   nnet-block-sparse-component.h.  For FusedAffineComponent the linear part is
+   converted.  Returns the number of components that were converted.  This is
+   called by CollapseModel(); the resulting nnet is only suitable for
+   inference.
+*/
+int32 ConvertToBlockSparse(BaseFloat min_sparsity, Nnet *nnet);
+
 /// This function returns various info about the neural net.
 /// If the nnet satisfied IsSimpleNnet(nnet), the info includes "left-context=5\nright-context=3\n...".  The info includes
 /// the output of nnet.Info().
@@ -171,6 +221,44 @@ void ConvertRepeatedToBlockAffine(Nnet *nnet);
 /// Info() function (we need this in the CTC code).
 std::string NnetInfo(const Nnet &nnet);
 
+/// Returns a hash of everything in the neural net that may affect a compiled
+/// computation: the network topology (node names, dimensions and
+/// descriptors), and the type, dimensions and properties of each component.
+/// For components that are not simple (e.g. convolutional components, which
+/// precompute indexes), it also includes the output of their Info()
+/// function, so the hash may change when their parameters change.  It does
+/// not otherwise depend on the parameters, so a model that was retrained
+/// from the same config gets the same hash.  This is used to decide whether
+/// computations that were compiled and cached on disk for one model can be
+/// used with another; see the --computation-cache option.
+uint64 NnetStructureHash(const Nnet &nnet);
+
+/// This class is used to write the computation-cache files (see the
+/// --computation-cache option).  It writes to a temporary file in the same
+/// directory, and Close() renames that to 'filename', so that parallel jobs
+/// that use the same cache file never read a partially written one.  The
+/// temporary name contains the process id, so those jobs won't pick the same
+/// name.  If Close() is not called (e.g. because of an exception), the
+/// temporary file is removed.
+class CacheFileOutput {
+ public:
+  explicit CacheFileOutput(const std::string &filename);
+
+  /// The stream to write to; it is in binary mode, and the binary-mode header
+  /// has already been written.
+  std::ostream &Stream() { return output_.Stream(); }
+
+  /// Closes the temporary file and renames it to the real name.  Throws on
+  /// error.
+  void Close();
+
+  ~CacheFileOutput();
+ private:
+  std::string filename_;
+  std::string tmp_filename_;
+  Output output_;
+};
+
 /// This function sets the dropout proportion in all dropout components to
 /// dropout_proportion value.
 void SetDropoutProportion(BaseFloat dropout_proportion, Nnet *nnet);
@@ -242,10 +330,19 @@ struct CollapseModelConfig {
   bool collapse_batchnorm;  // batchnorm then affine.
   bool collapse_affine;  // affine or fixed-affine then affine.
   bool collapse_scale;  // affine then fixed-scale.
+  // affine or TDNN then ReLU, batchnorm or dropout.  This creates
+  // FusedAffineComponent, which older versions of Kaldi cannot read, so
+  // nnet3-copy and nnet3-am-copy only do it with --fuse-affine=true.
+  bool fuse_affine;
+  // convert affine or TDNN components with at least this proportion of zero
+  // blocks to block-sparse form; values > 1 disable this.
+  BaseFloat min_block_sparsity;
   CollapseModelConfig(): collapse_dropout(false),
                          collapse_batchnorm(false),
                          collapse_affine(true),
-                         collapse_scale(true) { }
+                         collapse_scale(true),
+                         fuse_affine(true),
+                         min_block_sparsity(0.9) { }
 };
 
 /**
@@ -253,7 +350,15 @@ struct CollapseModelConfig {
    suitable to be done in test time.  For example, it tries to get
    rid of dropout, batchnorm and fixed-scale components, and to
    collapse subsequent affine components if doing so won't hurt
-   speed.
+   speed.  If config.fuse_affine is true, it also replaces an affine-type
+   component (AffineComponent and child classes, FixedAffineComponent,
+   LinearComponent, TdnnComponent or their quantized versions) followed by
+   any of RectifiedLinearComponent, BatchNormComponent and test-mode dropout
+   components (as in TDNN-F layers) with a single FusedAffineComponent; see
+   nnet-fused-component.h.  Batchnorm and dropout components must already be
+   in test mode.  Lastly, it calls ConvertToBlockSparse() with
+   config.min_block_sparsity, so that models pruned with PruneNnetBlocks()
+   use the block-sparse kernels.
  */
 void CollapseModel(const CollapseModelConfig &config,
                    Nnet *nnet);
@@ -322,6 +427,23 @@ void CollapseModel(const CollapseModelConfig &config,
        after the SVD based refactoring, is greater than shrinkage threshold.
        See also 'reduce-rank'.
 
+    quantize [name=<name-pattern>]
+       Replaces the affine-type components (including TdnnComponent and
+       LinearComponent) whose names match the pattern with 8-bit quantized
+       versions, for faster inference on CPU; see QuantizeNnet().
+       <name-pattern> defaults to "*".
+
+    prune-blocks [name=<name-pattern>] [block-size=<n>] sparsity=<s>
+       Sets to zero the blocks of <n> rows by one column (<n> may be 4, 8 or
+       16; default: 4) of the parameters of the affine-type components
+       (including TdnnComponent and LinearComponent) whose names match the
+       pattern that have the smallest 2-norms, so that a proportion <s> of the
+       blocks are zero; see
+       PruneNnetBlocks().  <name-pattern> defaults to "*".  The pruned
+       components are run with block-sparse kernels once the model has been
+       prepared for test, if they are sparse enough (by default, if <s> is at
+       least 0.9).
+
     reduce-rank name=<name-pattern> rank=<dim>
        Locates all components with names matching <name-pattern>, which are
        type AffineComponent or child classes thereof.  Does SVD on the
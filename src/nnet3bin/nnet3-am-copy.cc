@@ -50,7 +50,8 @@ int main(int argc, char *argv[]) {
     std::string set_raw_nnet = "";
     bool convert_repeated_to_block = false;
     BaseFloat scale = 1.0;
-    bool prepare_for_test = false;
+    bool prepare_for_test = false,
+        fuse_affine = false;
     std::string nnet_config, edits_config, edits_str;
 
     ParseOptions po(usage);
@@ -87,6 +88,12 @@ int main(int argc, char *argv[]) {
                 "slightly.  Involves setting test mode in dropout and batch-norm "
                 "components, and calling CollapseModel() which may remove some "
                 "components.");
+    po.Register("fuse-affine", &fuse_affine,
+                "If true, --prepare-for-test also replaces affine or TDNN "
+                "components followed by ReLU, batch-norm or dropout components "
+                "with FusedAffineComponent, which is faster.  Note: older "
+                "versions of Kaldi cannot read the resulting model.  The "
+                "decoding programs do this anyway after reading the model.");
 
     po.Read(argc, argv);
 
@@ -145,7 +152,9 @@ int main(int argc, char *argv[]) {
     if (prepare_for_test) {
       SetBatchnormTestMode(true, &am_nnet.GetNnet());
       SetDropoutTestMode(true, &am_nnet.GetNnet());
-      CollapseModel(CollapseModelConfig(), &am_nnet.GetNnet());
+      CollapseModelConfig collapse_config;
+      collapse_config.fuse_affine = fuse_affine;
+      CollapseModel(collapse_config, &am_nnet.GetNnet());
     }
 
     if (raw) {
@@ -122,7 +122,8 @@ int main(int argc, char *argv[]) {
     RandomAccessBaseFloatVectorReaderMapped ivector_reader(
         ivector_rspecifier, utt2spk_rspecifier);
 
-    CachingOptimizingCompiler compiler(nnet, opts.optimize_config);
+    CachingOptimizingCompiler compiler(nnet, opts.optimize_config,
+                                       opts.compiler_config);
 
     BaseFloatMatrixWriter matrix_writer(matrix_wspecifier);
 
@@ -44,7 +44,8 @@ int main(int argc, char *argv[]) {
     BaseFloat learning_rate = -1;
     std::string nnet_config, edits_config, edits_str;
     BaseFloat scale = 1.0;
-    bool prepare_for_test = false;
+    bool prepare_for_test = false,
+        fuse_affine = false;
     bool batchnorm_test_mode = false;
 
     ParseOptions po(usage);
@@ -71,6 +72,12 @@ int main(int argc, char *argv[]) {
                 "slightly.  Involves setting test mode in dropout and batch-norm "
                 "components, and calling CollapseModel() which may remove some "
                 "components.");
+    po.Register("fuse-affine", &fuse_affine,
+                "If true, --prepare-for-test also replaces affine or TDNN "
+                "components followed by ReLU, batch-norm or dropout components "
+                "with FusedAffineComponent, which is faster.  Note: older "
+                "versions of Kaldi cannot read the resulting model.  The "
+                "decoding programs do this anyway after reading the model.");
     po.Register("batchnorm-test-mode", &batchnorm_test_mode,
                 "Batch-norm components' test mode is set to this value. "
                 "The deafult is false, but is overriden when --prepare-for-test is "
@@ -114,7 +121,9 @@ int main(int argc, char *argv[]) {
     if (prepare_for_test) {
       SetBatchnormTestMode(true, &nnet);
       SetDropoutTestMode(true, &nnet);
-      CollapseModel(CollapseModelConfig(), &nnet);
+      CollapseModelConfig collapse_config;
+      collapse_config.fuse_affine = fuse_affine;
+      CollapseModel(collapse_config, &nnet);
     }
     else {
       SetBatchnormTestMode(batchnorm_test_mode, &nnet);
@@ -138,7 +138,8 @@ int main(int argc, char *argv[]) {
     // this compiler object allows caching of computations across
     // different utterances.
     CachingOptimizingCompiler compiler(am_nnet.GetNnet(),
-                                       decodable_opts.optimize_config);
+                                       decodable_opts.optimize_config,
+                                       decodable_opts.compiler_config);
 
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -55,6 +55,7 @@ int main(int argc, char *argv[]) {
     Timer timer;
     bool allow_partial = false;
     TaskSequencerConfig sequencer_config; // has --num-threads option
+    int32 num_determinize_threads = 0;
     LatticeFasterDecoderConfig config;
     NnetSimpleComputationOptions decodable_opts;
 
@@ -70,6 +71,10 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "If true, produce output even if end state was not reached.");
+    po.Register("num-determinize-threads", &num_determinize_threads,
+                "If > 0, the lattices are determinized by this many separate "
+                "threads rather than by the decoding threads, so that the "
+                "decoding does not wait for the determinization.");
     po.Register("ivectors", &ivector_rspecifier, "Rspecifier for "
                 "iVectors as vectors (i.e. not estimated online); per utterance "
                 "by default, or per speaker if you provide the --utt2spk option.");
@@ -87,6 +92,10 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    if (!decodable_opts.compiler_config.cache_filename.empty())
+      KALDI_WARN << "--computation-cache is not supported by this program "
+                 << "(each utterance has its own compiler); ignoring it.";
+
     std::string model_in_filename = po.GetArg(1),
         fst_in_str = po.GetArg(2),
         feature_rspecifier = po.GetArg(3),
@@ -94,6 +103,13 @@ int main(int argc, char *argv[]) {
         words_wspecifier = po.GetOptArg(5),
         alignment_wspecifier = po.GetOptArg(6);
 
+    // The determinizer is declared first, so that it is destroyed after the
+    // decoding tasks, which give their lattices to it.
+    TaskSequencerConfig determinizer_config;
+    determinizer_config.num_threads = num_determinize_threads;
+    TaskSequencer<DeterminizeLatticeClass> determinizer(determinizer_config);
+    TaskSequencer<DeterminizeLatticeClass> *determinizer_ptr =
+        (num_determinize_threads > 0 ? &determinizer : NULL);
     TaskSequencer<DecodeUtteranceLatticeFasterClass> sequencer(sequencer_config);
     TransitionModel trans_model;
     AmNnetSimple am_nnet;
@@ -185,13 +201,15 @@ int main(int argc, char *argv[]) {
                   trans_model, word_syms, utt, decodable_opts.acoustic_scale,
                   determinize, allow_partial, &alignment_writer, &words_writer,
                    &compact_lattice_writer, &lattice_writer,
-                   &tot_like, &frame_count, &num_success, &num_fail, NULL);
+                   &tot_like, &frame_count, &num_success, &num_fail, NULL,
+                   determinizer_ptr);
 
           sequencer.Run(task); // takes ownership of "task",
                                // and will delete it when done.
         }
       }
       sequencer.Wait(); // Waits for all tasks to be done.
+      determinizer.Wait();
       delete decode_fst;
     } else { // We have different FSTs for different utterances.
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
@@ -249,12 +267,14 @@ int main(int argc, char *argv[]) {
                 trans_model, word_syms, utt, decodable_opts.acoustic_scale,
                 determinize, allow_partial, &alignment_writer, &words_writer,
                 &compact_lattice_writer, &lattice_writer,
-                &tot_like, &frame_count, &num_success, &num_fail, NULL);
+                &tot_like, &frame_count, &num_success, &num_fail, NULL,
+                determinizer_ptr);
 
         sequencer.Run(task); // takes ownership of "task",
         // and will delete it when done.
       }
       sequencer.Wait(); // Waits for all tasks to be done.
+      determinizer.Wait();
     }
 
     kaldi::int64 input_frame_count =
@@ -25,10 +25,97 @@
 #include "hmm/transition-model.h"
 #include "fstext/fstext-lib.h"
 #include "decoder/decoder-wrappers.h"
+#include "decoder/flat-fst.h"
 #include "nnet3/nnet-am-decodable-simple.h"
 #include "nnet3/nnet-utils.h"
 #include "base/timer.h"
 
+namespace kaldi {
+namespace nnet3 {
+
+// Decodes all the utterances in 'feature_reader' with 'decoder'.  This is
+// templated so that the decoding graph can be either an OpenFst FST or a
+// FlatFst.  'ivector_reader' and 'online_ivector_reader' are used if they are
+// open.
+template <typename FST>
+void DecodeAllUtterances(LatticeFasterDecoderTpl<FST> &decoder,
+                         const TransitionModel &trans_model,
+                         const AmNnetSimple &am_nnet,
+                         const NnetSimpleComputationOptions &decodable_opts,
+                         const fst::SymbolTable *word_syms,
+                         bool determinize,
+                         bool allow_partial,
+                         RandomAccessBaseFloatVectorReaderMapped *ivector_reader,
+                         RandomAccessBaseFloatMatrixReader *online_ivector_reader,
+                         int32 online_ivector_period,
+                         CachingOptimizingCompiler *compiler,
+                         SequentialBaseFloatMatrixReader *feature_reader,
+                         Int32VectorWriter *alignment_writer,
+                         Int32VectorWriter *words_writer,
+                         CompactLatticeWriter *compact_lattice_writer,
+                         LatticeWriter *lattice_writer,
+                         Output *decoder_stats_output,
+                         const std::string &decoder_stats_format,
+                         double *tot_like,
+                         int64 *frame_count,
+                         int *num_success,
+                         int *num_fail) {
+  for (; !feature_reader->Done(); feature_reader->Next()) {
+    std::string utt = feature_reader->Key();
+    const Matrix<BaseFloat> &features (feature_reader->Value());
+    if (features.NumRows() == 0) {
+      KALDI_WARN << "Zero-length utterance: " << utt;
+      (*num_fail)++;
+      continue;
+    }
+    const Matrix<BaseFloat> *online_ivectors = NULL;
+    const Vector<BaseFloat> *ivector = NULL;
+    if (ivector_reader->IsOpen()) {
+      if (!ivector_reader->HasKey(utt)) {
+        KALDI_WARN << "No iVector available for utterance " << utt;
+        (*num_fail)++;
+        continue;
+      } else {
+        ivector = &ivector_reader->Value(utt);
+      }
+    }
+    if (online_ivector_reader->IsOpen()) {
+      if (!online_ivector_reader->HasKey(utt)) {
+        KALDI_WARN << "No online iVector available for utterance " << utt;
+        (*num_fail)++;
+        continue;
+      } else {
+        online_ivectors = &online_ivector_reader->Value(utt);
+      }
+    }
+
+    DecodableAmNnetSimple nnet_decodable(
+        decodable_opts, trans_model, am_nnet,
+        features, ivector, online_ivectors,
+        online_ivector_period, compiler);
+
+    double like;
+    if (DecodeUtteranceLatticeFaster(
+            decoder, nnet_decodable, trans_model, word_syms, utt,
+            decodable_opts.acoustic_scale, determinize, allow_partial,
+            alignment_writer, words_writer, compact_lattice_writer,
+            lattice_writer, &like)) {
+      *tot_like += like;
+      *frame_count += nnet_decodable.NumFramesReady();
+      (*num_success)++;
+    } else (*num_fail)++;
+    if (decoder_stats_output->IsOpen()) {
+      if (decoder_stats_format == "json")
+        decoder.Stats().WriteJson(utt, decoder_stats_output->Stream());
+      else
+        decoder.Stats().WriteTable(utt, true, decoder_stats_output->Stream());
+    }
+  }
+}
+
+}  // namespace nnet3
+}  // namespace kaldi
+
 
 int main(int argc, char *argv[]) {
   // note: making this program work with GPUs is as simple as initializing the
@@ -46,6 +133,7 @@ int main(int argc, char *argv[]) {
         "Generate lattices using nnet3 neural net model.\n"
         "Usage: nnet3-latgen-faster [options] <nnet-in> <fst-in|fsts-rspecifier> <features-rspecifier>"
         " <lattice-wspecifier> [ <words-wspecifier> [<alignments-wspecifier>] ]\n"
+        "fst-in may also be a FlatFst, as created by make-flat-fst.\n"
         "See also: nnet3-latgen-faster-parallel, nnet3-latgen-faster-batch\n";
     ParseOptions po(usage);
     Timer timer;
@@ -58,6 +146,9 @@ int main(int argc, char *argv[]) {
         online_ivector_rspecifier,
         utt2spk_rspecifier;
     int32 online_ivector_period = 0;
+    bool quantize = false;
+    bool use_mmap = false;
+    std::string decoder_stats_wxfilename, decoder_stats_format = "json";
     config.Register(&po);
     decodable_opts.Register(&po);
     po.Register("word-symbol-table", &word_syms_filename,
@@ -75,6 +166,23 @@ int main(int argc, char *argv[]) {
     po.Register("online-ivector-period", &online_ivector_period, "Number of frames "
                 "between iVectors in matrices supplied to the --online-ivectors "
                 "option");
+    po.Register("quantize", &quantize,
+                "If true, convert the affine, linear and TDNN components of "
+                "the model to 8-bit integer versions after reading it, for "
+                "faster computation on CPU (see also nnet3-quantize, which "
+                "can keep sensitive components in floating point).");
+    po.Register("use-mmap", &use_mmap,
+                "If true, memory-map <fst-in> instead of reading it, if it is a "
+                "single ConstFst written with --fst_align=true (a FlatFst is "
+                "always read).");
+    po.Register("write-decoder-stats", &decoder_stats_wxfilename,
+                "If set, write per-utterance and per-frame decoder statistics "
+                "(active tokens, arcs expanded, pruning, lattice size) to this "
+                "file.  Requires the decoder library to have been compiled "
+                "with -DKALDI_DECODER_STATS.");
+    po.Register("decoder-stats-format", &decoder_stats_format,
+                "Format for --write-decoder-stats: \"json\" (one JSON object "
+                "per line) or \"table\" (space-separated text).");
 
     po.Read(argc, argv);
 
@@ -90,6 +198,19 @@ int main(int argc, char *argv[]) {
         words_wspecifier = po.GetOptArg(5),
         alignment_wspecifier = po.GetOptArg(6);
 
+    if (decoder_stats_format != "json" && decoder_stats_format != "table")
+      KALDI_ERR << "Invalid --decoder-stats-format: " << decoder_stats_format;
+    Output decoder_stats_output;
+    if (!decoder_stats_wxfilename.empty()) {
+      if (!DecoderStatsEnabled())
+        KALDI_WARN << "--write-decoder-stats: the decoder was compiled "
+                   << "without -DKALDI_DECODER_STATS, so the stats will be "
+                   << "zero.";
+      if (!decoder_stats_output.Open(decoder_stats_wxfilename, false, false))
+        KALDI_ERR << "Could not open " << decoder_stats_wxfilename
+                  << " for writing decoder stats.";
+    }
+
     TransitionModel trans_model;
     AmNnetSimple am_nnet;
     {
@@ -100,6 +221,10 @@ int main(int argc, char *argv[]) {
       SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
       SetDropoutTestMode(true, &(am_nnet.GetNnet()));
       CollapseModel(CollapseModelConfig(), &(am_nnet.GetNnet()));
+      if (quantize) {
+        int32 num_quantized = QuantizeNnet("*", &(am_nnet.GetNnet()));
+        KALDI_LOG << "Quantized " << num_quantized << " components.";
+      }
     }
 
     bool determinize = config.determinize_lattice;
@@ -130,66 +255,43 @@ int main(int argc, char *argv[]) {
     // this compiler object allows caching of computations across
     // different utterances.
     CachingOptimizingCompiler compiler(am_nnet.GetNnet(),
-                                       decodable_opts.optimize_config);
+                                       decodable_opts.optimize_config,
+                                       decodable_opts.compiler_config);
 
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
-      // Input FST is just one FST, not a table of FSTs.
-      Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      // Input FST is just one FST, not a table of FSTs.  It may be either a
+      // normal FST or a FlatFst (see make-flat-fst).
+      Fst<StdArc> *decode_fst = NULL;
+      fst::FlatFst *flat_fst = fst::ReadDecodingGraph(fst_in_str, &decode_fst,
+                                                      use_mmap);
       timer.Reset();
 
-      {
+      if (flat_fst != NULL) {
+        LatticeFasterDecoderTpl<fst::FlatFst> decoder(*flat_fst, config);
+        DecodeAllUtterances(decoder, trans_model, am_nnet, decodable_opts,
+                            word_syms, determinize, allow_partial,
+                            &ivector_reader, &online_ivector_reader,
+                            online_ivector_period, &compiler, &feature_reader,
+                            &alignment_writer, &words_writer,
+                            &compact_lattice_writer, &lattice_writer,
+                            &decoder_stats_output, decoder_stats_format,
+                            &tot_like, &frame_count, &num_success, &num_fail);
+      } else {
         LatticeFasterDecoder decoder(*decode_fst, config);
-
-        for (; !feature_reader.Done(); feature_reader.Next()) {
-          std::string utt = feature_reader.Key();
-          const Matrix<BaseFloat> &features (feature_reader.Value());
-          if (features.NumRows() == 0) {
-            KALDI_WARN << "Zero-length utterance: " << utt;
-            num_fail++;
-            continue;
-          }
-          const Matrix<BaseFloat> *online_ivectors = NULL;
-          const Vector<BaseFloat> *ivector = NULL;
-          if (!ivector_rspecifier.empty()) {
-            if (!ivector_reader.HasKey(utt)) {
-              KALDI_WARN << "No iVector available for utterance " << utt;
-              num_fail++;
-              continue;
-            } else {
-              ivector = &ivector_reader.Value(utt);
-            }
-          }
-          if (!online_ivector_rspecifier.empty()) {
-            if (!online_ivector_reader.HasKey(utt)) {
-              KALDI_WARN << "No online iVector available for utterance " << utt;
-              num_fail++;
-              continue;
-            } else {
-              online_ivectors = &online_ivector_reader.Value(utt);
-            }
-          }
-
-          DecodableAmNnetSimple nnet_decodable(
-              decodable_opts, trans_model, am_nnet,
-              features, ivector, online_ivectors,
-              online_ivector_period, &compiler);
-
-          double like;
-          if (DecodeUtteranceLatticeFaster(
-                  decoder, nnet_decodable, trans_model, word_syms, utt,
-                  decodable_opts.acoustic_scale, determinize, allow_partial,
-                  &alignment_writer, &words_writer, &compact_lattice_writer,
-                  &lattice_writer,
-                  &like)) {
-            tot_like += like;
-            frame_count += nnet_decodable.NumFramesReady();
-            num_success++;
-          } else num_fail++;
-        }
+        DecodeAllUtterances(decoder, trans_model, am_nnet, decodable_opts,
+                            word_syms, determinize, allow_partial,
+                            &ivector_reader, &online_ivector_reader,
+                            online_ivector_period, &compiler, &feature_reader,
+                            &alignment_writer, &words_writer,
+                            &compact_lattice_writer, &lattice_writer,
+                            &decoder_stats_output, decoder_stats_format,
+                            &tot_like, &frame_count, &num_success, &num_fail);
       }
-      delete decode_fst; // delete this only after decoder goes out of scope.
+      // delete these only after the decoder goes out of scope.
+      delete decode_fst;
+      delete flat_fst;
     } else { // We have different FSTs for different utterances.
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
       RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -246,6 +348,13 @@ int main(int argc, char *argv[]) {
           frame_count += nnet_decodable.NumFramesReady();
           num_success++;
         } else num_fail++;
+        if (decoder_stats_output.IsOpen()) {
+          if (decoder_stats_format == "json")
+            decoder.Stats().WriteJson(utt, decoder_stats_output.Stream());
+          else
+            decoder.Stats().WriteTable(utt, true,
+                                       decoder_stats_output.Stream());
+        }
       }
     }
 
@@ -0,0 +1,167 @@
+// nnet3bin/nnet3-prune.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "nnet3/am-nnet-simple.h"
+#include "nnet3/nnet-output-eval.h"
+#include "nnet3/nnet-utils.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Prunes the affine, linear and TDNN components of an nnet3 acoustic\n"
+        "model so that a proportion --sparsity of the blocks of --block-size\n"
+        "rows by one column of their parameter matrices are zero (the blocks\n"
+        "with the smallest 2-norms are chosen).  The output model is still in\n"
+        "floating point and can be trained further; when it is prepared for\n"
+        "test (e.g. by the decoding programs or nnet3-am-copy\n"
+        "--prepare-for-test), components that are sparse enough (by default,\n"
+        "with at least 90% of the blocks zero) are converted to block-sparse\n"
+        "versions that only do the computation for the nonzero blocks.\n"
+        "If --eval-feats is given, the output of the network and the time\n"
+        "taken to compute it on those features is compared before and after\n"
+        "pruning (with the network prepared for test in both cases).\n"
+        "\n"
+        "Usage: nnet3-prune [options] <model-in> <model-out>\n"
+        "e.g.: nnet3-prune --block-size=8 --sparsity=0.9 \\\n"
+        "   --eval-feats='ark:head -n 20 feats.scp | copy-feats scp:- ark:- |' \\\n"
+        "   final.mdl final_pruned.mdl\n"
+        "See also: nnet3-am-copy, and the 'prune-blocks' directive of "
+        "--edits.\n";
+
+    ParseOptions po(usage);
+
+    NnetSimpleComputationOptions opts;
+    opts.acoustic_scale = 1.0;
+
+    bool binary_write = true;
+    std::string name_pattern = "*",
+        eval_rspecifier,
+        ivector_rspecifier,
+        online_ivector_rspecifier,
+        utt2spk_rspecifier;
+    int32 block_size = 4, online_ivector_period = 0;
+    BaseFloat sparsity = 0.9;
+
+    opts.Register(&po);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("name-pattern", &name_pattern, "Only components whose names "
+                "match this pattern (which may contain '*') are pruned.");
+    po.Register("block-size", &block_size, "Number of consecutive rows of "
+                "the parameter matrices in each block (4, 8 or 16).");
+    po.Register("sparsity", &sparsity, "Proportion of the blocks of each "
+                "parameter matrix that are set to zero.");
+    po.Register("eval-feats", &eval_rspecifier, "Rspecifier of features "
+                "on which to report the change in the output of the network, "
+                "and the speed of the computation, before and after "
+                "pruning.");
+    po.Register("ivectors", &ivector_rspecifier, "Rspecifier for "
+                "iVectors as vectors (i.e. not estimated online); per utterance "
+                "by default, or per speaker if you provide the --utt2spk option.");
+    po.Register("utt2spk", &utt2spk_rspecifier, "Rspecifier for "
+                "utt2spk option used to get ivectors per speaker");
+    po.Register("online-ivectors", &online_ivector_rspecifier, "Rspecifier for "
+                "iVectors estimated online, as matrices.  If you supply this,"
+                " you must set the --online-ivector-period option.");
+    po.Register("online-ivector-period", &online_ivector_period, "Number of "
+                "frames between iVectors in matrices supplied to the "
+                "--online-ivectors option");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+    if (!(block_size == 4 || block_size == 8 || block_size == 16))
+      KALDI_ERR << "Invalid --block-size=" << block_size;
+    if (sparsity < 0.0 || sparsity > 1.0)
+      KALDI_ERR << "Invalid --sparsity=" << sparsity;
+
+    std::string model_rxfilename = po.GetArg(1),
+        model_wxfilename = po.GetArg(2);
+
+    TransitionModel trans_model;
+    AmNnetSimple am_nnet;
+    {
+      bool binary;
+      Input ki(model_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+    }
+    Nnet &nnet = am_nnet.GetNnet();
+    Nnet orig_nnet(nnet);
+
+    int32 num_pruned = PruneNnetBlocks(name_pattern, block_size, sparsity,
+                                       &nnet);
+    KALDI_LOG << "Pruned " << num_pruned << " components.";
+
+    if (!eval_rspecifier.empty()) {
+      std::vector<NnetEvalUtterance*> utts;
+      int64 num_frames = ReadNnetEvalUtterances(
+          eval_rspecifier, ivector_rspecifier, online_ivector_rspecifier,
+          utt2spk_rspecifier, &utts);
+      if (utts.empty())
+        KALDI_ERR << "No features were read from " << eval_rspecifier;
+
+      // Prepare both networks for test, as the decoding programs would.
+      Nnet pruned_nnet(nnet);
+      SetBatchnormTestMode(true, &orig_nnet);
+      SetDropoutTestMode(true, &orig_nnet);
+      CollapseModel(CollapseModelConfig(), &orig_nnet);
+      SetBatchnormTestMode(true, &pruned_nnet);
+      SetDropoutTestMode(true, &pruned_nnet);
+      CollapseModel(CollapseModelConfig(), &pruned_nnet);
+
+      BaseFloat relative_change;
+      double orig_time = EvaluateNnetOutput(opts, orig_nnet,
+                                            online_ivector_period, true,
+                                            utts, NULL),
+          pruned_time = EvaluateNnetOutput(opts, pruned_nnet,
+                                           online_ivector_period, false,
+                                           utts, &relative_change);
+      KALDI_LOG << "Relative change in output on " << utts.size()
+                << " utterances (" << num_frames << " frames) is "
+                << relative_change;
+      KALDI_LOG << "Time taken to compute the output was " << orig_time
+                << "s before pruning and " << pruned_time
+                << "s after pruning; speedup is "
+                << (orig_time / pruned_time);
+      DeletePointers(&utts);
+    }
+
+    {
+      Output ko(model_wxfilename, binary_write);
+      trans_model.Write(ko.Stream(), binary_write);
+      am_nnet.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Wrote model to " << model_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
@@ -0,0 +1,225 @@
+// nnet3bin/nnet3-quantize.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "nnet3/am-nnet-simple.h"
+#include "nnet3/nnet-output-eval.h"
+#include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-parse.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Returns the relative change in the output of 'nnet' versus the stored
+// output of the unquantized network (see EvaluateNnetOutput()).
+BaseFloat ComputeRelativeChange(
+    const NnetSimpleComputationOptions &opts,
+    const Nnet &nnet,
+    int32 online_ivector_period,
+    const std::vector<NnetEvalUtterance*> &utts) {
+  BaseFloat relative_change;
+  EvaluateNnetOutput(opts, nnet, online_ivector_period, false, utts,
+                     &relative_change);
+  return relative_change;
+}
+
+// Quantizes the components of 'nnet' whose indexes are in 'components'.
+void QuantizeComponents(const std::vector<int32> &components, Nnet *nnet) {
+  for (size_t i = 0; i < components.size(); i++) {
+    const std::string &name = nnet->GetComponentName(components[i]);
+    if (QuantizeNnet(name, nnet) != 1)
+      KALDI_ERR << "Could not quantize component " << name
+                << " (does its name contain wildcards?)";
+  }
+}
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Converts the affine, linear and TDNN components of an nnet3 acoustic\n"
+        "model to versions with 8-bit integer weights, for faster decoding on\n"
+        "CPU.  If --calibration-feats is given, the output of the network is\n"
+        "computed on these features before and after quantization, and the\n"
+        "components whose quantization changes the output the most are kept\n"
+        "in floating point until the relative change in the output is no more\n"
+        "than --max-relative-change.  Batchnorm and dropout components are set\n"
+        "to test mode and the model is collapsed (see nnet3-am-copy\n"
+        "--prepare-for-test) before quantizing.\n"
+        "\n"
+        "Usage: nnet3-quantize [options] <model-in> <model-out>\n"
+        "e.g.: nnet3-quantize --calibration-feats='ark:head -n 20 feats.scp |\n"
+        "   copy-feats scp:- ark:- |' final.mdl final_quantized.mdl\n"
+        "See also: nnet3-am-copy, and the 'quantize' directive of --edits.\n";
+
+    ParseOptions po(usage);
+
+    NnetSimpleComputationOptions opts;
+    opts.acoustic_scale = 1.0;
+
+    bool binary_write = true;
+    std::string name_pattern = "*",
+        calibration_rspecifier,
+        ivector_rspecifier,
+        online_ivector_rspecifier,
+        utt2spk_rspecifier;
+    int32 online_ivector_period = 0;
+    BaseFloat max_relative_change = 0.05;
+
+    opts.Register(&po);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("name-pattern", &name_pattern, "Only components whose names "
+                "match this pattern (which may contain '*') are quantized.");
+    po.Register("calibration-feats", &calibration_rspecifier, "Rspecifier "
+                "of features used to decide which components to keep in "
+                "floating point; if not given, all components are quantized.");
+    po.Register("max-relative-change", &max_relative_change, "Maximum "
+                "relative change in the output of the network on the "
+                "calibration features (in Frobenius norm) that quantization "
+                "is allowed to cause.");
+    po.Register("ivectors", &ivector_rspecifier, "Rspecifier for "
+                "iVectors as vectors (i.e. not estimated online); per utterance "
+                "by default, or per speaker if you provide the --utt2spk option.");
+    po.Register("utt2spk", &utt2spk_rspecifier, "Rspecifier for "
+                "utt2spk option used to get ivectors per speaker");
+    po.Register("online-ivectors", &online_ivector_rspecifier, "Rspecifier for "
+                "iVectors estimated online, as matrices.  If you supply this,"
+                " you must set the --online-ivector-period option.");
+    po.Register("online-ivector-period", &online_ivector_period, "Number of "
+                "frames between iVectors in matrices supplied to the "
+                "--online-ivectors option");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string model_rxfilename = po.GetArg(1),
+        model_wxfilename = po.GetArg(2);
+
+    TransitionModel trans_model;
+    AmNnetSimple am_nnet;
+    {
+      bool binary;
+      Input ki(model_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+    }
+    Nnet &nnet = am_nnet.GetNnet();
+    SetBatchnormTestMode(true, &nnet);
+    SetDropoutTestMode(true, &nnet);
+    CollapseModel(CollapseModelConfig(), &nnet);
+
+    if (calibration_rspecifier.empty()) {
+      int32 num_quantized = QuantizeNnet(name_pattern, &nnet);
+      KALDI_LOG << "Quantized " << num_quantized << " components.";
+    } else {
+      // Work out which components would be quantized.
+      std::vector<int32> candidates;
+      {
+        Nnet nnet_copy(nnet);
+        for (int32 c = 0; c < nnet.NumComponents(); c++) {
+          const std::string &name = nnet.GetComponentName(c);
+          if (NameMatchesPattern(name.c_str(), name_pattern.c_str()) &&
+              QuantizeNnet(name, &nnet_copy) == 1)
+            candidates.push_back(c);
+        }
+      }
+
+      std::vector<NnetEvalUtterance*> utts;
+      ReadNnetEvalUtterances(calibration_rspecifier, ivector_rspecifier,
+                             online_ivector_rspecifier, utt2spk_rspecifier,
+                             &utts);
+      if (utts.empty())
+        KALDI_ERR << "No calibration data was read from "
+                  << calibration_rspecifier;
+      EvaluateNnetOutput(opts, nnet, online_ivector_period, true, utts, NULL);
+
+      Nnet nnet_quantized(nnet);
+      QuantizeComponents(candidates, &nnet_quantized);
+      BaseFloat change = ComputeRelativeChange(opts, nnet_quantized,
+                                               online_ivector_period, utts);
+      KALDI_LOG << "Relative change in output with all " << candidates.size()
+                << " components quantized is " << change;
+
+      if (change > max_relative_change) {
+        // Measure the effect of quantizing each component on its own, and
+        // keep the worst ones in floating point until the change is small
+        // enough.
+        std::vector<std::pair<BaseFloat, int32> > component_changes;
+        for (size_t i = 0; i < candidates.size(); i++) {
+          Nnet nnet_copy(nnet);
+          QuantizeComponents(std::vector<int32>(1, candidates[i]), &nnet_copy);
+          BaseFloat this_change = ComputeRelativeChange(
+              opts, nnet_copy, online_ivector_period, utts);
+          KALDI_LOG << "Relative change in output from quantizing component "
+                    << nnet.GetComponentName(candidates[i]) << " is "
+                    << this_change;
+          component_changes.push_back(std::pair<BaseFloat, int32>(
+              this_change, candidates[i]));
+        }
+        std::sort(component_changes.begin(), component_changes.end());
+        while (change > max_relative_change && !component_changes.empty()) {
+          KALDI_LOG << "Keeping component "
+                    << nnet.GetComponentName(component_changes.back().second)
+                    << " in floating point.";
+          component_changes.pop_back();
+          candidates.clear();
+          for (size_t i = 0; i < component_changes.size(); i++)
+            candidates.push_back(component_changes[i].second);
+          std::sort(candidates.begin(), candidates.end());
+          nnet_quantized = nnet;
+          QuantizeComponents(candidates, &nnet_quantized);
+          change = ComputeRelativeChange(opts, nnet_quantized,
+                                         online_ivector_period, utts);
+          KALDI_LOG << "Relative change in output with " << candidates.size()
+                    << " components quantized is " << change;
+        }
+      }
+      nnet = nnet_quantized;
+      KALDI_LOG << "Quantized " << candidates.size() << " components; "
+                << "relative change in output on " << utts.size()
+                << " calibration utterances is " << change;
+      DeletePointers(&utts);
+    }
+
+    {
+      Output ko(model_wxfilename, binary_write);
+      trans_model.Write(ko.Stream(), binary_write);
+      am_nnet.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Wrote model to " << model_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
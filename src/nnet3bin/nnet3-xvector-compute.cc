@@ -144,6 +144,8 @@ int main(int argc, char *argv[]) {
     SetDropoutTestMode(true, &nnet);
     CollapseModel(CollapseModelConfig(), &nnet);
 
+    // --computation-cache is registered by 'opts'.
+    compiler_config.cache_filename = opts.compiler_config.cache_filename;
     CachingOptimizingCompiler compiler(nnet, opts.optimize_config, compiler_config);
 
     if (!cached_compiler_in.empty()) {
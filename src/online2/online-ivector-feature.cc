@@ -43,6 +43,7 @@ void OnlineIvectorExtractionInfo::Init(
     use_most_recent_ivector = true;
   }
   max_remembered_frames = config.max_remembered_frames;
+  max_ivector_history = config.max_ivector_history;
 
   std::string note = "(note: this may be needed "
       "in the file supplied to --ivector-extractor-config)";
@@ -99,7 +100,7 @@ void OnlineIvectorExtractionInfo::Check() const {
 OnlineIvectorExtractionInfo::OnlineIvectorExtractionInfo():
     online_cmvn_iextractor(false), ivector_period(0), num_gselect(0), min_post(0.0), posterior_scale(0.0),
     use_most_recent_ivector(true), greedy_ivector_extractor(false),
-    max_remembered_frames(0) { }
+    max_remembered_frames(0), max_ivector_history(-1) { }
 
 OnlineIvectorExtractorAdaptationState::OnlineIvectorExtractorAdaptationState(
     const OnlineIvectorExtractorAdaptationState &other):
@@ -269,8 +270,8 @@ void OnlineIvectorFeature::UpdateStatsUntilFrame(int32 frame) {
       ivector_stats_.GetIvector(num_cg_iters, &current_ivector_);
       if (!info_.use_most_recent_ivector) {  // need to cache iVectors.
         int32 ivec_index = t / ivector_period;
-        KALDI_ASSERT(ivec_index == static_cast<int32>(ivectors_history_.size()));
-        ivectors_history_.push_back(new Vector<BaseFloat>(current_ivector_));
+        KALDI_ASSERT(ivec_index == ivectors_history_.Size());
+        ivectors_history_.PushBack(new Vector<BaseFloat>(current_ivector_));
       }
     }
   }
@@ -314,8 +315,8 @@ void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
       ivector_stats_.GetIvector(num_cg_iters, &current_ivector_);
       if (!info_.use_most_recent_ivector) {  // need to cache iVectors.
         int32 ivec_index = t / ivector_period;
-        KALDI_ASSERT(ivec_index == static_cast<int32>(ivectors_history_.size()));
-        ivectors_history_.push_back(new Vector<BaseFloat>(current_ivector_));
+        KALDI_ASSERT(ivec_index == ivectors_history_.Size());
+        ivectors_history_.PushBack(new Vector<BaseFloat>(current_ivector_));
       }
     }
   }
@@ -348,8 +349,8 @@ void OnlineIvectorFeature::GetFrame(int32 frame,
   } else {
     int32 i = frame / info_.ivector_period;  // rounds down.
     // if the following fails, UpdateStatsUntilFrame would have a bug.
-    KALDI_ASSERT(static_cast<size_t>(i) <  ivectors_history_.size());
-    feat->CopyFromVec(*(ivectors_history_[i]));
+    KALDI_ASSERT(i < ivectors_history_.Size());
+    feat->CopyFromVec(*(ivectors_history_.At(i)));
     (*feat)(0) -= info_.extractor.PriorOffset();
   }
 }
@@ -379,8 +380,6 @@ OnlineIvectorFeature::~OnlineIvectorFeature() {
   // Delete objects owned here.
   for (size_t i = 0; i < to_delete_.size(); i++)
     delete to_delete_[i];
-  for (size_t i = 0; i < ivectors_history_.size(); i++)
-    delete ivectors_history_[i];
 }
 
 void OnlineIvectorFeature::GetAdaptationState(
@@ -406,7 +405,9 @@ OnlineIvectorFeature::OnlineIvectorFeature(
                    info_.max_count),
     num_frames_stats_(0), delta_weights_provided_(false),
     updated_with_no_delta_weights_(false),
-    most_recent_frame_with_weight_(-1), tot_ubm_loglike_(0.0) {
+    most_recent_frame_with_weight_(-1), tot_ubm_loglike_(0.0),
+    ivectors_history_(info.max_ivector_history > 0 ?
+                      info.max_ivector_history : -1) {
   info.Check();
   KALDI_ASSERT(base_feature != NULL);
   OnlineFeatureInterface *splice_feature = new OnlineSpliceFrames(info_.splice_opts, base_feature);
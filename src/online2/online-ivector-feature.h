@@ -102,13 +102,19 @@ struct OnlineIvectorExtractionConfig {
   // by calling SetAdaptationState()).
   BaseFloat max_remembered_frames;
 
+  // Memory optimization: if larger than 0, only this number of the most
+  // recent iVectors (one per ivector_period frames) is retained when
+  // use_most_recent_ivector is false.
+  int32 max_ivector_history;
+
   OnlineIvectorExtractionConfig(): online_cmvn_iextractor(false),
                                    ivector_period(10), num_gselect(5),
                                    min_post(0.025), posterior_scale(0.1),
                                    max_count(0.0), num_cg_iters(15),
                                    use_most_recent_ivector(true),
                                    greedy_ivector_extractor(false),
-                                   max_remembered_frames(1000) { }
+                                   max_remembered_frames(1000),
+                                   max_ivector_history(-1) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("lda-matrix", &lda_mat_rxfilename, "Filename of LDA matrix, "
@@ -160,6 +166,10 @@ struct OnlineIvectorExtractionConfig {
                    "number allows the speaker adaptation state to change over "
                    "time).  Interpret as a real frame count, i.e. not a count "
                    "scaled by --posterior-scale.");
+    opts->Register("max-ivector-history", &max_ivector_history, "Memory "
+                   "optimization. If larger than 0, only this number of the "
+                   "latest iVectors is retained (only relevant with "
+                   "--use-most-recent-ivector=false).");
   }
 };
 
@@ -189,6 +199,7 @@ struct OnlineIvectorExtractionInfo {
   bool use_most_recent_ivector;
   bool greedy_ivector_extractor;
   BaseFloat max_remembered_frames;
+  int32 max_ivector_history;
 
   OnlineIvectorExtractionInfo(const OnlineIvectorExtractionConfig &config);
 
@@ -407,8 +418,9 @@ class OnlineIvectorFeature: public OnlineFeatureInterface {
   /// the iVector we estimated each info_.ivector_period frames so that
   /// GetFrame() can return the iVector that was active on that frame.
   /// ivectors_history_[i] contains the iVector we estimated on
-  /// frame t = i * info_.ivector_period.
-  std::vector<Vector<BaseFloat>* > ivectors_history_;
+  /// frame t = i * info_.ivector_period.  Only the latest
+  /// info_.max_ivector_history of them are kept, if that is > 0.
+  RecyclingVector ivectors_history_;
 
 };
 
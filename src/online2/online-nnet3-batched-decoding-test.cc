@@ -0,0 +1,179 @@
+// online2/online-nnet3-batched-decoding-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "online2/online-nnet3-batched-decoding.h"
+#include "online2/online-nnet3-decoding.h"
+#include "hmm/hmm-test-utils.h"
+#include "lat/lattice-functions.h"
+
+namespace kaldi {
+
+// Creates a small feed-forward neural net with 13-dimensional input (the
+// default MFCC dimension) and 'num_pdfs' outputs.
+static void CreateTestNnet(int32 num_pdfs, nnet3::Nnet *nnet) {
+  std::ostringstream config;
+  config << "input-node name=input dim=13\n"
+         << "component name=affine1 type=AffineComponent input-dim=39 "
+         << "output-dim=32\n"
+         << "component-node name=affine1 component=affine1 "
+         << "input=Append(Offset(input, -2), input, Offset(input, 2))\n"
+         << "component name=relu1 type=RectifiedLinearComponent dim=32\n"
+         << "component-node name=relu1 component=relu1 input=affine1\n"
+         << "component name=affine2 type=AffineComponent input-dim=32 "
+         << "output-dim=" << num_pdfs << "\n"
+         << "component-node name=affine2 component=affine2 input=relu1\n"
+         << "component name=logsoftmax type=LogSoftmaxComponent dim="
+         << num_pdfs << "\n"
+         << "component-node name=logsoftmax component=logsoftmax "
+         << "input=affine2\n"
+         << "output-node name=output input=logsoftmax\n";
+  std::istringstream is(config.str());
+  nnet->ReadConfig(is);
+}
+
+// Creates a decoding graph that accepts any sequence of transition-ids; the
+// output labels are the transition-ids, so the best path of a lattice gives
+// the alignment.
+static void CreateTestFst(const TransitionModel &trans_model,
+                          fst::StdVectorFst *fst) {
+  fst->DeleteStates();
+  fst::StdArc::StateId s = fst->AddState();
+  fst->SetStart(s);
+  fst->SetFinal(s, fst::TropicalWeight::One());
+  for (int32 tid = 1; tid <= trans_model.NumTransitionIds(); tid++)
+    fst->AddArc(s, fst::StdArc(tid, tid, fst::TropicalWeight::One(), s));
+}
+
+static void GetBestPath(const CompactLattice &clat,
+                        std::vector<int32> *alignment, BaseFloat *cost) {
+  KALDI_ASSERT(clat.NumStates() != 0);
+  CompactLattice best_path_clat;
+  CompactLatticeShortestPath(clat, &best_path_clat);
+  Lattice best_path;
+  ConvertLattice(best_path_clat, &best_path);
+  std::vector<int32> words;
+  LatticeWeight weight;
+  GetLinearSymbolSequence(best_path, alignment, &words, &weight);
+  *cost = weight.Value1() + weight.Value2();
+}
+
+// Checks that decoding several streams at the same time with
+// OnlineNnet3BatchedDecoder gives the same best paths as decoding them one
+// by one with SingleUtteranceNnet3Decoder.
+static void UnitTestBatchedDecoding() {
+  ContextDependency *ctx_dep = NULL;
+  TransitionModel *trans_model = GenRandTransitionModel(&ctx_dep);
+  nnet3::Nnet nnet;
+  CreateTestNnet(trans_model->NumPdfs(), &nnet);
+  nnet3::AmNnetSimple am_nnet(nnet);
+  fst::StdVectorFst fst;
+  CreateTestFst(*trans_model, &fst);
+
+  OnlineNnet2FeaturePipelineInfo feature_info;
+  feature_info.feature_type = "mfcc";
+  feature_info.use_ivectors = false;
+  feature_info.mfcc_opts.frame_opts.dither = 0.0;  // Makes it deterministic.
+  BaseFloat samp_freq = feature_info.mfcc_opts.frame_opts.samp_freq;
+
+  int32 num_streams = 3;
+  std::vector<Vector<BaseFloat> > waves(num_streams);
+  for (int32 i = 0; i < num_streams; i++) {
+    waves[i].Resize(RandInt(2000, 20000));
+    waves[i].SetRandn();
+    waves[i].Scale(1000.0);
+  }
+
+  LatticeFasterDecoderConfig decoder_opts;
+  std::vector<std::vector<int32> > ref_alignments(num_streams);
+  std::vector<BaseFloat> ref_costs(num_streams);
+  {
+    nnet3::NnetSimpleLoopedComputationOptions looped_opts;
+    nnet3::DecodableNnetSimpleLoopedInfo info(looped_opts, &am_nnet);
+    for (int32 i = 0; i < num_streams; i++) {
+      OnlineNnet2FeaturePipeline feature_pipeline(feature_info);
+      SingleUtteranceNnet3Decoder decoder(decoder_opts, *trans_model, info,
+                                          fst, &feature_pipeline);
+      feature_pipeline.AcceptWaveform(samp_freq, waves[i]);
+      feature_pipeline.InputFinished();
+      decoder.AdvanceDecoding();
+      decoder.FinalizeDecoding();
+      CompactLattice clat;
+      decoder.GetLattice(true, &clat);
+      GetBestPath(clat, &ref_alignments[i], &ref_costs[i]);
+    }
+  }
+
+  OnlineNnet3BatchedDecoderConfig batched_opts;
+  batched_opts.decoder_opts = decoder_opts;
+  // Use small chunks so that the streams have several chunks each.
+  batched_opts.compute_opts.frames_per_chunk = 10;
+  OnlineNnet3BatchedDecoder decoder(batched_opts, *trans_model, am_nnet, fst);
+  std::vector<OnlineNnet2FeaturePipeline*> pipelines(num_streams);
+  for (int32 i = 0; i < num_streams; i++) {
+    pipelines[i] = new OnlineNnet2FeaturePipeline(feature_info);
+    decoder.InitStream(i, pipelines[i]);
+  }
+  // Give the waveforms to the streams in interleaved pieces.
+  int32 piece_length = 1600;
+  std::vector<int32> offsets(num_streams, 0);
+  bool done = false;
+  while (!done) {
+    done = true;
+    for (int32 i = 0; i < num_streams; i++) {
+      int32 length = std::min(piece_length, waves[i].Dim() - offsets[i]);
+      if (length == 0)
+        continue;
+      SubVector<BaseFloat> piece(waves[i], offsets[i], length);
+      pipelines[i]->AcceptWaveform(samp_freq, piece);
+      offsets[i] += length;
+      if (offsets[i] == waves[i].Dim())
+        pipelines[i]->InputFinished();
+      else
+        done = false;
+      decoder.AcceptInput(i);
+    }
+  }
+  for (int32 i = 0; i < num_streams; i++) {
+    decoder.Wait(i);
+    decoder.FinalizeDecoding(i);
+    CompactLattice clat;
+    decoder.GetLattice(i, true, &clat);
+    std::vector<int32> alignment;
+    BaseFloat cost;
+    GetBestPath(clat, &alignment, &cost);
+    KALDI_ASSERT(alignment == ref_alignments[i]);
+    KALDI_ASSERT(ApproxEqual(cost, ref_costs[i], 1.0e-03));
+    decoder.CloseStream(i);
+    delete pipelines[i];
+  }
+  delete trans_model;
+  delete ctx_dep;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 3; i++)
+    UnitTestBatchedDecoding();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
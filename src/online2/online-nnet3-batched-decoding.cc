@@ -0,0 +1,441 @@
+// online2/online-nnet3-batched-decoding.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-nnet3-batched-decoding.h"
+#include "nnet3/nnet-utils.h"
+#include "lat/lattice-functions.h"
+#include "lat/determinize-lattice-pruned.h"
+
+namespace kaldi {
+
+OnlineNnet3BatchedDecoder::OnlineNnet3BatchedDecoder(
+    const OnlineNnet3BatchedDecoderConfig &config,
+    const TransitionModel &trans_model,
+    const nnet3::AmNnetSimple &am_nnet,
+    const fst::Fst<fst::StdArc> &fst):
+    config_(config),
+    trans_model_(trans_model),
+    fst_(fst),
+    computer_(config.compute_opts, am_nnet.GetNnet(), am_nnet.Priors()),
+    is_terminating_(false),
+    num_tasks_submitted_(0),
+    num_chunks_decoded_(0),
+    num_streams_(0),
+    decode_seconds_(0.0) {
+  KALDI_ASSERT(config_.num_decoder_threads > 0);
+  nnet3::ComputeSimpleNnetContext(am_nnet.GetNnet(), &nnet_left_context_,
+                                  &nnet_right_context_);
+  nnet_input_dim_ = am_nnet.GetNnet().InputDim("input");
+  nnet_ivector_dim_ = am_nnet.GetNnet().InputDim("ivector");
+  // NnetBatchComputer may have modified frames-per-chunk to be a multiple of
+  // the frame-subsampling-factor, so we take the options from there.
+  const nnet3::NnetBatchComputerOptions &opts = computer_.GetOptions();
+  frames_per_chunk_ = opts.frames_per_chunk;
+  frame_subsampling_factor_ = opts.frame_subsampling_factor;
+  KALDI_ASSERT(frames_per_chunk_ % frame_subsampling_factor_ == 0);
+  if (am_nnet.GetNnet().OutputDim("output") != trans_model_.NumPdfs())
+    KALDI_ERR << "Neural net output dim " << am_nnet.GetNnet().OutputDim("output")
+              << " does not match number of pdfs " << trans_model_.NumPdfs();
+
+  compute_thread_ = std::thread(ComputeFunc, this);
+  for (int32 i = 0; i < config_.num_decoder_threads; i++)
+    decode_threads_.push_back(new std::thread(DecodeFunc, this));
+}
+
+OnlineNnet3BatchedDecoder::StreamState* OnlineNnet3BatchedDecoder::GetStream(
+    int64 stream_id) {
+  std::unique_lock<std::mutex> lock(streams_mutex_);
+  std::unordered_map<int64, StreamState*>::iterator iter =
+      streams_.find(stream_id);
+  if (iter == streams_.end())
+    KALDI_ERR << "No such stream " << stream_id
+              << " (did you call InitStream()?)";
+  return iter->second;
+}
+
+void OnlineNnet3BatchedDecoder::InitStream(
+    int64 stream_id, OnlineNnet2FeaturePipeline *features) {
+  KALDI_ASSERT(features != NULL);
+  int32 feat_input_dim = features->InputFeature()->Dim(),
+      feat_ivector_dim = (features->IvectorFeature() != NULL ?
+                          features->IvectorFeature()->Dim() : -1);
+  if (nnet_input_dim_ != feat_input_dim)
+    KALDI_ERR << "Input feature dimension mismatch: got " << feat_input_dim
+              << " but network expects " << nnet_input_dim_;
+  if (nnet_ivector_dim_ != feat_ivector_dim)
+    KALDI_ERR << "Ivector feature dimension mismatch: got " << feat_ivector_dim
+              << " but network expects " << nnet_ivector_dim_;
+
+  StreamState *stream = new StreamState(config_.decoder_opts, trans_model_,
+                                        fst_, features);
+  {
+    std::unique_lock<std::mutex> lock(streams_mutex_);
+    if (!streams_.insert(std::make_pair(stream_id, stream)).second) {
+      delete stream;
+      KALDI_ERR << "Stream " << stream_id << " is already active.";
+    }
+  }
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  num_streams_++;
+}
+
+nnet3::NnetInferenceTask* OnlineNnet3BatchedDecoder::CreateTask(
+    StreamState *stream, int32 chunk_index, int32 num_feature_frames,
+    bool is_last_chunk) {
+  const nnet3::NnetBatchComputerOptions &opts = computer_.GetOptions();
+  int32 sf = frame_subsampling_factor_,
+      left_context = nnet_left_context_ + opts.extra_left_context,
+      right_context = nnet_right_context_ + opts.extra_right_context,
+      chunk_begin = chunk_index * frames_per_chunk_,
+      first_input_frame = chunk_begin - left_context,
+      num_input_frames = left_context + frames_per_chunk_ + right_context;
+
+  nnet3::NnetInferenceTask *task = new nnet3::NnetInferenceTask();
+  OnlineFeatureInterface *input_feature = stream->features->InputFeature();
+  {
+    // All chunks have the same structure, so that the chunks of all streams
+    // can be computed in the same minibatch; at the edges of the utterance we
+    // pad with copies of the first and last frames.
+    Matrix<BaseFloat> input(num_input_frames, input_feature->Dim(),
+                            kUndefined);
+    for (int32 i = 0; i < num_input_frames; i++) {
+      int32 t = first_input_frame + i;
+      if (t < 0) t = 0;
+      if (t >= num_feature_frames) t = num_feature_frames - 1;
+      SubVector<BaseFloat> row(input, i);
+      input_feature->GetFrame(t, &row);
+    }
+    task->input.Swap(&input);
+  }
+  task->first_input_t = -left_context;
+  task->output_t_stride = sf;
+  task->num_output_frames = frames_per_chunk_ / sf;
+  task->num_initial_unused_output_frames = 0;
+  if (is_last_chunk)
+    task->num_used_output_frames =
+        (num_feature_frames + sf - 1) / sf - chunk_begin / sf;
+  else
+    task->num_used_output_frames = task->num_output_frames;
+  KALDI_ASSERT(task->num_used_output_frames > 0 &&
+               task->num_used_output_frames <= task->num_output_frames);
+  task->first_used_output_frame_index = chunk_begin / sf;
+  task->is_edge = false;
+  task->is_irregular = false;
+  task->output_to_cpu = true;
+
+  OnlineIvectorFeature *ivector_feature = stream->features->IvectorFeature();
+  if (ivector_feature != NULL) {
+    // As in DecodableNnetLoopedOnlineBase, we use the iVector from the most
+    // recent frame that we can, rather than trying to be exact about it.
+    Vector<BaseFloat> ivector(ivector_feature->Dim());
+    int32 most_recent_input_frame = std::min(first_input_frame +
+                                             num_input_frames,
+                                             num_feature_frames) - 1,
+        num_ivector_frames_ready = ivector_feature->NumFramesReady();
+    if (num_ivector_frames_ready > 0)
+      ivector_feature->GetFrame(std::min(most_recent_input_frame,
+                                         num_ivector_frames_ready - 1),
+                                &ivector);
+    task->ivector.Swap(&ivector);
+  }
+  return task;
+}
+
+void OnlineNnet3BatchedDecoder::AcceptInput(int64 stream_id) {
+  StreamState *stream = GetStream(stream_id);
+  // 'input_finished' and 'num_chunks_submitted' are only changed from this
+  // thread, so we can read them without locking.
+  if (stream->input_finished)
+    return;
+
+  OnlineFeatureInterface *input_feature = stream->features->InputFeature();
+  int32 num_feature_frames = input_feature->NumFramesReady(),
+      sf = frame_subsampling_factor_,
+      right_context = nnet_right_context_ +
+          computer_.GetOptions().extra_right_context;
+  bool input_finished = input_feature->IsLastFrame(num_feature_frames - 1);
+
+  int32 num_chunks_ready;
+  if (input_finished) {
+    int32 num_output_frames = (num_feature_frames + sf - 1) / sf,
+        output_frames_per_chunk = frames_per_chunk_ / sf;
+    num_chunks_ready = (num_output_frames + output_frames_per_chunk - 1) /
+        output_frames_per_chunk;
+  } else {
+    num_chunks_ready = std::max<int32>(0, num_feature_frames - right_context) /
+        frames_per_chunk_;
+  }
+
+  std::vector<nnet3::NnetInferenceTask*> tasks;
+  for (int32 c = stream->num_chunks_submitted; c < num_chunks_ready; c++)
+    tasks.push_back(CreateTask(stream, c, num_feature_frames,
+                               input_finished && c + 1 == num_chunks_ready));
+
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    if (!tasks.empty() && stream->computing.empty())
+      computing_streams_.push_back(stream);
+    for (size_t i = 0; i < tasks.size(); i++) {
+      tasks[i]->priority = -static_cast<double>(num_tasks_submitted_++);
+      stream->computing.push_back(tasks[i]);
+    }
+    stream->num_chunks_submitted += tasks.size();
+    stream->input_finished = input_finished;
+  }
+  if (input_finished && num_feature_frames == 0) {
+    // Pathological case: no input at all.
+    std::unique_lock<std::mutex> lock(stream->decoder_mutex);
+    stream->decodable.InputIsFinished();
+  }
+  if (!tasks.empty()) {
+    for (size_t i = 0; i < tasks.size(); i++)
+      computer_.AcceptTask(tasks[i]);
+    tasks_ready_semaphore_.Signal();
+  }
+}
+
+void OnlineNnet3BatchedDecoder::Compute() {
+  while (true) {
+    tasks_ready_semaphore_.Wait();
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      if (is_terminating_)
+        return;
+    }
+    // Any chunks that arrive while we are computing will be batched together
+    // in the next minibatch, so under load the minibatches fill up, while
+    // under light load we don't add any latency by waiting for them to.
+    bool allow_partial_minibatch = true;
+    while (computer_.Compute(allow_partial_minibatch))
+      CollectFinishedTasks();
+  }
+}
+
+void OnlineNnet3BatchedDecoder::CollectFinishedTasks() {
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  bool queued_any = false;
+  std::vector<StreamState*>::iterator iter = computing_streams_.begin();
+  while (iter != computing_streams_.end()) {
+    StreamState *stream = *iter;
+    // We hand over the chunks in order, so we stop at the first one that's
+    // not done.
+    while (!stream->computing.empty() &&
+           stream->computing.front()->semaphore.TryWait()) {
+      stream->computed.push_back(stream->computing.front());
+      stream->computing.pop_front();
+    }
+    if (!stream->computed.empty() && !stream->decoding) {
+      stream->decoding = true;
+      decode_queue_.push_back(stream);
+      queued_any = true;
+    }
+    if (stream->computing.empty()) {
+      *iter = computing_streams_.back();
+      computing_streams_.pop_back();
+    } else {
+      ++iter;
+    }
+  }
+  if (queued_any)
+    decode_queue_cond_.notify_all();
+}
+
+void OnlineNnet3BatchedDecoder::Decode() {
+  while (true) {
+    StreamState *stream;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      while (decode_queue_.empty() && !is_terminating_)
+        decode_queue_cond_.wait(lock);
+      if (decode_queue_.empty())
+        return;  // We are terminating.
+      stream = decode_queue_.front();
+      decode_queue_.pop_front();
+    }
+    DecodeStream(stream);
+  }
+}
+
+void OnlineNnet3BatchedDecoder::DecodeStream(StreamState *stream) {
+  Timer timer;
+  while (true) {
+    std::vector<nnet3::NnetInferenceTask*> tasks;
+    bool is_last_chunk;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      if (stream->computed.empty()) {
+        // Nothing more to do for now; if more chunks are computed, the
+        // compute thread will queue this stream again.
+        stream->decoding = false;
+        decode_seconds_ += timer.Elapsed();
+        stream_decoded_cond_.notify_all();
+        return;
+      }
+      tasks.assign(stream->computed.begin(), stream->computed.end());
+      stream->computed.clear();
+      is_last_chunk = stream->input_finished &&
+          stream->num_chunks_decoded + static_cast<int32>(tasks.size()) ==
+          stream->num_chunks_submitted;
+    }
+    {
+      std::unique_lock<std::mutex> lock(stream->decoder_mutex);
+      for (size_t i = 0; i < tasks.size(); i++) {
+        nnet3::NnetInferenceTask *task = tasks[i];
+        // Only the first 'num_used_output_frames' rows are valid.
+        task->output_cpu.Resize(task->num_used_output_frames,
+                                task->output_cpu.NumCols(), kCopyData);
+        int32 frames_to_discard = stream->decoder.NumFramesDecoded() -
+            stream->decodable.FirstAvailableFrame();
+        stream->decodable.AcceptLoglikes(&(task->output_cpu),
+                                         frames_to_discard);
+        delete task;
+      }
+      if (is_last_chunk)
+        stream->decodable.InputIsFinished();
+      stream->decoder.AdvanceDecoding(&(stream->decodable));
+    }
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      stream->num_chunks_decoded += tasks.size();
+      num_chunks_decoded_ += tasks.size();
+    }
+    stream_decoded_cond_.notify_all();
+  }
+}
+
+void OnlineNnet3BatchedDecoder::WaitForStream(StreamState *stream) {
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  while (stream->num_chunks_decoded < stream->num_chunks_submitted ||
+         stream->decoding)
+    stream_decoded_cond_.wait(lock);
+}
+
+void OnlineNnet3BatchedDecoder::Wait(int64 stream_id) {
+  WaitForStream(GetStream(stream_id));
+}
+
+void OnlineNnet3BatchedDecoder::FinalizeDecoding(int64 stream_id) {
+  StreamState *stream = GetStream(stream_id);
+  WaitForStream(stream);
+  std::unique_lock<std::mutex> lock(stream->decoder_mutex);
+  stream->decoder.FinalizeDecoding();
+}
+
+int32 OnlineNnet3BatchedDecoder::NumFramesDecoded(int64 stream_id) {
+  StreamState *stream = GetStream(stream_id);
+  std::unique_lock<std::mutex> lock(stream->decoder_mutex);
+  return stream->decoder.NumFramesDecoded();
+}
+
+void OnlineNnet3BatchedDecoder::GetLattice(int64 stream_id,
+                                           bool end_of_utterance,
+                                           CompactLattice *clat) {
+  StreamState *stream = GetStream(stream_id);
+  WaitForStream(stream);
+  Lattice raw_lat;
+  {
+    std::unique_lock<std::mutex> lock(stream->decoder_mutex);
+    if (stream->decoder.NumFramesDecoded() == 0)
+      KALDI_ERR << "You cannot get a lattice if you decoded no frames.";
+    stream->decoder.GetRawLattice(&raw_lat, end_of_utterance);
+  }
+  if (!config_.decoder_opts.determinize_lattice)
+    KALDI_ERR << "--determinize-lattice=false option is not supported at the moment";
+
+  BaseFloat lat_beam = config_.decoder_opts.lattice_beam;
+  DeterminizeLatticePhonePrunedWrapper(
+      trans_model_, &raw_lat, lat_beam, clat, config_.decoder_opts.det_opts);
+}
+
+void OnlineNnet3BatchedDecoder::GetBestPath(int64 stream_id,
+                                            bool end_of_utterance,
+                                            Lattice *best_path) {
+  StreamState *stream = GetStream(stream_id);
+  WaitForStream(stream);
+  std::unique_lock<std::mutex> lock(stream->decoder_mutex);
+  stream->decoder.GetBestPath(best_path, end_of_utterance);
+}
+
+bool OnlineNnet3BatchedDecoder::EndpointDetected(
+    int64 stream_id, const OnlineEndpointConfig &config) {
+  StreamState *stream = GetStream(stream_id);
+  WaitForStream(stream);
+  BaseFloat output_frame_shift =
+      stream->features->FrameShiftInSeconds() * frame_subsampling_factor_;
+  std::unique_lock<std::mutex> lock(stream->decoder_mutex);
+  return kaldi::EndpointDetected(config, trans_model_,
+                                 output_frame_shift, stream->decoder);
+}
+
+void OnlineNnet3BatchedDecoder::CloseStream(int64 stream_id) {
+  StreamState *stream = GetStream(stream_id);
+  WaitForStream(stream);
+  {
+    std::unique_lock<std::mutex> lock(streams_mutex_);
+    streams_.erase(stream_id);
+  }
+  delete stream;
+}
+
+void OnlineNnet3BatchedDecoder::PrintStats() {
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  KALDI_LOG << "Decoded " << num_chunks_decoded_ << " chunks of "
+            << frames_per_chunk_ << " frames from " << num_streams_
+            << " streams; time in graph search was " << decode_seconds_
+            << " seconds over " << config_.num_decoder_threads
+            << " decoder threads.";
+}
+
+OnlineNnet3BatchedDecoder::~OnlineNnet3BatchedDecoder() {
+  {
+    std::unique_lock<std::mutex> lock(streams_mutex_);
+    if (!streams_.empty())
+      KALDI_WARN << streams_.size() << " streams were not closed before "
+                 << "destroying the decoder.";
+  }
+  // Wait for any pending work so that no thread holds pointers to the
+  // streams when we delete them.
+  std::vector<StreamState*> streams;
+  {
+    std::unique_lock<std::mutex> lock(streams_mutex_);
+    for (std::unordered_map<int64, StreamState*>::iterator iter =
+             streams_.begin(); iter != streams_.end(); ++iter)
+      streams.push_back(iter->second);
+    streams_.clear();
+  }
+  for (size_t i = 0; i < streams.size(); i++)
+    WaitForStream(streams[i]);
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    is_terminating_ = true;
+  }
+  decode_queue_cond_.notify_all();
+  tasks_ready_semaphore_.Signal();
+  compute_thread_.join();
+  for (size_t i = 0; i < decode_threads_.size(); i++) {
+    decode_threads_[i]->join();
+    delete decode_threads_[i];
+  }
+  for (size_t i = 0; i < streams.size(); i++)
+    delete streams[i];
+  PrintStats();
+}
+
+
+}  // namespace kaldi
@@ -0,0 +1,308 @@
+// online2/online-nnet3-batched-decoding.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_ONLINE2_ONLINE_NNET3_BATCHED_DECODING_H_
+#define KALDI_ONLINE2_ONLINE_NNET3_BATCHED_DECODING_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "matrix/matrix-lib.h"
+#include "util/common-utils.h"
+#include "base/kaldi-error.h"
+#include "decoder/decodable-matrix.h"
+#include "decoder/lattice-faster-online-decoder.h"
+#include "nnet3/am-nnet-simple.h"
+#include "nnet3/nnet-batch-compute.h"
+#include "online2/online-nnet2-feature-pipeline.h"
+#include "online2/online-endpoint.h"
+#include "hmm/transition-model.h"
+#include "util/kaldi-semaphore.h"
+
+namespace kaldi {
+/// @addtogroup  onlinedecoding OnlineDecoding
+/// @{
+
+
+/**
+   This is the configuration class for OnlineNnet3BatchedDecoder.
+   The neural-net computation options (frames-per-chunk, minibatch-size,
+   acoustic-scale and so on) are those of class nnet3::NnetBatchComputer.
+*/
+struct OnlineNnet3BatchedDecoderConfig {
+  nnet3::NnetBatchComputerOptions compute_opts;
+  LatticeFasterDecoderConfig decoder_opts;
+
+  // The number of threads that do the graph search.  The neural net
+  // computation is done in one additional thread, shared by all streams.
+  int32 num_decoder_threads;
+
+  OnlineNnet3BatchedDecoderConfig(): num_decoder_threads(2) {
+    // In the online setting the chunks are smaller than in the offline
+    // batched setup, so we can afford to batch more of them.
+    compute_opts.frames_per_chunk = 51;
+    compute_opts.minibatch_size = 64;
+  }
+
+  void Register(OptionsItf *po) {
+    compute_opts.Register(po);
+    decoder_opts.Register(po);
+    po->Register("num-decoder-threads", &num_decoder_threads,
+                 "Number of threads used for the graph search; the neural "
+                 "net is evaluated in one additional thread that batches "
+                 "together chunks from all active streams.");
+  }
+};
+
+
+/**
+   OnlineNnet3BatchedDecoder is a serving engine for online decoding of many
+   concurrent streams on CPU.  Instead of each stream running its own small
+   neural net computation (as SingleUtteranceNnet3Decoder does), chunks of
+   features from all active streams are given to a shared
+   nnet3::NnetBatchComputer, which evaluates them together as one minibatch in
+   a single compute thread.  The resulting per-stream log-likelihoods are then
+   handed to a pool of decoder threads which advance the per-stream
+   LatticeFasterOnlineDecoder objects.
+
+   Like the GPU online pipeline in ../cudadecoder/, the neural net is evaluated
+   in the 'static' (non-looped) way: each chunk is computed with its full left
+   and right context, taken from the stream's features.  The looped
+   computation keeps recurrent state inside each stream's NnetComputer, which
+   is what prevents chunks of different streams being computed together.
+
+   Each stream is identified by an integer id chosen by the user.  The
+   feature pipeline of a stream is owned by the user, and is only ever
+   accessed from the thread that calls the member functions of this class for
+   that stream (AcceptInput() is where the features are read); so the usual
+   pattern is:
+
+    - InitStream(id, &feature_pipeline)
+    - repeatedly: feature_pipeline.AcceptWaveform(...); AcceptInput(id);
+    - feature_pipeline.InputFinished(); AcceptInput(id);
+    - Wait(id); FinalizeDecoding(id); GetLattice(id, true, &clat);
+    - CloseStream(id).
+
+   Different streams may be driven from different threads.  All the
+   functions of this class are thread safe, but for any given stream the
+   calls must be made from one thread at a time.
+*/
+class OnlineNnet3BatchedDecoder {
+ public:
+  /// Constructor.  It stores references to all the arguments, so don't
+  /// delete them until this object goes out of scope.  The neural net is
+  /// expected to already be in test mode (see SetBatchnormTestMode(),
+  /// SetDropoutTestMode() and CollapseModel()).
+  OnlineNnet3BatchedDecoder(const OnlineNnet3BatchedDecoderConfig &config,
+                            const TransitionModel &trans_model,
+                            const nnet3::AmNnetSimple &am_nnet,
+                            const fst::Fst<fst::StdArc> &fst);
+
+  /// Starts decoding a new stream.  'features' is owned externally and must
+  /// stay in scope until CloseStream(stream_id) has been called.  It is an
+  /// error if 'stream_id' is already in use.
+  void InitStream(int64 stream_id, OnlineNnet2FeaturePipeline *features);
+
+  /// Reads whatever new features are ready from the stream's feature
+  /// pipeline, and queues them for neural net computation and decoding.  You
+  /// should call this after providing more waveform to the feature pipeline,
+  /// and once more after calling InputFinished() on it.  This does not wait
+  /// for the computation to finish.
+  void AcceptInput(int64 stream_id);
+
+  /// Waits until all the input provided so far for this stream has been
+  /// decoded.
+  void Wait(int64 stream_id);
+
+  /// Finalizes the decoding of this stream (see
+  /// LatticeFasterDecoder::FinalizeDecoding()).  Must be called after Wait(),
+  /// once the input is finished.
+  void FinalizeDecoding(int64 stream_id);
+
+  /// Returns the number of frames decoded so far for this stream (this is at
+  /// the output frame rate, i.e. after any frame subsampling).
+  int32 NumFramesDecoded(int64 stream_id);
+
+  /// Gets the lattice for this stream, as in
+  /// SingleUtteranceNnet3Decoder::GetLattice().  Waits for any pending input
+  /// to be decoded first.  The lattice includes the acoustic scale.
+  void GetLattice(int64 stream_id, bool end_of_utterance,
+                  CompactLattice *clat);
+
+  /// Outputs the single best path through the current lattice of this stream.
+  /// Waits for any pending input to be decoded first.
+  void GetBestPath(int64 stream_id, bool end_of_utterance,
+                   Lattice *best_path);
+
+  /// Calls EndpointDetected() from online-endpoint.h for this stream, after
+  /// waiting for any pending input to be decoded.
+  bool EndpointDetected(int64 stream_id, const OnlineEndpointConfig &config);
+
+  /// Finishes with this stream: waits for any pending computation and frees
+  /// the decoder.  After this the stream id may be reused.
+  void CloseStream(int64 stream_id);
+
+  /// Prints statistics about the batching of the neural net computation
+  /// and the decoding.
+  void PrintStats();
+
+  /// The destructor terminates the background threads.  All streams should
+  /// have been closed before this is called.
+  ~OnlineNnet3BatchedDecoder();
+
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineNnet3BatchedDecoder);
+
+  // All the state of one stream.
+  struct StreamState {
+    OnlineNnet2FeaturePipeline *features;
+    LatticeFasterOnlineDecoder decoder;
+    DecodableMatrixMappedOffset decodable;
+
+    // The number of chunks that we have given to computer_ so far.
+    int32 num_chunks_submitted;
+    // The number of chunks whose output was given to the decoder.
+    int32 num_chunks_decoded;
+    // True once we have submitted the chunk that contains the last frame of
+    // the input.
+    bool input_finished;
+
+    // Tasks given to computer_ whose output has not yet been collected, in
+    // chunk order.  Accessed only while holding the decoder's queue_mutex_.
+    std::deque<nnet3::NnetInferenceTask*> computing;
+    // Tasks that have been computed but not yet decoded, in chunk order.
+    // Accessed only while holding queue_mutex_.
+    std::deque<nnet3::NnetInferenceTask*> computed;
+    // True if this stream is in decode_queue_ or is currently being decoded
+    // by a decoder thread.  Accessed only while holding queue_mutex_.
+    bool decoding;
+
+    // Guards 'decoder' and 'decodable', which are accessed from the decoder
+    // threads.
+    std::mutex decoder_mutex;
+
+    StreamState(const LatticeFasterDecoderConfig &decoder_opts,
+                const TransitionModel &trans_model,
+                const fst::Fst<fst::StdArc> &fst,
+                OnlineNnet2FeaturePipeline *features):
+        features(features), decoder(fst, decoder_opts),
+        decodable(trans_model), num_chunks_submitted(0),
+        num_chunks_decoded(0), input_finished(false), decoding(false) {
+      decoder.InitDecoding();
+    }
+  };
+
+  // Returns the state for this stream id; dies if it does not exist.
+  StreamState *GetStream(int64 stream_id);
+
+  // Creates the task for the chunk numbered 'chunk_index' of this stream,
+  // reading the features from the stream's feature pipeline.
+  // 'num_feature_frames' is the number of feature frames ready, and
+  // 'is_last_chunk' is true if this chunk contains the last output frame.
+  nnet3::NnetInferenceTask *CreateTask(StreamState *stream,
+                                       int32 chunk_index,
+                                       int32 num_feature_frames,
+                                       bool is_last_chunk);
+
+  // Waits until all chunks submitted for this stream have been decoded.
+  void WaitForStream(StreamState *stream);
+
+  // This is the computation thread; it runs computer_.Compute() until
+  // the object is destroyed.
+  void Compute();
+  static void ComputeFunc(OnlineNnet3BatchedDecoder *object) {
+    object->Compute();
+  }
+
+  // Moves tasks that computer_ has finished from the 'computing' to the
+  // 'computed' lists of their streams, and queues those streams for decoding.
+  // Called from the computation thread.
+  void CollectFinishedTasks();
+
+  // This is the decoder thread, several copies of which are run in the
+  // background.
+  void Decode();
+  static void DecodeFunc(OnlineNnet3BatchedDecoder *object) {
+    object->Decode();
+  }
+
+  // Gives the computed chunks of 'stream' to its decoder and advances
+  // the decoding.  Called from a decoder thread.
+  void DecodeStream(StreamState *stream);
+
+  const OnlineNnet3BatchedDecoderConfig &config_;
+  const TransitionModel &trans_model_;
+  const fst::Fst<fst::StdArc> &fst_;
+
+  nnet3::NnetBatchComputer computer_;
+
+  // Some static information about the neural net, computed at the start.
+  int32 nnet_left_context_;
+  int32 nnet_right_context_;
+  int32 nnet_input_dim_;
+  int32 nnet_ivector_dim_;  // -1 if the nnet does not take iVectors.
+  int32 frames_per_chunk_;  // After any fixing by NnetBatchComputer.
+  int32 frame_subsampling_factor_;
+
+  // Guards streams_.
+  std::mutex streams_mutex_;
+  std::unordered_map<int64, StreamState*> streams_;
+
+  // queue_mutex_ guards the 'computing', 'computed' and 'decoding' members
+  // of all streams, plus decode_queue_, num_tasks_computing_, is_terminating_
+  // and the statistics.
+  std::mutex queue_mutex_;
+  // Streams that have computed chunks waiting to be decoded.
+  std::deque<StreamState*> decode_queue_;
+  // Notified when something is added to decode_queue_ (or on termination).
+  std::condition_variable decode_queue_cond_;
+  // Notified when a decoder thread has finished with a stream.
+  std::condition_variable stream_decoded_cond_;
+  // The streams that have tasks in their 'computing' lists.
+  std::vector<StreamState*> computing_streams_;
+  bool is_terminating_;
+
+  // Signaled every time new tasks are given to computer_ (or on termination).
+  Semaphore tasks_ready_semaphore_;
+  // Used to set the task priorities so that older chunks are computed first.
+  int64 num_tasks_submitted_;
+
+  // Statistics, guarded by queue_mutex_.
+  int64 num_chunks_decoded_;
+  int64 num_streams_;
+  double decode_seconds_;
+
+  std::thread compute_thread_;
+  std::vector<std::thread*> decode_threads_;
+};
+
+
+/// @} End of "addtogroup onlinedecoding"
+
+}  // namespace kaldi
+
+
+
+#endif  // KALDI_ONLINE2_ONLINE_NNET3_BATCHED_DECODING_H_
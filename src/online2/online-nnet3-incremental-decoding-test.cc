@@ -0,0 +1,251 @@
+// online2/online-nnet3-incremental-decoding-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "online2/online-nnet3-incremental-decoding.h"
+#include "hmm/hmm-test-utils.h"
+#include "lat/lattice-functions.h"
+
+namespace kaldi {
+
+// Creates a small feed-forward neural net with 13-dimensional input (the
+// default MFCC dimension) and 'num_pdfs' outputs.
+static void CreateTestNnet(int32 num_pdfs, nnet3::Nnet *nnet) {
+  std::ostringstream config;
+  config << "input-node name=input dim=13\n"
+         << "component name=affine1 type=AffineComponent input-dim=39 "
+         << "output-dim=32\n"
+         << "component-node name=affine1 component=affine1 "
+         << "input=Append(Offset(input, -2), input, Offset(input, 2))\n"
+         << "component name=relu1 type=RectifiedLinearComponent dim=32\n"
+         << "component-node name=relu1 component=relu1 input=affine1\n"
+         << "component name=affine2 type=AffineComponent input-dim=32 "
+         << "output-dim=" << num_pdfs << "\n"
+         << "component-node name=affine2 component=affine2 input=relu1\n"
+         << "component name=logsoftmax type=LogSoftmaxComponent dim="
+         << num_pdfs << "\n"
+         << "component-node name=logsoftmax component=logsoftmax "
+         << "input=affine2\n"
+         << "output-node name=output input=logsoftmax\n";
+  std::istringstream is(config.str());
+  nnet->ReadConfig(is);
+}
+
+// Creates a decoding graph with one state, that accepts any sequence of
+// transition-ids.  The "words" are pdf-ids plus one, so that the word
+// sequence of the best path does not depend on how ties between
+// transition-ids with the same pdf are broken.  Since the graph has only one
+// state, which is final, restarting the decoding at any frame does not change
+// the best path.
+static void CreateTestFst(const TransitionModel &trans_model,
+                          fst::StdVectorFst *fst) {
+  fst->DeleteStates();
+  fst::StdArc::StateId s = fst->AddState();
+  fst->SetStart(s);
+  fst->SetFinal(s, fst::TropicalWeight::One());
+  for (int32 tid = 1; tid <= trans_model.NumTransitionIds(); tid++)
+    fst->AddArc(s, fst::StdArc(tid, trans_model.TransitionIdToPdf(tid) + 1,
+                               fst::TropicalWeight::One(), s));
+}
+
+// Appends the words of the best path of 'clat' to 'words', adds its cost to
+// 'cost' and returns its number of frames.
+static int32 AppendBestPath(const CompactLattice &clat,
+                            std::vector<int32> *words, double *cost) {
+  KALDI_ASSERT(clat.NumStates() != 0);
+  CompactLattice best_path_clat;
+  CompactLatticeShortestPath(clat, &best_path_clat);
+  Lattice best_path;
+  ConvertLattice(best_path_clat, &best_path);
+  std::vector<int32> alignment, these_words;
+  LatticeWeight weight;
+  GetLinearSymbolSequence(best_path, &alignment, &these_words, &weight);
+  words->insert(words->end(), these_words.begin(), these_words.end());
+  *cost += weight.Value1() + weight.Value2();
+  return alignment.size();
+}
+
+// Decodes 'wave' with lattice flushing as configured by 'flush_config' and
+// 'silence_phones', giving the audio to the decoder in pieces as
+// online2-wav-nnet3-latgen-incremental does.  Outputs the word sequence and
+// the cost of the segments' best paths, joined together, and the length in
+// frames of each segment.
+static void DecodeInSegments(const TransitionModel &trans_model,
+                             const nnet3::DecodableNnetSimpleLoopedInfo &info,
+                             const fst::StdVectorFst &fst,
+                             const OnlineNnet2FeaturePipelineInfo &feature_info,
+                             const Vector<BaseFloat> &wave,
+                             const OnlineLatticeFlushConfig &flush_config,
+                             const std::string &silence_phones,
+                             std::vector<int32> *words, double *cost,
+                             std::vector<int32> *segment_lengths) {
+  LatticeIncrementalDecoderConfig decoder_opts;
+  OnlineNnet2FeaturePipeline feature_pipeline(feature_info);
+  SingleUtteranceNnet3IncrementalDecoder decoder(decoder_opts, trans_model,
+                                                 info, fst, &feature_pipeline);
+  BaseFloat samp_freq = feature_info.mfcc_opts.frame_opts.samp_freq;
+  int32 piece_length = 800;
+  words->clear();
+  *cost = 0.0;
+  segment_lengths->clear();
+  for (int32 offset = 0; offset < wave.Dim(); offset += piece_length) {
+    int32 length = std::min(piece_length, wave.Dim() - offset);
+    SubVector<BaseFloat> piece(wave, offset, length);
+    feature_pipeline.AcceptWaveform(samp_freq, piece);
+    if (offset + length == wave.Dim())
+      feature_pipeline.InputFinished();
+    decoder.AdvanceDecoding();
+    if (decoder.FlushPointDetected(flush_config, silence_phones)) {
+      int32 start_frame = decoder.FrameOffset(),
+          num_frames = decoder.NumFramesDecoded();
+      CompactLattice clat;
+      decoder.FlushLattice(&clat);
+      KALDI_ASSERT(decoder.NumFramesDecoded() == 0 &&
+                   decoder.FrameOffset() == start_frame + num_frames);
+      KALDI_ASSERT(AppendBestPath(clat, words, cost) == num_frames);
+      segment_lengths->push_back(num_frames);
+    }
+  }
+  decoder.FinalizeDecoding();
+  if (decoder.NumFramesDecoded() > 0) {
+    int32 num_frames = decoder.NumFramesDecoded();
+    CompactLattice clat = decoder.GetLattice(num_frames, true);
+    KALDI_ASSERT(AppendBestPath(clat, words, cost) == num_frames);
+    segment_lengths->push_back(num_frames);
+  }
+  // If the number of feature vectors kept was limited, the features of the
+  // first frame should be gone by now.
+  int32 max_feature_vectors =
+      feature_info.mfcc_opts.frame_opts.max_feature_vectors;
+  if (max_feature_vectors > 0) {
+    KALDI_ASSERT(feature_pipeline.NumFramesReady() > max_feature_vectors);
+    Vector<BaseFloat> feat(feature_pipeline.Dim());
+    bool threw = false;
+    try {
+      feature_pipeline.GetFrame(0, &feat);
+    } catch (const std::exception &e) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+  }
+}
+
+// Checks that with lattice flushing, a long input is split into segments
+// (at silence after --flush.min-segment-length, or else at
+// --flush.max-segment-length), and that the best paths of the segments'
+// lattices join together into the best path of the whole input, also when
+// the feature pipeline keeps only the latest --flush.max-feature-vectors
+// frames.
+static void UnitTestLatticeFlushing() {
+  ContextDependency *ctx_dep = NULL;
+  TransitionModel *trans_model = GenRandTransitionModel(&ctx_dep);
+  nnet3::Nnet nnet;
+  CreateTestNnet(trans_model->NumPdfs(), &nnet);
+  nnet3::AmNnetSimple am_nnet(nnet);
+  fst::StdVectorFst fst;
+  CreateTestFst(*trans_model, &fst);
+  nnet3::NnetSimpleLoopedComputationOptions looped_opts;
+  nnet3::DecodableNnetSimpleLoopedInfo info(looped_opts, &am_nnet);
+
+  OnlineNnet2FeaturePipelineInfo feature_info;
+  feature_info.feature_type = "mfcc";
+  feature_info.use_ivectors = false;
+  feature_info.mfcc_opts.frame_opts.dither = 0.0;  // Makes it deterministic.
+  BaseFloat samp_freq = feature_info.mfcc_opts.frame_opts.samp_freq,
+      frame_shift = feature_info.mfcc_opts.frame_opts.frame_shift_ms / 1000.0;
+
+  Vector<BaseFloat> wave(RandInt(3, 5) * static_cast<int32>(samp_freq));
+  wave.SetRandn();
+  wave.Scale(1000.0);
+
+  // The reference: no flushing.
+  OnlineLatticeFlushConfig no_flush_config;
+  no_flush_config.min_segment_length = 1.0e+10;
+  no_flush_config.max_segment_length = 1.0e+10;
+  std::vector<int32> ref_words, segment_lengths;
+  double ref_cost;
+  DecodeInSegments(*trans_model, info, fst, feature_info, wave,
+                   no_flush_config, "1", &ref_words, &ref_cost,
+                   &segment_lengths);
+  KALDI_ASSERT(segment_lengths.size() == 1);
+  int32 num_frames = segment_lengths[0];
+  KALDI_ASSERT(ref_words.size() == num_frames);
+
+  std::ostringstream all_phones;
+  const std::vector<int32> &phones = trans_model->GetPhones();
+  for (size_t i = 0; i < phones.size(); i++)
+    all_phones << (i == 0 ? "" : ":") << phones[i];
+
+  for (int32 silence_cut = 0; silence_cut < 2; silence_cut++) {
+    OnlineLatticeFlushConfig flush_config;
+    flush_config.min_trailing_silence = 0.05;
+    // The input is at least 3 seconds (about 300 frames) long.
+    flush_config.max_feature_vectors = 250;
+    flush_config.Check();
+    flush_config.LimitFeatureBuffers(&feature_info);
+    std::string silence_phones;
+    BaseFloat segment_length;
+    if (silence_cut) {
+      // All the phones are silence, so we should cut as soon as the segment
+      // is min_segment_length long.
+      flush_config.min_segment_length = segment_length = 0.5;
+      flush_config.max_segment_length = 1.0e+10;
+      silence_phones = all_phones.str();
+    } else {
+      // There is no silence, so we should cut when the segment is
+      // max_segment_length long.
+      flush_config.min_segment_length = 0.2;
+      flush_config.max_segment_length = segment_length = 0.7;
+      silence_phones = "100000";
+    }
+    int32 segment_frames = static_cast<int32>(segment_length / frame_shift +
+                                              0.5);
+    std::vector<int32> words;
+    double cost;
+    DecodeInSegments(*trans_model, info, fst, feature_info, wave,
+                     flush_config, silence_phones, &words, &cost,
+                     &segment_lengths);
+    KALDI_LOG << "Input of " << num_frames << " frames was split into "
+              << segment_lengths.size() << " segments with "
+              << (silence_cut ? "silence" : "hard") << " cuts.";
+    KALDI_ASSERT(segment_lengths.size() > 1);
+    int32 tot_frames = 0;
+    for (size_t i = 0; i < segment_lengths.size(); i++) {
+      if (i + 1 < segment_lengths.size())
+        KALDI_ASSERT(segment_lengths[i] >= segment_frames);
+      tot_frames += segment_lengths[i];
+    }
+    KALDI_ASSERT(tot_frames == num_frames);
+    KALDI_ASSERT(words == ref_words);
+    KALDI_ASSERT(ApproxEqual(cost, ref_cost, 1.0e-03));
+  }
+  delete trans_model;
+  delete ctx_dep;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 3; i++)
+    UnitTestLatticeFlushing();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -17,6 +17,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits>
 #include "online2/online-nnet3-incremental-decoding.h"
 #include "lat/lattice-functions.h"
 #include "lat/determinize-lattice-pruned.h"
@@ -24,6 +25,20 @@
 
 namespace kaldi {
 
+void OnlineLatticeFlushConfig::LimitFeatureBuffers(
+    OnlineNnet2FeaturePipelineInfo *info) const {
+  int32 *max_vectors[] = { &(info->mfcc_opts.frame_opts.max_feature_vectors),
+                           &(info->plp_opts.frame_opts.max_feature_vectors),
+                           &(info->fbank_opts.frame_opts.max_feature_vectors) };
+  for (size_t i = 0; i < sizeof(max_vectors) / sizeof(max_vectors[0]); i++)
+    if (*(max_vectors[i]) <= 0)
+      *(max_vectors[i]) = max_feature_vectors;
+  OnlineIvectorExtractionInfo &ivector_info = info->ivector_extractor_info;
+  if (info->use_ivectors && ivector_info.max_ivector_history <= 0)
+    ivector_info.max_ivector_history =
+        max_feature_vectors / ivector_info.ivector_period + 1;
+}
+
 template <typename FST>
 SingleUtteranceNnet3IncrementalDecoderTpl<FST>::SingleUtteranceNnet3IncrementalDecoderTpl(
     const LatticeIncrementalDecoderConfig &decoder_opts,
@@ -67,6 +82,38 @@ bool SingleUtteranceNnet3IncrementalDecoderTpl<FST>::EndpointDetected(
                                  output_frame_shift, decoder_);
 }
 
+template <typename FST>
+bool SingleUtteranceNnet3IncrementalDecoderTpl<FST>::FlushPointDetected(
+    const OnlineLatticeFlushConfig &config,
+    const std::string &silence_phones) {
+  // We express the flushing rules as endpointing rules: rule1 requires
+  // trailing silence and a minimum segment length; rule2 just requires the
+  // maximum segment length.  The other rules are disabled.
+  BaseFloat inf = std::numeric_limits<BaseFloat>::infinity();
+  OnlineEndpointConfig endpoint_config;
+  endpoint_config.silence_phones = silence_phones;
+  endpoint_config.rule1 = OnlineEndpointRule(false,
+                                             config.min_trailing_silence,
+                                             inf, config.min_segment_length);
+  endpoint_config.rule2 = OnlineEndpointRule(false, 0.0, inf,
+                                             config.max_segment_length);
+  endpoint_config.rule3 = OnlineEndpointRule(false, inf, inf, inf);
+  endpoint_config.rule4 = endpoint_config.rule3;
+  endpoint_config.rule5 = endpoint_config.rule3;
+  return EndpointDetected(endpoint_config);
+}
+
+template <typename FST>
+void SingleUtteranceNnet3IncrementalDecoderTpl<FST>::FlushLattice(
+    CompactLattice *clat) {
+  int32 num_frames = decoder_.NumFramesDecoded();
+  decoder_.FinalizeDecoding();
+  bool use_final_probs = true;
+  *clat = decoder_.GetLattice(num_frames, use_final_probs);
+  // This frees the decoder's tokens and its determinized lattice.
+  InitDecoding(decodable_.GetFrameOffset() + num_frames);
+}
+
 
 // Instantiate the template for the types needed.
 template class SingleUtteranceNnet3IncrementalDecoderTpl<fst::Fst<fst::StdArc> >;
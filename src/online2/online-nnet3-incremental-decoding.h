@@ -41,6 +41,67 @@ namespace kaldi {
 /// @{
 
 
+/**
+   This configuration class is for decoding long recordings (e.g. hours of
+   meeting audio) in segments with SingleUtteranceNnet3IncrementalDecoderTpl,
+   so that the memory used does not grow with the length of the recording.
+   When FlushPointDetected() returns true, the user would call FlushLattice(),
+   which finalizes the lattice of the audio decoded so far and restarts the
+   decoding from the next frame.  We try to cut at silence: a segment ends
+   once it is at least min_segment_length seconds long and the best path ends
+   in at least min_trailing_silence seconds of silence, or, failing that, when
+   it is max_segment_length seconds long.  Since the decoder is restarted,
+   the feature pipeline should not keep all the frames either; see
+   LimitFeatureBuffers().
+*/
+struct OnlineLatticeFlushConfig {
+  BaseFloat min_segment_length;
+  BaseFloat max_segment_length;
+  BaseFloat min_trailing_silence;
+  int32 max_feature_vectors;
+
+  OnlineLatticeFlushConfig(): min_segment_length(20.0),
+                              max_segment_length(60.0),
+                              min_trailing_silence(0.3),
+                              max_feature_vectors(1000) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("flush.min-segment-length", &min_segment_length,
+                   "Minimum length in seconds of the segments whose lattices "
+                   "are flushed, if the flushing is done at silence.");
+    opts->Register("flush.max-segment-length", &max_segment_length,
+                   "Maximum length in seconds of the segments whose lattices "
+                   "are flushed; this limits the memory used.");
+    opts->Register("flush.min-trailing-silence", &min_trailing_silence,
+                   "Length in seconds of trailing silence that the best path "
+                   "must have for a segment to be flushed before it reaches "
+                   "--flush.max-segment-length (uses "
+                   "--endpoint.silence-phones).");
+    opts->Register("flush.max-feature-vectors", &max_feature_vectors,
+                   "Number of the latest feature vectors (and of the iVectors "
+                   "for them) that the feature pipeline retains when flushing "
+                   "lattices, unless --max-feature-vectors is set.  Must be "
+                   "more than 200.");
+  }
+  void Check() const {
+    KALDI_ASSERT(min_segment_length >= 0.0 &&
+                 max_segment_length >= min_segment_length &&
+                 max_segment_length > 0.0 && min_trailing_silence >= 0.0 &&
+                 max_feature_vectors > 200);
+  }
+
+  /// Sets the --max-feature-vectors option of the MFCC, PLP and filterbank
+  /// features in 'info' to max_feature_vectors, if it was not set, and
+  /// limits the number of iVectors kept to match (if the iVector
+  /// extractor does not already limit it), so that the memory used by the
+  /// feature pipeline does not grow with the length of the recording.
+  /// Call this before creating the OnlineNnet2FeaturePipeline.  The audio
+  /// must then be given to the pipeline, and decoded, in pieces that are
+  /// much shorter than max_feature_vectors frames.
+  void LimitFeatureBuffers(OnlineNnet2FeaturePipelineInfo *info) const;
+};
+
+
 /**
    You will instantiate this class when you want to decode a single utterance
    using the online-decoding setup for neural nets.  The template will be
@@ -115,6 +176,27 @@ class SingleUtteranceNnet3IncrementalDecoderTpl {
   /// with the required arguments.
   bool EndpointDetected(const OnlineEndpointConfig &config);
 
+  /// Returns true if the part of the audio decoded since the last call to
+  /// FlushLattice() (or since the start) should be flushed, according to
+  /// 'config'; see OnlineLatticeFlushConfig.  'silence_phones' is a
+  /// colon-separated list of silence phones, as in OnlineEndpointConfig.
+  bool FlushPointDetected(const OnlineLatticeFlushConfig &config,
+                          const std::string &silence_phones);
+
+  /// Finalizes the decoding of the frames decoded so far, outputs their
+  /// lattice (with final-probs, and with any acoustic scaling in it) to
+  /// 'clat', and restarts the decoding from the next frame.  After this,
+  /// NumFramesDecoded() is zero and FrameOffset() has been increased by the
+  /// number of frames flushed.  This limits the memory used by the decoder
+  /// (and the cost of getting the final lattice) for long recordings.
+  void FlushLattice(CompactLattice *clat);
+
+  /// Returns the number of frames (at the output frame rate, i.e. after
+  /// frame subsampling) that were flushed by previous calls to
+  /// FlushLattice(), or that were given to InitDecoding(); frame t of the
+  /// current segment is frame FrameOffset() + t of the input.
+  int32 FrameOffset() const { return decodable_.GetFrameOffset(); }
+
   const LatticeIncrementalOnlineDecoderTpl<FST> &Decoder() const { return decoder_; }
 
   ~SingleUtteranceNnet3IncrementalDecoderTpl() { }
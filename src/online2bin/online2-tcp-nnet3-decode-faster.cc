@@ -21,6 +21,7 @@
 
 #include "feat/wave-reader.h"
 #include "online2/online-nnet3-decoding.h"
+#include "online2/online-nnet3-batched-decoding.h"
 #include "online2/online-nnet2-feature-pipeline.h"
 #include "online2/onlinebin-util.h"
 #include "online2/online-timing.h"
@@ -29,6 +30,7 @@
 #include "lat/lattice-functions.h"
 #include "util/kaldi-thread.h"
 #include "nnet3/nnet-utils.h"
+#include "util/kaldi-semaphore.h"
 
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -37,30 +39,44 @@
 #include <signal.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <functional>
 #include <string>
+#include <thread>
 
 namespace kaldi {
 
 class TcpServer {
  public:
-  explicit TcpServer(int read_timeout);
+  TcpServer();
   ~TcpServer();
 
-  bool Listen(int32 port);  // start listening on a given port
+  // start listening on a given port; 'backlog' is the number of pending
+  // connections that are queued.
+  bool Listen(int32 port, int32 backlog = 1);
   int32 Accept();  // accept a client and return its descriptor
 
+ private:
+  struct ::sockaddr_in h_addr_;
+  int32 server_desc_;
+};
+
+// A connection to a client accepted by TcpServer.
+class TcpConnection {
+ public:
+  TcpConnection(int32 client_desc, int read_timeout);
+  ~TcpConnection();
+
   bool ReadChunk(size_t len); // get more data and return false if end-of-stream
 
   Vector<BaseFloat> GetChunk(); // get the data read by above method
 
-  bool Write(const std::string &msg); // write to accepted client
-  bool WriteLn(const std::string &msg, const std::string &eol = "\n"); // write line to accepted client
+  bool Write(const std::string &msg); // write to the client
+  bool WriteLn(const std::string &msg, const std::string &eol = "\n"); // write line to the client
 
   void Disconnect();
 
  private:
-  struct ::sockaddr_in h_addr_;
-  int32 server_desc_, client_desc_;
+  int32 client_desc_;
   int16 *samp_buf_;
   size_t buf_len_, has_read_;
   pollfd client_set_[1];
@@ -111,6 +127,156 @@ std::string LatticeToString(const CompactLattice &clat, const fst::SymbolTable &
   ConvertLattice(best_path_clat, &best_path_lat);
   return LatticeToString(best_path_lat, word_syms);
 }
+
+// The things that the clients share when they are decoded as streams of
+// OnlineNnet3BatchedDecoder (i.e. if --num-streams > 1).
+struct BatchedServerInfo {
+  OnlineNnet3BatchedDecoder *decoder;
+  const OnlineNnet2FeaturePipelineInfo *feature_info;
+  const OnlineEndpointConfig *endpoint_opts;
+  const fst::SymbolTable *word_syms;
+  BaseFloat samp_freq;
+  BaseFloat chunk_length_secs;
+  BaseFloat output_period;
+  BaseFloat frame_shift;  // After frame subsampling.
+  int read_timeout;
+  bool produce_time;
+  // Counts the streams that are free; signaled when a client is finished.
+  Semaphore *free_streams;
+};
+
+// Decodes the audio of one client as a stream of the batched decoder, and
+// sends it the same messages as the single-client server does.  The batched
+// decoder cannot restart decoding at a frame offset as
+// SingleUtteranceNnet3Decoder::InitDecoding() does, so after each endpoint we
+// start a new stream with a new feature pipeline, to which we give the audio
+// that was not decoded yet.  This means that the iVector adaptation starts
+// again after each endpoint.
+void ServeClientBatched(const BatchedServerInfo &info, int32 client_desc,
+                        int64 stream_id) {
+  TcpConnection client(client_desc, info.read_timeout);
+  OnlineNnet3BatchedDecoder &decoder = *(info.decoder);
+  OnlineNnet2FeaturePipeline *feature_pipeline = NULL;
+  bool stream_open = false;
+  try {
+    size_t chunk_len = static_cast<size_t>(info.chunk_length_secs *
+                                           info.samp_freq);
+    int32 check_period = static_cast<int32>(info.samp_freq *
+                                            info.output_period);
+    int32 frame_offset = 0;
+    // The audio received since the last endpoint.
+    std::vector<BaseFloat> segment_wave;
+    bool eos = false;
+
+    while (!eos) {
+      feature_pipeline = new OnlineNnet2FeaturePipeline(*(info.feature_info));
+      decoder.InitStream(stream_id, feature_pipeline);
+      stream_open = true;
+      if (!segment_wave.empty()) {
+        SubVector<BaseFloat> wave(segment_wave.data(), segment_wave.size());
+        feature_pipeline->AcceptWaveform(info.samp_freq, wave);
+        decoder.AcceptInput(stream_id);
+      }
+      int32 samp_count = 0, check_count = check_period;
+
+      while (true) {
+        eos = !client.ReadChunk(chunk_len);
+
+        if (eos) {
+          feature_pipeline->InputFinished();
+          decoder.AcceptInput(stream_id);
+          decoder.FinalizeDecoding(stream_id);
+          int32 num_frames = decoder.NumFramesDecoded(stream_id);
+          frame_offset += num_frames;
+          if (num_frames > 0) {
+            CompactLattice lat;
+            decoder.GetLattice(stream_id, true, &lat);
+            std::string msg = LatticeToString(lat, *(info.word_syms));
+
+            // get time-span from previous endpoint to end of audio,
+            if (info.produce_time) {
+              int32 t_beg = frame_offset - num_frames;
+              int32 t_end = frame_offset;
+              msg = GetTimeString(t_beg, t_end, info.frame_shift) + " " + msg;
+            }
+
+            KALDI_VLOG(1) << "EndOfAudio, sending message: " << msg;
+            client.WriteLn(msg);
+          } else
+            client.Write("\n");
+          break;
+        }
+
+        Vector<BaseFloat> wave_part = client.GetChunk();
+        segment_wave.insert(segment_wave.end(), wave_part.Data(),
+                            wave_part.Data() + wave_part.Dim());
+        feature_pipeline->AcceptWaveform(info.samp_freq, wave_part);
+        decoder.AcceptInput(stream_id);
+        samp_count += chunk_len;
+
+        if (samp_count > check_count) {
+          decoder.Wait(stream_id);
+          if (decoder.NumFramesDecoded(stream_id) > 0) {
+            Lattice lat;
+            decoder.GetBestPath(stream_id, false, &lat);
+            TopSort(&lat); // for LatticeStateTimes(),
+            std::string msg = LatticeToString(lat, *(info.word_syms));
+
+            // get time-span after previous endpoint,
+            if (info.produce_time) {
+              int32 t_beg = frame_offset;
+              int32 t_end = frame_offset + GetLatticeTimeSpan(lat);
+              msg = GetTimeString(t_beg, t_end, info.frame_shift) + " " + msg;
+            }
+
+            KALDI_VLOG(1) << "Temporary transcript: " << msg;
+            client.WriteLn(msg, "\r");
+          }
+          check_count += check_period;
+        }
+
+        if (decoder.EndpointDetected(stream_id, *(info.endpoint_opts))) {
+          decoder.FinalizeDecoding(stream_id);
+          int32 num_frames = decoder.NumFramesDecoded(stream_id);
+          frame_offset += num_frames;
+          CompactLattice lat;
+          decoder.GetLattice(stream_id, true, &lat);
+          std::string msg = LatticeToString(lat, *(info.word_syms));
+
+          // get time-span between endpoints,
+          if (info.produce_time) {
+            int32 t_beg = frame_offset - num_frames;
+            int32 t_end = frame_offset;
+            msg = GetTimeString(t_beg, t_end, info.frame_shift) + " " + msg;
+          }
+
+          KALDI_VLOG(1) << "Endpoint, sending message: " << msg;
+          client.WriteLn(msg);
+
+          // Keep the audio after the endpoint for the next stream.
+          size_t num_samp_decoded = std::min(
+              segment_wave.size(), static_cast<size_t>(
+                  num_frames * info.frame_shift * info.samp_freq));
+          segment_wave.erase(segment_wave.begin(),
+                             segment_wave.begin() + num_samp_decoded);
+          break; // while (true)
+        }
+      }
+      decoder.CloseStream(stream_id);
+      stream_open = false;
+      delete feature_pipeline;
+      feature_pipeline = NULL;
+    }
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Error decoding stream " << stream_id << ", disconnecting: "
+               << e.what();
+    if (stream_open)
+      decoder.CloseStream(stream_id);
+    delete feature_pipeline;
+  }
+  client.Disconnect();
+  info.free_streams->Signal();
+}
 }
 
 int main(int argc, char *argv[]) {
@@ -127,6 +293,9 @@ int main(int argc, char *argv[]) {
         "speaker adaptation and endpointing.\n"
         "Note: some configuration values and inputs are set via config\n"
         "files whose filenames are passed as options\n"
+        "With --num-streams > 1, up to that many clients are served at the\n"
+        "same time, and the neural net computation for all of them is batched\n"
+        "together (see OnlineNnet3BatchedDecoder).\n"
         "\n"
         "Usage: online2-tcp-nnet3-decode-faster [options] <nnet3-in> "
         "<fst-in> <word-symbol-table>\n";
@@ -147,6 +316,9 @@ int main(int argc, char *argv[]) {
     int port_num = 5050;
     int read_timeout = 3;
     bool produce_time = false;
+    bool use_mmap = false;
+    int32 num_streams = 1;
+    OnlineNnet3BatchedDecoderConfig batched_opts;
 
     po.Register("samp-freq", &samp_freq,
                 "Sampling frequency of the input signal (coded as 16-bit slinear).");
@@ -156,12 +328,25 @@ int main(int argc, char *argv[]) {
                 "How often in seconds, do we check for changes in output.");
     po.Register("num-threads-startup", &g_num_threads,
                 "Number of threads used when initializing iVector extractor.");
+    po.Register("use-mmap", &use_mmap,
+                "If true, memory-map the decoding graph instead of reading it, "
+                "if it is a ConstFst written with --fst_align=true.");
     po.Register("read-timeout", &read_timeout,
                 "Number of seconds of timeout for TCP audio data to appear on the stream. Use -1 for blocking.");
     po.Register("port-num", &port_num,
                 "Port number the server will listen on.");
     po.Register("produce-time", &produce_time,
                 "Prepend begin/end times between endpoints (e.g. '5.46 6.81 <text_output>', in seconds)");
+    po.Register("num-streams", &num_streams,
+                "Number of clients that are served at the same time.  If "
+                "more than one, the clients are decoded as streams of a "
+                "batched decoder, which evaluates the neural net with its "
+                "full context in chunks of 51 frames (--frames-per-chunk "
+                "does not apply), and starts the iVector adaptation again "
+                "after each endpoint.");
+    po.Register("num-decoder-threads", &batched_opts.num_decoder_threads,
+                "If --num-streams > 1, the number of threads used for the "
+                "graph search.");
 
     feature_opts.Register(&po);
     decodable_opts.Register(&po);
@@ -198,15 +383,10 @@ int main(int argc, char *argv[]) {
       nnet3::CollapseModel(nnet3::CollapseModelConfig(), &(am_nnet.GetNnet()));
     }
 
-    // this object contains precomputed stuff that is used by all decodable
-    // objects.  It takes a pointer to am_nnet because if it has iVectors it has
-    // to modify the nnet to accept iVectors at intervals.
-    nnet3::DecodableNnetSimpleLoopedInfo decodable_info(decodable_opts,
-                                                        &am_nnet);
-
     KALDI_VLOG(1) << "Loading FST...";
 
-    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldiGeneric(fst_rxfilename);
+    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldiGeneric(fst_rxfilename,
+                                                            true, use_mmap);
 
     fst::SymbolTable *word_syms = NULL;
     if (!word_syms_filename.empty())
@@ -216,13 +396,50 @@ int main(int argc, char *argv[]) {
 
     signal(SIGPIPE, SIG_IGN); // ignore SIGPIPE to avoid crashing when socket forcefully disconnected
 
-    TcpServer server(read_timeout);
+    TcpServer server;
+
+    server.Listen(port_num, num_streams);
+
+    if (num_streams > 1) {
+      // The batched decoder takes the options of the neural net computation
+      // and of the decoder from the options of the single-client mode.
+      batched_opts.compute_opts.acoustic_scale = decodable_opts.acoustic_scale;
+      batched_opts.compute_opts.frame_subsampling_factor =
+          decodable_opts.frame_subsampling_factor;
+      batched_opts.decoder_opts = decoder_opts;
+      OnlineNnet3BatchedDecoder decoder(batched_opts, trans_model, am_nnet,
+                                        *decode_fst);
+      Semaphore free_streams(num_streams);
+      BatchedServerInfo info;
+      info.decoder = &decoder;
+      info.feature_info = &feature_info;
+      info.endpoint_opts = &endpoint_opts;
+      info.word_syms = word_syms;
+      info.samp_freq = samp_freq;
+      info.chunk_length_secs = chunk_length_secs;
+      info.output_period = output_period;
+      info.frame_shift = frame_shift * frame_subsampling;
+      info.read_timeout = read_timeout;
+      info.produce_time = produce_time;
+      info.free_streams = &free_streams;
+      for (int64 stream_id = 0; ; stream_id++) {
+        free_streams.Wait();
+        int32 client_desc = server.Accept();
+        std::thread(ServeClientBatched, std::cref(info), client_desc,
+                    stream_id).detach();
+      }
+    }
 
-    server.Listen(port_num);
+    // this object contains precomputed stuff that is used by all decodable
+    // objects.  It takes a pointer to am_nnet because if it has iVectors it has
+    // to modify the nnet to accept iVectors at intervals (so we don't create
+    // it in the batched mode above, which never returns).
+    nnet3::DecodableNnetSimpleLoopedInfo decodable_info(decodable_opts,
+                                                        &am_nnet);
 
     while (true) {
 
-      server.Accept();
+      TcpConnection client(server.Accept(), read_timeout);
 
       int32 samp_count = 0;// this is used for output refresh rate
       size_t chunk_len = static_cast<size_t>(chunk_length_secs * samp_freq);
@@ -248,7 +465,7 @@ int main(int argc, char *argv[]) {
         std::vector<std::pair<int32, BaseFloat>> delta_weights;
 
         while (true) {
-          eos = !server.ReadChunk(chunk_len);
+          eos = !client.ReadChunk(chunk_len);
 
           if (eos) {
             feature_pipeline.InputFinished();
@@ -278,14 +495,14 @@ int main(int argc, char *argv[]) {
               }
 
               KALDI_VLOG(1) << "EndOfAudio, sending message: " << msg;
-              server.WriteLn(msg);
+              client.WriteLn(msg);
             } else
-              server.Write("\n");
-            server.Disconnect();
+              client.Write("\n");
+            client.Disconnect();
             break;
           }
 
-          Vector<BaseFloat> wave_part = server.GetChunk();
+          Vector<BaseFloat> wave_part = client.GetChunk();
           feature_pipeline.AcceptWaveform(samp_freq, wave_part);
           samp_count += chunk_len;
 
@@ -315,7 +532,7 @@ int main(int argc, char *argv[]) {
               }
 
               KALDI_VLOG(1) << "Temporary transcript: " << msg;
-              server.WriteLn(msg, "\r");
+              client.WriteLn(msg, "\r");
             }
             check_count += check_period;
           }
@@ -335,7 +552,7 @@ int main(int argc, char *argv[]) {
             }
 
             KALDI_VLOG(1) << "Endpoint, sending message: " << msg;
-            server.WriteLn(msg);
+            client.WriteLn(msg);
             break; // while (true)
           }
         }
@@ -349,15 +566,11 @@ int main(int argc, char *argv[]) {
 
 
 namespace kaldi {
-TcpServer::TcpServer(int read_timeout) {
+TcpServer::TcpServer() {
   server_desc_ = -1;
-  client_desc_ = -1;
-  samp_buf_ = NULL;
-  buf_len_ = 0;
-  read_timeout_ = 1000 * read_timeout;
 }
 
-bool TcpServer::Listen(int32 port) {
+bool TcpServer::Listen(int32 port, int32 backlog) {
   h_addr_.sin_addr.s_addr = INADDR_ANY;
   h_addr_.sin_port = htons(port);
   h_addr_.sin_family = AF_INET;
@@ -381,7 +594,7 @@ bool TcpServer::Listen(int32 port) {
     return false;
   }
 
-  if (listen(server_desc_, 1) == -1) {
+  if (listen(server_desc_, backlog) == -1) {
     KALDI_ERR << "Cannot listen on port!";
     return false;
   }
@@ -393,10 +606,8 @@ bool TcpServer::Listen(int32 port) {
 }
 
 TcpServer::~TcpServer() {
-  Disconnect();
   if (server_desc_ != -1)
     close(server_desc_);
-  delete[] samp_buf_;
 }
 
 int32 TcpServer::Accept() {
@@ -405,26 +616,38 @@ int32 TcpServer::Accept() {
   socklen_t len;
 
   len = sizeof(struct sockaddr);
-  client_desc_ = accept(server_desc_, (struct sockaddr *) &h_addr_, &len);
+  int32 client_desc = accept(server_desc_, (struct sockaddr *) &h_addr_, &len);
 
   struct sockaddr_storage addr;
   char ipstr[20];
 
   len = sizeof addr;
-  getpeername(client_desc_, (struct sockaddr *) &addr, &len);
+  getpeername(client_desc, (struct sockaddr *) &addr, &len);
 
   struct sockaddr_in *s = (struct sockaddr_in *) &addr;
   inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof ipstr);
 
+  KALDI_LOG << "Accepted connection from: " << ipstr;
+
+  return client_desc;
+}
+
+TcpConnection::TcpConnection(int32 client_desc, int read_timeout) {
+  client_desc_ = client_desc;
+  samp_buf_ = NULL;
+  buf_len_ = 0;
+  has_read_ = 0;
+  read_timeout_ = 1000 * read_timeout;
   client_set_[0].fd = client_desc_;
   client_set_[0].events = POLLIN;
+}
 
-  KALDI_LOG << "Accepted connection from: " << ipstr;
-
-  return client_desc_;
+TcpConnection::~TcpConnection() {
+  Disconnect();
+  delete[] samp_buf_;
 }
 
-bool TcpServer::ReadChunk(size_t len) {
+bool TcpConnection::ReadChunk(size_t len) {
   if (buf_len_ != len) {
     buf_len_ = len;
     delete[] samp_buf_;
@@ -459,7 +682,7 @@ bool TcpServer::ReadChunk(size_t len) {
   return has_read_ > 0;
 }
 
-Vector<BaseFloat> TcpServer::GetChunk() {
+Vector<BaseFloat> TcpConnection::GetChunk() {
   Vector<BaseFloat> buf;
 
   buf.Resize(static_cast<MatrixIndexT>(has_read_));
@@ -470,7 +693,7 @@ Vector<BaseFloat> TcpServer::GetChunk() {
   return buf;
 }
 
-bool TcpServer::Write(const std::string &msg) {
+bool TcpConnection::Write(const std::string &msg) {
 
   const char *p = msg.c_str();
   size_t to_write = msg.size();
@@ -487,13 +710,13 @@ bool TcpServer::Write(const std::string &msg) {
   return true;
 }
 
-bool TcpServer::WriteLn(const std::string &msg, const std::string &eol) {
+bool TcpConnection::WriteLn(const std::string &msg, const std::string &eol) {
   if (Write(msg))
     return Write(eol);
   else return false;
 }
 
-void TcpServer::Disconnect() {
+void TcpConnection::Disconnect() {
   if (client_desc_ != -1) {
     close(client_desc_);
     client_desc_ = -1;
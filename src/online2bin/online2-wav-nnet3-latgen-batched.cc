@@ -0,0 +1,280 @@
+// online2bin/online2-wav-nnet3-latgen-batched.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/wave-reader.h"
+#include "online2/online-nnet3-batched-decoding.h"
+#include "online2/online-nnet2-feature-pipeline.h"
+#include "online2/onlinebin-util.h"
+#include "fstext/fstext-lib.h"
+#include "lat/lattice-functions.h"
+#include "util/kaldi-thread.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+
+void GetDiagnosticsAndPrintOutput(const std::string &utt,
+                                  const fst::SymbolTable *word_syms,
+                                  const CompactLattice &clat,
+                                  int64 *tot_num_frames,
+                                  double *tot_like) {
+  if (clat.NumStates() == 0) {
+    KALDI_WARN << "Empty lattice.";
+    return;
+  }
+  CompactLattice best_path_clat;
+  CompactLatticeShortestPath(clat, &best_path_clat);
+
+  Lattice best_path_lat;
+  ConvertLattice(best_path_clat, &best_path_lat);
+
+  double likelihood;
+  LatticeWeight weight;
+  int32 num_frames;
+  std::vector<int32> alignment;
+  std::vector<int32> words;
+  GetLinearSymbolSequence(best_path_lat, &alignment, &words, &weight);
+  num_frames = alignment.size();
+  likelihood = -(weight.Value1() + weight.Value2());
+  *tot_num_frames += num_frames;
+  *tot_like += likelihood;
+  KALDI_VLOG(2) << "Likelihood per frame for utterance " << utt << " is "
+                << (likelihood / num_frames) << " over " << num_frames
+                << " frames, = " << (-weight.Value1() / num_frames)
+                << ',' << (weight.Value2() / num_frames);
+
+  if (word_syms != NULL) {
+    std::cerr << utt << ' ';
+    for (size_t i = 0; i < words.size(); i++) {
+      std::string s = word_syms->Find(words[i]);
+      if (s == "")
+        KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
+      std::cerr << s << ' ';
+    }
+    std::cerr << std::endl;
+  }
+}
+
+// The state of one utterance that is being decoded as a stream.
+struct StreamInfo {
+  std::string utt;
+  WaveData wave_data;
+  OnlineNnet2FeaturePipeline *feature_pipeline;
+  int32 samp_offset;
+  bool input_finished;
+};
+
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Reads in wav file(s) and simulates online decoding with neural nets\n"
+        "(nnet3 setup) of many concurrent streams, where the neural net\n"
+        "computation of all streams is batched together on CPU and the graph\n"
+        "search is done by a pool of decoder threads.  Utterances are decoded\n"
+        "as separate streams (no speaker adaptation state is carried over).\n"
+        "\n"
+        "Usage: online2-wav-nnet3-latgen-batched [options] <nnet3-in> <fst-in> "
+        "<wav-rspecifier> <lattice-wspecifier>\n"
+        "e.g.: online2-wav-nnet3-latgen-batched --num-streams=100 \\\n"
+        "   --num-decoder-threads=8 --config=conf/online.conf final.mdl \\\n"
+        "   HCLG.fst scp:wav.scp ark:lat.ark\n";
+
+    ParseOptions po(usage);
+
+    std::string word_syms_rxfilename;
+
+    OnlineNnet2FeaturePipelineConfig feature_opts;
+    OnlineNnet3BatchedDecoderConfig batched_opts;
+
+    BaseFloat chunk_length_secs = 0.18;
+    int32 num_streams = 64;
+    bool quantize = false;
+    bool use_mmap = false;
+
+    po.Register("chunk-length", &chunk_length_secs,
+                "Length of chunk size in seconds, that we provide to each "
+                "stream at a time.");
+    po.Register("num-streams", &num_streams,
+                "Number of utterances that are decoded concurrently.");
+    po.Register("word-symbol-table", &word_syms_rxfilename,
+                "Symbol table for words [for debug output]");
+    po.Register("num-threads-startup", &g_num_threads,
+                "Number of threads used when initializing iVector extractor.");
+    po.Register("quantize", &quantize,
+                "If true, convert the affine, linear and TDNN components of "
+                "the model to 8-bit integer versions after reading it, for "
+                "faster computation on CPU (see also nnet3-quantize, which "
+                "can keep sensitive components in floating point).");
+    po.Register("use-mmap", &use_mmap,
+                "If true, memory-map the decoding graph instead of reading it, "
+                "if it is a ConstFst written with --fst_align=true.");
+
+    feature_opts.Register(&po);
+    batched_opts.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 4) {
+      po.PrintUsage();
+      return 1;
+    }
+
+    std::string nnet3_rxfilename = po.GetArg(1),
+        fst_rxfilename = po.GetArg(2),
+        wav_rspecifier = po.GetArg(3),
+        clat_wspecifier = po.GetArg(4);
+
+    KALDI_ASSERT(num_streams > 0 && chunk_length_secs > 0.0);
+
+    OnlineNnet2FeaturePipelineInfo feature_info(feature_opts);
+
+    TransitionModel trans_model;
+    nnet3::AmNnetSimple am_nnet;
+    {
+      bool binary;
+      Input ki(nnet3_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+      SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
+      SetDropoutTestMode(true, &(am_nnet.GetNnet()));
+      nnet3::CollapseModel(nnet3::CollapseModelConfig(), &(am_nnet.GetNnet()));
+      if (quantize) {
+        int32 num_quantized = nnet3::QuantizeNnet("*", &(am_nnet.GetNnet()));
+        KALDI_LOG << "Quantized " << num_quantized << " components.";
+      }
+    }
+
+    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldiGeneric(fst_rxfilename,
+                                                            true, use_mmap);
+
+    fst::SymbolTable *word_syms = NULL;
+    if (word_syms_rxfilename != "")
+      if (!(word_syms = fst::SymbolTable::ReadText(word_syms_rxfilename)))
+        KALDI_ERR << "Could not read symbol table from file "
+                  << word_syms_rxfilename;
+
+    int32 num_done = 0, num_err = 0;
+    double tot_like = 0.0;
+    int64 num_frames = 0;
+    double tot_audio_seconds = 0.0;
+
+    SequentialTableReader<WaveHolder> wav_reader(wav_rspecifier);
+    CompactLatticeWriter clat_writer(clat_wspecifier);
+
+    Timer timer;
+    {
+      OnlineNnet3BatchedDecoder decoder(batched_opts, trans_model, am_nnet,
+                                        *decode_fst);
+      int64 stream_id = 0;
+
+      while (!wav_reader.Done()) {
+        // Start up to 'num_streams' utterances, and feed them chunk by chunk
+        // in round-robin fashion until they are all finished.
+        std::vector<StreamInfo*> streams;
+        for (; !wav_reader.Done() &&
+                 static_cast<int32>(streams.size()) < num_streams;
+             wav_reader.Next()) {
+          StreamInfo *info = new StreamInfo();
+          info->utt = wav_reader.Key();
+          info->wave_data = wav_reader.Value();
+          info->feature_pipeline = new OnlineNnet2FeaturePipeline(feature_info);
+          info->samp_offset = 0;
+          info->input_finished = false;
+          decoder.InitStream(stream_id + streams.size(),
+                             info->feature_pipeline);
+          tot_audio_seconds += info->wave_data.Duration();
+          streams.push_back(info);
+        }
+
+        bool all_done = false;
+        while (!all_done) {
+          all_done = true;
+          for (size_t i = 0; i < streams.size(); i++) {
+            StreamInfo *info = streams[i];
+            if (info->input_finished)
+              continue;
+            // we only take the first channel.
+            SubVector<BaseFloat> data(info->wave_data.Data(), 0);
+            BaseFloat samp_freq = info->wave_data.SampFreq();
+            int32 chunk_length = std::max<int32>(1,
+                                                 samp_freq * chunk_length_secs),
+                num_samp = std::min(chunk_length,
+                                    data.Dim() - info->samp_offset);
+            SubVector<BaseFloat> wave_part(data, info->samp_offset, num_samp);
+            info->feature_pipeline->AcceptWaveform(samp_freq, wave_part);
+            info->samp_offset += num_samp;
+            if (info->samp_offset == data.Dim()) {
+              info->feature_pipeline->InputFinished();
+              info->input_finished = true;
+            } else {
+              all_done = false;
+            }
+            decoder.AcceptInput(stream_id + i);
+          }
+        }
+
+        for (size_t i = 0; i < streams.size(); i++) {
+          StreamInfo *info = streams[i];
+          decoder.FinalizeDecoding(stream_id + i);
+          if (decoder.NumFramesDecoded(stream_id + i) == 0) {
+            KALDI_WARN << "No frames decoded for utterance " << info->utt;
+            num_err++;
+          } else {
+            CompactLattice clat;
+            bool end_of_utterance = true;
+            decoder.GetLattice(stream_id + i, end_of_utterance, &clat);
+            GetDiagnosticsAndPrintOutput(info->utt, word_syms, clat,
+                                         &num_frames, &tot_like);
+            // we want to output the lattice with un-scaled acoustics.
+            BaseFloat inv_acoustic_scale =
+                1.0 / batched_opts.compute_opts.acoustic_scale;
+            ScaleLattice(AcousticLatticeScale(inv_acoustic_scale), &clat);
+            clat_writer.Write(info->utt, clat);
+            num_done++;
+          }
+          decoder.CloseStream(stream_id + i);
+          delete info->feature_pipeline;
+          delete info;
+        }
+        stream_id += streams.size();
+      }
+    }
+    double elapsed = timer.Elapsed();
+    KALDI_LOG << "Time taken " << elapsed << "s for " << tot_audio_seconds
+              << "s of audio: real-time factor is "
+              << (elapsed / tot_audio_seconds);
+    KALDI_LOG << "Decoded " << num_done << " utterances, "
+              << num_err << " with errors.";
+    KALDI_LOG << "Overall likelihood per frame was " << (tot_like / num_frames)
+              << " per frame over " << num_frames << " frames.";
+    delete decode_fst;
+    delete word_syms; // will delete if non-NULL.
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+} // main()
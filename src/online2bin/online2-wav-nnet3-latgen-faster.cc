@@ -108,6 +108,8 @@ int main(int argc, char *argv[]) {
     BaseFloat chunk_length_secs = 0.18;
     bool do_endpointing = false;
     bool online = true;
+    bool quantize = false;
+    bool use_mmap = false;
 
     po.Register("chunk-length", &chunk_length_secs,
                 "Length of chunk size in seconds, that we process.  Set to <= 0 "
@@ -127,6 +129,14 @@ int main(int argc, char *argv[]) {
                 "--chunk-length=-1.");
     po.Register("num-threads-startup", &g_num_threads,
                 "Number of threads used when initializing iVector extractor.");
+    po.Register("quantize", &quantize,
+                "If true, convert the affine, linear and TDNN components of "
+                "the model to 8-bit integer versions after reading it, for "
+                "faster computation on CPU (see also nnet3-quantize, which "
+                "can keep sensitive components in floating point).");
+    po.Register("use-mmap", &use_mmap,
+                "If true, memory-map the decoding graph instead of reading it, "
+                "if it is a ConstFst written with --fst_align=true.");
 
     feature_opts.Register(&po);
     decodable_opts.Register(&po);
@@ -169,6 +179,10 @@ int main(int argc, char *argv[]) {
       SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
       SetDropoutTestMode(true, &(am_nnet.GetNnet()));
       nnet3::CollapseModel(nnet3::CollapseModelConfig(), &(am_nnet.GetNnet()));
+      if (quantize) {
+        int32 num_quantized = nnet3::QuantizeNnet("*", &(am_nnet.GetNnet()));
+        KALDI_LOG << "Quantized " << num_quantized << " components.";
+      }
     }
 
     // this object contains precomputed stuff that is used by all decodable
@@ -178,7 +192,8 @@ int main(int argc, char *argv[]) {
                                                         &am_nnet);
 
 
-    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldiGeneric(fst_rxfilename);
+    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldiGeneric(fst_rxfilename,
+                                                            true, use_mmap);
 
     fst::SymbolTable *word_syms = NULL;
     if (word_syms_rxfilename != "")
@@ -17,6 +17,8 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iomanip>
+#include <sstream>
 #include "feat/wave-reader.h"
 #include "online2/online-nnet3-incremental-decoding.h"
 #include "online2/online-nnet2-feature-pipeline.h"
@@ -72,6 +74,37 @@ void GetDiagnosticsAndPrintOutput(const std::string &utt,
   }
 }
 
+// Returns the key for the lattice of the segment of utterance 'utt' that
+// consists of output frames [start_frame, end_frame), in the usual format for
+// segment names: <utt>-<start>-<end>, with the start and end in input frames
+// (normally 10ms), zero-padded to 7 digits.
+std::string SegmentKey(const std::string &utt, int32 start_frame,
+                       int32 end_frame, int32 frame_subsampling_factor) {
+  std::ostringstream os;
+  os << utt << '-' << std::setfill('0') << std::setw(7)
+     << (start_frame * frame_subsampling_factor) << '-' << std::setw(7)
+     << (end_frame * frame_subsampling_factor);
+  return os.str();
+}
+
+// Prints diagnostics for the lattice, removes the acoustic scale from it
+// and writes it.
+void OutputLattice(const std::string &key,
+                   const fst::SymbolTable *word_syms,
+                   BaseFloat acoustic_scale,
+                   CompactLattice *clat,
+                   CompactLatticeWriter *clat_writer,
+                   int64 *tot_num_frames,
+                   double *tot_like) {
+  fst::Connect(clat);
+  GetDiagnosticsAndPrintOutput(key, word_syms, *clat,
+                               tot_num_frames, tot_like);
+  // we want to output the lattice with un-scaled acoustics.
+  BaseFloat inv_acoustic_scale = 1.0 / acoustic_scale;
+  fst::ScaleLattice(fst::AcousticLatticeScale(inv_acoustic_scale), clat);
+  clat_writer->Write(key, *clat);
+}
+
 }
 
 int main(int argc, char *argv[]) {
@@ -93,7 +126,10 @@ int main(int argc, char *argv[]) {
         "Usage: online2-wav-nnet3-latgen-incremental [options] <nnet3-in> <fst-in> "
         "<spk2utt-rspecifier> <wav-rspecifier> <lattice-wspecifier>\n"
         "The spk2utt-rspecifier can just be <utterance-id> <utterance-id> if\n"
-        "you want to decode utterance by utterance.\n";
+        "you want to decode utterance by utterance.\n"
+        "With --flush-lattices=true (for long recordings), the lattice of each\n"
+        "utterance is output in segments as the decoding proceeds, with keys\n"
+        "<utterance-id>-<start-frame>-<end-frame>; see the --flush.* options.\n";
 
     ParseOptions po(usage);
 
@@ -105,10 +141,12 @@ int main(int argc, char *argv[]) {
     nnet3::NnetSimpleLoopedComputationOptions decodable_opts;
     LatticeIncrementalDecoderConfig decoder_opts;
     OnlineEndpointConfig endpoint_opts;
+    OnlineLatticeFlushConfig flush_opts;
 
     BaseFloat chunk_length_secs = 0.18;
     bool do_endpointing = false;
     bool online = true;
+    bool flush_lattices = false;
 
     po.Register("chunk-length", &chunk_length_secs,
                 "Length of chunk size in seconds, that we process.  Set to <= 0 "
@@ -128,12 +166,18 @@ int main(int argc, char *argv[]) {
                 "--chunk-length=-1.");
     po.Register("num-threads-startup", &g_num_threads,
                 "Number of threads used when initializing iVector extractor.");
+    po.Register("flush-lattices", &flush_lattices,
+                "If true, output the lattices of long utterances in segments "
+                "as the decoding proceeds, restarting the decoder after each "
+                "segment, and keep only the latest features (see "
+                "--flush.max-feature-vectors), so that the memory used does "
+                "not grow with the length of the utterance.");
 
     feature_opts.Register(&po);
     decodable_opts.Register(&po);
     decoder_opts.Register(&po);
     endpoint_opts.Register(&po);
-
+    flush_opts.Register(&po);
 
     po.Read(argc, argv);
 
@@ -148,6 +192,9 @@ int main(int argc, char *argv[]) {
         wav_rspecifier = po.GetArg(4),
         clat_wspecifier = po.GetArg(5);
 
+    if (flush_lattices)
+      flush_opts.Check();
+
     OnlineNnet2FeaturePipelineInfo feature_info(feature_opts);
 
     if (!online) {
@@ -155,6 +202,15 @@ int main(int argc, char *argv[]) {
       feature_info.ivector_extractor_info.greedy_ivector_extractor = true;
       chunk_length_secs = -1.0;
     }
+    // The decoder is restarted at each flush, so the features of old frames
+    // are not needed either, as long as we decode in chunks.
+    if (flush_lattices) {
+      if (chunk_length_secs > 0)
+        flush_opts.LimitFeatureBuffers(&feature_info);
+      else
+        KALDI_WARN << "With --chunk-length <= 0 or --online=false, the "
+                   << "features of the whole utterance are kept in memory.";
+    }
 
     TransitionModel trans_model;
     nnet3::AmNnetSimple am_nnet;
@@ -253,26 +309,46 @@ int main(int argc, char *argv[]) {
           if (silence_weighting.Active() &&
               feature_pipeline.IvectorFeature() != NULL) {
             silence_weighting.ComputeCurrentTraceback(decoder.Decoder());
-            silence_weighting.GetDeltaWeights(feature_pipeline.NumFramesReady(),
-                                              &delta_weights);
+            silence_weighting.GetDeltaWeights(
+                feature_pipeline.NumFramesReady(),
+                decoder.FrameOffset() * decodable_opts.frame_subsampling_factor,
+                &delta_weights);
             feature_pipeline.IvectorFeature()->UpdateFrameWeights(delta_weights);
           }
 
           decoder.AdvanceDecoding();
 
+          if (flush_lattices &&
+              decoder.FlushPointDetected(flush_opts,
+                                         endpoint_opts.silence_phones)) {
+            int32 start_frame = decoder.FrameOffset();
+            CompactLattice clat;
+            decoder.FlushLattice(&clat);
+            OutputLattice(SegmentKey(utt, start_frame, decoder.FrameOffset(),
+                                     decodable_opts.frame_subsampling_factor),
+                          word_syms, decodable_opts.acoustic_scale, &clat,
+                          &clat_writer, &num_frames, &tot_like);
+          }
+
           if (do_endpointing && decoder.EndpointDetected(endpoint_opts)) {
             break;
           }
         }
         decoder.FinalizeDecoding();
 
-        bool use_final_probs = true;
-        CompactLattice clat = decoder.GetLattice(decoder.NumFramesDecoded(),
-                                                 use_final_probs);
-
-        Connect(&clat);
-        GetDiagnosticsAndPrintOutput(utt, word_syms, clat,
-                                     &num_frames, &tot_like);
+        // If we flushed the lattice, the last segment may be empty.
+        if (!flush_lattices || decoder.NumFramesDecoded() > 0) {
+          bool use_final_probs = true;
+          CompactLattice clat = decoder.GetLattice(decoder.NumFramesDecoded(),
+                                                   use_final_probs);
+          std::string key = utt;
+          if (flush_lattices)
+            key = SegmentKey(utt, decoder.FrameOffset(),
+                             decoder.FrameOffset() + decoder.NumFramesDecoded(),
+                             decodable_opts.frame_subsampling_factor);
+          OutputLattice(key, word_syms, decodable_opts.acoustic_scale, &clat,
+                        &clat_writer, &num_frames, &tot_like);
+        }
 
         decoding_timer.OutputStats(&timing_stats);
 
@@ -280,12 +356,6 @@ int main(int argc, char *argv[]) {
         // you felt the utterance had low confidence.  See lat/confidence.h
         feature_pipeline.GetAdaptationState(&adaptation_state);
 
-        // we want to output the lattice with un-scaled acoustics.
-        BaseFloat inv_acoustic_scale =
-            1.0 / decodable_opts.acoustic_scale;
-        ScaleLattice(AcousticLatticeScale(inv_acoustic_scale), &clat);
-
-        clat_writer.Write(utt, clat);
         KALDI_LOG << "Decoded utterance " << utt;
         num_done++;
       }
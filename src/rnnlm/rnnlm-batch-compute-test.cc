@@ -0,0 +1,161 @@
+// rnnlm/rnnlm-batch-compute-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "rnnlm/rnnlm-batch-compute.h"
+#include "nnet3/nnet-nnet.h"
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+namespace rnnlm {
+
+// Returns a random unigram distribution over words 1 .. vocab_size - 1.
+static std::vector<BaseFloat> RandomUnigramProbs(int32 vocab_size) {
+  std::vector<BaseFloat> probs(vocab_size, 0.0);
+  double sum = 0.0;
+  for (int32 i = 1; i < vocab_size; i++)
+    sum += (probs[i] = RandUniform() + 0.5);
+  for (int32 i = 1; i < vocab_size; i++)
+    probs[i] /= sum;
+  return probs;
+}
+
+// Creates a small RNNLM with a recurrence and a non-recurrent left context.
+static void GetTestRnnlm(nnet3::Nnet *rnnlm) {
+  std::string config =
+      "input-node name=input dim=8\n"
+      "component name=affine1 type=AffineComponent input-dim=28 "
+      "output-dim=12\n"
+      "component name=relu1 type=RectifiedLinearComponent dim=12\n"
+      "component name=affine2 type=AffineComponent input-dim=12 "
+      "output-dim=8\n"
+      "component-node name=affine1 component=affine1 input=Append(input, "
+      "IfDefined(Offset(relu1, -1)), IfDefined(Offset(input, -2)))\n"
+      "component-node name=relu1 component=relu1 input=affine1\n"
+      "component-node name=affine2 component=affine2 input=relu1\n"
+      "output-node name=output input=affine2\n";
+  std::istringstream is(config);
+  rnnlm->ReadConfig(is);
+}
+
+// Checks that RnnlmBatchComputer gives the same log-probs as
+// RnnlmComputeState, for random histories and batch sizes.
+void UnitTestRnnlmBatchComputer(bool normalize_probs, bool sample_normalizer) {
+  nnet3::Nnet rnnlm;
+  GetTestRnnlm(&rnnlm);
+
+  int32 vocab_size = RandInt(10, 30);
+  CuMatrix<BaseFloat> word_embedding_mat(vocab_size, 8);
+  word_embedding_mat.SetRandn();
+
+  RnnlmComputeStateComputationOptions opts;
+  opts.bos_index = 1;
+  opts.eos_index = 2;
+  opts.normalize_probs = normalize_probs;
+  RnnlmComputeStateInfo info(opts, rnnlm, word_embedding_mat);
+  if (sample_normalizer)
+    info.InitNormalizationSample(RandomUnigramProbs(vocab_size),
+                                 vocab_size / 2);
+
+  int32 batch_size = RandInt(1, 9);
+  RnnlmBatchComputer computer(info, batch_size);
+
+  for (int32 iter = 0; iter < 2; iter++) {
+    // Grow a tree of histories, keeping the equivalent RnnlmComputeState for
+    // each of them.
+    std::vector<int32> states(1, 0);
+    std::vector<RnnlmComputeState*> ref_states(
+        1, new RnnlmComputeState(info, opts.bos_index));
+    int32 num_states = RandInt(1, 40);
+    for (int32 i = 0; i < num_states; i++) {
+      int32 prev = RandInt(0, states.size() - 1),
+          word = RandInt(3, vocab_size - 1);
+      states.push_back(computer.GetSuccessorState(states[prev], word));
+      ref_states.push_back(ref_states[prev]->GetSuccessorState(word));
+    }
+    // Compute a random subset of them in batches; the rest will be computed
+    // one at a time by LogProbOfWord().
+    std::vector<int32> to_compute;
+    for (size_t i = 0; i < states.size(); i++)
+      if (WithProb(0.7))
+        to_compute.push_back(states[i]);
+    computer.ComputeStates(to_compute);
+
+    for (size_t i = 0; i < states.size(); i++) {
+      for (int32 word = 1; word < vocab_size; word++) {
+        BaseFloat log_prob = computer.LogProbOfWord(states[i], word),
+            ref_log_prob = ref_states[i]->LogProbOfWord(word);
+        KALDI_ASSERT(ApproxEqual(log_prob, ref_log_prob, 0.001) ||
+                     std::abs(log_prob - ref_log_prob) < 0.001);
+      }
+      delete ref_states[i];
+    }
+    computer.Clear();
+    KALDI_ASSERT(computer.NumStates() == 1);
+  }
+  computer.PrintStats();
+}
+
+// Checks that the sampled estimate of the normalizer is close to the exact
+// one, for a model whose word scores are all close to zero.
+void UnitTestSampledNormalizer() {
+  nnet3::Nnet rnnlm;
+  GetTestRnnlm(&rnnlm);
+
+  int32 vocab_size = RandInt(1000, 2000);
+  CuMatrix<BaseFloat> word_embedding_mat(vocab_size, 8);
+  word_embedding_mat.SetRandn();
+  word_embedding_mat.Scale(0.1);
+
+  RnnlmComputeStateComputationOptions opts;
+  opts.bos_index = 1;
+  opts.eos_index = 2;
+  opts.normalize_probs = true;
+  RnnlmComputeStateInfo exact_info(opts, rnnlm, word_embedding_mat),
+      sampled_info(opts, rnnlm, word_embedding_mat);
+  int32 sample_size = vocab_size / 4;
+  sampled_info.InitNormalizationSample(RandomUnigramProbs(vocab_size),
+                                       sample_size);
+  KALDI_ASSERT(sampled_info.normalization_embedding_mat.NumRows() ==
+               sample_size);
+
+  CuMatrix<BaseFloat> predicted_embeddings(5, 8);
+  predicted_embeddings.SetRandn();
+  predicted_embeddings.Scale(0.1);
+  CuVector<BaseFloat> exact(5), sampled(5);
+  exact_info.ComputeNormalizers(predicted_embeddings, &exact);
+  sampled_info.ComputeNormalizers(predicted_embeddings, &sampled);
+  KALDI_LOG << "Exact normalizers are " << exact << ", sampled are "
+            << sampled;
+  for (int32 i = 0; i < 5; i++)
+    KALDI_ASSERT(std::abs(exact(i) - sampled(i)) < 0.2);
+}
+
+}  // namespace rnnlm
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 12; i++) {
+    rnnlm::UnitTestRnnlmBatchComputer(i % 3 != 0, i % 3 == 2);
+  }
+  rnnlm::UnitTestSampledNormalizer();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
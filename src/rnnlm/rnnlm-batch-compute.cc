@@ -0,0 +1,371 @@
+// rnnlm/rnnlm-batch-compute.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <set>
+
+#include "rnnlm/rnnlm-batch-compute.h"
+#include "nnet3/nnet-compile-looped.h"
+#include "nnet3/nnet-utils.h"
+#include "util/stl-utils.h"
+
+namespace kaldi {
+namespace rnnlm {
+
+RnnlmBatchComputer::RnnlmBatchComputer(const RnnlmComputeStateInfo &info,
+                                       int32 batch_size):
+    info_(info), batch_size_(batch_size), state_dim_(0),
+    num_states_computed_(0), num_batches_(0) {
+  KALDI_ASSERT(batch_size > 0);
+  int32 num_sizes = 1;
+  while ((1 << (num_sizes - 1)) < batch_size)
+    num_sizes++;
+  computations_.resize(num_sizes, NULL);
+
+  // The BOS state is computed from an all-zero history.
+  states_.push_back(new StateInfo(-1, info.opts.bos_index));
+  ComputeStates(std::vector<int32>(1, 0));
+
+  // Check that this gives the same result as RnnlmComputeState, which starts
+  // the computation from the beginning.
+  RnnlmComputeState ref_state(info, info.opts.bos_index);
+  int32 num_words = info.word_embedding_mat.NumRows();
+  int32 test_words[] = { info.opts.eos_index, 1, num_words / 2,
+                         num_words - 1 };
+  for (int32 i = 0; i < 4; i++) {
+    BaseFloat ref_log_prob = ref_state.LogProbOfWord(test_words[i]),
+        log_prob = LogProbOfWord(0, test_words[i]);
+    if (!(std::abs(ref_log_prob - log_prob) <=
+          1.0e-03 * std::max<BaseFloat>(1.0, std::abs(ref_log_prob))))
+      KALDI_ERR << "Batched RNNLM computation gives different log-prob from "
+                << "the regular one (" << log_prob << " vs. " << ref_log_prob
+                << "); this RNNLM cannot be evaluated in batches.";
+  }
+}
+
+RnnlmBatchComputer::~RnnlmBatchComputer() {
+  DeletePointers(&states_);
+  DeletePointers(&computations_);
+}
+
+int32 RnnlmBatchComputer::GetSuccessorState(int32 state, int32 next_word) {
+  KALDI_ASSERT(static_cast<size_t>(state) < states_.size() &&
+               next_word > 0 &&
+               next_word < info_.word_embedding_mat.NumRows());
+  states_.push_back(new StateInfo(state, next_word));
+  return states_.size() - 1;
+}
+
+void RnnlmBatchComputer::ComputeStates(const std::vector<int32> &states) {
+  // 'to_compute' will contain the states that have not been computed, and
+  // their predecessors that have not been computed.
+  std::vector<int32> to_compute;
+  for (size_t i = 0; i < states.size(); i++) {
+    int32 s = states[i];
+    KALDI_ASSERT(static_cast<size_t>(s) < states_.size());
+    while (s >= 0 && states_[s]->predicted_embedding.Dim() == 0) {
+      to_compute.push_back(s);
+      s = states_[s]->prev_state;
+    }
+  }
+  SortAndUniq(&to_compute);
+
+  // A state is always created after its predecessor, so at each iteration the
+  // first remaining state can be computed.
+  while (!to_compute.empty()) {
+    std::vector<int32> ready, not_ready;
+    for (size_t i = 0; i < to_compute.size(); i++) {
+      int32 s = to_compute[i], prev = states_[s]->prev_state;
+      if (prev < 0 || states_[prev]->predicted_embedding.Dim() != 0)
+        ready.push_back(s);
+      else
+        not_ready.push_back(s);
+    }
+    KALDI_ASSERT(!ready.empty());
+    for (size_t i = 0; i < ready.size(); i += batch_size_) {
+      std::vector<int32> batch(ready.begin() + i,
+                               ready.begin() + std::min<size_t>(
+                                   ready.size(), i + batch_size_));
+      AdvanceStates(batch);
+    }
+    to_compute.swap(not_ready);
+  }
+}
+
+BaseFloat RnnlmBatchComputer::LogProbOfWord(int32 state, int32 word_index) {
+  KALDI_ASSERT(static_cast<size_t>(state) < states_.size() &&
+               word_index >= 0 &&
+               word_index < info_.word_embedding_mat.NumRows());
+  const StateInfo *info = states_[state];
+  if (info->predicted_embedding.Dim() == 0)
+    ComputeStates(std::vector<int32>(1, state));
+  BaseFloat log_prob = VecVec(info->predicted_embedding,
+                              info_.word_embedding_mat.Row(word_index));
+  // See the comment in RnnlmComputeState::LogProbOfWord().
+  if (info_.opts.normalize_probs)
+    log_prob -= info->normalization_factor;
+  return log_prob;
+}
+
+void RnnlmBatchComputer::Clear() {
+  for (size_t i = 1; i < states_.size(); i++)
+    delete states_[i];
+  states_.resize(1);
+}
+
+void RnnlmBatchComputer::PrintStats() const {
+  KALDI_LOG << "Computed " << num_states_computed_ << " RNNLM states in "
+            << num_batches_ << " batches, average batch size "
+            << (num_states_computed_ / std::max<double>(num_batches_, 1.0));
+}
+
+RnnlmBatchComputer::BatchComputation* RnnlmBatchComputer::GetComputation(
+    int32 num_sequences) {
+  for (size_t i = 0; i < computations_.size(); i++) {
+    int32 this_num_sequences = std::min<int32>(1 << i, batch_size_);
+    if (this_num_sequences >= num_sequences) {
+      if (computations_[i] == NULL) {
+        computations_[i] = new BatchComputation();
+        computations_[i]->num_sequences = this_num_sequences;
+        InitComputation(computations_[i]);
+      }
+      return computations_[i];
+    }
+  }
+  KALDI_ERR << "Too many sequences requested: " << num_sequences << " > "
+            << batch_size_;
+  return NULL;  // Suppress compiler warning.
+}
+
+void RnnlmBatchComputer::InitComputation(BatchComputation *bc) {
+  using namespace nnet3;
+  const Nnet &rnnlm = info_.rnnlm;
+  int32 num_sequences = bc->num_sequences,
+      embedding_dim = info_.word_embedding_mat.NumCols();
+
+  ComputationRequest request1, request2, request3;
+  CreateLoopedComputationRequestSimple(rnnlm,
+                                       1, // num_frames
+                                       1, // frame_subsampling_factor
+                                       1, // ivector_period
+                                       0, // extra_left_context_initial
+                                       0, // extra_right_context
+                                       num_sequences,
+                                       &request1, &request2, &request3);
+  NnetComputation &computation = bc->computation;
+  CompileLooped(rnnlm, info_.opts.optimize_config, request1, request2,
+                request3, &computation);
+  computation.ComputeCudaIndexes();
+  if (GetVerboseLevel() >= 3) {
+    KALDI_VLOG(3) << "Computation for " << num_sequences << " sequences is:";
+    computation.Print(std::cerr, rnnlm);
+  }
+
+  // The computation ends with a loop, from a label to a 'goto' command, that
+  // processes one chunk.  We work out how many chunks we need to process
+  // before we are inside the loop, and the matrix that the output is provided
+  // from inside the loop.
+  const std::vector<NnetComputation::Command> &commands = computation.commands;
+  int32 num_commands = commands.size(), goto_command = num_commands - 1;
+  while (goto_command >= 0 &&
+         commands[goto_command].command_type != kGotoLabel)
+    goto_command--;
+  if (goto_command < 0)
+    KALDI_ERR << "Looped RNNLM computation has no loop.";
+  int32 label_command = commands[goto_command].arg1,
+      output_node = rnnlm.GetNodeIndex("output"),
+      num_initial_chunks = 1, output_matrix = -1;
+  for (int32 c = 0; c < goto_command; c++) {
+    if (commands[c].command_type == kProvideOutput &&
+        commands[c].arg2 == output_node) {
+      if (c < label_command) {
+        num_initial_chunks++;
+      } else {
+        KALDI_ASSERT(output_matrix == -1);
+        output_matrix = computation.submatrices[commands[c].arg1].matrix_index;
+      }
+    }
+  }
+  int32 num_matrices = computation.matrices.size();
+  if (output_matrix == -1 ||
+      computation.matrix_debug_info.size() != num_matrices)
+    KALDI_ERR << "Looped RNNLM computation has an unexpected structure.";
+  int32 output_t =
+      computation.matrix_debug_info[output_matrix].cindexes[0].second.t;
+
+  bc->computer = new NnetComputer(info_.opts.compute_config, computation,
+                                  rnnlm, NULL);  // NULL is 'nnet_to_update'
+  for (int32 i = 0; i < num_initial_chunks; i++) {
+    CuMatrix<BaseFloat> input(num_sequences, embedding_dim);
+    bc->computer->AcceptInput("input", &input);
+    bc->computer->Run();
+    bc->computer->GetOutput("output");
+  }
+
+  // Now the computer is stopped just after providing the output of a chunk
+  // inside the loop, and will always be at this point between calls to
+  // AdvanceStates().  The matrices allocated at this point are the recurrent
+  // state; we identify their rows by the cindexes (without the 'n' index,
+  // and with time relative to the output).
+  bool first_computation = state_layout_.empty();
+  if (first_computation) {
+    for (int32 m = 1; m < num_matrices; m++) {
+      int32 num_rows = bc->computer->GetMatrix(m).NumRows(),
+          num_cols = computation.matrices[m].num_cols;
+      if (num_rows == 0)
+        continue;
+      const std::vector<Cindex> &cindexes =
+          computation.matrix_debug_info[m].cindexes;
+      for (int32 r = 0; r < num_rows; r++) {
+        const Cindex &cindex = cindexes[r];
+        if (cindex.second.n != 0)
+          continue;
+        state_layout_[std::make_pair(cindex.first,
+                                     std::make_pair(cindex.second.t - output_t,
+                                                    cindex.second.x))] =
+            std::make_pair(0, num_cols);
+      }
+    }
+    state_dim_ = 0;
+    for (auto iter = state_layout_.begin(); iter != state_layout_.end();
+         ++iter) {
+      iter->second.first = state_dim_;
+      state_dim_ += iter->second.second;
+    }
+    KALDI_VLOG(1) << "Recurrent state of RNNLM has " << state_layout_.size()
+                  << " parts, with total dimension " << state_dim_;
+  }
+
+  // 'covered' is the set of (sequence, offset) that we have seen, to check
+  // that the recurrent state of each sequence is the same as in
+  // 'state_layout_'.
+  std::set<std::pair<int32, int32> > covered;
+  for (int32 m = 1; m < num_matrices; m++) {
+    int32 num_rows = bc->computer->GetMatrix(m).NumRows(),
+        num_cols = computation.matrices[m].num_cols;
+    if (num_rows == 0)
+      continue;
+    const std::vector<Cindex> &cindexes =
+        computation.matrix_debug_info[m].cindexes;
+    KALDI_ASSERT(cindexes.size() == num_rows);
+    bc->state_matrices.push_back(m);
+    bc->row_sequences.push_back(std::vector<int32>(num_rows));
+    bc->row_offsets.push_back(std::vector<int32>(num_rows));
+    for (int32 r = 0; r < num_rows; r++) {
+      const Cindex &cindex = cindexes[r];
+      auto iter = state_layout_.find(
+          std::make_pair(cindex.first,
+                         std::make_pair(cindex.second.t - output_t,
+                                        cindex.second.x)));
+      int32 n = cindex.second.n;
+      if (iter == state_layout_.end() || iter->second.second != num_cols ||
+          n < 0 || n >= num_sequences)
+        KALDI_ERR << "The RNNLM computation for " << num_sequences
+                  << " sequences has an unexpected recurrent state.";
+      bc->row_sequences.back()[r] = n;
+      bc->row_offsets.back()[r] = iter->second.first;
+      covered.insert(std::make_pair(n, iter->second.first));
+    }
+  }
+  if (covered.size() != state_layout_.size() * num_sequences)
+    KALDI_ERR << "The RNNLM computation for " << num_sequences
+              << " sequences has an unexpected recurrent state.";
+}
+
+void RnnlmBatchComputer::AdvanceStates(const std::vector<int32> &states) {
+  int32 num_states = states.size(),
+      embedding_dim = info_.word_embedding_mat.NumCols();
+  BatchComputation *bc = GetComputation(num_states);
+  nnet3::NnetComputer *computer = bc->computer;
+  int32 num_sequences = bc->num_sequences;
+
+  // Restore the recurrent state of the predecessor of each state into the
+  // rows of its sequence.  Sequences that we don't use, and the BOS state's
+  // (nonexistent) predecessor, get zeros.
+  for (size_t i = 0; i < bc->state_matrices.size(); i++) {
+    CuMatrixBase<BaseFloat> &mat = computer->GetMatrix(bc->state_matrices[i]);
+    const std::vector<int32> &row_sequences = bc->row_sequences[i],
+        &row_offsets = bc->row_offsets[i];
+    std::vector<const BaseFloat*> src(mat.NumRows(), NULL);
+    for (int32 r = 0; r < mat.NumRows(); r++) {
+      int32 n = row_sequences[r];
+      if (n < num_states) {
+        int32 prev_state = states_[states[n]]->prev_state;
+        if (prev_state >= 0) {
+          KALDI_ASSERT(states_[prev_state]->recurrent_state.Dim() ==
+                       state_dim_);
+          src[r] = states_[prev_state]->recurrent_state.Data() +
+              row_offsets[r];
+        }
+      }
+    }
+    CuArray<const BaseFloat*> src_array(src);
+    mat.CopyRows(src_array);
+  }
+
+  std::vector<int32> words(num_sequences, -1);  // -1 gives a zero row.
+  for (int32 n = 0; n < num_states; n++)
+    words[n] = states_[states[n]]->word;
+  CuArray<int32> words_array(words);
+  CuMatrix<BaseFloat> input(num_sequences, embedding_dim, kUndefined);
+  input.CopyRows(info_.word_embedding_mat, words_array);
+  computer->AcceptInput("input", &input);
+  computer->Run();
+  // Note: here GetOutput() is used instead of GetOutputDestructive(), as the
+  // output may be part of the recurrent state.
+  const CuMatrixBase<BaseFloat> &output = computer->GetOutput("output");
+
+  // Save the new recurrent states.
+  for (int32 n = 0; n < num_states; n++) {
+    StateInfo *info = states_[states[n]];
+    KALDI_ASSERT(info->predicted_embedding.Dim() == 0);
+    info->recurrent_state.Resize(state_dim_, kUndefined);
+    info->predicted_embedding.Resize(embedding_dim, kUndefined);
+    info->predicted_embedding.CopyFromVec(output.Row(n));
+  }
+  for (size_t i = 0; i < bc->state_matrices.size(); i++) {
+    const CuMatrixBase<BaseFloat> &mat =
+        computer->GetMatrix(bc->state_matrices[i]);
+    const std::vector<int32> &row_sequences = bc->row_sequences[i],
+        &row_offsets = bc->row_offsets[i];
+    std::vector<BaseFloat*> dest(mat.NumRows(), NULL);
+    for (int32 r = 0; r < mat.NumRows(); r++) {
+      int32 n = row_sequences[r];
+      if (n < num_states)
+        dest[r] = states_[states[n]]->recurrent_state.Data() + row_offsets[r];
+    }
+    CuArray<BaseFloat*> dest_array(dest);
+    mat.CopyToRows(dest_array);
+  }
+
+  if (info_.opts.normalize_probs) {
+    // Work out the normalizers of all the states at once.
+    CuVector<BaseFloat> normalizers(num_states);
+    info_.ComputeNormalizers(output.RowRange(0, num_states), &normalizers);
+    Vector<BaseFloat> normalizers_cpu(normalizers);
+    for (int32 n = 0; n < num_states; n++)
+      states_[states[n]]->normalization_factor = normalizers_cpu(n);
+  }
+  num_states_computed_ += num_states;
+  num_batches_++;
+}
+
+}  // namespace rnnlm
+}  // namespace kaldi
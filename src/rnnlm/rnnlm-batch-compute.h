@@ -0,0 +1,181 @@
+// rnnlm/rnnlm-batch-compute.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_RNNLM_RNNLM_BATCH_COMPUTE_H_
+#define KALDI_RNNLM_RNNLM_BATCH_COMPUTE_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "nnet3/nnet-compute.h"
+#include "rnnlm/rnnlm-compute-state.h"
+
+namespace kaldi {
+namespace rnnlm {
+
+/**
+   Class RnnlmBatchComputer evaluates the RNNLM for many word histories
+   ("states") at once, for use in lattice rescoring.  RnnlmComputeState keeps a
+   whole nnet3::NnetComputer for each history and advances it one word at a
+   time, so rescoring runs the RNNLM on one-row matrices and its cost is
+   dominated by per-state overhead.  This class instead stores, for each
+   history, only the part of the looped computation that is carried over to the
+   next word (the recurrent state), and advances up to 'batch_size' histories
+   as one computation with that many sequences.
+
+   States are identified by integers; state 0 is the state after the BOS
+   symbol.  GetSuccessorState() is cheap: it only records the new state, which
+   is computed when it is needed, by LogProbOfWord() or ComputeStates().  The
+   way to get large batches is to call ComputeStates() with all the states
+   that are going to be needed soon (see the Prefetch() function of
+   fst::DeterministicOnDemandFst, and the --lm-batch-size option of
+   ComposeCompactLatticePruned()).
+
+   This relies on the RNNLM's state at the start of a sentence being the same
+   as that of a history of all-zero values, which is the case for RNNLMs that
+   have zero left context (which RnnlmComputeStateInfo requires) because all
+   recurrences must then use IfDefined(); the constructor checks this against
+   RnnlmComputeState.
+*/
+class RnnlmBatchComputer {
+ public:
+  /// Constructor.  'info' supplies the options, the RNNLM and the word
+  /// embeddings, and must outlive this object.  'batch_size' is the maximum
+  /// number of states that we compute at once; we compile computations for
+  /// powers of two less than that, and for 'batch_size' itself.
+  RnnlmBatchComputer(const RnnlmComputeStateInfo &info, int32 batch_size);
+
+  ~RnnlmBatchComputer();
+
+  /// Creates a state whose history is that of 'state' followed by
+  /// 'next_word', and returns its index.  The new state is not computed
+  /// until it is needed.
+  int32 GetSuccessorState(int32 state, int32 next_word);
+
+  /// Makes sure that the listed states have been computed, computing those
+  /// that were not in batches of up to 'batch_size' states.  Repeats and
+  /// states that were already computed are allowed.
+  void ComputeStates(const std::vector<int32> &states);
+
+  /// Returns the log-prob that the model predicts for 'word_index' after the
+  /// history of 'state' (computing that state by itself, if it has not been
+  /// computed).
+  BaseFloat LogProbOfWord(int32 state, int32 word_index);
+
+  /// Forgets all states except the BOS state (state 0).
+  void Clear();
+
+  int32 NumStates() const { return states_.size(); }
+
+  int32 BosIndex() const { return info_.opts.bos_index; }
+  int32 EosIndex() const { return info_.opts.eos_index; }
+
+  /// Prints (at log level) the number of states computed and the average
+  /// batch size.
+  void PrintStats() const;
+
+ private:
+  struct StateInfo {
+    // The state this state was created from (-1 for the BOS state, which is
+    // created from an all-zero history).
+    int32 prev_state;
+    // The word that was appended to the history of prev_state.
+    int32 word;
+    // The recurrent state, of dimension state_dim_.  Empty if this state has
+    // not been computed yet.
+    CuVector<BaseFloat> recurrent_state;
+    // The output of the RNNLM for this history, of dimension equal to the
+    // embedding dimension.  Empty if this state has not been computed yet.
+    CuVector<BaseFloat> predicted_embedding;
+    // The log of the sum of the exp'ed scores of all words, if
+    // opts.normalize_probs is true.
+    BaseFloat normalization_factor;
+
+    StateInfo(int32 prev_state, int32 word):
+        prev_state(prev_state), word(word), normalization_factor(0.0) { }
+  };
+
+  // The looped computation for a particular number of sequences, and the
+  // NnetComputer that runs it.  Between calls to AdvanceStates(), the computer
+  // is stopped just after providing the output of the last chunk; at that
+  // point, the matrices that are allocated contain all the information that
+  // will be used by the next chunk, and 'state_matrices', 'row_sequences' and
+  // 'row_offsets' tell us how to save and restore it per sequence.
+  struct BatchComputation {
+    int32 num_sequences;
+    nnet3::NnetComputation computation;
+    nnet3::NnetComputer *computer;
+    // The matrix-indexes of the allocated matrices.
+    std::vector<int32> state_matrices;
+    // row_sequences[i][r] is the sequence index for row r of matrix
+    // state_matrices[i].
+    std::vector<std::vector<int32> > row_sequences;
+    // row_offsets[i][r] is the offset of the values of row r of matrix
+    // state_matrices[i] within the recurrent state of a sequence.
+    std::vector<std::vector<int32> > row_offsets;
+    BatchComputation(): num_sequences(0), computer(NULL) { }
+    ~BatchComputation() { delete computer; }
+  };
+
+  // Returns the computation for the smallest of our batch sizes that is
+  // >= num_sequences, compiling it if needed.
+  BatchComputation *GetComputation(int32 num_sequences);
+
+  // Compiles the computation and works out how its recurrent state is
+  // stored; called from GetComputation().
+  void InitComputation(BatchComputation *bc);
+
+  // Advances the RNNLM by one word for each of the listed states (which must
+  // not have been computed, and whose prev_state must have been computed),
+  // setting their recurrent_state, predicted_embedding and
+  // normalization_factor.  'states' must have no more than batch_size_
+  // elements.
+  void AdvanceStates(const std::vector<int32> &states);
+
+  const RnnlmComputeStateInfo &info_;
+  int32 batch_size_;
+
+  // The keys are the (node-index, time relative to the output, x) of the
+  // values in the recurrent state of one sequence, and the values are the
+  // (offset, dimension) of those values in the recurrent state.  This is
+  // set up when we compile the first computation and checked for the others.
+  std::map<std::pair<int32, std::pair<int32, int32> >,
+           std::pair<int32, int32> > state_layout_;
+  int32 state_dim_;
+
+  // Indexed by log2 of the number of sequences (except the last one, which
+  // is for batch_size_).  NULL if not compiled yet.
+  std::vector<BatchComputation*> computations_;
+
+  std::vector<StateInfo*> states_;
+
+  // Statistics for PrintStats().
+  int64 num_states_computed_;
+  int64 num_batches_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(RnnlmBatchComputer);
+};
+
+
+}  // namespace rnnlm
+}  // namespace kaldi
+
+#endif  // KALDI_RNNLM_RNNLM_BATCH_COMPUTE_H_
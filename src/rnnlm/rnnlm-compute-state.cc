@@ -19,9 +19,13 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+
 #include "rnnlm/rnnlm-compute-state.h"
 #include "nnet3/nnet-utils.h"
 #include "nnet3/nnet-compile-looped.h"
+#include "rnnlm/sampler.h"
+#include "rnnlm/sampling-lm.h"
 
 namespace kaldi {
 namespace rnnlm {
@@ -68,6 +72,94 @@ RnnlmComputeStateInfo::RnnlmComputeStateInfo(
     KALDI_VLOG(3) << "Computation is:";
     computation.Print(std::cerr, rnnlm);
   }
+
+  if (opts.normalization_sample_size > 0 && opts.normalize_probs) {
+    if (opts.sampling_lm_rxfilename.empty())
+      KALDI_ERR << "--normalization-sample-size requires --sampling-lm.";
+    SamplingLm sampling_lm;
+    ReadKaldiObject(opts.sampling_lm_rxfilename, &sampling_lm);
+    InitNormalizationSample(sampling_lm.GetUnigramDistribution(),
+                            opts.normalization_sample_size);
+  }
+}
+
+void RnnlmComputeStateInfo::InitNormalizationSample(
+    const std::vector<BaseFloat> &unigram_probs, int32 sample_size) {
+  int32 num_words = word_embedding_mat.NumRows();
+  if (static_cast<int32>(unigram_probs.size()) > num_words)
+    KALDI_ERR << "Sampling LM has more words (" << unigram_probs.size()
+              << ") than the word embedding matrix (" << num_words << ")";
+  std::vector<BaseFloat> probs(unigram_probs);
+  probs.resize(num_words, 0.0);
+  probs[0] = 0.0;  // We never include <eps> in the normalizer.
+  int32 num_nonzero = 0;
+  for (int32 i = 0; i < num_words; i++)
+    if (probs[i] > 0.0)
+      num_nonzero++;
+  if (sample_size <= 0 || sample_size >= num_nonzero) {
+    KALDI_WARN << "Not sampling the normalizer: sample size is "
+               << sample_size << " but " << num_nonzero
+               << " words have nonzero unigram probability.";
+    normalization_embedding_mat.Resize(0, 0);
+    normalization_weights.Resize(0);
+    return;
+  }
+
+  // The Sampler gives each word an inclusion probability proportional to its
+  // unigram probability, or 1.0 for the most frequent words, so the sum of
+  // the exp'ed scores of the sampled words divided by their inclusion
+  // probabilities is an unbiased estimate of the sum over the vocabulary
+  // (ignoring words with zero unigram probability).  This is the same
+  // estimate that is used in training (see ProcessRnnlmOutput()).
+  Sampler sampler(probs);
+  std::vector<std::pair<int32, BaseFloat> > sample;
+  sampler.SampleWords(sample_size, 1.0,
+                      std::vector<std::pair<int32, BaseFloat> >(), &sample);
+  std::sort(sample.begin(), sample.end());
+  std::vector<int32> words(sample.size());
+  Vector<BaseFloat> weights(sample.size());
+  int32 num_certain = 0;
+  for (size_t i = 0; i < sample.size(); i++) {
+    words[i] = sample[i].first;
+    weights(i) = 1.0 / sample[i].second;
+    if (sample[i].second >= 1.0)
+      num_certain++;
+  }
+  CuArray<int32> cu_words(words);
+  normalization_embedding_mat.Resize(words.size(),
+                                     word_embedding_mat.NumCols(), kUndefined);
+  normalization_embedding_mat.CopyRows(word_embedding_mat, cu_words);
+  normalization_weights = weights;
+  KALDI_LOG << "Estimating the normalizer from " << words.size()
+            << " sampled words (" << num_certain
+            << " of them always included) out of " << num_words;
+}
+
+void RnnlmComputeStateInfo::ComputeNormalizers(
+    const CuMatrixBase<BaseFloat> &predicted_embeddings,
+    CuVectorBase<BaseFloat> *normalizers) const {
+  KALDI_ASSERT(normalizers->Dim() == predicted_embeddings.NumRows());
+  if (normalization_embedding_mat.NumRows() == 0) {
+    int32 num_words = word_embedding_mat.NumRows();
+    CuMatrix<BaseFloat> word_scores(predicted_embeddings.NumRows(), num_words,
+                                    kUndefined);
+    word_scores.AddMatMat(1.0, predicted_embeddings, kNoTrans,
+                          word_embedding_mat, kTrans, 0.0);
+    word_scores.ApplyExp();
+    // We excluding the <eps> symbol which is always 0.
+    normalizers->AddColSumMat(1.0, word_scores.ColRange(1, num_words - 1),
+                              0.0);
+  } else {
+    CuMatrix<BaseFloat> word_scores(predicted_embeddings.NumRows(),
+                                    normalization_embedding_mat.NumRows(),
+                                    kUndefined);
+    word_scores.AddMatMat(1.0, predicted_embeddings, kNoTrans,
+                          normalization_embedding_mat, kTrans, 0.0);
+    word_scores.ApplyExp();
+    normalizers->AddMatVec(1.0, word_scores, kNoTrans,
+                           normalization_weights, 0.0);
+  }
+  normalizers->ApplyLog();
 }
 
 RnnlmComputeState::RnnlmComputeState(const RnnlmComputeStateInfo &info,
@@ -97,16 +189,10 @@ void RnnlmComputeState::AddWord(int32 word_index) {
   previous_word_ = word_index;
   AdvanceChunk();
 
-  const CuMatrix<BaseFloat> &word_embedding_mat = info_.word_embedding_mat;
   if (info_.opts.normalize_probs) {
-    CuVector<BaseFloat> log_probs(info_.word_embedding_mat.NumRows());
-
-    log_probs.AddMatVec(1.0, word_embedding_mat, kNoTrans,
-                        predicted_word_embedding_->Row(0), 0.0);
-    log_probs.ApplyExp();
-
-    // We excluding the <eps> symbol which is always 0.
-    normalization_factor_ = log(log_probs.Range(1, log_probs.Dim() - 1).Sum());
+    CuVector<BaseFloat> normalizer(1);
+    info_.ComputeNormalizers(*predicted_word_embedding_, &normalizer);
+    normalization_factor_ = normalizer(0);
   }
 }
 
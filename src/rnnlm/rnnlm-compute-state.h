@@ -22,6 +22,7 @@
 #ifndef KALDI_RNNLM_COMPUTE_STATE_H_
 #define KALDI_RNNLM_COMPUTE_STATE_H_
 
+#include <string>
 #include <vector>
 #include "base/kaldi-common.h"
 #include "nnet3/nnet-optimize.h"
@@ -35,6 +36,12 @@ namespace rnnlm {
 struct RnnlmComputeStateComputationOptions {
   bool debug_computation;
   bool normalize_probs;
+  // If >0 (and normalize_probs is true), the normalizer is estimated from
+  // this many words sampled from the unigram distribution of the sampling LM
+  // in 'sampling_lm_rxfilename', instead of being computed over the whole
+  // vocabulary.
+  int32 normalization_sample_size;
+  std::string sampling_lm_rxfilename;
   // We need this when we initialize the RnnlmComputeState and pass the BOS history.
   int32 bos_index;
   // We need this to compute the Final() cost of a state.
@@ -46,6 +53,7 @@ struct RnnlmComputeStateComputationOptions {
   RnnlmComputeStateComputationOptions():
       debug_computation(false),
       normalize_probs(false),
+      normalization_sample_size(0),
       bos_index(-1),
       eos_index(-1),
       brk_index(-1)
@@ -57,6 +65,14 @@ struct RnnlmComputeStateComputationOptions {
     opts->Register("normalize-probs", &normalize_probs, "If true, word "
        "probabilities will be correctly normalized (otherwise the sum-to-one "
        "normalization is approximate)");
+    opts->Register("normalization-sample-size", &normalization_sample_size,
+                   "If >0 and --normalize-probs=true, approximate the "
+                   "normalizer using this many words sampled from the unigram "
+                   "distribution of --sampling-lm (frequent words are always "
+                   "included), which is much faster for large vocabularies.");
+    opts->Register("sampling-lm", &sampling_lm_rxfilename, "Sampling LM, "
+                   "as used in training, whose unigram distribution is used "
+                   "with --normalization-sample-size.");
     opts->Register("bos-symbol", &bos_index, "Index in wordlist representing "
                    "the begin-of-sentence symbol");
     opts->Register("eos-symbol", &eos_index, "Index in wordlist representing "
@@ -87,12 +103,31 @@ class RnnlmComputeStateInfo  {
       const kaldi::nnet3::Nnet &rnnlm,
       const CuMatrix<BaseFloat> &word_embedding_mat);
 
+  /// Sets up the sampled approximation of the normalizer, using 'sample_size'
+  /// words sampled from 'unigram_probs' (which should sum to one; words past
+  /// its end, if any, are never sampled).  This is called from the
+  /// constructor if opts.normalization_sample_size > 0.
+  void InitNormalizationSample(const std::vector<BaseFloat> &unigram_probs,
+                               int32 sample_size);
+
+  /// Computes the log normalizer (the log of the sum of the exp'ed scores of
+  /// all words except <eps>) for each row of 'predicted_embeddings', which
+  /// are outputs of the RNNLM.  If InitNormalizationSample() was called this
+  /// is an estimate from the sampled words; otherwise it is exact.
+  void ComputeNormalizers(const CuMatrixBase<BaseFloat> &predicted_embeddings,
+                          CuVectorBase<BaseFloat> *normalizers) const;
+
   const RnnlmComputeStateComputationOptions &opts;
   const kaldi::nnet3::Nnet &rnnlm;
   const CuMatrix<BaseFloat> &word_embedding_mat;
 
   // The compiled, 'looped' computation.
   nnet3::NnetComputation computation;
+
+  // The embeddings of the sampled words and the inverses of their inclusion
+  // probabilities, if InitNormalizationSample() was called; otherwise empty.
+  CuMatrix<BaseFloat> normalization_embedding_mat;
+  CuVector<BaseFloat> normalization_weights;
 };
 
 /*
@@ -19,6 +19,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <utility>
 
 #include "rnnlm/rnnlm-lattice-rescoring.h"
@@ -28,11 +29,59 @@
 namespace kaldi {
 namespace rnnlm {
 
+RnnlmComputeStateCache::RnnlmComputeStateCache(int32 max_states):
+    max_states_(max_states), num_lookups_(0), num_hits_(0),
+    num_evictions_(0) {
+  KALDI_ASSERT(max_states > 0);
+}
+
+std::shared_ptr<const RnnlmComputeState>
+RnnlmComputeStateCache::GetSuccessorState(const std::vector<int32> &history,
+                                          const RnnlmComputeState &prev_state,
+                                          int32 next_word) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_lookups_++;
+    MapType::iterator iter = history_to_elem_.find(history);
+    if (iter != history_to_elem_.end()) {
+      num_hits_++;
+      lru_list_.splice(lru_list_.begin(), lru_list_, iter->second);
+      return iter->second->second;
+    }
+  }
+  // We compute the state without holding the lock, so other threads can use
+  // the cache in the meantime.
+  std::shared_ptr<const RnnlmComputeState> state(
+      prev_state.GetSuccessorState(next_word));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::pair<MapType::iterator, bool> ret = history_to_elem_.insert(
+      std::make_pair(history, lru_list_.end()));
+  if (!ret.second) {
+    // Another thread added this history while we were computing it.
+    lru_list_.splice(lru_list_.begin(), lru_list_, ret.first->second);
+    return ret.first->second->second;
+  }
+  lru_list_.push_front(std::make_pair(history, state));
+  ret.first->second = lru_list_.begin();
+  while (lru_list_.size() > static_cast<size_t>(max_states_)) {
+    history_to_elem_.erase(lru_list_.back().first);
+    lru_list_.pop_back();
+    num_evictions_++;
+  }
+  return state;
+}
+
+void RnnlmComputeStateCache::PrintStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  KALDI_LOG << "RNNLM state cache: " << num_hits_ << " hits out of "
+            << num_lookups_ << " lookups (hit rate "
+            << (num_hits_ / std::max<double>(num_lookups_, 1.0))
+            << "), " << num_evictions_ << " evictions, "
+            << lru_list_.size() << " states cached.";
+}
+
 KaldiRnnlmDeterministicFst::~KaldiRnnlmDeterministicFst() {
-  int32 size = state_to_rnnlm_state_.size();
-  for (int32 i = 0; i < size; i++)
-    delete state_to_rnnlm_state_[i];
-  
   state_to_rnnlm_state_.resize(0);
   state_to_wseq_.resize(0);
   wseq_to_state_.clear();
@@ -41,18 +90,15 @@ KaldiRnnlmDeterministicFst::~KaldiRnnlmDeterministicFst() {
 void KaldiRnnlmDeterministicFst::Clear() {
   // This function is similar to the destructor but we retain the 0-th entries
   // in each map which corresponds to the <bos> state.
-  int32 size = state_to_rnnlm_state_.size();
-  for (int32 i = 1; i < size; i++)
-    delete state_to_rnnlm_state_[i];
-  
   state_to_rnnlm_state_.resize(1);
   state_to_wseq_.resize(1);
   wseq_to_state_.clear();
   wseq_to_state_[state_to_wseq_[0]] = 0;
 }
 
-KaldiRnnlmDeterministicFst::KaldiRnnlmDeterministicFst(int32 max_ngram_order,
-    const RnnlmComputeStateInfo &info) {
+KaldiRnnlmDeterministicFst::KaldiRnnlmDeterministicFst(
+    int32 max_ngram_order, const RnnlmComputeStateInfo &info,
+    RnnlmComputeStateCache *cache): cache_(cache) {
   max_ngram_order_ = max_ngram_order;
   bos_index_ = info.opts.bos_index;
   eos_index_ = info.opts.eos_index;
@@ -60,7 +106,8 @@ KaldiRnnlmDeterministicFst::KaldiRnnlmDeterministicFst(int32 max_ngram_order,
   std::vector<Label> bos_seq;
   bos_seq.push_back(bos_index_);
   state_to_wseq_.push_back(bos_seq);
-  RnnlmComputeState *decodable_rnnlm = new RnnlmComputeState(info, bos_index_);
+  std::shared_ptr<const RnnlmComputeState> decodable_rnnlm(
+      new RnnlmComputeState(info, bos_index_));
   wseq_to_state_[bos_seq] = 0;
   start_state_ = 0;
 
@@ -71,7 +118,7 @@ fst::StdArc::Weight KaldiRnnlmDeterministicFst::Final(StateId s) {
   /// At this point, we have created the state.
   KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
 
-  RnnlmComputeState* rnn = state_to_rnnlm_state_[s];
+  const RnnlmComputeState *rnn = state_to_rnnlm_state_[s].get();
   return Weight(-rnn->LogProbOfWord(eos_index_));
 }
 
@@ -81,7 +128,7 @@ bool KaldiRnnlmDeterministicFst::GetArc(StateId s, Label ilabel,
   KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
 
   std::vector<Label> word_seq = state_to_wseq_[s];
-  const RnnlmComputeState* rnnlm = state_to_rnnlm_state_[s];
+  const RnnlmComputeState* rnnlm = state_to_rnnlm_state_[s].get();
 
   BaseFloat logprob = rnnlm->LogProbOfWord(ilabel);
 
@@ -103,9 +150,14 @@ bool KaldiRnnlmDeterministicFst::GetArc(StateId s, Label ilabel,
 
   // If the pair was just inserted, then also add it to state_to_* structures.
   if (result.second == true) {
-    RnnlmComputeState *rnnlm2 = rnnlm->GetSuccessorState(ilabel);
     state_to_wseq_.push_back(word_seq);
-    state_to_rnnlm_state_.push_back(rnnlm2);
+    if (cache_ != NULL)
+      state_to_rnnlm_state_.push_back(
+          cache_->GetSuccessorState(word_seq, *rnnlm, ilabel));
+    else
+      state_to_rnnlm_state_.push_back(
+          std::shared_ptr<const RnnlmComputeState>(
+              rnnlm->GetSuccessorState(ilabel)));
   }
 
   // Creates the arc.
@@ -116,5 +168,73 @@ bool KaldiRnnlmDeterministicFst::GetArc(StateId s, Label ilabel,
   return true;
 }
 
+KaldiRnnlmBatchedDeterministicFst::KaldiRnnlmBatchedDeterministicFst(
+    int32 max_ngram_order, RnnlmBatchComputer *computer):
+    max_ngram_order_(max_ngram_order), eos_index_(0), computer_(computer) {
+  Clear();
+}
+
+void KaldiRnnlmBatchedDeterministicFst::Clear() {
+  computer_->Clear();
+  // State 0 of computer_ is the <bos> state; we keep it as our state 0.
+  state_to_wseq_.clear();
+  state_to_wseq_.push_back(std::vector<Label>(1, computer_->BosIndex()));
+  state_to_rnnlm_state_.clear();
+  state_to_rnnlm_state_.push_back(0);
+  wseq_to_state_.clear();
+  wseq_to_state_[state_to_wseq_[0]] = 0;
+  eos_index_ = computer_->EosIndex();
+}
+
+fst::StdArc::Weight KaldiRnnlmBatchedDeterministicFst::Final(StateId s) {
+  KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
+  return Weight(-computer_->LogProbOfWord(state_to_rnnlm_state_[s],
+                                          eos_index_));
+}
+
+bool KaldiRnnlmBatchedDeterministicFst::GetArc(StateId s, Label ilabel,
+                                               fst::StdArc *oarc) {
+  KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
+
+  std::vector<Label> word_seq = state_to_wseq_[s];
+  int32 rnnlm_state = state_to_rnnlm_state_[s];
+  BaseFloat logprob = computer_->LogProbOfWord(rnnlm_state, ilabel);
+
+  word_seq.push_back(ilabel);
+  if (max_ngram_order_ > 0) {
+    while (word_seq.size() >= max_ngram_order_) {
+      /// History state has at most <max_ngram_order_> - 1 words in the state.
+      word_seq.erase(word_seq.begin(), word_seq.begin() + 1);
+    }
+  }
+
+  std::pair<const std::vector<Label>, StateId> wseq_state_pair(
+      word_seq, static_cast<Label>(state_to_wseq_.size()));
+  typedef MapType::iterator IterType;
+  std::pair<IterType, bool> result = wseq_to_state_.insert(wseq_state_pair);
+  if (result.second == true) {
+    // The new state is not computed until it is needed (see Prefetch()).
+    state_to_wseq_.push_back(word_seq);
+    state_to_rnnlm_state_.push_back(
+        computer_->GetSuccessorState(rnnlm_state, ilabel));
+  }
+
+  oarc->ilabel = ilabel;
+  oarc->olabel = ilabel;
+  oarc->nextstate = result.first->second;
+  oarc->weight = Weight(-logprob);
+  return true;
+}
+
+void KaldiRnnlmBatchedDeterministicFst::Prefetch(
+    const std::vector<StateId> &states) {
+  std::vector<int32> rnnlm_states(states.size());
+  for (size_t i = 0; i < states.size(); i++) {
+    KALDI_ASSERT(static_cast<size_t>(states[i]) < state_to_wseq_.size());
+    rnnlm_states[i] = state_to_rnnlm_state_[states[i]];
+  }
+  computer_->ComputeStates(rnnlm_states);
+}
+
 }  // namespace rnnlm
 }  // namespace kaldi
@@ -22,17 +22,72 @@
 #ifndef KALDI_RNNLM_RNNLM_LATTICE_RESCORING_H_
 #define KALDI_RNNLM_RNNLM_LATTICE_RESCORING_H_
 
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/kaldi-common.h"
 #include "fstext/deterministic-fst.h"
+#include "rnnlm/rnnlm-batch-compute.h"
 #include "rnnlm/rnnlm-compute-state.h"
 #include "util/common-utils.h"
 
 namespace kaldi {
 namespace rnnlm {
 
+/**
+   This class is a cache of RNNLM states, indexed by word history (as
+   truncated by KaldiRnnlmDeterministicFst), that can be shared between
+   utterances and between threads, so that the histories that occur in many
+   lattices (e.g. "<s> yeah") are computed only once.  It keeps at most
+   'max_states' states, evicting the least recently used ones.  The states are
+   held by std::shared_ptr, so a state that has been evicted remains valid for
+   as long as an FST is using it.  All functions are thread-safe.
+
+   Note: if the histories are truncated (max_ngram_order > 0), the state stored
+   for a history is the one computed for whichever full history led to it
+   first, so the scores depend on which lattices were rescored earlier with the
+   same cache (and, if it is shared between threads, on the timing of the
+   threads).  The output is then not reproducible, although the approximation
+   is the same one that --max-ngram-order already makes within a lattice.
+ */
+class RnnlmComputeStateCache {
+ public:
+  explicit RnnlmComputeStateCache(int32 max_states);
+
+  /// Returns the state whose (truncated) history is 'history'.  If it is not
+  /// in the cache, it is computed as prev_state.GetSuccessorState(next_word)
+  /// and added; 'history' is expected to be the history of 'prev_state'
+  /// followed by 'next_word', possibly truncated.
+  std::shared_ptr<const RnnlmComputeState> GetSuccessorState(
+      const std::vector<int32> &history,
+      const RnnlmComputeState &prev_state,
+      int32 next_word);
+
+  /// Prints (at log level) the hit rate and the number of evictions.
+  void PrintStats() const;
+
+ private:
+  // The list of (history, state), most recently used first.
+  typedef std::list<std::pair<std::vector<int32>,
+                              std::shared_ptr<const RnnlmComputeState> > >
+      ListType;
+  typedef unordered_map<std::vector<int32>, ListType::iterator,
+                        VectorHasher<int32> > MapType;
+
+  int32 max_states_;
+  ListType lru_list_;
+  MapType history_to_elem_;
+  mutable std::mutex mutex_;
+
+  int64 num_lookups_;
+  int64 num_hits_;
+  int64 num_evictions_;
+};
+
 class KaldiRnnlmDeterministicFst
     : public fst::DeterministicOnDemandFst<fst::StdArc> {
  public:
@@ -40,9 +95,12 @@ class KaldiRnnlmDeterministicFst
   typedef fst::StdArc::StateId StateId;
   typedef fst::StdArc::Label Label;
 
-  // Does not take ownership.
+  // Does not take ownership.  If 'cache' is non-NULL, the RNNLM states of new
+  // histories are taken from it (and added to it), so that they can be
+  // re-used by other lattices and by other FSTs using the same cache.
   KaldiRnnlmDeterministicFst(int32 max_ngram_order,
-      const RnnlmComputeStateInfo &info);
+                             const RnnlmComputeStateInfo &info,
+                             RnnlmComputeStateCache *cache = NULL);
   ~KaldiRnnlmDeterministicFst();
 
   void Clear();
@@ -70,10 +128,55 @@ class KaldiRnnlmDeterministicFst
   // Mapping from state-id to history sequence>
   std::vector<std::vector<Label> > state_to_wseq_;
 
-  // Mapping from state-id to RNNLM states.
-  // The pointers are owned in this class
-  std::vector<RnnlmComputeState*> state_to_rnnlm_state_;
+  // Mapping from state-id to RNNLM states.  They are shared with 'cache_', if
+  // it is non-NULL.
+  std::vector<std::shared_ptr<const RnnlmComputeState> > state_to_rnnlm_state_;
+
+  RnnlmComputeStateCache *cache_;
+};
+
+/**
+   This is like KaldiRnnlmDeterministicFst, but it gets its scores from an
+   RnnlmBatchComputer, and implements Prefetch() so that the states listed
+   there are computed in batches.  Use it together with the --lm-batch-size
+   option of ComposeCompactLatticePruned().
+ */
+class KaldiRnnlmBatchedDeterministicFst
+    : public fst::DeterministicOnDemandFst<fst::StdArc> {
+ public:
+  typedef fst::StdArc::Weight Weight;
+  typedef fst::StdArc::StateId StateId;
+  typedef fst::StdArc::Label Label;
+
+  // Does not take ownership of 'computer'; its states other than the BOS
+  // state are forgotten when you call Clear().
+  KaldiRnnlmBatchedDeterministicFst(int32 max_ngram_order,
+                                    RnnlmBatchComputer *computer);
+
+  void Clear();
+
+  virtual StateId Start() { return 0; }
+
+  virtual Weight Final(StateId s);
+
+  virtual bool GetArc(StateId s, Label ilabel, fst::StdArc* oarc);
+
+  virtual void Prefetch(const std::vector<StateId> &states);
+
+ private:
+  typedef unordered_map
+      <std::vector<Label>, StateId, VectorHasher<Label> > MapType;
+  int32 max_ngram_order_;
+  int32 eos_index_;
+  RnnlmBatchComputer *computer_;
+
+  MapType wseq_to_state_;
+
+  // Mapping from state-id to history sequence.
+  std::vector<std::vector<Label> > state_to_wseq_;
 
+  // Mapping from state-id to the state of computer_.
+  std::vector<int32> state_to_rnnlm_state_;
 };
 
 }  // namespace rnnlm
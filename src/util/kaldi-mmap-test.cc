@@ -0,0 +1,65 @@
+// util/kaldi-mmap-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <unistd.h>
+#include "util/kaldi-mmap.h"
+
+namespace kaldi {
+
+void UnitTestMemoryMappedFile() {
+  const char *filename = "tmpf.mmap";
+  int32 num_bytes = 10000 + Rand() % 10000;
+  std::string contents(num_bytes, ' ');
+  for (int32 i = 0; i < num_bytes; i++)
+    contents[i] = static_cast<char>(Rand() % 256);
+  {
+    std::ofstream os(filename, std::ios::binary);
+    os.write(contents.data(), num_bytes);
+    KALDI_ASSERT(os.good());
+  }
+  for (int32 i = 0; i < 10; i++) {
+    int64 offset = Rand() % num_bytes,
+        size = Rand() % (num_bytes - offset + 1);
+    MemoryMappedFile mapped_file;
+    KALDI_ASSERT(mapped_file.Open(filename, offset, size));
+    KALDI_ASSERT(mapped_file.Size() == size);
+    KALDI_ASSERT(std::string(mapped_file.Data(), size) ==
+                 contents.substr(offset, size));
+    mapped_file.Close();
+    KALDI_ASSERT(mapped_file.Data() == NULL);
+  }
+  {
+    // Mapping beyond the end of the file should fail.
+    MemoryMappedFile mapped_file;
+    KALDI_ASSERT(!mapped_file.Open(filename, num_bytes - 10, 11));
+    KALDI_ASSERT(mapped_file.Data() == NULL);
+  }
+  unlink(filename);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++)
+    UnitTestMemoryMappedFile();
+  KALDI_LOG << "Test OK.";
+  return 0;
+}
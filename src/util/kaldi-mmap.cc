@@ -0,0 +1,100 @@
+// util/kaldi-mmap.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-mmap.h"
+
+#ifndef _MSC_VER
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+#ifndef _MSC_VER
+
+bool MemoryMappedFile::Open(const std::string &filename, int64 offset,
+                            int64 size) {
+  Close();
+  KALDI_ASSERT(offset >= 0 && size >= 0);
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    KALDI_WARN << "Could not open " << filename << " for memory-mapping: "
+               << strerror(errno);
+    return false;
+  }
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0 || stat_buf.st_size < offset + size) {
+    KALDI_WARN << "Could not memory-map " << size << " bytes at offset "
+               << offset << " of " << filename
+               << ": file is too small or could not be examined.";
+    close(fd);
+    return false;
+  }
+  // mmap() requires the offset to be a multiple of the page size.
+  int64 page_size = sysconf(_SC_PAGESIZE),
+      map_offset = offset - offset % page_size;
+  map_size_ = static_cast<size_t>(size + offset - map_offset);
+  if (map_size_ == 0) {
+    // Mapping zero bytes is an error, so we map the first page instead.
+    map_size_ = 1;
+  }
+  map_base_ = mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd,
+                   static_cast<off_t>(map_offset));
+  // The mapping stays valid after the file descriptor is closed.
+  close(fd);
+  if (map_base_ == MAP_FAILED) {
+    KALDI_WARN << "Memory-mapping " << filename << " failed: "
+               << strerror(errno);
+    map_base_ = NULL;
+    map_size_ = 0;
+    return false;
+  }
+  data_ = static_cast<const char*>(map_base_) + (offset - map_offset);
+  size_ = size;
+  return true;
+}
+
+void MemoryMappedFile::Close() {
+  if (map_base_ != NULL) {
+    if (munmap(map_base_, map_size_) != 0)
+      KALDI_WARN << "munmap() failed: " << strerror(errno);
+  }
+  map_base_ = NULL;
+  map_size_ = 0;
+  data_ = NULL;
+  size_ = 0;
+}
+
+#else  // _MSC_VER
+
+bool MemoryMappedFile::Open(const std::string &filename, int64 offset,
+                            int64 size) {
+  KALDI_WARN << "Memory-mapping files is not supported on this platform.";
+  return false;
+}
+
+void MemoryMappedFile::Close() { }
+
+#endif  // _MSC_VER
+
+}  // namespace kaldi
@@ -0,0 +1,75 @@
+// util/kaldi-mmap.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_KALDI_MMAP_H_
+#define KALDI_UTIL_KALDI_MMAP_H_
+
+#include <string>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/**
+   MemoryMappedFile maps a region of a file read-only into memory.  The pages
+   are loaded lazily by the operating system as they are accessed, and are
+   shared between all processes that map the same file, so this is useful for
+   loading large read-only models (e.g. language models or decoding graphs)
+   in servers that run several worker processes.
+
+   Caution: the file must not be modified while it is mapped; if it is
+   truncated, accessing the mapped memory will crash the program.  Memory
+   mapping is not supported on Windows, where Open() will just return false.
+*/
+class MemoryMappedFile {
+ public:
+  MemoryMappedFile(): data_(NULL), size_(0), map_base_(NULL), map_size_(0) { }
+
+  /// Maps 'size' bytes of the file 'filename', starting at byte 'offset'
+  /// (which does not have to be a multiple of the page size).  'filename'
+  /// must be a plain file, not an rxfilename such as a pipe.  Returns true on
+  /// success; on failure it prints a warning and returns false.
+  bool Open(const std::string &filename, int64 offset, int64 size);
+
+  /// Unmaps the file, if it was mapped.
+  void Close();
+
+  /// Returns a pointer to the mapped data (i.e. to byte 'offset' of the
+  /// file), or NULL if nothing is mapped.
+  const char *Data() const { return data_; }
+
+  /// Returns the number of bytes mapped, as given to Open().
+  int64 Size() const { return size_; }
+
+  ~MemoryMappedFile() { Close(); }
+
+ private:
+  const char *data_;
+  int64 size_;
+  // The start and size of the region that was actually mapped, which starts
+  // at a page boundary.
+  void *map_base_;
+  size_t map_size_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MemoryMappedFile);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_MMAP_H_
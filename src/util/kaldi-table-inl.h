@@ -24,8 +24,12 @@
 #define KALDI_UTIL_KALDI_TABLE_INL_H_
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <errno.h>
@@ -34,6 +38,7 @@
 #include "util/text-utils.h"
 #include "util/stl-utils.h"  // for StringHasher.
 #include "util/kaldi-semaphore.h"
+#include "util/table-index.h"
 
 
 namespace kaldi {
@@ -75,6 +80,16 @@ template<class Holder> class SequentialTableReaderImplBase {
   // this->holder_ with those of 'other_holder'.  It's needed as part of how
   // we implement SequentialTableReaderBackgroundImpl.
   virtual void SwapHolder(Holder *other_holder) = 0;
+  // GetLocation() is not part of the public interface of SequentialTableReader
+  // either.  If the object for the current key has not been read yet and can
+  // be read independently of this reader, it sets 'rxfilename' (and, if the
+  // object is a range of what is read from there, 'range'; else it sets it to
+  // the empty string) and returns true.  It's used by
+  // SequentialTableReaderBackgroundImpl to read objects in parallel.  The
+  // default implementation, used for archives, returns false.
+  virtual bool GetLocation(std::string *rxfilename, std::string *range) {
+    return false;
+  }
   SequentialTableReaderImplBase() { }
   virtual ~SequentialTableReaderImplBase() { }  // throws.
  private:
@@ -210,6 +225,16 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
     // function needs to be lightweight for the 'bg' feature to work well.
   }
 
+  // If we have the scp line but have not read the object (which is the
+  // normal case except in permissive mode), return its location.
+  virtual bool GetLocation(std::string *rxfilename, std::string *range) {
+    if (state_ != kHaveScpLine)
+      return false;
+    *rxfilename = data_rxfilename_;
+    *range = range_;
+    return true;
+  }
+
   // Next goes to the next object.
   // It can leave the object in most of the statuses, but
   // the only circumstances under which it will return are:
@@ -696,8 +721,165 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
   } state_;
 };
 
-// this is for when someone adds the 'th' modifier; it wraps around the basic
-// implementation and allows it to do the reading in a background thread.
+// This is the implementation for SequentialTableReader when it's a table index
+// (the "idx:" rspecifier; see table-index.h).  It goes through the entries in
+// sorted order of key, reading each object from its archive.  As for scp
+// files, the object is only read when Value() is called.
+template<class Holder>
+class SequentialTableReaderIndexImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  SequentialTableReaderIndexImpl(): pos_(0), state_(kUninitialized) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (state_ != kUninitialized)
+      if (!Close())  // call Close() yourself to suppress this exception.
+        KALDI_ERR << "Error closing previous input: "
+                  << "rspecifier was " << rspecifier_;
+    rspecifier_ = rspecifier;
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &index_filename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kIndexRspecifier);
+    if (!index_.Open(index_filename_))
+      return false;  // TableIndex::Open() will have printed a warning.
+    pos_ = -1;
+    state_ = kHaveEntry;
+    Next();
+    return true;
+  }
+
+  virtual bool IsOpen() const { return state_ != kUninitialized; }
+
+  virtual bool Done() const {
+    if (state_ == kUninitialized)
+      KALDI_ERR << "Done() called on TableReader object at the wrong time.";
+    return state_ == kEof;
+  }
+
+  virtual std::string Key() {
+    if (state_ != kHaveEntry && state_ != kHaveObject)
+      KALDI_ERR << "Key() called on TableReader object at the wrong time.";
+    return index_.Key(pos_);
+  }
+
+  T &Value() {
+    if (state_ == kHaveEntry && !LoadObject())
+      KALDI_ERR << "Failed to load object from "
+                << PrintableRxfilename(index_.Rxfilename(pos_))
+                << " (to suppress this error, add the permissive "
+                << "(p, ) option to the rspecifier.";
+    if (state_ != kHaveObject)
+      KALDI_ERR << "Value() called on TableReader object at the wrong time.";
+    return holder_.Value();
+  }
+
+  void FreeCurrent() {
+    if (state_ == kHaveObject) {
+      holder_.Clear();
+      state_ = kHaveEntry;
+    } else {
+      KALDI_WARN << "FreeCurrent called at the wrong time.";
+    }
+  }
+
+  void SwapHolder(Holder *other_holder) {
+    (void) Value();
+    holder_.Swap(other_holder);
+    state_ = kHaveEntry;
+  }
+
+  virtual bool GetLocation(std::string *rxfilename, std::string *range) {
+    if (state_ != kHaveEntry)
+      return false;
+    *rxfilename = index_.Rxfilename(pos_);
+    range->clear();
+    return true;
+  }
+
+  void Next() {
+    if (state_ == kHaveObject)
+      holder_.Clear();
+    else if (state_ != kHaveEntry)
+      KALDI_ERR << "Next() called wrongly.";
+    while (1) {
+      pos_++;
+      if (pos_ >= index_.NumEntries()) {
+        state_ = kEof;
+        return;
+      }
+      state_ = kHaveEntry;
+      // In permissive mode we skip over objects that cannot be read.
+      if (!opts_.permissive || LoadObject())
+        return;
+    }
+  }
+
+  // Errors reading objects are reported by Value() (or, in permissive mode,
+  // ignored), so there is nothing that can fail here.
+  virtual bool Close() {
+    if (!this->IsOpen())
+      KALDI_ERR << "Close() called on input that was not open.";
+    if (input_.IsOpen())
+      input_.Close();
+    holder_.Clear();
+    index_.Close();
+    state_ = kUninitialized;
+    return true;
+  }
+
+  virtual ~SequentialTableReaderIndexImpl() {
+    if (this->IsOpen())
+      Close();
+  }
+
+ private:
+  // Reads the object for the current entry, and returns true on success.
+  bool LoadObject() {
+    KALDI_ASSERT(state_ == kHaveEntry);
+    std::string rxfilename = index_.Rxfilename(pos_);
+    if (!(Holder::IsReadInBinary() ? input_.Open(rxfilename, NULL) :
+          input_.OpenTextMode(rxfilename))) {
+      KALDI_WARN << "Failed to open file " << PrintableRxfilename(rxfilename);
+      return false;
+    }
+    if (!holder_.Read(input_.Stream())) {
+      KALDI_WARN << "Failed to load object from "
+                 << PrintableRxfilename(rxfilename);
+      return false;
+    }
+    state_ = kHaveObject;
+    return true;
+  }
+
+  TableIndex index_;
+  Input input_;  // Kept open between objects, so that we can just seek if the
+                 // next object is in the same archive.
+  Holder holder_;
+  int64 pos_;  // The index of the current entry in index_.
+  std::string rspecifier_;
+  std::string index_filename_;
+  RspecifierOptions opts_;
+  enum StateType {
+    kUninitialized,  // Uninitialized or closed.
+    kHaveEntry,      // At entry pos_, but holder_ does not have its object.
+    kHaveObject,     // At entry pos_, and holder_ has its object.
+    kEof             // Past the last entry.
+  } state_;
+};
+
+// This is for when someone adds the 'bg' or 'bg=N' modifier; it wraps around
+// the basic implementation and does the reading in background threads, keeping
+// up to N objects (N = 1 for 'bg') read ahead of the one the user is looking
+// at.  A producer thread goes through the base reader.  If the base reader is
+// for an scp file or a table index (see GetLocation()), the objects are read
+// (including any decompression, e.g. of CompressedMatrix, which happens inside
+// Holder::Read()) by N worker threads in parallel, each with its own Input
+// object, so that the latency of reading many files from a network
+// filesystem can be hidden; otherwise, e.g. for archives, they are read in
+// sequence by the producer thread.  Either way the objects are returned in
+// the original order.
 template<class Holder>
 class SequentialTableReaderBackgroundImpl:
       public SequentialTableReaderImplBase<Holder> {
@@ -705,8 +887,13 @@ class SequentialTableReaderBackgroundImpl:
   typedef typename Holder::T T;
 
   SequentialTableReaderBackgroundImpl(
-      SequentialTableReaderImplBase<Holder> *base_reader):
-      base_reader_(base_reader) {}
+      SequentialTableReaderImplBase<Holder> *base_reader,
+      int32 queue_size = 1, bool permissive = false):
+      base_reader_(base_reader), queue_size_(queue_size),
+      permissive_(permissive), producer_done_(false), stop_(false),
+      have_value_(false) {
+    KALDI_ASSERT(queue_size > 0);
+  }
 
   // This function ignores the rxfilename argument.
   // We use the same function signature as the regular Open(),
@@ -714,13 +901,9 @@ class SequentialTableReaderBackgroundImpl:
   virtual bool Open(const std::string &rxfilename) {
     KALDI_ASSERT(base_reader_ != NULL &&
                  base_reader_->IsOpen());  // or code error.
-    {
-      thread_ = std::thread(SequentialTableReaderBackgroundImpl<Holder>::run,
-                            this);
-    }
-
-    if (!base_reader_->Done())
-      Next();
+    producer_thread_ = std::thread(
+        SequentialTableReaderBackgroundImpl<Holder>::RunProducer, this);
+    Next();
     return true;
   }
 
@@ -730,62 +913,28 @@ class SequentialTableReaderBackgroundImpl:
     return base_reader_ != NULL;
   }
 
-  void RunInBackground() {
-    try {
-      // This function is called in the background thread.  The whole point of
-      // the background thread is that we don't want to do the actual reading
-      // (inside Next()) in the foreground.
-      while (base_reader_ != NULL && !base_reader_->Done()) {
-        consumer_sem_.Signal();
-        // Here is where the consumer process (parent thread) gets to do its
-        // stuff.  Principally it calls SwapHolder()-- a shallow swap that is
-        // cheap.
-        producer_sem_.Wait();
-        // we check that base_reader_ is not NULL in case Close() was
-        // called in the main thread.
-        if (base_reader_ != NULL)
-          base_reader_->Next();   //  here is where the work happens.
-      }
-      // this signal will be waited on in the Next() function of the foreground
-      // thread if it is still running, or Close() otherwise.
-      consumer_sem_.Signal();
-      // this signal may be waited on in Close().
-      consumer_sem_.Signal();
-    } catch (...) {
-      // There is nothing we called above that could potentially throw due to
-      // user data.  So we treat reaching this point as a code-error condition.
-      // Closing base_reader_ will trigger an exception in Next() in the main
-      // thread when it checks that base_reader_->IsOpen().
-      if (base_reader_->IsOpen()) {
-        base_reader_->Close();
-        delete base_reader_;
-        base_reader_ = NULL;
-      }
-      consumer_sem_.Signal();
-      return;
-    }
-  }
-  static void run(SequentialTableReaderBackgroundImpl<Holder> *object) {
-    object->RunInBackground();
-  }
   virtual bool Done() const {
-    return key_.empty();
+    return !have_value_;
   }
   virtual std::string Key() {
-    if (key_.empty())
+    if (!have_value_)
       KALDI_ERR << "Calling Key() at the wrong time.";
     return key_;
   }
   virtual T &Value() {
-    if (key_.empty())
+    if (!have_value_)
       KALDI_ERR << "Calling Value() at the wrong time.";
+    if (!error_.empty())
+      KALDI_ERR << "Failed to read object for key " << key_ << ": " << error_
+                << " (to suppress this error, add the permissive "
+                << "(p, ) option to the rspecifier.";
     return holder_.Value();
   }
   void SwapHolder(Holder *other_holder) {
     KALDI_ERR << "SwapHolder() should not be called on this class.";
   }
   virtual void FreeCurrent() {
-    if (key_.empty())
+    if (!have_value_)
       KALDI_ERR << "Calling FreeCurrent() at the wrong time.";
     // note: ideally a call to Value() should crash if you have just called
     // FreeCurrent().  For typical holders such as KaldiObjectHolder this will
@@ -795,28 +944,60 @@ class SequentialTableReaderBackgroundImpl:
     holder_.Clear();
   }
   virtual void Next() {
-    consumer_sem_.Wait();
-    if (base_reader_ == NULL || !base_reader_->IsOpen())
-      KALDI_ERR << "Error detected (likely code error) in background "
-                << "reader (',bg' option)";
-    if (base_reader_->Done()) {
-      // there is nothing else to read.
-      key_ = "";
-    } else {
-      key_ = base_reader_->Key();
-      base_reader_->SwapHolder(&holder_);
+    if (base_reader_ == NULL)
+      KALDI_ERR << "Next() called on closed background reader.";
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      consumer_cond_.wait(lock, [this] {
+          return (!queue_.empty() && (queue_.front()->state == Slot::kLoaded ||
+                                      queue_.front()->state == Slot::kFailed))
+              || (queue_.empty() && producer_done_); });
+      if (queue_.empty()) {
+        // there is nothing else to read.
+        have_value_ = false;
+        key_ = "";
+        holder_.Clear();
+        return;
+      }
+      Slot *slot = queue_.front();
+      queue_.pop_front();
+      // Tell the producer that there is space in the queue.
+      producer_cond_.notify_one();
+      if (slot->state == Slot::kFailed && permissive_) {
+        // In permissive mode we treat objects that cannot be read as if they
+        // were not there.
+        KALDI_WARN << "Failed to read object for key " << slot->key << ": "
+                   << slot->error << " [ignoring as permissive mode "
+                   << "specified]";
+        delete slot;
+        continue;
+      }
+      key_ = slot->key;
+      error_ = slot->error;
+      holder_.Swap(&(slot->holder));
+      have_value_ = true;
+      delete slot;
+      return;
     }
-    // this Signal() tells the producer thread, in the background,
-    // that it's now safe to read the next value.
-    producer_sem_.Signal();
   }
 
   // note: we can be sure that Close() won't be called twice, as the TableReader
   // object will delete this object after calling Close.
   virtual bool Close() {
-    KALDI_ASSERT(base_reader_ != NULL && thread_.joinable());
-    // wait until the producer thread is idle.
-    consumer_sem_.Wait();
+    KALDI_ASSERT(base_reader_ != NULL && producer_thread_.joinable());
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    producer_cond_.notify_all();
+    worker_cond_.notify_all();
+    producer_thread_.join();
+    for (size_t i = 0; i < worker_threads_.size(); i++)
+      worker_threads_[i].join();
+    worker_threads_.clear();
+    for (size_t i = 0; i < queue_.size(); i++)
+      delete queue_[i];
+    queue_.clear();
     bool ans = true;
     try {
       ans = base_reader_->Close();
@@ -824,12 +1005,9 @@ class SequentialTableReaderBackgroundImpl:
       ans = false;
     }
     delete base_reader_;
-    // setting base_reader_ to NULL will cause the loop in the producer thread
-    // to exit.
     base_reader_ = NULL;
-    producer_sem_.Signal();
-
-    thread_.join();
+    holder_.Clear();
+    have_value_ = false;
     return ans;
   }
   ~SequentialTableReaderBackgroundImpl() {
@@ -841,16 +1019,192 @@ class SequentialTableReaderBackgroundImpl:
     }
   }
  private:
+  // An object that has been, or is being, read ahead.
+  struct Slot {
+    std::string key;
+    // If nonempty, the object has to be read from here by a worker thread.
+    std::string rxfilename;
+    std::string range;
+    Holder holder;
+    std::string error;  // Set if state == kFailed.
+    enum { kPending, kLoading, kLoaded, kFailed } state;
+  };
+
+  static void RunProducer(SequentialTableReaderBackgroundImpl<Holder> *object) {
+    object->ProducerLoop();
+  }
+  static void RunWorker(SequentialTableReaderBackgroundImpl<Holder> *object) {
+    object->WorkerLoop();
+  }
+
+  // This function, run in the producer thread, goes through the base reader
+  // and adds a Slot to queue_ for each of its objects.
+  void ProducerLoop() {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        producer_cond_.wait(lock, [this] {
+            return stop_ || queue_.size() < static_cast<size_t>(queue_size_);
+          });
+        if (stop_)
+          break;
+      }
+      // We can access base_reader_ without holding the lock, as only this
+      // thread uses it until Close() has joined this thread.
+      Slot *slot = NULL;
+      try {
+        if (base_reader_->Done())
+          break;
+        slot = new Slot();
+        slot->key = base_reader_->Key();
+        if (base_reader_->GetLocation(&(slot->rxfilename), &(slot->range))) {
+          slot->state = Slot::kPending;
+          // The worker threads are started the first time they are needed;
+          // they are joined by Close() after this thread.
+          if (worker_threads_.empty())
+            for (int32 i = 0; i < queue_size_; i++)
+              worker_threads_.push_back(std::thread(
+                  SequentialTableReaderBackgroundImpl<Holder>::RunWorker,
+                  this));
+        } else {
+          // The base reader reads the object itself (e.g. from an archive).
+          // Reading it here in the producer thread is the whole point.
+          slot->rxfilename = "";
+          ReadInProducer(slot);
+        }
+        base_reader_->Next();
+      } catch (const std::exception &e) {
+        // Errors in reading the data itself are dealt with by
+        // ReadInProducer(); reaching this point means something is badly
+        // wrong, so we stop reading and let Close() report the error.
+        KALDI_WARN << "Error in background reader: " << e.what();
+        delete slot;
+        break;
+      }
+      // Once it's in the queue, the slot may be deleted at any time.
+      bool pending = (slot->state == Slot::kPending);
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queue_.push_back(slot);
+      }
+      if (pending)
+        worker_cond_.notify_one();
+      else
+        consumer_cond_.notify_one();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      producer_done_ = true;
+    }
+    consumer_cond_.notify_one();
+    worker_cond_.notify_all();
+  }
+
+  void ReadInProducer(Slot *slot) {
+    try {
+      base_reader_->SwapHolder(&(slot->holder));
+      slot->state = Slot::kLoaded;
+    } catch (const std::exception &e) {
+      slot->error = e.what();
+      slot->state = Slot::kFailed;
+    }
+  }
+
+  // This function, run in the worker threads, reads the objects of Slots
+  // whose state is kPending.
+  void WorkerLoop() {
+    Input input;
+    while (true) {
+      Slot *slot = NULL;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (slot == NULL) {
+          for (size_t i = 0; i < queue_.size(); i++) {
+            if (queue_[i]->state == Slot::kPending) {
+              slot = queue_[i];
+              break;
+            }
+          }
+          if (slot != NULL)
+            break;
+          if (stop_ || producer_done_)
+            return;
+          worker_cond_.wait(lock);
+        }
+        slot->state = Slot::kLoading;
+      }
+      // The consumer will not take this slot out of the queue until its state
+      // is kLoaded or kFailed, so we can work on it without the lock.
+      bool ans = ReadObject(&input, slot);
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        slot->state = (ans ? Slot::kLoaded : Slot::kFailed);
+      }
+      consumer_cond_.notify_one();
+    }
+  }
+
+  // Reads the object for 'slot' from slot->rxfilename (and slot->range), and
+  // returns true on success; as in
+  // SequentialTableReaderScriptImpl::EnsureObjectLoaded().
+  bool ReadObject(Input *input, Slot *slot) {
+    try {
+      bool ans;
+      if (Holder::IsReadInBinary())
+        ans = input->Open(slot->rxfilename, NULL);
+      else
+        ans = input->OpenTextMode(slot->rxfilename);
+      if (!ans) {
+        slot->error = "failed to open file " +
+            PrintableRxfilename(slot->rxfilename);
+        return false;
+      }
+      if (!slot->holder.Read(input->Stream())) {
+        slot->error = "failed to load object from " +
+            PrintableRxfilename(slot->rxfilename);
+        return false;
+      }
+      if (!slot->range.empty()) {
+        Holder range_holder;
+        if (!range_holder.ExtractRange(slot->holder, slot->range)) {
+          slot->error = "failed to load object from " +
+              PrintableRxfilename(slot->rxfilename) + "[" + slot->range + "]";
+          return false;
+        }
+        slot->holder.Swap(&range_holder);
+      }
+      return true;
+    } catch (const std::exception &e) {
+      slot->error = e.what();
+      return false;
+    }
+  }
+
   std::string key_;
   Holder holder_;
-  // I couldn't figure out what to call these semaphores.  consumer_sem_ is the
-  // one that the consumer (main thread) waits on; producer_sem_ is the one
-  // that the producer (background thread) waits on.
-  Semaphore consumer_sem_;
-  Semaphore producer_sem_;
-  std::thread thread_;
-  SequentialTableReaderImplBase<Holder> *base_reader_;
+  std::string error_;  // Error reading the current object, if any.
 
+  SequentialTableReaderImplBase<Holder> *base_reader_;
+  int32 queue_size_;
+  bool permissive_;
+
+  // queue_, the states of the Slots in it, producer_done_ and stop_ are
+  // protected by mutex_.
+  std::mutex mutex_;
+  std::deque<Slot*> queue_;
+  bool producer_done_;  // True when the producer thread has finished.
+  bool stop_;  // Set by Close() to stop the background threads.
+  // The condition variables that the consumer (main thread), the producer
+  // thread and the worker threads wait on.
+  std::condition_variable consumer_cond_;
+  std::condition_variable producer_cond_;
+  std::condition_variable worker_cond_;
+  std::thread producer_thread_;
+  // The worker threads; this is only accessed by the producer thread, until
+  // Close() has joined it.
+  std::vector<std::thread> worker_threads_;
+
+  bool have_value_;  // True if key_ and holder_ have the current object.
 };
 
 template<class Holder>
@@ -876,6 +1230,9 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
     case kScriptRspecifier:
       impl_ = new SequentialTableReaderScriptImpl<Holder>();
       break;
+    case kIndexRspecifier:
+      impl_ = new SequentialTableReaderIndexImpl<Holder>();
+      break;
     case kNoRspecifier: default:
       KALDI_WARN << "Invalid rspecifier " << rspecifier;
       return false;
@@ -887,7 +1244,7 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
   }
   if (opts.background) {
     impl_ = new SequentialTableReaderBackgroundImpl<Holder>(
-        impl_);
+        impl_, opts.background_queue_size, opts.permissive);
     if (!impl_->Open("")) {
       // the rxfilename is ignored in that Open() call.
       // It should only return false on code error.
@@ -1463,6 +1820,167 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
 };
 
 
+// TableWriterCopier<T>::Copy() returns a copy of an object, allocated with
+// new, or NULL if objects of type T cannot be copied (e.g. MatrixBase);
+// Delete() deletes such a copy.  It's used by TableWriterBackgroundImpl.
+template<class T, bool copyable = std::is_copy_constructible<T>::value>
+struct TableWriterCopier {
+  static T *Copy(const T &t) { return new T(t); }
+  static void Delete(T *t) { delete t; }
+};
+template<class T>
+struct TableWriterCopier<T, false> {
+  static T *Copy(const T &t) { return NULL; }
+  static void Delete(T *t) { KALDI_ASSERT(t == NULL); }
+};
+
+// This is for when someone adds the 'bg' or 'bg=N' modifier to a wspecifier.
+// It wraps around the basic implementation, and does the writing, including
+// the serialization of the objects by the Holder, in a background thread, so
+// that the thread that calls Write() is not held up by it; this matters for
+// large objects such as lattices, and when writing to a pipe such as
+// "| gzip -c >foo.gz", where writing blocks if the pipe is full.  Write()
+// copies the object and adds it to a queue of up to N objects, waiting if it
+// is full.  Objects of types that cannot be copied are written in the calling
+// thread (after the ones already queued).  Errors are reported by a later
+// call to Write(), or by Close().
+template<class Holder>
+class TableWriterBackgroundImpl: public TableWriterImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  TableWriterBackgroundImpl(TableWriterImplBase<Holder> *base_writer,
+                            int32 queue_size):
+      base_writer_(base_writer), queue_size_(queue_size), busy_(false),
+      error_(false), stop_(false) {
+    KALDI_ASSERT(queue_size > 0);
+  }
+
+  // This function ignores the wspecifier, as base_writer_ has already been
+  // opened.
+  virtual bool Open(const std::string &wspecifier) {
+    KALDI_ASSERT(base_writer_ != NULL && base_writer_->IsOpen());
+    thread_ = std::thread(TableWriterBackgroundImpl<Holder>::Run, this);
+    return true;
+  }
+
+  virtual bool IsOpen() const { return base_writer_ != NULL; }
+
+  virtual bool Write(const std::string &key, const T &value) {
+    if (base_writer_ == NULL)
+      KALDI_ERR << "Write called on closed background writer.";
+    T *copy = TableWriterCopier<T>::Copy(value);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (copy == NULL) {
+      // Write in this thread, once the background thread is idle.
+      idle_cond_.wait(lock, [this] { return queue_.empty() && !busy_; });
+      if (!error_ && !base_writer_->Write(key, value))
+        error_ = true;
+      return !error_;
+    }
+    producer_cond_.wait(lock, [this] {
+        return queue_.size() < static_cast<size_t>(queue_size_); });
+    queue_.push_back(std::make_pair(key, copy));
+    // We return the status of earlier writes; errors in writing this object
+    // will be reported later.
+    bool ans = !error_;
+    lock.unlock();
+    consumer_cond_.notify_one();
+    return ans;
+  }
+
+  // Flush() waits until everything has been written, then flushes.
+  virtual void Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cond_.wait(lock, [this] { return queue_.empty() && !busy_; });
+    base_writer_->Flush();
+  }
+
+  virtual bool Close() {
+    if (base_writer_ == NULL)
+      KALDI_ERR << "Close called on a stream that was not open.";
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    consumer_cond_.notify_one();
+    // The background thread finishes writing what is in the queue before it
+    // exits.
+    thread_.join();
+    bool ans = !error_;
+    try {
+      if (!base_writer_->Close())
+        ans = false;
+    } catch (...) {
+      ans = false;
+    }
+    delete base_writer_;
+    base_writer_ = NULL;
+    return ans;
+  }
+
+  virtual ~TableWriterBackgroundImpl() {
+    if (base_writer_ != NULL && !Close())
+      KALDI_ERR << "Error detected closing background writer "
+                << "(relates to ',bg' modifier)";
+  }
+
+ private:
+  static void Run(TableWriterBackgroundImpl<Holder> *object) {
+    object->WriteInBackground();
+  }
+
+  void WriteInBackground() {
+    while (true) {
+      std::pair<std::string, T*> item;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        consumer_cond_.wait(lock, [this] { return !queue_.empty() || stop_; });
+        if (queue_.empty())
+          return;  // stop_ is set, and there is nothing left to write.
+        item = queue_.front();
+        queue_.pop_front();
+        busy_ = true;
+      }
+      producer_cond_.notify_one();
+      bool ans;
+      try {
+        ans = base_writer_->Write(item.first, *(item.second));
+      } catch (const std::exception &e) {
+        KALDI_WARN << "Error writing object for key " << item.first
+                   << " in background writer: " << e.what();
+        ans = false;
+      }
+      TableWriterCopier<T>::Delete(item.second);
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!ans)
+          error_ = true;
+        busy_ = false;
+      }
+      idle_cond_.notify_all();
+    }
+  }
+
+  TableWriterImplBase<Holder> *base_writer_;
+  int32 queue_size_;
+
+  // queue_, busy_, error_ and stop_ are protected by mutex_.
+  std::mutex mutex_;
+  std::deque<std::pair<std::string, T*> > queue_;
+  bool busy_;  // True while the background thread is writing an object.
+  bool error_;  // True if there was an error writing.
+  bool stop_;  // Set by Close() to make the background thread exit.
+  // The condition variables that the background thread waits on, that
+  // Write() waits on when the queue is full, and that Write() and Flush()
+  // wait on for the background thread to finish what it is doing.
+  std::condition_variable consumer_cond_;
+  std::condition_variable producer_cond_;
+  std::condition_variable idle_cond_;
+  std::thread thread_;
+};
+
+
 template<class Holder>
 TableWriter<Holder>::TableWriter(const std::string &wspecifier): impl_(NULL) {
   if (wspecifier != "" && !Open(wspecifier))
@@ -1483,7 +2001,8 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
       KALDI_ERR << "Failed to close previously open writer.";
   }
   KALDI_ASSERT(impl_ == NULL);
-  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, NULL);
+  WspecifierOptions opts;
+  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, &opts);
   switch (wtype) {
     case kBothWspecifier:
       impl_ = new TableWriterBothImpl<Holder>();
@@ -1498,13 +2017,20 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
       KALDI_WARN << "ClassifyWspecifier: invalid wspecifier " << wspecifier;
       return false;
   }
-  if (impl_->Open(wspecifier)) {
-    return true;
-  } else {  // The class will have printed a more specific warning.
+  if (!impl_->Open(wspecifier)) {
+    // The class will have printed a more specific warning.
     delete impl_;
     impl_ = NULL;
     return false;
   }
+  if (opts.background) {
+    impl_ = new TableWriterBackgroundImpl<Holder>(impl_,
+                                                  opts.background_queue_size);
+    // the wspecifier is ignored in that Open() call.
+    if (!impl_->Open(""))
+      return false;
+  }
+  return true;
 }
 
 template<class Holder>
@@ -1883,6 +2409,122 @@ class RandomAccessTableReaderScriptImpl:
 
 
 
+// Implementation of RandomAccessTableReader for a table index (the "idx:"
+// rspecifier; see table-index.h).  Unlike RandomAccessTableReaderScriptImpl,
+// it does not read anything into memory when opened: the keys are looked up
+// by binary search in the memory-mapped index.  As in that class, we keep the
+// most recently read object, so that calling HasKey() and then Value() does
+// not read it twice.
+template<class Holder>
+class RandomAccessTableReaderIndexImpl:
+      public RandomAccessTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  RandomAccessTableReaderIndexImpl(): last_found_(-1), have_object_(false) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (index_.IsOpen())
+      KALDI_ERR << " Opening already open RandomAccessTableReader:"
+                   " call Close first.";
+    rspecifier_ = rspecifier;
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &index_filename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kIndexRspecifier);  // or wrongly called.
+    return index_.Open(index_filename_);
+  }
+
+  virtual bool Close() {
+    if (!index_.IsOpen())
+      KALDI_ERR << "Close() called on RandomAccessTableReader that was not"
+                   " open.";
+    holder_.Clear();
+    have_object_ = false;
+    if (input_.IsOpen())
+      input_.Close();
+    index_.Close();
+    last_found_ = -1;
+    return true;
+  }
+
+  virtual bool HasKey(const std::string &key) {
+    // In permissive mode, we have to check that we can read the object before
+    // we assert that the key is there.
+    return HasKeyInternal(key, opts_.permissive);
+  }
+
+  virtual const T &Value(const std::string &key) {
+    if (!HasKeyInternal(key, true))  // true == preload.
+      KALDI_ERR << "Could not get item for key " << key
+                << ", rspecifier is " << rspecifier_ << " [to ignore this, "
+                << "add the p, (permissive) option to the rspecifier.";
+    return holder_.Value();
+  }
+
+  virtual ~RandomAccessTableReaderIndexImpl() { }
+
+ private:
+  bool HasKeyInternal(const std::string &key, bool preload) {
+    if (!index_.IsOpen())
+      KALDI_ERR << "HasKey called on RandomAccessTableReader object that is"
+                   " not open.";
+    if (have_object_ && last_found_ >= 0 && key == index_.Key(last_found_))
+      return true;
+    int64 pos = LookupKey(key);
+    if (pos < 0)
+      return false;
+    if (!preload)
+      return true;
+    holder_.Clear();
+    have_object_ = false;
+    std::string rxfilename = index_.Rxfilename(pos);
+    if (!(Holder::IsReadInBinary() ? input_.Open(rxfilename, NULL) :
+          input_.OpenTextMode(rxfilename))) {
+      KALDI_WARN << "Error opening stream " << PrintableRxfilename(rxfilename);
+      return false;
+    }
+    if (!holder_.Read(input_.Stream())) {
+      KALDI_WARN << "Error reading object from stream "
+                 << PrintableRxfilename(rxfilename);
+      return false;
+    }
+    have_object_ = true;
+    return true;
+  }
+
+  // Returns the position of 'key' in the index, or -1 if it is not there, and
+  // sets last_found_ to it if it is found.  As in
+  // RandomAccessTableReaderScriptImpl::LookupKey(), we first check the last
+  // position found and the next one, which makes access in sorted order fast.
+  int64 LookupKey(const std::string &key) {
+    if (last_found_ >= 0 && key == index_.Key(last_found_))
+      return last_found_;
+    if (last_found_ + 1 < index_.NumEntries() &&
+        key == index_.Key(last_found_ + 1)) {
+      have_object_ = false;
+      return ++last_found_;
+    }
+    int64 pos = index_.Find(key);
+    if (pos >= 0) {
+      have_object_ = false;
+      last_found_ = pos;
+    }
+    return pos;
+  }
+
+  TableIndex index_;
+  Input input_;  // Use the same input_ object for reading each object, so we
+                 // can keep the archive open.
+  RspecifierOptions opts_;
+  std::string rspecifier_;  // rspecifier used to open this object; used in
+                            // debug messages
+  std::string index_filename_;
+  Holder holder_;
+  int64 last_found_;  // Position in index_ of the last key we looked up.
+  bool have_object_;  // True if holder_ has the object for last_found_.
+};
+
+
 // This is the base-class (with some implemented functions) for the
 // implementations of RandomAccessTableReader when it's an archive.  This
 // base-class handles opening the files, storing the state of the reading
@@ -2523,6 +3165,9 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
     case kScriptRspecifier:
       impl_ = new RandomAccessTableReaderScriptImpl<Holder>();
       break;
+    case kIndexRspecifier:
+      impl_ = new RandomAccessTableReaderIndexImpl<Holder>();
+      break;
     case kArchiveRspecifier:
       if (opts.sorted) {
         if (opts.called_sorted)  // "doubly" sorted case.
@@ -172,6 +172,30 @@ void UnitTestClassifyWspecifier() {
     KALDI_ASSERT(ans == kBothWspecifier && ark == "" && scp == "" &&
                  opts.binary == true && opts.flush == false);
   }
+
+  {
+    std::string a = "ark,bg:foo";
+    std::string ark = "x", scp = "y";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kArchiveWspecifier && ark == "foo" &&
+                 opts.background && opts.background_queue_size == 1);
+  }
+
+  {
+    std::string a = "ark,scp,bg=4:foo,bar";
+    std::string ark = "x", scp = "y";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kBothWspecifier && ark == "foo" && scp == "bar" &&
+                 opts.background && opts.background_queue_size == 4);
+  }
+
+  {
+    std::string a = "ark,bg=0:foo";  // queue size must be positive.
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, NULL);
+    KALDI_ASSERT(ans == kNoWspecifier);
+  }
 }
 
 
@@ -319,6 +343,18 @@ void UnitTestClassifyRspecifier() {
     RspecifierType ans = ClassifyRspecifier(a, &b, NULL);
     KALDI_ASSERT(ans == kArchiveRspecifier && b == "a");
   }
+  {
+    std::string a = "bg=4,scp:a", b;
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &b, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && b == "a" && opts.background &&
+                 opts.background_queue_size == 4);
+  }
+  {
+    std::string a = "bg=0,scp:a";
+    RspecifierType ans = ClassifyRspecifier(a, NULL, NULL);
+    KALDI_ASSERT(ans == kNoRspecifier);
+  }
 }
 
 void UnitTestTableSequentialInt32(bool binary) {
@@ -631,8 +667,9 @@ void UnitTestTableSequentialInt32Script(bool binary) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialInt32Reader sbr(RandInt(0, 1) == 0 ?
-                            "scp:tmp.scp" : "scp,bg:tmp.scp");
+  const char *rspecifiers[] = { "scp:tmp.scp", "scp,bg:tmp.scp",
+                                "scp,bg=3:tmp.scp" };
+  SequentialInt32Reader sbr(rspecifiers[RandInt(0, 2)]);
   std::vector<std::string> k2;
   std::vector<int32> v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -649,6 +686,66 @@ void UnitTestTableSequentialInt32Script(bool binary) {
   KALDI_ASSERT(v2 == v);
 }
 
+// Tests reading an scp file with the bg=N option, where some of the files do
+// not exist.
+void UnitTestTableSequentialBackgroundScript() {
+  int32 sz = RandInt(0, 50), queue_size = RandInt(1, 8);
+  std::vector<std::pair<std::string, std::string> > script;
+  std::vector<std::string> k;
+  std::vector<int32> v;
+  std::vector<bool> exists;
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream key;
+    key << "utt" << i;
+    script.push_back(std::make_pair(key.str(), key.str() + ".tmp"));
+    k.push_back(key.str());
+    v.push_back(Rand());
+    exists.push_back(RandInt(0, 3) != 0);
+  }
+  WriteScriptFile("tmp.scp", script);
+  for (int32 i = 0; i < sz; i++) {
+    if (exists[i]) {
+      Output ko(script[i].second, true);
+      WriteBasicType(ko.Stream(), true, v[i]);
+    }
+  }
+
+  std::ostringstream rspecifier;
+  rspecifier << "p,bg=" << queue_size << ",scp:tmp.scp";
+  SequentialInt32Reader reader(rspecifier.str());
+  int32 i = 0;
+  for (; !reader.Done(); reader.Next(), i++) {
+    while (!exists[i]) i++;  // These should be skipped in permissive mode.
+    KALDI_ASSERT(reader.Key() == k[i] && reader.Value() == v[i]);
+  }
+  while (i < sz && !exists[i]) i++;
+  KALDI_ASSERT(i == sz);
+  KALDI_ASSERT(reader.Close());
+
+  // Without the permissive option, Value() should throw for the missing
+  // files.
+  rspecifier.str("");
+  rspecifier << "bg=" << queue_size << ",scp:tmp.scp";
+  int32 num_errors = 0;
+  i = 0;
+  for (reader.Open(rspecifier.str()); !reader.Done(); reader.Next(), i++) {
+    KALDI_ASSERT(reader.Key() == k[i]);
+    try {
+      KALDI_ASSERT(reader.Value() == v[i] && exists[i]);
+    } catch (const std::exception &e) {
+      KALDI_ASSERT(!exists[i]);
+      num_errors++;
+    }
+  }
+  KALDI_ASSERT(i == sz);
+  KALDI_ASSERT(reader.Close());
+
+  unlink("tmp.scp");
+  for (int32 j = 0; j < sz; j++)
+    if (exists[j])
+      unlink(script[j].second.c_str());
+}
+
 // Writing as both and reading as archive.
 void UnitTestTableSequentialDoubleMatrixBoth(bool binary, bool read_scp) {
   int32 sz = Rand() % 10;
@@ -667,8 +764,11 @@ void UnitTestTableSequentialDoubleMatrixBoth(bool binary, bool read_scp) {
   }
 
   bool ans;
-  DoubleMatrixWriter bw(binary ? "b,ark,scp:tmpf,tmpf.scp" :
-                        "t,ark,scp:tmpf,tmpf.scp");
+  // Sometimes write in a background thread.
+  std::string bg_opt = (Rand() % 2 == 0 ? "" :
+                        (Rand() % 2 == 0 ? "bg," : "bg=3,"));
+  DoubleMatrixWriter bw(bg_opt + (binary ? "b,ark,scp:tmpf,tmpf.scp" :
+                                  "t,ark,scp:tmpf,tmpf.scp"));
   for (int32 i = 0; i < sz; i++)  {
     bw.Write(k[i], *(v[i]));
   }
@@ -952,9 +1052,10 @@ void UnitTestRangesMatrix(bool binary) {
 
   {  // test sequential reading.
     bool permissive = (RandInt(0, 1) == 0);
-    SequentialBaseFloatMatrixReader reader(permissive ?
-                                           "scp,p:tmpf_ranges.scp" :
-                                           "scp:tmpf_ranges.scp");
+    const char *background[] = { "", "bg,", "bg=4," };
+    SequentialBaseFloatMatrixReader reader(
+        std::string(background[RandInt(0, 2)]) +
+        (permissive ? "scp,p:tmpf_ranges.scp" : "scp:tmpf_ranges.scp"));
 
     int32 i = 0;
     for (; !reader.Done(); reader.Next(), i++) {
@@ -1137,6 +1238,7 @@ int main() {
     UnitTestTableSequentialBool(b);
     UnitTestTableSequentialInt32(b);
     UnitTestTableSequentialInt32Script(b);
+    UnitTestTableSequentialBackgroundScript();
     UnitTestTableSequentialDouble(b);
     UnitTestRangesMatrix(b);
     for (int j = 0; j < 2; j++) {
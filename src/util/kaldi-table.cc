@@ -148,6 +148,8 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
   //  ark,scp,f:filename, wxfilename ->  kBothWspecifier
   // or:
   //  scp,t,nf:rxfilename -> kScriptWspecifier
+  // and the background option (bg or bg=N), e.g.
+  //  ark,bg=4:wxfilename -> kArchiveWspecifier
 
   if (archive_wxfilename) archive_wxfilename->clear();
   if (script_wxfilename) script_wxfilename->clear();
@@ -183,6 +185,17 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
       if (opts) opts->binary = false;
     } else if (!strcmp(c, "p")) {
       if (opts) opts->permissive = true;
+    } else if (!strcmp(c, "bg")) {
+      if (opts) opts->background = true;
+    } else if (!strncmp(c, "bg=", 3)) {
+      int32 queue_size;
+      if (!ConvertStringToInteger(str.substr(3), &queue_size) ||
+          queue_size <= 0)
+        return kNoWspecifier;
+      if (opts) {
+        opts->background = true;
+        opts->background_queue_size = queue_size;
+      }
     } else if (!strcmp(c, "ark")) {
       if (ws == kNoWspecifier) ws = kArchiveWspecifier;
       else
@@ -228,6 +241,7 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
   // Examples
   // ark:rxfilename  ->  kArchiveRspecifier
   // scp:rxfilename  -> kScriptRspecifier
+  // idx:filename  -> kIndexRspecifier
   //
   // We also allow the meaningless prefixes b, and t,
   // plus the options o (once), no (not-once),
@@ -293,6 +307,15 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = false;
     } else if (!strcmp(c, "bg")) {
       if (opts) opts->background = true;
+    } else if (!strncmp(c, "bg=", 3)) {
+      int32 queue_size;
+      if (!ConvertStringToInteger(str.substr(3), &queue_size) ||
+          queue_size <= 0)
+        return kNoRspecifier;
+      if (opts) {
+        opts->background = true;
+        opts->background_queue_size = queue_size;
+      }
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else
@@ -303,12 +326,16 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       else
         return kNoRspecifier;  // Repeated or combined ark and scp options
       // invalid.
+    } else if (!strcmp(c, "idx")) {
+      if (rs == kNoRspecifier) rs = kIndexRspecifier;
+      else
+        return kNoRspecifier;
     } else {
       return kNoRspecifier;  // Could not interpret this option.
     }
   }
-  if ((rs == kArchiveRspecifier || rs == kScriptRspecifier)
-     && rxfilename != NULL)
+  if ((rs == kArchiveRspecifier || rs == kScriptRspecifier ||
+       rs == kIndexRspecifier) && rxfilename != NULL)
     *rxfilename = after_colon;
   return rs;
 }
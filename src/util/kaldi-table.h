@@ -71,12 +71,18 @@ typedef std::vector<std::string> KeyList;
 //  p means permissive mode, when writing to an "scp" file only: will ignore
 //     missing scp entries, i.e. won't write anything for those files but will
 //     return success status).
+//  bg means "background": the objects are copied, and written (including
+//     serializing them) in a background thread, so that the program does not
+//     wait for the writing, e.g. to a pipe to gzip.  bg=N allows up to N
+//     objects to be queued for writing (plain bg means N = 1).  Errors are
+//     reported by later calls to Write(), or by Close().
 //
 //  So the following are valid wspecifiers:
 //  ark,b,f:foo
 //  "ark,b,b:| gzip -c > foo"
 //  "ark,scp,t,nf:foo.ark,|gzip -c > foo.scp.gz"
 //  ark,b:-
+//  "ark,bg=4:| gzip -c > foo.gz"
 //
 //  The meanings of rxfilename and wxfilename are as described in
 //  kaldi-io.h (they are filenames but include pipes, stdin/stdout
@@ -114,7 +120,10 @@ struct WspecifierOptions {
   bool binary;
   bool flush;
   bool permissive;  // will ignore absent scp entries.
-  WspecifierOptions(): binary(true), flush(false), permissive(false) { }
+  bool background;  // write in a background thread ("bg" option).
+  int32 background_queue_size;  // max objects queued for writing ("bg=N").
+  WspecifierOptions(): binary(true), flush(false), permissive(false),
+                       background(false), background_queue_size(1) { }
 };
 
 // ClassifyWspecifier returns the type of the wspecifier string,
@@ -167,6 +176,14 @@ bool WriteScriptFile(std::ostream &os,
 //
 // ark:rxfilename
 // scp:rxfilename
+// idx:filename
+//
+// The idx:filename type reads a table index, as created by build-table-index
+// (see table-index.h), which gives the byte offset of each key in one or more
+// archives, like an scp file; but it is not read into memory, and lookups
+// are done by binary search in the memory-mapped index.  This is the most
+// efficient way to randomly access very large tables.  Here, filename must be
+// a plain file.  Sequential readers read the entries in sorted order of key.
 //
 // We also allow various modifiers:
 //   o   means the program will only ask for each key once, which enables
@@ -189,6 +206,11 @@ bool WriteScriptFile(std::ostream &os,
 //       value, in a background thread.  Recommended when reading larger objects
 //       such as neural-net training examples, especially when you want to
 //       maximize GPU usage.
+//   bg=N is like bg, but reads up to N values ahead.  For scp files and table
+//       indexes (idx:), the values are read by N threads in parallel, which
+//       helps hide the latency of network filesystems; e.g.
+//       "bg=8, scp:feats.scp".  (In permissive mode, scp entries are read
+//       one at a time).
 //
 //   b   is ignored [for scripting convenience]
 //   t   is ignored [for scripting convenience]
@@ -211,15 +233,18 @@ struct  RspecifierOptions {
   bool background;  // For sequential readers, if the background option ("bg")
                     // is provided, it will read ahead to the next object in a
                     // background thread.
+  int32 background_queue_size;  // The number of objects to read ahead if
+                                // background == true; "bg=N" sets it to N.
   RspecifierOptions(): once(false), sorted(false),
                        called_sorted(false), permissive(false),
-                       background(false) { }
+                       background(false), background_queue_size(1) { }
 };
 
 enum RspecifierType  {
   kNoRspecifier,
   kArchiveRspecifier,
-  kScriptRspecifier
+  kScriptRspecifier,
+  kIndexRspecifier
 };
 
 RspecifierType ClassifyRspecifier(const std::string &rspecifier,
@@ -0,0 +1,90 @@
+// util/memory-pool-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "util/memory-pool.h"
+#include <algorithm>
+#include <set>
+
+namespace kaldi {
+
+struct TestObject {
+  int32 a;
+  double b;
+  static int32 num_objects;
+  TestObject(int32 a, double b): a(a), b(b) { num_objects++; }
+  ~TestObject() { num_objects--; }
+};
+
+int32 TestObject::num_objects = 0;
+
+void TestMemoryPool() {
+  size_t block_size = 1 + Rand() % 20;
+  MemoryPool<TestObject> pool(block_size);
+  std::vector<TestObject*> objects;
+  size_t peak = 0;
+  for (int32 i = 0; i < 1000; i++) {
+    if (objects.empty() || Rand() % 3 != 0) {
+      int32 a = Rand() % 100;
+      TestObject *t = pool.New(a, a * 0.5);
+      KALDI_ASSERT(t->a == a && t->b == a * 0.5);
+      objects.push_back(t);
+    } else {
+      size_t j = Rand() % objects.size();
+      pool.Delete(objects[j]);
+      objects[j] = objects.back();
+      objects.pop_back();
+    }
+    peak = std::max(peak, objects.size());
+    KALDI_ASSERT(pool.NumInUse() == objects.size());
+    KALDI_ASSERT(TestObject::num_objects ==
+                 static_cast<int32>(objects.size()));
+  }
+  KALDI_ASSERT(pool.PeakInUse() == peak);
+  KALDI_ASSERT(pool.NumAllocated() >= peak &&
+               pool.NumAllocated() % block_size == 0 &&
+               pool.NumAllocated() < peak + block_size);
+  // All the live objects must be distinct.
+  std::set<TestObject*> object_set(objects.begin(), objects.end());
+  KALDI_ASSERT(object_set.size() == objects.size());
+
+  pool.ResetPeak();
+  KALDI_ASSERT(pool.PeakInUse() == objects.size());
+  for (size_t j = 0; j < objects.size(); j++)
+    pool.Delete(objects[j]);
+  objects.clear();
+  KALDI_ASSERT(pool.NumInUse() == 0 && TestObject::num_objects == 0);
+
+  // Memory that was freed gets reused, so allocating up to the old peak
+  // again should not allocate any more blocks.
+  size_t num_allocated = pool.NumAllocated();
+  for (size_t j = 0; j < peak; j++)
+    objects.push_back(pool.New(1, 2.0));
+  KALDI_ASSERT(pool.NumAllocated() == num_allocated);
+  for (size_t j = 0; j < objects.size(); j++)
+    pool.Delete(objects[j]);
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  for (int32 i = 0; i < 10; i++)
+    kaldi::TestMemoryPool();
+  KALDI_LOG << "Test OK.\n";
+}
@@ -0,0 +1,144 @@
+// util/memory-pool.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_MEMORY_POOL_H_
+#define KALDI_UTIL_MEMORY_POOL_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/**
+   MemoryPool is a simple slab allocator for objects of a single type T, for
+   use where very many small objects are created and destroyed, as with the
+   tokens and arcs of the decoders.  Memory is obtained from the system in
+   blocks of 'block_size' objects and is never returned to the system until
+   the MemoryPool is destroyed; freed objects go on a free list and are reused
+   by later calls to New().  This is the same scheme that HashList uses for
+   its Elem objects.
+
+   Because the memory is recycled, a decoder that owns a MemoryPool and
+   decodes many utterances will not keep allocating memory once it has seen
+   its largest utterance, and does not fragment the heap shared with other
+   threads.
+
+   This class is not thread safe; each decoder should have its own pool.
+*/
+template<class T>
+class MemoryPool {
+ public:
+  /// 'block_size' is the number of objects that are allocated from the
+  /// system at a time.
+  explicit MemoryPool(size_t block_size = 1024):
+      block_size_(block_size), free_head_(NULL), num_in_use_(0),
+      peak_in_use_(0), num_allocated_(0) {
+    KALDI_ASSERT(block_size > 0);
+  }
+
+  /// Constructs a new object with the given constructor arguments, in
+  /// memory taken from the pool.  Free it with Delete(), not with delete.
+  template<typename... Args>
+  inline T *New(Args&&... args) {
+    if (free_head_ == NULL)
+      AllocateBlock();
+    FreeItem *item = free_head_;
+    free_head_ = item->next;
+    num_in_use_++;
+    if (num_in_use_ > peak_in_use_)
+      peak_in_use_ = num_in_use_;
+    return new (static_cast<void*>(item)) T(std::forward<Args>(args)...);
+  }
+
+  /// Destroys an object that was created by New(), and returns its memory to
+  /// the pool.
+  inline void Delete(T *t) {
+    t->~T();
+    FreeItem *item = reinterpret_cast<FreeItem*>(t);
+    item->next = free_head_;
+    free_head_ = item;
+    num_in_use_--;
+  }
+
+  /// Returns the number of objects currently in use, i.e. created by New()
+  /// and not yet freed by Delete().
+  size_t NumInUse() const { return num_in_use_; }
+
+  /// Returns the largest number of objects that have been in use at any one
+  /// time since the pool was created or ResetPeak() was last called.
+  size_t PeakInUse() const { return peak_in_use_; }
+
+  /// Returns the number of objects that the pool has room for, i.e. the
+  /// number of objects in all the blocks allocated so far.
+  size_t NumAllocated() const { return num_allocated_; }
+
+  /// Returns the number of bytes of memory the pool has allocated.
+  size_t BytesAllocated() const { return num_allocated_ * sizeof(FreeItem); }
+
+  /// Resets the peak-usage statistic to the current usage.
+  /// LatticeFasterDecoderTpl calls this from ClearActiveTokens(), after it has
+  /// freed the tokens and links of the previous utterance, so that
+  /// PeakInUse() gives the per-utterance peak.
+  void ResetPeak() { peak_in_use_ = num_in_use_; }
+
+  ~MemoryPool() {
+    if (num_in_use_ != 0)
+      KALDI_WARN << "Possible memory leak: " << num_in_use_
+                 << " objects still in use when destroying MemoryPool.";
+    for (size_t i = 0; i < blocks_.size(); i++)
+      delete [] blocks_[i];
+  }
+
+ private:
+  // The storage for an object; while the object is free, the same memory
+  // holds a pointer to the next free item.
+  union FreeItem {
+    FreeItem *next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  void AllocateBlock() {
+    FreeItem *block = new FreeItem[block_size_];
+    blocks_.push_back(block);
+    // Link the items so that they are handed out in address order.
+    for (size_t i = 0; i + 1 < block_size_; i++)
+      block[i].next = block + i + 1;
+    block[block_size_ - 1].next = free_head_;
+    free_head_ = block;
+    num_allocated_ += block_size_;
+  }
+
+  size_t block_size_;
+  FreeItem *free_head_;  // Head of the list of free items.
+  std::vector<FreeItem*> blocks_;  // All blocks we allocated.
+  size_t num_in_use_;
+  size_t peak_in_use_;
+  size_t num_allocated_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MemoryPool);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_MEMORY_POOL_H_
@@ -0,0 +1,134 @@
+// util/table-index-test.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <map>
+#include <unistd.h>
+#include "util/table-types.h"
+#include "util/table-index.h"
+
+namespace kaldi {
+
+// Writes a random archive (and scp file) of int-vectors, and checks that
+// indexes built from the scp file and by scanning the archive give the same
+// contents when read with "idx:" rspecifiers.
+void UnitTestTableIndex(bool binary) {
+  std::map<std::string, std::vector<int32> > contents;
+  int32 num_keys = Rand() % 100;
+  for (int32 i = 0; i < num_keys; i++) {
+    std::ostringstream ss;
+    ss << "utt" << (Rand() % 1000);
+    std::vector<int32> vec(Rand() % 10);
+    for (size_t j = 0; j < vec.size(); j++)
+      vec[j] = Rand() % 100;
+    contents[ss.str()] = vec;
+  }
+  // Write the keys in random order, so that the index has to sort them.
+  std::vector<std::string> keys;
+  for (std::map<std::string, std::vector<int32> >::iterator iter =
+           contents.begin(); iter != contents.end(); ++iter)
+    keys.push_back(iter->first);
+  std::random_shuffle(keys.begin(), keys.end());
+  {
+    Int32VectorWriter writer(binary ? "ark,scp,b:tmpf.ark,tmpf.scp"
+                             : "ark,scp,t:tmpf.ark,tmpf.scp");
+    for (size_t i = 0; i < keys.size(); i++)
+      writer.Write(keys[i], contents[keys[i]]);
+  }
+
+  {
+    TableIndexWriter index_writer;
+    std::vector<std::pair<std::string, std::string> > script;
+    KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script));
+    for (size_t i = 0; i < script.size(); i++)
+      KALDI_ASSERT(index_writer.AddScriptEntry(script[i].first,
+                                               script[i].second));
+    KALDI_ASSERT(index_writer.Write("tmpf.scp.idx"));
+  }
+  {
+    TableIndexWriter index_writer;
+    int64 num_entries = AddArchiveToTableIndex<BasicVectorHolder<int32> >(
+        "tmpf.ark", &index_writer);
+    KALDI_ASSERT(num_entries == static_cast<int64>(keys.size()));
+    KALDI_ASSERT(index_writer.Write("tmpf.ark.idx"));
+  }
+
+  for (int32 n = 0; n < 2; n++) {
+    std::string index_filename = (n == 0 ? "tmpf.scp.idx" : "tmpf.ark.idx");
+    TableIndex index;
+    KALDI_ASSERT(index.Open(index_filename) &&
+                 index.NumEntries() == static_cast<int64>(contents.size()));
+    for (int64 i = 0; i + 1 < index.NumEntries(); i++)
+      KALDI_ASSERT(std::string(index.Key(i)) < std::string(index.Key(i + 1)));
+
+    RandomAccessInt32VectorReader random_reader("idx:" + index_filename);
+    for (int32 i = 0; i < 200; i++) {
+      std::ostringstream ss;
+      ss << "utt" << (Rand() % 1000);
+      std::string key = ss.str();
+      bool has_key = (contents.count(key) != 0);
+      KALDI_ASSERT(random_reader.HasKey(key) == has_key);
+      KALDI_ASSERT((index.Find(key) >= 0) == has_key);
+      if (has_key)
+        KALDI_ASSERT(random_reader.Value(key) == contents[key]);
+    }
+
+    // Also test reading in the background, with several threads.
+    SequentialInt32VectorReader sequential_reader(
+        (RandInt(0, 1) == 0 ? "idx:" : "bg=3,idx:") + index_filename);
+    std::map<std::string, std::vector<int32> >::iterator iter =
+        contents.begin();
+    for (; !sequential_reader.Done(); sequential_reader.Next(), ++iter) {
+      KALDI_ASSERT(iter != contents.end() &&
+                   sequential_reader.Key() == iter->first &&
+                   sequential_reader.Value() == iter->second);
+    }
+    KALDI_ASSERT(iter == contents.end());
+  }
+
+  {
+    // Duplicate keys are not allowed.
+    TableIndexWriter index_writer;
+    index_writer.AddEntry("a", "tmpf.ark", 0);
+    index_writer.AddEntry("a", "tmpf.ark", 10);
+    KALDI_ASSERT(!index_writer.Write("tmpf.scp.idx"));
+  }
+  {
+    // Something that is not an index should not be opened.
+    TableIndex index;
+    KALDI_ASSERT(!index.Open("tmpf.scp"));
+  }
+
+  unlink("tmpf.ark");
+  unlink("tmpf.scp");
+  unlink("tmpf.scp.idx");
+  unlink("tmpf.ark.idx");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestTableIndex(true);
+    UnitTestTableIndex(false);
+  }
+  KALDI_LOG << "Test OK.";
+  return 0;
+}
@@ -0,0 +1,226 @@
+// util/table-index.cc
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/table-index.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "util/text-utils.h"
+
+namespace kaldi {
+
+static const char *kTableIndexMagic = "KaldiIdx";
+static const int64 kTableIndexHeaderSize = 5;  // In int64's, including magic.
+
+bool TableIndex::Open(const std::string &filename) {
+  Close();
+  std::ifstream is(filename.c_str(), std::ios::binary);
+  if (!is.is_open()) {
+    KALDI_WARN << "Could not open table index " << filename;
+    return false;
+  }
+  is.seekg(0, std::ios::end);
+  int64 size = is.tellg();
+  is.seekg(0, std::ios::beg);
+  if (size < kTableIndexHeaderSize * static_cast<int64>(sizeof(int64)) ||
+      size % sizeof(int64) != 0) {
+    KALDI_WARN << "File " << filename << " is not a table index "
+               << "(bad size " << size << ")";
+    return false;
+  }
+  const int64 *data;
+  if (mmap_.Open(filename, 0, size)) {
+    data = reinterpret_cast<const int64*>(mmap_.Data());
+  } else {
+    // Memory-mapping is not supported (e.g. on Windows), so read the file.
+    data_.resize(size / sizeof(int64));
+    is.read(reinterpret_cast<char*>(data_.data()), size);
+    if (!is.good()) {
+      KALDI_WARN << "Error reading table index " << filename;
+      data_.clear();
+      return false;
+    }
+    data = data_.data();
+  }
+  if (std::memcmp(data, kTableIndexMagic, sizeof(int64)) != 0) {
+    KALDI_WARN << "File " << filename << " is not a table index.";
+    Close();
+    return false;
+  }
+  int64 version = data[1];
+  if (version != 1) {
+    KALDI_WARN << "Table index " << filename << " has version " << version
+               << ", which this version of the code cannot read.";
+    Close();
+    return false;
+  }
+  int64 num_entries = data[2], num_files = data[3], strings_size = data[4];
+  if (num_entries < 0 || num_files < 0 || strings_size < 0 ||
+      static_cast<int64>(sizeof(int64)) *
+      (kTableIndexHeaderSize + 3 * num_entries + num_files) + strings_size
+      > size || (strings_size > 0 &&
+                 reinterpret_cast<const char*>(data)[size - 1] != '\0')) {
+    KALDI_WARN << "Table index " << filename << " is corrupted.";
+    Close();
+    return false;
+  }
+  num_entries_ = num_entries;
+  num_files_ = num_files;
+  entries_ = data + kTableIndexHeaderSize;
+  files_ = entries_ + 3 * num_entries;
+  strings_ = reinterpret_cast<const char*>(files_ + num_files);
+  strings_size_ = strings_size;
+  return true;
+}
+
+void TableIndex::Close() {
+  mmap_.Close();
+  data_.clear();
+  num_entries_ = 0;
+  num_files_ = 0;
+  entries_ = NULL;
+  files_ = NULL;
+  strings_ = NULL;
+  strings_size_ = 0;
+}
+
+std::string TableIndex::Rxfilename(int64 i) const {
+  std::ostringstream ss;
+  ss << Filename(i) << ':' << Offset(i);
+  return ss.str();
+}
+
+int64 TableIndex::Find(const std::string &key) const {
+  const char *k = key.c_str();
+  int64 lo = 0, hi = num_entries_;
+  while (lo < hi) {
+    int64 mid = lo + (hi - lo) / 2;
+    int c = std::strcmp(Key(mid), k);
+    if (c == 0)
+      return mid;
+    else if (c < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return -1;
+}
+
+
+void TableIndexWriter::AddEntry(const std::string &key,
+                                const std::string &filename,
+                                int64 offset) {
+  KALDI_ASSERT(IsToken(key) && offset >= 0);
+  std::unordered_map<std::string, int64>::iterator iter =
+      file_to_index_.find(filename);
+  int64 file_index;
+  if (iter != file_to_index_.end()) {
+    file_index = iter->second;
+  } else {
+    file_index = files_.size();
+    files_.push_back(filename);
+    file_to_index_[filename] = file_index;
+  }
+  Entry entry;
+  entry.key = key;
+  entry.file_index = file_index;
+  entry.offset = offset;
+  entries_.push_back(entry);
+}
+
+bool TableIndexWriter::AddScriptEntry(const std::string &key,
+                                      const std::string &rxfilename) {
+  size_t pos = rxfilename.find_last_of(':');
+  int64 offset;
+  if (rxfilename.empty() || rxfilename[rxfilename.size() - 1] == ']' ||
+      ClassifyRxfilename(rxfilename) != kOffsetFileInput ||
+      pos == std::string::npos ||
+      !ConvertStringToInteger(rxfilename.substr(pos + 1), &offset)) {
+    KALDI_WARN << "Cannot index the entry '" << key << ' ' << rxfilename
+               << "': expected an offset into an archive, like foo.ark:1234";
+    return false;
+  }
+  AddEntry(key, rxfilename.substr(0, pos), offset);
+  return true;
+}
+
+// Writes 'size' int64's from 'data' to 'os'.
+static void WriteInt64s(const int64 *data, size_t size, std::ostream &os) {
+  if (size != 0)
+    os.write(reinterpret_cast<const char*>(data), sizeof(int64) * size);
+}
+
+bool TableIndexWriter::Write(const std::string &wxfilename) {
+  std::sort(entries_.begin(), entries_.end());
+  for (size_t i = 0; i + 1 < entries_.size(); i++) {
+    if (entries_[i].key == entries_[i + 1].key) {
+      KALDI_WARN << "Duplicate key " << entries_[i].key
+                 << " in table index.";
+      return false;
+    }
+  }
+
+  std::string strings;
+  std::vector<int64> entry_data(3 * entries_.size()),
+      file_offsets(files_.size());
+  for (size_t i = 0; i < entries_.size(); i++) {
+    entry_data[3 * i] = strings.size();
+    entry_data[3 * i + 1] = entries_[i].file_index;
+    entry_data[3 * i + 2] = entries_[i].offset;
+    strings.append(entries_[i].key);
+    strings.push_back('\0');
+  }
+  for (size_t f = 0; f < files_.size(); f++) {
+    file_offsets[f] = strings.size();
+    strings.append(files_[f]);
+    strings.push_back('\0');
+  }
+  // Pad the strings so the file size is a multiple of sizeof(int64); the
+  // padding is with NULs, so the last byte is always NUL.
+  while (strings.size() % sizeof(int64) != 0)
+    strings.push_back('\0');
+
+  int64 header[kTableIndexHeaderSize];
+  std::memcpy(header, kTableIndexMagic, sizeof(int64));
+  header[1] = 1;  // version
+  header[2] = entries_.size();
+  header[3] = files_.size();
+  header[4] = strings.size();
+
+  Output ko;
+  if (!ko.Open(wxfilename, true, false)) {
+    KALDI_WARN << "Could not open " << PrintableWxfilename(wxfilename)
+               << " to write table index.";
+    return false;
+  }
+  std::ostream &os = ko.Stream();
+  WriteInt64s(header, kTableIndexHeaderSize, os);
+  WriteInt64s(entry_data.data(), entry_data.size(), os);
+  WriteInt64s(file_offsets.data(), file_offsets.size(), os);
+  os.write(strings.data(), strings.size());
+  if (!os.good()) {
+    KALDI_WARN << "Error writing table index to "
+               << PrintableWxfilename(wxfilename);
+    return false;
+  }
+  return ko.Close();
+}
+
+}  // namespace kaldi
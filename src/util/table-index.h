@@ -0,0 +1,214 @@
+// util/table-index.h
+
+// Copyright 2026  Kaldi contributors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_TABLE_INDEX_H_
+#define KALDI_UTIL_TABLE_INDEX_H_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
+
+namespace kaldi {
+
+/**
+   A table index is a file that maps the keys of a table to byte offsets in
+   one or more archives (i.e. it contains the same information as an scp file
+   with lines like "key foo.ark:12407"), stored as a sorted binary array so
+   that it can be memory-mapped and searched by binary search without reading
+   it into memory.  It is read by RandomAccessTableReader and
+   SequentialTableReader given an rspecifier of the form "idx:foo.idx", and is
+   created by the program build-table-index, either from an scp file or by
+   scanning an existing archive.
+
+   Compared with reading the same table as "scp:foo.scp", opening the table is
+   nearly free (no matter how many keys it has), and the memory used is only
+   that of the pages of the index that are accessed.  The archives themselves
+   are read with the normal Kaldi I/O code, keeping the archive open between
+   consecutive lookups in the same archive.
+
+   The format is as follows; all integers are int64 in the machine's native
+   byte order, so index files are not portable between machines of different
+   endianness:
+
+     "KaldiIdx"                   [8 bytes]
+     version (currently 1), num-entries, num-files, strings-size
+     num-entries x (key-offset, file-index, byte-offset), sorted on key
+     num-files x filename-offset
+     strings-size bytes of NUL-terminated strings (the keys and filenames)
+
+   where key-offset and filename-offset are offsets into the strings.  The
+   filenames are those of the archives, and, as with scp files, relative
+   filenames are interpreted relative to the current directory of the program
+   that reads the index, not the location of the index.
+*/
+class TableIndex {
+ public:
+  TableIndex(): num_entries_(0), num_files_(0), entries_(NULL), files_(NULL),
+                strings_(NULL), strings_size_(0) { }
+
+  /// Opens the index in the file 'filename', which must be a plain file (not
+  /// an rxfilename such as a pipe), memory-mapping it if possible and reading
+  /// it into memory otherwise.  Returns true on success; on failure it prints
+  /// a warning and returns false.
+  bool Open(const std::string &filename);
+
+  void Close();
+
+  bool IsOpen() const { return entries_ != NULL; }
+
+  int64 NumEntries() const { return num_entries_; }
+
+  /// Returns the key of entry i; the entries are sorted on key.
+  const char *Key(int64 i) const {
+    KALDI_PARANOID_ASSERT(i >= 0 && i < num_entries_);
+    return String(entries_[3 * i]);
+  }
+
+  /// Returns the filename of the archive that entry i is in.
+  const char *Filename(int64 i) const {
+    KALDI_PARANOID_ASSERT(i >= 0 && i < num_entries_);
+    int64 f = entries_[3 * i + 1];
+    KALDI_ASSERT(f >= 0 && f < num_files_);
+    return String(files_[f]);
+  }
+
+  /// Returns the byte offset of the object of entry i in its archive.
+  int64 Offset(int64 i) const {
+    KALDI_PARANOID_ASSERT(i >= 0 && i < num_entries_);
+    return entries_[3 * i + 2];
+  }
+
+  /// Returns the rxfilename from which the object of entry i can be read,
+  /// e.g. "foo.ark:12407" (as it would appear in an scp file).
+  std::string Rxfilename(int64 i) const;
+
+  /// Returns the index of the entry with key 'key', or -1 if there is no such
+  /// entry.  Uses binary search.
+  int64 Find(const std::string &key) const;
+
+ private:
+  const char *String(int64 offset) const {
+    KALDI_ASSERT(offset >= 0 && offset < strings_size_);
+    return strings_ + offset;
+  }
+
+  MemoryMappedFile mmap_;
+  // Holds the contents of the file if we could not memory-map it.
+  std::vector<int64> data_;
+
+  int64 num_entries_;
+  int64 num_files_;
+  const int64 *entries_;
+  const int64 *files_;
+  const char *strings_;
+  int64 strings_size_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TableIndex);
+};
+
+
+/// Class TableIndexWriter collects the entries of a table index and writes it
+/// in the format that TableIndex reads.
+class TableIndexWriter {
+ public:
+  /// Adds an entry saying that the object for 'key' starts at byte 'offset'
+  /// of the archive 'filename', which must be a plain file.
+  void AddEntry(const std::string &key, const std::string &filename,
+                int64 offset);
+
+  /// Adds an entry from a line of an scp file, whose rxfilename must be an
+  /// offset into an archive such as "foo.ark:12407" (object ranges such as
+  /// "foo.ark:12407[0:9]" are not supported).  Returns false and prints a
+  /// warning if the rxfilename is not of this form.
+  bool AddScriptEntry(const std::string &key, const std::string &rxfilename);
+
+  int64 NumEntries() const { return entries_.size(); }
+
+  /// Sorts the entries and writes the index to 'wxfilename'.  Returns false
+  /// and prints a warning if there were duplicate keys or there was an error
+  /// writing.
+  bool Write(const std::string &wxfilename);
+
+ private:
+  struct Entry {
+    std::string key;
+    int64 file_index;
+    int64 offset;
+    bool operator < (const Entry &other) const { return key < other.key; }
+  };
+  std::vector<Entry> entries_;
+  std::vector<std::string> files_;
+  std::unordered_map<std::string, int64> file_to_index_;
+};
+
+
+/// Scans the archive in the file 'archive_filename' (which must be a plain
+/// file, so that byte offsets are meaningful), reading each object with
+/// Holder, and adds an entry for each of its keys to 'writer'.  Returns the
+/// number of entries added, or -1 if there was an error reading the archive.
+template<class Holder>
+int64 AddArchiveToTableIndex(const std::string &archive_filename,
+                             TableIndexWriter *writer) {
+  if (ClassifyRxfilename(archive_filename) != kFileInput) {
+    KALDI_WARN << "Cannot index " << PrintableRxfilename(archive_filename)
+               << ": archive must be a plain file.";
+    return -1;
+  }
+  Input input;
+  if (!input.Open(archive_filename)) {
+    KALDI_WARN << "Failed to open archive " << archive_filename;
+    return -1;
+  }
+  std::istream &is = input.Stream();
+  Holder holder;
+  int64 num_entries = 0;
+  std::string key;
+  while (is >> key) {
+    // The format is as in SequentialTableReaderArchiveImpl::Next().
+    int c = is.peek();
+    if (c != ' ' && c != '\t' && c != '\n') {
+      KALDI_WARN << "Invalid archive file format: expected space after key "
+                 << key << ", reading " << archive_filename;
+      return -1;
+    }
+    if (c != '\n') is.get();
+    int64 offset = is.tellg();
+    if (!holder.Read(is)) {
+      KALDI_WARN << "Object read failed for key " << key
+                 << ", reading archive " << archive_filename;
+      return -1;
+    }
+    writer->AddEntry(key, archive_filename, offset);
+    num_entries++;
+  }
+  if (!is.eof()) {
+    KALDI_WARN << "Error reading archive " << archive_filename;
+    return -1;
+  }
+  return num_entries;
+}
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_TABLE_INDEX_H_